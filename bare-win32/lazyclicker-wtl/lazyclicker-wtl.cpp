@@ -6,10 +6,13 @@
 #include <atlctrls.h>
 #include "resource.h"
 #include "windowops.h"
+#include "registrysettings.h"
+#include "engine/logger.h"
 
 #define WM_TRAYICON (WM_USER + 1)
 #define WM_SLIDER_CHANGE (WM_USER + 2)
 #define WM_CHECKBOX_CHANGE (WM_USER + 3)
+#define WM_ARRANGE_DONE (WM_USER + 4)
 
 CAppModule _Module;
 constexpr TCHAR settingsKey[] = _T("Software\\qduaty\\lazyclicker\\Preferences");
@@ -70,7 +73,7 @@ private:
 class CMainWnd : public CWindowImpl<CMainWnd>
 {
 public:
-    CMainWnd() : settingsDlg(this) {}
+    CMainWnd() : settingsBackend(settingsKey), settings(settingsBackend, settingsClock), settingsDlg(this) {}
     DECLARE_WND_CLASS(nullptr)
 
     BEGIN_MSG_MAP(CMainWnd)
@@ -78,58 +81,75 @@ public:
         MESSAGE_HANDLER(WM_TRAYICON, OnTrayIcon)
         MESSAGE_HANDLER(WM_COMMAND, OnCommand)
         MESSAGE_HANDLER(WM_DESTROY, OnDestroy)
-        MESSAGE_HANDLER(WM_TIMER, OnTimer)
         MESSAGE_HANDLER(WM_SLIDER_CHANGE, OnSliderChange)
         MESSAGE_HANDLER(WM_CHECKBOX_CHANGE, OnCheckboxChange)
+        MESSAGE_HANDLER(WM_ARRANGE_DONE, OnArrangeDone)
+        MESSAGE_HANDLER(WM_TIMER, OnTimer)
     END_MSG_MAP()
 
-    LRESULT OnTimer(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/, BOOL const& /*bHandled*/) const
-    {
-        if (m_bAutoArrange)
-            arrangeAllWindows();
-        return 0;
-    }
-
-    LRESULT OnSliderChange(UINT /*uMsg*/, WPARAM wParam, LPARAM /*lParam*/, BOOL const& /*bHandled*/) const
+    LRESULT OnSliderChange(UINT /*uMsg*/, WPARAM wParam, LPARAM /*lParam*/, BOOL const& /*bHandled*/)
     {
-        windowops_maxIncrease = static_cast<int>(wParam);
-        writeRegistryValue<DWORD, REG_DWORD>(settingsKey, L"allowedIncrease", windowops_maxIncrease);
-        arrangeAllWindows();
+        auto layout = layoutSettings();
+        layout.maxIncrease = static_cast<int>(wParam);
+        applyLayoutSettings(layout);
         return 0;
     }
 
-    LRESULT OnCheckboxChange(UINT /*uMsg*/, WPARAM wParam, LPARAM /*lParam*/, BOOL const& /*bHandled*/) const
+    LRESULT OnCheckboxChange(UINT /*uMsg*/, WPARAM wParam, LPARAM /*lParam*/, BOOL const& /*bHandled*/)
     {
+        auto layout = layoutSettings();
         switch (auto wId = static_cast<WORD>(wParam >> 16)) 
         {
         case IDC_CHECK_AVOID_TOPRIGHT_CORNER:
-            avoidTopRightCorner = static_cast<bool>(wParam & 0x01);
-            writeRegistryValue<DWORD, REG_DWORD>(settingsKey, L"avoidTopRightCorner", avoidTopRightCorner);
+            layout.avoidTopRightCorner = static_cast<bool>(wParam & 0x01);
             break;
         case IDC_CHECK_INCREASE_UNIT_FOR_TOUCH:
-            increaseUnitSizeForTouch = static_cast<bool>(wParam & 0x01);
-            writeRegistryValue<DWORD, REG_DWORD>(settingsKey, L"increaseUnitSizeForTouch", increaseUnitSizeForTouch);
+            layout.increaseUnitSizeForTouch = static_cast<bool>(wParam & 0x01);
             break;
         default:
             break;
         }
-        arrangeAllWindows();
+        applyLayoutSettings(layout);
         return 0;
     }
 
-    LRESULT OnCreate(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/, BOOL& /*bHandled*/)
+    LRESULT OnTimer(UINT /*uMsg*/, WPARAM wParam, LPARAM /*lParam*/, BOOL& bHandled)
+    {
+        if (wParam != settingsFlushTimer)
+        {
+            bHandled = FALSE;
+            return 0;
+        }
+        KillTimer(settingsFlushTimer);
+        settings.poll();
+        scheduleSettingsFlush();
+        return 0;
+    }
+
+    LRESULT OnArrangeDone(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM lParam, BOOL const& /*bHandled*/)
     {
-        SetTimer(1, 1000);
+        if (lParam & arrangeToggledMinimize)
+        {
+            m_bWindowsMinimized = (lParam & arrangeMinimized) != 0;
+            logger().debug("windows {} {} ms after the click", m_bWindowsMinimized ? "minimized" : "restored", lParam >> arrangeLatencyShift);
+        }
+        return 0;
+    }
 
+    LRESULT OnCreate(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/, BOOL& /*bHandled*/)
+    {
         auto hInstance = HINSTANCE(GetWindowLongPtr(GWLP_HINSTANCE));
-        m_bAutoArrange = readRegistryValue<wstring, REG_SZ>(settingsKey, L"actionAuto_arrange_windows") == L"true";
+        settings.load();
+        m_bAutoArrange = settings.get(preferences::autoArrange);
         updateTrayIcon(true);
-        windowops_maxIncrease = readRegistryValue<DWORD, REG_DWORD>(settingsKey, L"allowedIncrease").value_or(0);
-        settingsDlg.allowedIncrease = windowops_maxIncrease;
-        avoidTopRightCorner = readRegistryValue<DWORD, REG_DWORD>(settingsKey, L"avoidTopRightCorner").value_or(0);
-        settingsDlg.avoidTopRightCorner = avoidTopRightCorner;
-        increaseUnitSizeForTouch = readRegistryValue<DWORD, REG_DWORD>(settingsKey, L"increaseUnitSizeForTouch").value_or(0);
-        settingsDlg.increaseUnitSizeForTouch = increaseUnitSizeForTouch;
+        auto layout = preferences::layoutSettings(settings);
+        settingsDlg.allowedIncrease = layout.maxIncrease;
+        settingsDlg.avoidTopRightCorner = layout.avoidTopRightCorner;
+        settingsDlg.increaseUnitSizeForTouch = layout.increaseUnitSizeForTouch;
+        setLayoutSettings(layout, false);
+        setWindowRules(string_view(settings.get(preferences::windowRules)));
+        setArrangeNotification(m_hWnd, WM_ARRANGE_DONE);
+        if (m_bAutoArrange) setAutoArrange(true);
         TCHAR processName[MAX_PATH] = { 0 };
         if (GetModuleFileName(hInstance, processName, MAX_PATH))
             writeRegistryValue<wstring_view, REG_SZ>(startupKey, L"lazyclicker", processName);
@@ -152,10 +172,11 @@ public:
                 CMenu menu;
                 menu.CreatePopupMenu();
                 menu.AppendMenu(MF_STRING | (m_bAutoArrange ? MF_CHECKED : 0), ID_TRAYMENU_OPTION_AUTO_ARRANGE, _T("Auto arrange windows"));
-                if(!m_bAutoArrange) menu.AppendMenu(MF_STRING, ID_TRAYMENU_TOGGLE_MINIMIZE_ALL, _T("Toggle minimize all windows"));
+                if(!m_bAutoArrange) menu.AppendMenu(MF_STRING | (m_bWindowsMinimized ? MF_CHECKED : 0), ID_TRAYMENU_TOGGLE_MINIMIZE_ALL, _T("Toggle minimize all windows"));
                 menu.AppendMenu(MF_STRING, ID_TRAYMENU_OPTION_QUIT, _T("Quit"));
                 menu.AppendMenu(MF_STRING, ID_TRAYMENU_OPTION_QUIT_AND_UNREGISTER, _T("Uninstall"));
                 menu.AppendMenu(MF_STRING, ID_TRAYMENU_OPTION_RESET_WINDOWS, _T("Reset window positions"));
+                menu.AppendMenu(MF_STRING, ID_TRAYMENU_DUMP_STATISTICS, _T("Dump statistics"));
 
                 POINT pt;
                 GetCursorPos(&pt);
@@ -178,8 +199,10 @@ public:
         {
         case ID_TRAYMENU_OPTION_AUTO_ARRANGE:
             m_bAutoArrange = !m_bAutoArrange;
-            writeRegistryValue<wstring_view, REG_SZ>(settingsKey, L"actionAuto_arrange_windows", m_bAutoArrange ? L"true" : L"false");
+            settings.set(preferences::autoArrange, m_bAutoArrange != FALSE);
+            scheduleSettingsFlush();
             updateTrayIcon(false);
+            setAutoArrange(m_bAutoArrange);
             break;
         case ID_TRAYMENU_OPTION_QUIT:
             DestroyWindow();
@@ -188,10 +211,14 @@ public:
             quitAndUnregister();
             break;
         case ID_TRAYMENU_TOGGLE_MINIMIZE_ALL:
-            if(!toggleMinimizeAllWindows()) arrangeAllWindows(true); 
+            toggleMinimizeAllWindows();
             break;
 		case ID_TRAYMENU_OPTION_RESET_WINDOWS:
             arrangeAllWindows(true, true);
+            break;
+        case ID_TRAYMENU_DUMP_STATISTICS:
+            dumpMetrics();
+            break;
         default:
             break;
         }
@@ -207,11 +234,33 @@ public:
         nid.uID = 1;
         Shell_NotifyIcon(NIM_DELETE, &nid);
 
+        KillTimer(settingsFlushTimer);
+        settings.flush();
+        stopArranger();
         PostQuitMessage(0);
         return 0;
     }
 
 private:
+    /// <summary>
+    /// Publish the settings to the arranger now and write them to the registry a moment after the last change
+    /// </summary>
+    void applyLayoutSettings(const LayoutSettings& layout)
+    {
+        preferences::setLayoutSettings(settings, layout);
+        setLayoutSettings(layout);
+        scheduleSettingsFlush();
+    }
+
+    void scheduleSettingsFlush()
+    {
+        if (auto due = settings.flushDue())
+        {
+            auto delay = chrono::ceil<chrono::milliseconds>(*due - SteadyClock::now()).count();
+            SetTimer(settingsFlushTimer, UINT((std::max)(delay, decltype(delay)(0))));
+        }
+    }
+
     void updateTrayIcon(bool create)
     {
         //auto hMainIcon = LoadIcon(nullptr, (LPCTSTR)MAKEINTRESOURCE(IDI_LAZYCLICKER));
@@ -231,27 +280,50 @@ private:
     void quitAndUnregister()
     {
         deleteRegistryValue(startupKey, L"lazyclicker");
-        deleteRegistrySubkey(L"Software\\qduaty\\lazyclicker", L"Preferences");
+        KillTimer(settingsFlushTimer);
+        settings.clear();
         deleteRegistrySubkey(L"Software\\qduaty", L"lazyclicker");
         deleteRegistrySubkey(L"Software", L"qduaty");
         DestroyWindow();
     }
 
     BOOL m_bAutoArrange = FALSE;
+    bool m_bWindowsMinimized = false;
+    RegistrySettingsBackend settingsBackend;
+    SystemClock settingsClock;
+    SettingsStore settings;
     CSettingsDlg settingsDlg;
+    static constexpr UINT_PTR settingsFlushTimer = 1;
 
     enum { 
         ID_TRAYMENU_OPTION_AUTO_ARRANGE = 1001, 
         ID_TRAYMENU_OPTION_QUIT = 1002, 
         ID_TRAYMENU_OPTION_QUIT_AND_UNREGISTER = 1003,
         ID_TRAYMENU_TOGGLE_MINIMIZE_ALL = 1004,
-		ID_TRAYMENU_OPTION_RESET_WINDOWS = 1005
+		ID_TRAYMENU_OPTION_RESET_WINDOWS = 1005,
+        ID_TRAYMENU_DUMP_STATISTICS = 1006
     };
 };
 
+/// <summary>
+/// Value of a --name=value option, which ends at the next option, so paths may contain spaces
+/// </summary>
+static optional<wstring_view> commandLineOption(wstring_view commandLine, wstring_view name)
+{
+    auto pos = commandLine.find(name);
+    if (pos == wstring_view::npos || commandLine.substr(pos + name.size(), 1) != L"=") return nullopt;
+    auto value = commandLine.substr(pos + name.size() + 1);
+    value = value.substr(0, value.find(L" --"));
+    return value.substr(0, value.find_last_not_of(L' ') + 1);
+}
+
 int WINAPI _tWinMain(HINSTANCE hInstance, HINSTANCE /*hPrevInstance*/, LPTSTR lpCmdLine, int nCmdShow)
 {
-    if (lpCmdLine == wstring_view(L"--console")) CreateConsole();
+    wstring_view commandLine = lpCmdLine;
+    if (commandLine.find(L"--console") != wstring_view::npos) CreateConsole();
+    if (auto path = commandLineOption(commandLine, L"--log-file")) logger().setFile({ *path });
+    if (auto path = commandLineOption(commandLine, L"--metrics-file")) setMetricsFile(*path);
+    if (auto path = commandLineOption(commandLine, L"--record")) setRecordingFile(*path);
     _Module.Init(nullptr, hInstance);
 
     CMainWnd wnd;
@@ -0,0 +1,220 @@
+#include "animator.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/// fast at first and slowing down toward the target, t from 0 to 1
+static double easeOut(double t)
+{
+    double rest = 1 - t;
+    return 1 - rest * rest * rest;
+}
+
+static int32_t interpolate(int32_t from, int32_t to, double f)
+{
+    return int32_t(from + llround((double(to) - from) * f));
+}
+
+static Rect interpolate(const Rect& from, const Rect& to, double f)
+{
+    return { interpolate(from.left, to.left, f), interpolate(from.top, to.top, f), interpolate(from.right, to.right, f),
+             interpolate(from.bottom, to.bottom, f) };
+}
+
+MoveAnimator::Animation* MoveAnimator::find(WindowId w)
+{
+    auto it = ranges::lower_bound(animations, w, {}, windowOf);
+    return it == animations.end() || it->move.window != w ? nullptr : &*it;
+}
+
+const MoveAnimator::Animation* MoveAnimator::find(WindowId w) const
+{
+    auto it = ranges::lower_bound(animations, w, {}, windowOf);
+    return it == animations.end() || it->move.window != w ? nullptr : &*it;
+}
+
+MoveResult MoveAnimator::start(const MovePlan& plan)
+{
+    auto now = clock.now();
+    if (animations.empty())
+    {
+        // the windows are where they are for the current period, the first frame comes with the next one
+        frameOrigin = now;
+        due = now + options.frameInterval;
+        slowStreak = 0;
+    }
+    MoveResult result;
+    result.status.resize(plan.size(), MoveStatus::skipped);
+    // new animations are merged in at the end, so the windows animating already are found by binary search
+    started.clear();
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        auto const& move = plan[i];
+        auto current = backend.currentRect(move.window);
+        auto animation = find(move.window);
+        if (!current)
+        {
+            if (animation) cancel(move.window);
+            result.status[i] = MoveStatus::failed;
+            result.failed++;
+            continue;
+        }
+        if (animation)
+        {
+            if (animation->move.rect != move.rect)
+            {
+                // on from where the last frame left it, taking the whole duration again
+                *animation = { move, animation->last, animation->last, animation->previous, now };
+                statistics.retargets++;
+            }
+            else animation->move = move;
+        }
+        else if (*current != move.rect) started.push_back({ move, *current, *current, *current, now });
+        else
+        {
+            result.skipped++;
+            continue;
+        }
+        result.status[i] = MoveStatus::moved;
+        result.committed++;
+    }
+    if (!started.empty())
+    {
+        // a window given twice heads for its last target
+        ranges::stable_sort(started, {}, windowOf);
+        auto last = unique(started.rbegin(), started.rend(), [](auto& a, auto& b) { return a.move.window == b.move.window; });
+        started.erase(started.begin(), last.base());
+        statistics.animations += started.size();
+        auto middle = animations.insert(animations.end(), started.begin(), started.end());
+        ranges::inplace_merge(animations, middle, {}, windowOf);
+    }
+    return result;
+}
+
+bool MoveAnimator::commit(vector<WindowMove>& moves)
+{
+    // posted, so a window slow to repaint holds up neither the other windows nor the arranger
+    if (moves.size() > 1 && backend.postBatch(moves)) return true;
+    // windows which refuse to move stop animating
+    bool all = true;
+    for (auto const& move : moves)
+        if (!backend.postMove(move))
+        {
+            cancel(move.window);
+            statistics.cancellations++;
+            all = false;
+        }
+    return all;
+}
+
+void MoveAnimator::frame()
+{
+    auto now = clock.now();
+    // windows closed or dragged away since the last frame are left alone, windows still where the frame before
+    // put them are behind; only the position is compared, because windows may keep a size of their own
+    size_t behind = 0;
+    erase_if(animations, [&](const Animation& a)
+    {
+        auto current = backend.currentRect(a.move.window);
+        auto at = [&](const Rect& r) { return current && current->left == r.left && current->top == r.top; };
+        if (at(a.last)) return false;
+        if (at(a.previous))
+        {
+            behind++;
+            return false;
+        }
+        statistics.cancellations++;
+        return true;
+    });
+    if (animations.empty()) return;
+
+    // a frame the windows cannot take yet would only pile up behind the previous one
+    bool posted = false;
+    if (!behind)
+    {
+        frameMoves.clear();
+        for (auto& a : animations)
+        {
+            double t = (std::min)(1.0, chrono::duration<double>(now - a.start) / chrono::duration<double>(options.duration));
+            frameMoves.push_back(a.move);
+            if (t < 1) frameMoves.back().rect = interpolate(a.from, a.move.rect, easeOut(t));
+        }
+        // a frame which used up its budget before it was posted would come late, the next one is posted instead
+        if (clock.now() - now <= options.frameBudget)
+        {
+            for (size_t i = 0; i < animations.size(); i++)
+            {
+                animations[i].previous = animations[i].last;
+                animations[i].last = frameMoves[i].rect;
+            }
+            commit(frameMoves);
+            statistics.frames++;
+            posted = true;
+        }
+    }
+    auto end = clock.now();
+    auto elapsed = end - now;
+    statistics.maxFrameTime = (std::max)(statistics.maxFrameTime, elapsed);
+    // windows at their targets are done, whether or not they took the last frame yet
+    erase_if(animations, [](const Animation& a) { return a.last == a.move.rect; });
+
+    if (behind || elapsed > options.frameBudget)
+    {
+        statistics.slowFrames++;
+        if (++slowStreak >= options.slowFrameLimit && !animations.empty())
+        {
+            statistics.jumps += animations.size();
+            finish();
+            return;
+        }
+    }
+    else slowStreak = 0;
+
+    // periods which passed before the frame started or while it was prepared and posted get no frame of their own,
+    // neither does a frame which was not posted
+    auto period = [&](TimePoint t) { return (t - frameOrigin) / options.frameInterval; };
+    auto expected = period(due);
+    auto drawn = period(now);
+    auto next = period(end) + 1;
+    statistics.droppedFrames += size_t((std::max)(decltype(drawn)(0), drawn - expected) + (next - drawn - 1) + (posted ? 0 : 1));
+    due = frameOrigin + next * options.frameInterval;
+}
+
+optional<TimePoint> MoveAnimator::nextFrame() const
+{
+    if (animations.empty()) return nullopt;
+    return due;
+}
+
+bool MoveAnimator::run(const function<bool()>& interrupt)
+{
+    while (auto next = nextFrame())
+    {
+        if (interrupt && interrupt()) return false;
+        clock.sleepUntil(*next);
+        frame();
+    }
+    return true;
+}
+
+void MoveAnimator::finish()
+{
+    frameMoves.clear();
+    for (auto const& a : animations) frameMoves.push_back(a.move);
+    animations.clear();
+    slowStreak = 0;
+    if (!frameMoves.empty()) commit(frameMoves);
+}
+
+void MoveAnimator::cancel(WindowId w)
+{
+    if (auto a = find(w)) animations.erase(animations.begin() + (a - animations.data()));
+}
+
+optional<Rect> MoveAnimator::target(WindowId w) const
+{
+    auto a = find(w);
+    if (!a) return nullopt;
+    return a->move.rect;
+}
@@ -0,0 +1,97 @@
+#ifndef ANIMATOR_H
+#define ANIMATOR_H
+#include "moveexecutor.h"
+#include <functional>
+
+/// <summary>
+/// Moves windows to their targets in frames instead of one jump, so the eye can follow them. Every frame posts all
+/// animating windows as one transaction without waiting for their threads; frames are due at whole refresh periods from
+/// the start of the animation, and a frame which comes late skips the periods it missed instead of slowing the animation
+/// down. A frame is slow when the windows have not taken the previous one yet, because they are slow to repaint, or when
+/// it takes longer than the frame budget; a frame which used up the budget before it was posted is not posted at all.
+/// After a few slow frames the remaining windows jump to their targets.
+/// </summary>
+class MoveAnimator
+{
+public:
+    struct Options
+    {
+        Duration duration = std::chrono::milliseconds(200);
+        Duration frameInterval = std::chrono::microseconds(16667); ///< refresh period of the display
+        Duration frameBudget = std::chrono::milliseconds(4);      ///< time a frame may take, from reading the windows to posting
+        int slowFrameLimit = 2; ///< consecutive slow frames before the windows jump
+    };
+
+    struct Stats
+    {
+        size_t animations = 0;    ///< windows started
+        size_t frames = 0;
+        size_t droppedFrames = 0; ///< refresh periods which passed without a frame
+        size_t slowFrames = 0;    ///< frames over budget or behind the windows
+        size_t jumps = 0;         ///< animations given up for slow frames
+        size_t retargets = 0;     ///< windows given a new target while animating
+        size_t cancellations = 0; ///< windows moved by somebody else or closed while animating
+        Duration maxFrameTime{};  ///< on the clock of the animator
+    };
+
+    MoveAnimator(WindowMoveBackend& backend, Clock& clock) : MoveAnimator(backend, clock, Options()) {}
+    MoveAnimator(WindowMoveBackend& backend, Clock& clock, Options options) : backend(backend), clock(clock), options(options) {}
+
+    /// <summary>
+    /// Start moving the windows of the plan from where they are. Windows which are animating already head for their
+    /// new targets from their current positions; the others keep their targets.
+    /// </summary>
+    /// <returns>moved for every animating window, skipped for windows at their targets, failed for closed ones</returns>
+    MoveResult start(const MovePlan& plan);
+    /// <summary>
+    /// Post the positions of all animating windows for the current time, the last frame puts them at their targets.
+    /// While a window has not taken the previous frame yet, the frame is skipped as a slow one.
+    /// </summary>
+    void frame();
+    /// <returns>when the next frame is due, nothing when no window is animating</returns>
+    std::optional<TimePoint> nextFrame() const;
+    /// <summary>
+    /// Post frames on time until every window arrived or interrupt returns true, e.g. because a new pass is waiting
+    /// </summary>
+    /// <returns>all animations finished</returns>
+    bool run(const std::function<bool()>& interrupt = {});
+    /// post the animating windows to their targets at once
+    void finish();
+    /// stop animating the window where it is
+    void cancel(WindowId w);
+    bool active() const { return !animations.empty(); }
+    /// <returns>the rect the window is heading for, nothing when it is not animating</returns>
+    std::optional<Rect> target(WindowId w) const;
+    void setOptions(const Options& o) { options = o; }
+    const Options& currentOptions() const { return options; }
+    const Stats& stats() const { return statistics; }
+
+private:
+    struct Animation
+    {
+        WindowMove move; ///< rect is the target
+        Rect from;
+        Rect last;       ///< posted by the previous frame
+        Rect previous;   ///< posted by the frame before, where the window is until it takes the last one
+        TimePoint start;
+    };
+
+    static WindowId windowOf(const Animation& a) { return a.move.window; }
+    Animation* find(WindowId w);
+    const Animation* find(WindowId w) const;
+    /// <returns>the windows accepted the moves</returns>
+    bool commit(std::vector<WindowMove>& moves);
+
+    WindowMoveBackend& backend;
+    Clock& clock;
+    Options options;
+    std::vector<Animation> animations; ///< sorted by window
+    std::vector<Animation> started;    ///< by start, reused
+    std::vector<WindowMove> frameMoves; ///< reused by every frame
+    TimePoint frameOrigin; ///< frames are due at whole intervals from here
+    TimePoint due;
+    int slowStreak = 0;
+    Stats statistics;
+};
+
+#endif // ANIMATOR_H
@@ -0,0 +1,124 @@
+#include "arrangequeue.h"
+
+using namespace std;
+
+uint64_t ArrangeQueue::post(ArrangeCommand command, const LayoutSettings& settings, bool byUser)
+{
+    uint64_t ticket;
+    auto now = SteadyClock::now();
+    {
+        lock_guard lock(mutex);
+        ticket = ++lastTicket;
+        statistics.posted++;
+        bool toggle = command == ArrangeCommand::toggleMinimize;
+        if (!queue.empty() && queue.back().toggleMinimize == toggle)
+        {
+            auto& back = queue.back();
+            back.ticket = ticket;
+            back.commands++;
+            back.settings = settings;
+            if (byUser && !back.userRequested) back.userRequested = now;
+            statistics.collapsed++;
+            if (toggle)
+            {
+                // minimizing and restoring the same windows changes nothing; the previous work still reports
+                // completion of its tickets when it is done, so an empty pass takes its place
+                back = { false, false, false, settings, {}, false, ticket, back.commands, back.requested, back.userRequested };
+            }
+            else
+            {
+                back.force |= command != ArrangeCommand::arrange;
+                back.reset |= command == ArrangeCommand::reset;
+            }
+        }
+        else
+        {
+            ArrangeWork& work = queue.emplace_back();
+            work.toggleMinimize = toggle;
+            work.force = command == ArrangeCommand::force || command == ArrangeCommand::reset || command == ArrangeCommand::settingsChanged;
+            work.reset = command == ArrangeCommand::reset;
+            work.settings = settings;
+            work.ticket = ticket;
+            work.commands = 1;
+            work.requested = now;
+            if (byUser) work.userRequested = now;
+        }
+    }
+    available.notify_one();
+    return ticket;
+}
+
+void ArrangeQueue::postEvent(const WindowEvent& event)
+{
+    lock_guard lock(mutex);
+    if (events.size() < maxEvents) events.push_back(event);
+    else eventsLost = true;
+}
+
+optional<ArrangeWork> ArrangeQueue::take()
+{
+    unique_lock lock(mutex);
+    available.wait(lock, [this] { return closed || !queue.empty(); });
+    return takeLocked();
+}
+
+optional<ArrangeWork> ArrangeQueue::tryTake()
+{
+    lock_guard lock(mutex);
+    return takeLocked();
+}
+
+optional<ArrangeWork> ArrangeQueue::takeLocked()
+{
+    if (closed || queue.empty()) return nullopt;
+    auto work = move(queue.front());
+    queue.pop_front();
+    work.events = move(events);
+    work.eventsLost = eventsLost;
+    events.clear();
+    eventsLost = false;
+    statistics.taken++;
+    return work;
+}
+
+void ArrangeQueue::close()
+{
+    {
+        lock_guard lock(mutex);
+        closed = true;
+        queue.clear();
+    }
+    available.notify_all();
+}
+
+size_t ArrangeQueue::size() const
+{
+    lock_guard lock(mutex);
+    return queue.size();
+}
+
+ArrangeQueue::Stats ArrangeQueue::stats() const
+{
+    lock_guard lock(mutex);
+    return statistics;
+}
+
+ArrangeWorker::ArrangeWorker(ArrangeQueue& queue, Execute execute, Notify notify) : queue(queue)
+{
+    thread = std::thread([&queue, execute = move(execute), notify = move(notify)]
+    {
+        while (auto work = queue.take())
+        {
+            auto completion = execute(*work);
+            completion.ticket = work->ticket;
+            completion.toggleMinimize = work->toggleMinimize;
+            if (notify) notify(completion);
+        }
+    });
+}
+
+void ArrangeWorker::stop()
+{
+    queue.close();
+    if (thread.joinable()) thread.join();
+}
@@ -0,0 +1,115 @@
+#ifndef ARRANGEQUEUE_H
+#define ARRANGEQUEUE_H
+#include "eventcoalescer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+enum class ArrangeCommand
+{
+    arrange,
+    force,           ///< arrange even if the desktop did not change
+    reset,           ///< arrange, then move the windows to the top-left corners of their monitors
+    toggleMinimize,  ///< minimize all windows, or restore the ones minimized before and arrange them
+    settingsChanged, ///< arrange with the new settings
+};
+
+/// <summary>
+/// The next thing the arranger does, merged from the commands queued since it last looked
+/// </summary>
+struct ArrangeWork
+{
+    bool toggleMinimize = false; ///< otherwise a pass
+    bool force = false;
+    bool reset = false;
+    LayoutSettings settings;     ///< the latest posted
+    std::vector<WindowEvent> events; ///< to apply to the caches first, in order
+    bool eventsLost = false;     ///< too many events were queued, the caches have to be invalidated
+    std::uint64_t ticket = 0;    ///< the last command covered by this work
+    size_t commands = 0;         ///< commands merged into this work
+    TimePoint requested;         ///< when the first of them was posted
+    std::optional<TimePoint> userRequested; ///< when the first of them a user asked for was posted, none for timers and events
+};
+
+/// <summary>
+/// Commands for the arranger thread. Adjacent passes collapse into one with the strongest flags,
+/// two adjacent minimize toggles cancel out. Window events wait for the next work item,
+/// so they are applied on the arranger thread without locking its caches.
+/// </summary>
+class ArrangeQueue
+{
+public:
+    struct Stats
+    {
+        size_t posted = 0;
+        size_t collapsed = 0; ///< commands merged into an earlier queued one
+        size_t taken = 0;
+    };
+
+    explicit ArrangeQueue(size_t maxEvents = 4096) : maxEvents(maxEvents) {}
+
+    /// <param name="byUser">a tray click, settings change or API call rather than a timer or window events</param>
+    /// <returns>ticket of the command, reported back when the work covering it completes</returns>
+    std::uint64_t post(ArrangeCommand command, const LayoutSettings& settings, bool byUser = true);
+    void postEvent(const WindowEvent& event);
+    /// <summary>
+    /// Wait for work
+    /// </summary>
+    /// <returns>nothing once closed</returns>
+    std::optional<ArrangeWork> take();
+    std::optional<ArrangeWork> tryTake();
+    /// wake the arranger and let it finish, queued work is dropped
+    void close();
+    size_t size() const;
+    Stats stats() const;
+
+private:
+    std::optional<ArrangeWork> takeLocked();
+
+    mutable std::mutex mutex;
+    std::condition_variable available;
+    std::deque<ArrangeWork> queue;
+    std::vector<WindowEvent> events;
+    bool eventsLost = false;
+    size_t maxEvents;
+    std::uint64_t lastTicket = 0;
+    bool closed = false;
+    Stats statistics;
+};
+
+struct ArrangeCompletion
+{
+    std::uint64_t ticket = 0; ///< the last command covered
+    bool toggleMinimize = false;
+    bool minimized = false;   ///< windows are minimized after a toggle
+    Duration latency{};       ///< from the tray click to the last window minimized or restored by a toggle
+    size_t moved = 0;
+};
+
+/// <summary>
+/// Thread running the work of a queue and reporting every completion
+/// </summary>
+class ArrangeWorker
+{
+public:
+    using Execute = std::function<ArrangeCompletion(ArrangeWork&)>;
+    using Notify = std::function<void(const ArrangeCompletion&)>;
+
+    ArrangeWorker(ArrangeQueue& queue, Execute execute, Notify notify);
+    ~ArrangeWorker() { stop(); }
+    ArrangeWorker(const ArrangeWorker&) = delete;
+    ArrangeWorker& operator=(const ArrangeWorker&) = delete;
+
+    /// close the queue and wait for the current work to finish
+    void stop();
+
+private:
+    ArrangeQueue& queue;
+    std::thread thread;
+};
+
+#endif // ARRANGEQUEUE_H
@@ -0,0 +1,181 @@
+#include "bulkminimize.h"
+#include <algorithm>
+#include <unordered_set>
+
+using namespace std;
+
+vector<WindowId> BulkMinimizer::apply(const vector<WindowId>& windows, bool minimize, Result& result, vector<WindowId>& skipped)
+{
+    auto start = clock.now();
+    vector<WindowId> applied, pending;
+    for (auto w : windows)
+    {
+        auto state = backend.minimized(w);
+        if (!state)
+        {
+            result.failed++;
+            continue;
+        }
+        if (*state == minimize) continue;
+        // a hung window would take the whole timeout and then change whenever its thread wakes up
+        if (backend.isHung(w))
+        {
+            result.hung++;
+            skipped.push_back(w);
+            continue;
+        }
+        if (!backend.postShow(w, minimize))
+        {
+            result.failed++;
+            continue;
+        }
+        result.requested++;
+        applied.push_back(w);
+        pending.push_back(w);
+    }
+
+    auto deadline = start + options.timeout;
+    while (!pending.empty())
+    {
+        erase_if(pending, [&](WindowId w)
+        {
+            auto state = backend.minimized(w);
+            if (state && *state != minimize) return false;
+            if (state) result.completed++;
+            else result.failed++;
+            return true;
+        });
+        result.latency = clock.now() - start;
+        if (pending.empty() || clock.now() >= deadline) break;
+        clock.sleepUntil((std::min)(clock.now() + options.pollInterval, deadline));
+    }
+    result.timedOut = pending.size();
+    return applied;
+}
+
+BulkMinimizer::Result BulkMinimizer::minimize(const vector<WindowId>& windows)
+{
+    Result result;
+    unordered_set<WindowId> wanted(windows.begin(), windows.end());
+    vector<WindowId> ordered;
+    for (auto w : backend.zOrder())
+        if (wanted.contains(w)) ordered.push_back(w);
+    auto foreground = backend.foreground();
+    vector<WindowId> skipped;
+    saved = apply(ordered, true, result, skipped);
+    // windows which were hung at the last restore come back with the others, below them
+    for (auto w : leftMinimized)
+        if (backend.minimized(w) == true && ranges::find(saved, w) == saved.end()) saved.push_back(w);
+    leftMinimized.clear();
+    savedForeground = ranges::find(saved, foreground) != saved.end() ? foreground : saved.empty() ? 0 : saved.front();
+    return result;
+}
+
+BulkMinimizer::Result BulkMinimizer::restore()
+{
+    Result result;
+    // bottom first, so the windows come up roughly in order before they are stacked exactly
+    vector<WindowId> bottomFirst(saved.rbegin(), saved.rend());
+    auto start = clock.now();
+    leftMinimized.clear();
+    apply(bottomFirst, false, result, leftMinimized);
+
+    vector<WindowId> stack;
+    for (auto w : saved)
+        if (backend.minimized(w) == false && !backend.isHung(w)) stack.push_back(w);
+    // activating raises the window, the stack put after it keeps the order whatever it was
+    if (savedForeground && backend.minimized(savedForeground) == false && !backend.isHung(savedForeground))
+        result.foregroundRestored = backend.activate(savedForeground) && backend.foreground() == savedForeground;
+    result.zOrderRestored = !stack.empty() && backend.stack(stack);
+    result.latency = clock.now() - start;
+    saved.clear();
+    savedForeground = 0;
+    return result;
+}
+
+vector<WindowId> SimulatedShowBackend::zOrder()
+{
+    process();
+    return stackOrder;
+}
+
+WindowId SimulatedShowBackend::foreground()
+{
+    process();
+    return foregroundWindow;
+}
+
+optional<bool> SimulatedShowBackend::minimized(WindowId w)
+{
+    process();
+    if (!exists(w)) return nullopt;
+    return minimizedWindows.contains(w);
+}
+
+bool SimulatedShowBackend::postShow(WindowId w, bool minimize)
+{
+    if (!exists(w)) return false;
+    posted++;
+    if (hung.contains(w)) return true;
+    auto delay = delays.find(w);
+    queue.push_back({ w, minimize, clock.now() + (delay == delays.end() ? Duration{} : delay->second) });
+    return true;
+}
+
+bool SimulatedShowBackend::stack(const vector<WindowId>& windows)
+{
+    process();
+    for (auto w : windows)
+        if (!exists(w)) return false;
+    stacked++;
+    erase_if(stackOrder, [&](WindowId w) { return ranges::find(windows, w) != windows.end(); });
+    stackOrder.insert(stackOrder.begin(), windows.begin(), windows.end());
+    return true;
+}
+
+bool SimulatedShowBackend::activate(WindowId w)
+{
+    process();
+    if (!exists(w) || hung.contains(w)) return false;
+    minimizedWindows.erase(w);
+    raise(w);
+    foregroundWindow = w;
+    return true;
+}
+
+void SimulatedShowBackend::process()
+{
+    auto now = clock.now();
+    // in the order they become due, like the threads of the windows would pick them up
+    ranges::stable_sort(queue, {}, &Request::due);
+    auto due = ranges::find_if(queue, [now](const Request& r) { return r.due > now; });
+    for (auto it = queue.begin(); it != due; ++it)
+    {
+        auto w = it->window;
+        if (!exists(w)) continue;
+        if (it->minimize)
+        {
+            minimizedWindows.insert(w);
+            erase_if(stackOrder, [w](WindowId s) { return s == w; });
+            stackOrder.push_back(w);
+            if (foregroundWindow == w) foregroundWindow = 0;
+        }
+        else
+        {
+            minimizedWindows.erase(w);
+            raise(w);
+        }
+    }
+    queue.erase(queue.begin(), due);
+}
+
+bool SimulatedShowBackend::exists(WindowId w) const
+{
+    return ranges::find(stackOrder, w) != stackOrder.end();
+}
+
+void SimulatedShowBackend::raise(WindowId w)
+{
+    erase_if(stackOrder, [w](WindowId s) { return s == w; });
+    stackOrder.insert(stackOrder.begin(), w);
+}
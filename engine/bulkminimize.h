@@ -0,0 +1,138 @@
+#ifndef BULKMINIMIZE_H
+#define BULKMINIMIZE_H
+#include "clock.h"
+#include "layout.h"
+#include <map>
+#include <set>
+
+/// <summary>
+/// Platform operations needed to minimize and restore many windows at once
+/// </summary>
+class WindowShowBackend
+{
+public:
+    virtual ~WindowShowBackend() = default;
+    /// <returns>top-level windows, topmost first</returns>
+    virtual std::vector<WindowId> zOrder() = 0;
+    virtual WindowId foreground() = 0;
+    /// <returns>nothing if the window no longer exists</returns>
+    virtual std::optional<bool> minimized(WindowId w) = 0;
+    /// the thread of the window stopped processing messages
+    virtual bool isHung(WindowId w) { (void)w; return false; }
+    /// <summary>
+    /// Ask the window to minimize, or to come back the way it was, without activating it and without waiting
+    /// for its thread (ShowWindowAsync on Windows)
+    /// </summary>
+    /// <returns>false if the request was refused</returns>
+    virtual bool postShow(WindowId w, bool minimize) = 0;
+    /// <summary>
+    /// Stack the windows in the given order, topmost first, on top of all others in one transaction, without activating
+    /// them and without waiting for their threads
+    /// </summary>
+    /// <returns>false if the request was refused</returns>
+    virtual bool stack(const std::vector<WindowId>& windows) = 0;
+    virtual bool activate(WindowId w) = 0;
+};
+
+/// <summary>
+/// Minimizes all windows and brings them back the way they were. The requests go out to all windows at once and
+/// are awaited together for a bounded time, so the toggle takes as long as the slowest window instead of the sum
+/// of all of them. Hung windows are left alone; those found hung while restoring are restored by the next restore.
+/// Restoring activates the window which was in the foreground and stacks the windows in their captured order.
+/// </summary>
+class BulkMinimizer
+{
+public:
+    struct Options
+    {
+        Duration timeout = std::chrono::seconds(2); ///< for all windows together
+        Duration pollInterval = std::chrono::milliseconds(10);
+    };
+
+    struct Result
+    {
+        size_t requested = 0; ///< windows asked to change
+        size_t completed = 0; ///< changed within the timeout
+        size_t hung = 0;      ///< not asked, their threads do not respond
+        size_t timedOut = 0;  ///< asked, but unchanged at the timeout
+        size_t failed = 0;    ///< closed or refused
+        bool zOrderRestored = false; ///< the captured order was posted
+        bool foregroundRestored = false;
+        Duration latency{};   ///< from the first request to the last change, or to the timeout
+    };
+
+    BulkMinimizer(WindowShowBackend& backend, Clock& clock) : BulkMinimizer(backend, clock, Options()) {}
+    BulkMinimizer(WindowShowBackend& backend, Clock& clock, Options options) : backend(backend), clock(clock), options(options) {}
+
+    /// <summary>
+    /// Minimize the windows which are not minimized yet, remembering their stacking order and the foreground window.
+    /// A click on the tray icon gives the foreground to the taskbar, so unless one of the windows has it, the topmost
+    /// of them counts as the foreground window.
+    /// </summary>
+    Result minimize(const std::vector<WindowId>& windows);
+    /// <summary>
+    /// Restore the windows minimized before, stack them as they were and give the foreground back
+    /// </summary>
+    Result restore();
+    /// windows minimized by minimize wait to be restored
+    bool holding() const { return !saved.empty(); }
+
+private:
+    /// <summary>
+    /// Post the change to the windows, all of them before waiting for any
+    /// </summary>
+    /// <param name="skipped">receives the hung windows</param>
+    /// <returns>windows which changed or are still on their way, in the given order</returns>
+    std::vector<WindowId> apply(const std::vector<WindowId>& windows, bool minimize, Result& result, std::vector<WindowId>& skipped);
+
+    WindowShowBackend& backend;
+    Clock& clock;
+    Options options;
+    std::vector<WindowId> saved; ///< minimized by us, topmost first
+    WindowId savedForeground = 0;
+    std::vector<WindowId> leftMinimized; ///< hung while restoring, saved again by the next minimize
+};
+
+/// <summary>
+/// Windows kept in memory whose show requests take effect after a delay on a virtual clock. Like on Windows,
+/// minimized windows drop to the bottom of the stack and restored ones come up on top, so restoring them
+/// one by one scrambles their order.
+/// </summary>
+class SimulatedShowBackend : public WindowShowBackend
+{
+public:
+    explicit SimulatedShowBackend(Clock& clock) : clock(clock) {}
+
+    std::vector<WindowId> stackOrder; ///< topmost first
+    std::set<WindowId> minimizedWindows;
+    WindowId foregroundWindow = 0;
+    std::set<WindowId> hung;         ///< reported as such and never process a request
+    std::map<WindowId, Duration> delays; ///< until a request takes effect, immediate if missing
+    size_t posted = 0;
+    size_t stacked = 0;              ///< transactions
+
+    std::vector<WindowId> zOrder() override;
+    WindowId foreground() override;
+    std::optional<bool> minimized(WindowId w) override;
+    bool isHung(WindowId w) override { return hung.contains(w); }
+    bool postShow(WindowId w, bool minimize) override;
+    bool stack(const std::vector<WindowId>& windows) override;
+    bool activate(WindowId w) override;
+
+private:
+    struct Request
+    {
+        WindowId window;
+        bool minimize;
+        TimePoint due;
+    };
+
+    void process();
+    bool exists(WindowId w) const;
+    void raise(WindowId w);
+
+    Clock& clock;
+    std::vector<Request> queue;
+};
+
+#endif // BULKMINIMIZE_H
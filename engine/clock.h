@@ -0,0 +1,39 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+#include "eventcoalescer.h"
+#include <thread>
+
+/// <summary>
+/// Time source of components which wait, replaced by a virtual clock in simulations
+/// </summary>
+class Clock
+{
+public:
+    virtual ~Clock() = default;
+    virtual TimePoint now() = 0;
+    virtual void sleepUntil(TimePoint t) = 0;
+};
+
+class SystemClock : public Clock
+{
+public:
+    TimePoint now() override { return SteadyClock::now(); }
+    void sleepUntil(TimePoint t) override { std::this_thread::sleep_until(t); }
+};
+
+/// <summary>
+/// Virtual time, which passes only when somebody sleeps or advances it
+/// </summary>
+class ManualClock : public Clock
+{
+public:
+    explicit ManualClock(TimePoint start = TimePoint()) : current(start) {}
+    TimePoint now() override { return current; }
+    void sleepUntil(TimePoint t) override { if (t > current) current = t; }
+    void advance(Duration d) { current += d; }
+
+private:
+    TimePoint current;
+};
+
+#endif // CLOCK_H
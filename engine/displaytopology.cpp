@@ -0,0 +1,76 @@
+#include "displaytopology.h"
+#include <algorithm>
+
+using namespace std;
+
+shared_ptr<const DisplayTopology> TopologyCache::current()
+{
+    if (stale.exchange(false) || !topology)
+    {
+        auto rebuilt = make_shared<DisplayTopology>(provider.query());
+        rebuilt->generation = topology ? topology->generation + 1 : 1;
+        topology = move(rebuilt);
+        statistics.rebuilds++;
+    }
+    else statistics.hits++;
+    statistics.invalidations = invalidations;
+    return topology;
+}
+
+void TopologyCache::invalidate(DisplayChange /*reason*/)
+{
+    invalidations++;
+    stale = true;
+}
+
+DisplayTopology FakeTopologyProvider::query()
+{
+    queries++;
+    DisplayTopology result;
+    result.monitors = monitors;
+    if (!monitors.empty())
+    {
+        result.primary = monitors.front().id;
+        result.primaryDpi = monitors.front().dpi;
+    }
+    return result;
+}
+
+void FakeTopologyProvider::connect(MonitorInfo monitor)
+{
+    if (monitor.rect.area() == 0) monitor.rect = monitor.workArea;
+    if (auto existing = find(monitor.id)) *existing = move(monitor);
+    else monitors.push_back(move(monitor));
+}
+
+bool FakeTopologyProvider::disconnect(MonitorId id)
+{
+    return erase_if(monitors, [id](auto& m) { return m.id == id; }) > 0;
+}
+
+bool FakeTopologyProvider::setDpi(MonitorId id, unsigned dpi)
+{
+    auto monitor = find(id);
+    if (monitor) monitor->dpi = dpi;
+    return monitor != nullptr;
+}
+
+bool FakeTopologyProvider::setWorkArea(MonitorId id, const Rect& workArea)
+{
+    auto monitor = find(id);
+    if (monitor) monitor->workArea = workArea;
+    return monitor != nullptr;
+}
+
+bool FakeTopologyProvider::setTouchCapable(MonitorId id, bool touchCapable)
+{
+    auto monitor = find(id);
+    if (monitor) monitor->touchCapable = touchCapable;
+    return monitor != nullptr;
+}
+
+MonitorInfo* FakeTopologyProvider::find(MonitorId id)
+{
+    auto it = find_if(monitors.begin(), monitors.end(), [id](auto& m) { return m.id == id; });
+    return it == monitors.end() ? nullptr : &*it;
+}
@@ -0,0 +1,69 @@
+#ifndef DISPLAYTOPOLOGY_H
+#define DISPLAYTOPOLOGY_H
+#include "layout.h"
+#include <atomic>
+
+enum class DisplayChange { display, dpi, settings, device, theme };
+
+/// <summary>
+/// Operating system access to the attached monitors
+/// </summary>
+class DisplayTopologyProvider
+{
+public:
+    virtual ~DisplayTopologyProvider() = default;
+    /// query all monitors, the generation of the result is assigned by the cache
+    virtual DisplayTopology query() = 0;
+};
+
+/// <summary>
+/// The current display topology, queried once and kept until a display, DPI, settings or device
+/// change notification arrives. Notifications may come from any thread, current() is called by the arranger.
+/// </summary>
+class TopologyCache
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t rebuilds = 0;
+        size_t invalidations = 0;
+    };
+
+    explicit TopologyCache(DisplayTopologyProvider& provider) : provider(provider) {}
+
+    std::shared_ptr<const DisplayTopology> current();
+    void invalidate(DisplayChange reason);
+    const Stats& stats() const { return statistics; }
+
+private:
+    DisplayTopologyProvider& provider;
+    std::shared_ptr<const DisplayTopology> topology;
+    std::atomic<bool> stale = true;
+    std::atomic<size_t> invalidations = 0;
+    Stats statistics;
+};
+
+/// <summary>
+/// Monitors kept in memory, for replaying hotplug and DPI change sequences without real displays.
+/// Changes do not notify anybody, invalidate the cache like the platform notification would.
+/// </summary>
+class FakeTopologyProvider : public DisplayTopologyProvider
+{
+public:
+    std::vector<MonitorInfo> monitors; ///< the first one is primary
+    size_t queries = 0;
+
+    DisplayTopology query() override;
+    void connect(MonitorInfo monitor);
+    /// <returns>the monitor was connected</returns>
+    bool disconnect(MonitorId id);
+    bool setDpi(MonitorId id, unsigned dpi);
+    bool setWorkArea(MonitorId id, const Rect& workArea);
+    bool setTouchCapable(MonitorId id, bool touchCapable);
+
+private:
+    MonitorInfo* find(MonitorId id);
+};
+
+#endif // DISPLAYTOPOLOGY_H
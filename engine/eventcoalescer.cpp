@@ -0,0 +1,112 @@
+#include "eventcoalescer.h"
+#include <algorithm>
+
+using namespace std;
+
+ArrangeCoalescer::ArrangeCoalescer(Duration debounce, Duration maxDelay) : debounce(debounce), maxDelay(maxDelay) {}
+
+void ArrangeCoalescer::onEvent(const WindowEvent& event, TimePoint now)
+{
+    statistics.events++;
+    using enum WindowEventKind;
+    switch (event.kind)
+    {
+    case nameChanged:
+        return; // titles do not affect the layout
+    case moveSizeStart:
+        draggedWindow = event.window;
+        break;
+    case moveSizeEnd:
+        draggedWindow.reset();
+        break;
+    case destroyed:
+    case hidden:
+        // the dragged window may vanish without ever reporting the end of the drag
+        if (draggedWindow == event.window) draggedWindow.reset();
+        break;
+    default:
+        break;
+    }
+    if (draggedWindow)
+    {
+        statistics.eventsDuringDrag++;
+        return;
+    }
+    if (!pending)
+    {
+        pending = true;
+        firstEvent = now;
+    }
+    lastEvent = now;
+}
+
+optional<TimePoint> ArrangeCoalescer::deadline() const
+{
+    if (!pending || draggedWindow) return nullopt;
+    return min(lastEvent + debounce, firstEvent + maxDelay);
+}
+
+bool ArrangeCoalescer::poll(TimePoint now)
+{
+    auto due = deadline();
+    if (!due || now < *due) return false;
+    pending = false;
+    statistics.passes++;
+    statistics.lastLatency = now - firstEvent;
+    statistics.maxLatency = max(statistics.maxLatency, statistics.lastLatency);
+    return true;
+}
+
+void ScriptedEventSource::add(Duration at, WindowEvent event)
+{
+    TimePoint time = origin + at;
+    auto it = upper_bound(script.begin() + position, script.end(), time, [](TimePoint t, auto& e) { return t < e.first; });
+    script.insert(it, { time, event });
+}
+
+bool ScriptedEventSource::start(Sink s)
+{
+    sink = move(s);
+    return true;
+}
+
+void ScriptedEventSource::stop()
+{
+    sink = nullptr;
+}
+
+void ScriptedEventSource::advanceTo(TimePoint time)
+{
+    for (; position < script.size() && script[position].first <= time; position++)
+    {
+        now = script[position].first;
+        if (sink) sink(script[position].second, now);
+    }
+    now = max(now, time);
+}
+
+optional<TimePoint> ScriptedEventSource::nextEvent() const
+{
+    if (position < script.size()) return script[position].first;
+    return nullopt;
+}
+
+vector<TimePoint> runScript(ScriptedEventSource& source, ArrangeCoalescer& coalescer)
+{
+    vector<TimePoint> passes;
+    source.start([&coalescer](const WindowEvent& e, TimePoint t) { coalescer.onEvent(e, t); });
+    for (;;)
+    {
+        auto event = source.nextEvent();
+        auto due = coalescer.deadline();
+        if (!event && !due) break;
+        if (due && (!event || *due < *event))
+        {
+            source.advanceTo(*due);
+            if (coalescer.poll(*due)) passes.push_back(*due);
+        }
+        else source.advanceTo(*event);
+    }
+    source.stop();
+    return passes;
+}
@@ -0,0 +1,105 @@
+#ifndef EVENTCOALESCER_H
+#define EVENTCOALESCER_H
+#include "layout.h"
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+using TimePoint = SteadyClock::time_point;
+using Duration = SteadyClock::duration;
+
+enum class WindowEventKind { created, destroyed, shown, hidden, locationChanged, moveSizeStart, moveSizeEnd,
+                             minimized, restored, nameChanged, ownerChanged,
+                             displayChanged, ///< monitors, work areas or DPI changed, the window is 0
+                             raised };       ///< the window came to the foreground, which changes the stacking order only
+
+struct WindowEvent
+{
+    WindowEventKind kind;
+    WindowId window = 0;
+};
+
+/// <summary>
+/// Source of top-level window notifications (SetWinEventHook on Windows)
+/// </summary>
+class WindowEventSource
+{
+public:
+    using Sink = std::function<void(const WindowEvent&, TimePoint)>;
+    virtual ~WindowEventSource() = default;
+    /// <returns>subscription succeeded</returns>
+    virtual bool start(Sink sink) = 0;
+    virtual void stop() = 0;
+};
+
+/// <summary>
+/// Turns bursts of window events into single arrangement passes. Passes run after the events
+/// went quiet for the debounce period, but no later than maxDelay after the first event of a burst,
+/// and never while the user is dragging or resizing a window.
+/// </summary>
+class ArrangeCoalescer
+{
+public:
+    struct Stats
+    {
+        size_t events = 0;
+        size_t passes = 0;
+        size_t eventsDuringDrag = 0;
+        Duration lastLatency{}; ///< from the first event of a burst to its pass
+        Duration maxLatency{};
+    };
+
+    explicit ArrangeCoalescer(Duration debounce = std::chrono::milliseconds(150),
+                              Duration maxDelay = std::chrono::milliseconds(1000));
+
+    void onEvent(const WindowEvent& event, TimePoint now);
+    /// <returns>when poll should be called next, nothing while idle or dragging</returns>
+    std::optional<TimePoint> deadline() const;
+    /// <returns>a pass should run now</returns>
+    bool poll(TimePoint now);
+    bool dragging() const { return draggedWindow.has_value(); }
+    const Stats& stats() const { return statistics; }
+
+private:
+    Duration debounce;
+    Duration maxDelay;
+    bool pending = false;
+    TimePoint firstEvent;
+    TimePoint lastEvent;
+    std::optional<WindowId> draggedWindow;
+    Stats statistics;
+};
+
+/// <summary>
+/// Replays a fixed list of events in virtual time
+/// </summary>
+class ScriptedEventSource : public WindowEventSource
+{
+public:
+    explicit ScriptedEventSource(TimePoint origin = {}) : origin(origin), now(origin) {}
+    /// schedule an event relative to the origin
+    void add(Duration at, WindowEvent event);
+    bool start(Sink sink) override;
+    void stop() override;
+    /// deliver all events scheduled up to the given time
+    void advanceTo(TimePoint time);
+    std::optional<TimePoint> nextEvent() const;
+    TimePoint currentTime() const { return now; }
+
+private:
+    std::vector<std::pair<TimePoint, WindowEvent>> script; ///< sorted by time
+    size_t position = 0;
+    TimePoint origin;
+    TimePoint now;
+    Sink sink;
+};
+
+/// <summary>
+/// Run the whole script through a coalescer, advancing virtual time to the next event or deadline
+/// </summary>
+/// <returns>times of the triggered passes</returns>
+std::vector<TimePoint> runScript(ScriptedEventSource& source, ArrangeCoalescer& coalescer);
+
+#endif // EVENTCOALESCER_H
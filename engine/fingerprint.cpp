@@ -0,0 +1,46 @@
+#include "fingerprint.h"
+
+using namespace std;
+
+static constexpr uint64_t pack(int32_t high, int32_t low)
+{
+    return uint64_t(uint32_t(high)) << 32 | uint32_t(low);
+}
+
+// finalizer of MurmurHash3, every input bit affects every output bit
+static constexpr uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static constexpr uint64_t hashWindow(const WindowState& w)
+{
+    return mix(uint64_t(w.id) * 0x9e3779b97f4a7c15ULL ^ pack(w.rect.left, w.rect.top) * 0xbf58476d1ce4e5b9ULL
+               ^ pack(w.rect.right, w.rect.bottom) * 0x94d049bb133111ebULL ^ w.visibility);
+}
+
+uint64_t desktopFingerprint(span<const WindowState> windows)
+{
+    // sums make the result independent of the order; the window count separates sets with equal sums
+    constexpr size_t lanes = 4;
+    uint64_t sums[lanes] = {};
+    size_t i = 0;
+    for (; i + lanes <= windows.size(); i += lanes)
+        for (size_t lane = 0; lane < lanes; lane++) sums[lane] += hashWindow(windows[i + lane]);
+    for (; i < windows.size(); i++) sums[0] += hashWindow(windows[i]);
+    return mix(sums[0] + sums[1] + sums[2] + sums[3] + windows.size());
+}
+
+uint64_t stackingFingerprint(span<const WindowState> windows)
+{
+    // windows without a rect are hidden or minimized, their place in the stack does not matter
+    uint64_t hash = 0;
+    for (auto const& w : windows)
+        if (w.rect.width() > 0 && w.rect.height() > 0) hash = mix(hash ^ uint64_t(w.id) * 0x9e3779b97f4a7c15ULL);
+    return hash;
+}
@@ -0,0 +1,49 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+#include "eventcoalescer.h"
+#include <cstdint>
+#include <span>
+
+/// <summary>
+/// What the fingerprint sees of a top-level window
+/// </summary>
+struct WindowState
+{
+    WindowId id = 0;
+    Rect rect;
+    std::uint32_t visibility = 0; ///< e.g. the visible and minimized style bits
+};
+
+/// <summary>
+/// Order-independent hash of the windows, so a z-order change alone does not count as a change.
+/// Four windows are mixed per iteration in independent lanes, which compilers turn into vector code.
+/// </summary>
+std::uint64_t desktopFingerprint(std::span<const WindowState> windows);
+
+/// <summary>
+/// Order-dependent hash of the ids of the windows with a rect, given topmost first, which changes when
+/// a window on screen is raised or lowered
+/// </summary>
+std::uint64_t stackingFingerprint(std::span<const WindowState> windows);
+
+/// <summary>
+/// Period of a background check, growing while checks find nothing and reset by activity
+/// </summary>
+class AdaptiveInterval
+{
+public:
+    explicit AdaptiveInterval(Duration shortest = std::chrono::seconds(1), Duration longest = std::chrono::seconds(30))
+        : shortest(shortest), longest(longest), period(shortest) {}
+    Duration current() const { return period; }
+    /// the check found nothing, wait longer next time
+    void idle() { period = (std::min)(period * 2, longest); }
+    /// something changed, check often again
+    void activity() { period = shortest; }
+
+private:
+    Duration shortest;
+    Duration longest;
+    Duration period;
+};
+
+#endif // FINGERPRINT_H
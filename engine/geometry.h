@@ -0,0 +1,114 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/// <summary>
+/// enum class wrapper
+/// </summary>
+/// <typeparam name="E">enum class</typeparam>
+/// <typeparam name="I">underlying int</typeparam>
+template<typename Enum>struct flags {
+    using Int = typename std::underlying_type_t<Enum>;
+    Int value;
+    flags() = default;
+    explicit(false) flags(Enum x) : value(Int(x)) {}
+    auto operator=(Enum x) { value = Int(x); return *this; }
+    auto operator=(Int x) { value = x; return *this; }
+    explicit(false) operator Int() const { return value; }
+    explicit operator Enum() const { return Enum(value); }
+    friend Int operator&(flags f, Enum x) { return f.value & Int(x); }
+    friend Int operator^(flags f, Enum x) { return f.value ^ Int(x); }
+    friend bool operator==(flags f, Enum x) { return f.value == Int(x); }
+    flags& operator|=(Enum x) { value |= Int(x); return *this; }
+};
+
+enum class Corner : int { top = 0, left = 0, topleft = top | left, right = 1, topright = top | right,
+                          bottom = 2, bottomleft = bottom | left, bottomright = bottom | right };
+
+struct Point
+{
+    std::int32_t x = 0;
+    std::int32_t y = 0;
+};
+
+/// <summary>
+/// Platform independent counterpart of win32 RECT. Coordinates are 32 bits wide everywhere, like LONG on Windows;
+/// products of them are computed in 64 bits.
+/// </summary>
+struct Rect
+{
+    std::int32_t left = 0;
+    std::int32_t top = 0;
+    std::int32_t right = 0;
+    std::int32_t bottom = 0;
+
+    constexpr std::int32_t width() const { return right - left; }
+    constexpr std::int32_t height() const { return bottom - top; }
+    constexpr size_t area() const { return size_t(std::int64_t(bottom - top) * (right - left)); }
+
+    size_t diameter() const
+    {
+        std::int64_t width = right - left;
+        std::int64_t height = bottom - top;
+        return size_t(sqrt(double(width * width + height * height)));
+    }
+
+    constexpr bool isDifferentSize(const Rect& r2) const
+    {
+        auto w1 = right - left;
+        auto w2 = r2.right - r2.left;
+        auto h1 = bottom - top;
+        auto h2 = r2.bottom - r2.top;
+        bool result = (w1 != w2) || (h1 != h2);
+        return result;
+    }
+
+    void moveInside(const Rect& monRect)
+    {
+        std::int32_t maxw = monRect.right - monRect.left;
+        std::int32_t maxh = monRect.bottom - monRect.top;
+        right -= (std::max)(0, right - left - maxw);
+        bottom -= (std::max)(0, bottom - top - maxh);
+        left -= (std::max)(0, right - monRect.right);
+        top -= (std::max)(0, bottom - monRect.bottom);
+    }
+
+    int distanceFromCorner(const Rect &mrect, flags<Corner> c) const
+    {
+        Point mcorner = {};
+        Point wcorner = {};
+        bool isRight = c & Corner::right;
+        mcorner.x = isRight ? mrect.right : mrect.left;
+        wcorner.x = isRight ? right : left;
+        bool isBottom = c & Corner::bottom;
+        mcorner.y = isBottom ? mrect.bottom : mrect.top;
+        wcorner.y = isBottom ? bottom : top;
+        std::int64_t distX = std::int64_t(wcorner.x) - mcorner.x;
+        std::int64_t distY = std::int64_t(wcorner.y) - mcorner.y;
+        return int(sqrt(double(distX * distX + distY * distY)));
+    }
+
+    /// <summary>
+    /// Same contract as win32 IntersectRect: an empty result is all zeros
+    /// </summary>
+    /// <returns>rectangles intersect</returns>
+    static bool intersect(Rect& result, const Rect& a, const Rect& b)
+    {
+        result = { (std::max)(a.left, b.left), (std::max)(a.top, b.top), (std::min)(a.right, b.right), (std::min)(a.bottom, b.bottom) };
+        if (result.left < result.right && result.top < result.bottom) return true;
+        result = {};
+        return false;
+    }
+
+    friend bool operator==(const Rect& self, const Rect& other)
+    {
+        return self.left == other.left && self.right == other.right && self.top == other.top && self.bottom == other.bottom;
+    }
+    friend bool operator!=(const Rect& self, const Rect& other) { return !(self == other); }
+};
+
+#endif // GEOMETRY_H
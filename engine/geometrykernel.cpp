@@ -0,0 +1,294 @@
+#include "geometrykernel.h"
+#include <array>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define GEOMETRY_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang compile intrinsics only in functions which target the instruction set, MSVC always does
+#if defined(GEOMETRY_X86) && defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+using namespace std;
+
+static constexpr int64_t vectorLimit = int64_t(1) << 24;
+/// windows per call of a kernel, the squared distances of a block stay in the cache
+static constexpr size_t blockSize = 256;
+
+/// <summary>
+/// Output of a kernel for one block: the main monitor, and the squared distances of the four window corners
+/// to the same corners of that monitor, one column per corner
+/// </summary>
+struct KernelBlock
+{
+    array<int32_t, blockSize> monitor;
+    array<array<int64_t, blockSize>, 4> distance;
+};
+
+using Kernel = void (*)(const RectColumns& windows, const MonitorColumns& monitors, size_t begin, size_t count, KernelBlock& out);
+
+RectColumns::RectColumns(pmr::memory_resource* arena) : left(arena), top(arena), right(arena), bottom(arena) {}
+
+void RectColumns::reserve(size_t n)
+{
+    left.reserve(n);
+    top.reserve(n);
+    right.reserve(n);
+    bottom.reserve(n);
+}
+
+static bool fitsLanes(int32_t v)
+{
+    return v > -vectorLimit && v < vectorLimit;
+}
+
+void RectColumns::push_back(const Rect& r)
+{
+    vectorizable = vectorizable && fitsLanes(r.left) && fitsLanes(r.top) && fitsLanes(r.right) && fitsLanes(r.bottom);
+    left.push_back(r.left);
+    top.push_back(r.top);
+    right.push_back(r.right);
+    bottom.push_back(r.bottom);
+}
+
+MonitorColumns::MonitorColumns(pmr::memory_resource* arena) : RectColumns(arena), avoidTopRight(arena), diagonalSquared(arena) {}
+
+void MonitorColumns::push_back(const Rect& r, bool avoid)
+{
+    RectColumns::push_back(r);
+    int64_t width = int64_t(right.back()) - left.back();
+    int64_t height = int64_t(bottom.back()) - top.back();
+    avoidTopRight.push_back(avoid);
+    auto truncated = int64_t(sqrt(double(width * width + height * height)));
+    diagonalSquared.push_back(truncated * truncated);
+}
+
+// KERNELS
+
+static void scalarKernel(const RectColumns& w, const MonitorColumns& mons, size_t begin, size_t count, KernelBlock& out)
+{
+    for (size_t j = 0; j < count; j++)
+    {
+        size_t i = begin + j;
+        int64_t maxArea = 0;
+        int32_t mon = -1;
+        for (size_t m = 0; m < mons.size(); m++)
+        {
+            int64_t width = int64_t((std::min)(w.right[i], mons.right[m])) - (std::max)(w.left[i], mons.left[m]);
+            int64_t height = int64_t((std::min)(w.bottom[i], mons.bottom[m])) - (std::max)(w.top[i], mons.top[m]);
+            int64_t area = width > 0 && height > 0 ? width * height : 0;
+            if (area > maxArea)
+            {
+                maxArea = area;
+                mon = int32_t(m);
+            }
+        }
+        out.monitor[j] = mon;
+        if (mon < 0) continue;
+        int64_t xl = int64_t(w.left[i]) - mons.left[mon];
+        int64_t xr = int64_t(w.right[i]) - mons.right[mon];
+        int64_t yt = int64_t(w.top[i]) - mons.top[mon];
+        int64_t yb = int64_t(w.bottom[i]) - mons.bottom[mon];
+        out.distance[int(Corner::topleft)][j] = xl * xl + yt * yt;
+        out.distance[int(Corner::topright)][j] = xr * xr + yt * yt;
+        out.distance[int(Corner::bottomleft)][j] = xl * xl + yb * yb;
+        out.distance[int(Corner::bottomright)][j] = xr * xr + yb * yb;
+    }
+}
+
+#ifdef GEOMETRY_X86
+
+/// <summary>
+/// Store 64 bit results of the even and the odd 32 bit lanes in lane order
+/// </summary>
+TARGET_AVX2 static void storeInterleaved(int64_t* out, __m256i even, __m256i odd)
+{
+    // unpack pairs lanes within the 128 bit halves, the permutes put the halves in order
+    auto low = _mm256_unpacklo_epi64(even, odd);
+    auto high = _mm256_unpackhi_epi64(even, odd);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permute2x128_si256(low, high, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4), _mm256_permute2x128_si256(low, high, 0x31));
+}
+
+// lambdas do not inherit the target of the enclosing function, so the helpers are functions
+
+TARGET_AVX2 static __m256i load8(const pmr::vector<int32_t>& v, size_t i)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.data() + i));
+}
+
+TARGET_AVX2 static __m256i gather8(const pmr::vector<int32_t>& v, __m256i index)
+{
+    return _mm256_i32gather_epi32(v.data(), index, 4);
+}
+
+/// squares of the even lanes, as 64 bit lanes
+TARGET_AVX2 static __m256i squareEven(__m256i v)
+{
+    return _mm256_mul_epu32(v, v);
+}
+
+TARGET_AVX2 static __m256i squareOdd(__m256i v)
+{
+    auto odd = _mm256_srli_epi64(v, 32);
+    return _mm256_mul_epu32(odd, odd);
+}
+
+TARGET_AVX2 static void avx2Kernel(const RectColumns& w, const MonitorColumns& mons, size_t begin, size_t count, KernelBlock& out)
+{
+    auto const zero = _mm256_setzero_si256();
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8)
+    {
+        size_t i = begin + j;
+        auto wl = load8(w.left, i);
+        auto wt = load8(w.top, i);
+        auto wr = load8(w.right, i);
+        auto wb = load8(w.bottom, i);
+        auto bestEven = zero;
+        auto bestOdd = zero;
+        auto best = _mm256_set1_epi32(-1);
+        for (size_t m = 0; m < mons.size(); m++)
+        {
+            auto width = _mm256_max_epi32(_mm256_sub_epi32(_mm256_min_epi32(wr, _mm256_set1_epi32(mons.right[m])), _mm256_max_epi32(wl, _mm256_set1_epi32(mons.left[m]))), zero);
+            auto height = _mm256_max_epi32(_mm256_sub_epi32(_mm256_min_epi32(wb, _mm256_set1_epi32(mons.bottom[m])), _mm256_max_epi32(wt, _mm256_set1_epi32(mons.top[m]))), zero);
+            // areas need 64 bits, the even and the odd lanes are multiplied separately
+            auto areaEven = _mm256_mul_epu32(width, height);
+            auto areaOdd = _mm256_mul_epu32(_mm256_srli_epi64(width, 32), _mm256_srli_epi64(height, 32));
+            auto winEven = _mm256_cmpgt_epi64(areaEven, bestEven);
+            auto winOdd = _mm256_cmpgt_epi64(areaOdd, bestOdd);
+            bestEven = _mm256_blendv_epi8(bestEven, areaEven, winEven);
+            bestOdd = _mm256_blendv_epi8(bestOdd, areaOdd, winOdd);
+            best = _mm256_blendv_epi8(best, _mm256_set1_epi32(int32_t(m)), _mm256_blend_epi32(winEven, winOdd, 0xAA));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.monitor.data() + j), best);
+
+        // windows off screen take the first monitor and are ignored later
+        auto index = _mm256_max_epi32(best, zero);
+        auto xl = _mm256_abs_epi32(_mm256_sub_epi32(wl, gather8(mons.left, index)));
+        auto xr = _mm256_abs_epi32(_mm256_sub_epi32(wr, gather8(mons.right, index)));
+        auto yt = _mm256_abs_epi32(_mm256_sub_epi32(wt, gather8(mons.top, index)));
+        auto yb = _mm256_abs_epi32(_mm256_sub_epi32(wb, gather8(mons.bottom, index)));
+        auto xlEven = squareEven(xl), xlOdd = squareOdd(xl);
+        auto xrEven = squareEven(xr), xrOdd = squareOdd(xr);
+        auto ytEven = squareEven(yt), ytOdd = squareOdd(yt);
+        auto ybEven = squareEven(yb), ybOdd = squareOdd(yb);
+        storeInterleaved(&out.distance[int(Corner::topleft)][j], _mm256_add_epi64(xlEven, ytEven), _mm256_add_epi64(xlOdd, ytOdd));
+        storeInterleaved(&out.distance[int(Corner::topright)][j], _mm256_add_epi64(xrEven, ytEven), _mm256_add_epi64(xrOdd, ytOdd));
+        storeInterleaved(&out.distance[int(Corner::bottomleft)][j], _mm256_add_epi64(xlEven, ybEven), _mm256_add_epi64(xlOdd, ybOdd));
+        storeInterleaved(&out.distance[int(Corner::bottomright)][j], _mm256_add_epi64(xrEven, ybEven), _mm256_add_epi64(xrOdd, ybOdd));
+    }
+    if (j < count)
+    {
+        KernelBlock rest;
+        scalarKernel(w, mons, begin + j, count - j, rest);
+        for (size_t k = 0; j + k < count; k++)
+        {
+            out.monitor[j + k] = rest.monitor[k];
+            for (int c = 0; c < 4; c++) out.distance[c][j + k] = rest.distance[c][k];
+        }
+    }
+}
+
+static bool cpuSupportsAvx2()
+{
+#ifdef _MSC_VER
+    array<int, 4> info{};
+    __cpuid(info.data(), 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info.data(), 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // GEOMETRY_X86
+
+bool geometryKernelSupported(GeometryKernel kernel)
+{
+    if (kernel == GeometryKernel::scalar) return true;
+#ifdef GEOMETRY_X86
+    static const bool avx2 = cpuSupportsAvx2();
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+GeometryKernel bestGeometryKernel()
+{
+    return geometryKernelSupported(GeometryKernel::avx2) ? GeometryKernel::avx2 : GeometryKernel::scalar;
+}
+
+const char* geometryKernelName(GeometryKernel kernel)
+{
+    switch (kernel)
+    {
+    case GeometryKernel::avx2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+/// <returns>floor of the square root, exact for all values</returns>
+static int64_t isqrt(int64_t n)
+{
+    auto r = int64_t(sqrt(double(n)));
+    while (r * r > n) r--;
+    while ((r + 1) * (r + 1) <= n) r++;
+    return r;
+}
+
+void findMainMonitorsAndCorners(const RectColumns& windows, const MonitorColumns& monitors, span<int> monitor, span<Corner> corner,
+                                GeometryKernel kernel)
+{
+    Kernel run = scalarKernel;
+#ifdef GEOMETRY_X86
+    if (kernel == GeometryKernel::avx2 && windows.vectorizable && monitors.vectorizable && geometryKernelSupported(kernel))
+        run = avx2Kernel;
+#endif
+    KernelBlock block;
+    for (size_t begin = 0; begin < windows.size(); begin += blockSize)
+    {
+        size_t count = (std::min)(blockSize, windows.size() - begin);
+        run(windows, monitors, begin, count, block);
+        for (size_t j = 0; j < count; j++)
+        {
+            int m = block.monitor[j];
+            monitor[begin + j] = m;
+            corner[begin + j] = Corner::topleft;
+            if (m < 0) continue;
+            // an avoided corner is never nearest
+            array<int64_t, 4> d{ block.distance[0][j], monitors.avoidTopRight[m] ? numeric_limits<int64_t>::max() : block.distance[1][j],
+                                 block.distance[2][j], block.distance[3][j] };
+            int nearest = 0;
+            for (int c = 1; c < 4; c++)
+                if (d[c] < d[nearest]) nearest = c;
+            // truncated distances below the truncated diagonal, the diagonal is squared too
+            if (d[nearest] >= monitors.diagonalSquared[m]) continue;
+            // the old search compared truncated distances, so an earlier corner wins if its distance truncates to the same value.
+            // That needs a gap below 2 sqrt(nearest) + 1, only then is the square root taken.
+            for (int c = 0; c < nearest; c++)
+            {
+                uint64_t gap = uint64_t(d[c] - d[nearest]);
+                if (gap > uint64_t(1) << 32 || (gap - 1) * (gap - 1) >= 4 * uint64_t(d[nearest])) continue;
+                auto truncated = isqrt(d[nearest]);
+                if (d[c] < (truncated + 1) * (truncated + 1))
+                {
+                    nearest = c;
+                    break;
+                }
+            }
+            corner[begin + j] = Corner(nearest);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef GEOMETRYKERNEL_H
+#define GEOMETRYKERNEL_H
+#include "geometry.h"
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+/// <summary>
+/// Rectangles as structure of arrays, so a kernel loads the same side of consecutive rects in one instruction.
+/// Coordinates are saturated to 32 bits, which is what every platform reports.
+/// </summary>
+struct RectColumns
+{
+    explicit RectColumns(std::pmr::memory_resource* arena = std::pmr::get_default_resource());
+    void reserve(size_t n);
+    void push_back(const Rect& r);
+    size_t size() const { return left.size(); }
+
+    std::pmr::vector<std::int32_t> left;
+    std::pmr::vector<std::int32_t> top;
+    std::pmr::vector<std::int32_t> right;
+    std::pmr::vector<std::int32_t> bottom;
+    /// all coordinates are within +-2^24, where the kernels agree with the per window search, see findMainMonitorsAndCorners
+    bool vectorizable = true;
+};
+
+/// <summary>
+/// Work areas of the monitors with what the corner search needs of each
+/// </summary>
+struct MonitorColumns : RectColumns
+{
+    explicit MonitorColumns(std::pmr::memory_resource* arena = std::pmr::get_default_resource());
+    void push_back(const Rect& r, bool avoidTopRight);
+
+    std::pmr::vector<std::uint8_t> avoidTopRight;
+    std::pmr::vector<std::int64_t> diagonalSquared; ///< square of the truncated diagonal, corners must be nearer
+};
+
+enum class GeometryKernel : int
+{
+    scalar,
+    avx2, ///< 8 windows at a time, monitor corners gathered
+};
+constexpr int geometryKernelCount = int(GeometryKernel::avx2) + 1;
+
+bool geometryKernelSupported(GeometryKernel kernel);
+/// <returns>the widest kernel the processor supports, detected once</returns>
+GeometryKernel bestGeometryKernel();
+const char* geometryKernelName(GeometryKernel kernel);
+
+/// <summary>
+/// Main monitor and corner of every window: the monitor with the largest intersection, the first of equal ones,
+/// -1 if the window is off screen; the corner of that monitor nearest to the same corner of the window, compared by
+/// truncated distance with the first of equal ones winning, and topleft if none is nearer than the diagonal.
+/// These are the results of the per window search with IntersectRect and sqrt, which the layout keeps for small desktops
+/// and processors without AVX2 where building the columns costs more than the kernels save, but distances
+/// are compared squared in 64 bits, and the one square root per window is an exact integer one.
+/// Identical for coordinates within +-2^24, where the distances of the per window search fit an int and its square roots
+/// in double are exact. Columns beyond that are not vectorizable: they get the scalar kernel, which stays exact, and the
+/// layout uses the per window search for them.
+/// </summary>
+void findMainMonitorsAndCorners(const RectColumns& windows, const MonitorColumns& monitors,
+                                std::span<int> monitor, std::span<Corner> corner, GeometryKernel kernel = bestGeometryKernel());
+
+#endif // GEOMETRYKERNEL_H
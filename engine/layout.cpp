@@ -0,0 +1,824 @@
+#include "layout.h"
+#include "geometrykernel.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <tuple>
+
+using namespace std;
+
+struct MonitorSlot
+{
+    MonitorId id;
+    Rect rect;
+    const MonitorInfo* info;
+    bool avoidTopRight;
+};
+
+struct WindowSlot
+{
+    WindowId id;
+    Rect rect;               ///< current rect, replaced by the target rect during adjustment
+    const WindowInfo* info;
+    int monitor = -1;        ///< index of the main monitor, -1 if the window is off screen
+    Corner corner = Corner::topleft;
+    bool isNew = false;
+    bool unmovable = false;
+};
+
+struct CornerEntry
+{
+    size_t size;
+    uint32_t window;
+};
+
+using CornerBucket = pmr::vector<CornerEntry>;
+
+/// <summary>
+/// Windows of one monitor, by size and by corner
+/// </summary>
+struct MonitorLayout
+{
+    MonitorLayout(int monitor, pmr::memory_resource* arena) :
+        monitor(monitor), windowsBySize(arena), corners{ CornerBucket(arena), CornerBucket(arena), CornerBucket(arena), CornerBucket(arena) } {}
+
+    int monitor;
+    pmr::vector<pair<int32_t, uint32_t>> windowsBySize; ///< ties keep window order
+    array<CornerBucket, 4> corners;                  ///< indexed by Corner, sorted by size, ties keep insertion order
+};
+
+/// <summary>
+/// Upstream of the per-pass arena, counts what did not fit into the arena buffer
+/// </summary>
+class OverflowCounter : public pmr::memory_resource
+{
+public:
+    size_t bytes = 0;
+
+private:
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        bytes += size;
+        return pmr::new_delete_resource()->allocate(size, alignment);
+    }
+    void do_deallocate(void* p, size_t size, size_t alignment) override
+    {
+        pmr::new_delete_resource()->deallocate(p, size, alignment);
+    }
+    bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+/// <summary>
+/// Stores the time elapsed since construction in the given phase on destruction
+/// </summary>
+class PhaseTimer
+{
+public:
+    PhaseTimer(PassTimings& timings, LayoutPhase phase) : target(timings[phase]), start(chrono::steady_clock::now()) {}
+    ~PhaseTimer() { target = chrono::steady_clock::now() - start; }
+
+private:
+    chrono::nanoseconds& target;
+    chrono::steady_clock::time_point start;
+};
+
+const char* phaseName(LayoutPhase phase)
+{
+    switch (phase)
+    {
+        using enum LayoutPhase;
+    case prepare: return "prepare";
+    case mainMonitor: return "main_monitor";
+    case changeDetection: return "change_detection";
+    case occlusion: return "occlusion";
+    case distribution: return "distribution";
+    case adjustment: return "adjustment";
+    }
+    return "?";
+}
+
+const MonitorInfo* DisplayTopology::findMonitor(MonitorId id) const
+{
+    for (auto& m : monitors) if (m.id == id) return &m;
+    return nullptr;
+}
+
+const shared_ptr<const DisplayTopology>& DisplayTopology::empty()
+{
+    static const shared_ptr<const DisplayTopology> topology = make_shared<DisplayTopology>();
+    return topology;
+}
+
+const WindowInfo* DesktopSnapshot::findWindow(WindowId id) const
+{
+    for (auto& w : windows) if (w.id == id) return &w;
+    return nullptr;
+}
+
+/// sort by id, the last of duplicate ids wins
+template<typename Slot> static void sortUnique(pmr::vector<Slot>& slots)
+{
+    stable_sort(slots.begin(), slots.end(), [](auto& a, auto& b) { return a.id < b.id; });
+    auto out = slots.begin();
+    for (auto it = slots.begin(); it != slots.end(); ++it)
+        if (next(it) == slots.end() || next(it)->id != it->id) *out++ = *it;
+    slots.erase(out, slots.end());
+}
+
+static void sortBucket(CornerBucket& bucket)
+{
+    stable_sort(bucket.begin(), bucket.end(), [](auto& a, auto& b) { return a.size < b.size; });
+}
+
+static bool shouldAvoidTopRightCorner(const LayoutSettings& settings, const MonitorInfo& mon)
+{
+    if (settings.avoidTopRightCorner) return true;
+    if (settings.increaseUnitSizeForTouch && mon.touchCapable) return true;
+    return false;
+}
+
+static MonitorMetrics findMonitorMetrics(const MonitorSlot& mon,
+                                        const DesktopSnapshot& desktop,
+                                        const LayoutSettings& settings,
+                                        ThemeMetricsCache& themeMetrics)
+{
+    bool touch = settings.increaseUnitSizeForTouch && mon.info->touchCapable;
+    MonitorMetrics metrics;
+    if (desktop.theme) metrics = themeMetrics.find(*desktop.theme, mon.info->dpi, touch, desktop.topology->primaryDpi);
+    else if (touch) metrics.unitSize = metrics.unitSize * 3 / 2;
+    return metrics;
+}
+
+/// <summary>
+/// Coverage with the corner squares of the monitor with the smallest unit, which no layout makes smaller
+/// </summary>
+static const DesktopCoverage& analyzeCoverage(OcclusionAnalyzer& analyzer,
+                                              const DesktopSnapshot& desktop,
+                                              const LayoutSettings& settings,
+                                              ThemeMetricsCache& themeMetrics,
+                                              pmr::memory_resource* arena)
+{
+    pmr::vector<Rect> workAreas(arena);
+    int unitSize = numeric_limits<int>::max();
+    for (auto& m : desktop.topology->monitors)
+    {
+        workAreas.push_back(m.workArea);
+        unitSize = min(unitSize, findMonitorMetrics({ m.id, m.workArea, &m, false }, desktop, settings, themeMetrics).unitSize);
+    }
+    pmr::vector<Rect> windows(arena);
+    windows.reserve(desktop.windows.size());
+    for (auto& w : desktop.windows) windows.push_back(w.rect);
+    return analyzer.analyze(workAreas, windows, workAreas.empty() ? MonitorMetrics{}.unitSize : unitSize);
+}
+
+static void adjustWindowsInCorner(MovePlan& plan,
+                                  pmr::vector<WindowSlot>& windows,
+                                  const MonitorSlot& mon,
+                                  flags<Corner> corner,
+                                  const array<CornerBucket, 4>& mcvw,
+                                  tuple<int /*unitSize*/, Point /*borderSize*/, bool /*multiMonitor*/> settings,
+                                  int maxIncrease)
+{
+    auto [unitSize, borderSize, multiMonitor] = settings;
+    auto const& mrect = mon.rect;
+    const auto& bucket = mcvw[corner];
+    bool verticalScreen = mrect.height() > mrect.width();
+    int i = verticalScreen ? int(bucket.size() - 1) : 0;
+    using enum Corner;
+    // sizes of the other corners do not change during adjustment
+    auto dy0 = int32_t(mcvw[corner ^ bottom].size());
+    auto dxRight = int32_t(mcvw[corner ^ right].size());
+    auto dxBottomRight = int32_t(mcvw[corner ^ bottomright].size());
+    for (auto& [s, index] : bucket)
+    {
+        auto& window = windows[index];
+        if (multiMonitor && !window.info->perMonitorDpiAware)
+            borderSize = { 0, 0 }; // prevent dpi unaware windows from being resized in context of a different screen
+
+        // 1°
+        int32_t dy = max(0, dy0 - i) * unitSize - borderSize.y;
+        // 2°
+        int32_t dx = max(dxRight * unitSize, dxBottomRight * unitSize) - borderSize.x;
+        auto& wrect = window.rect;
+        if (wrect.width() + maxIncrease > mrect.width())
+        {
+            wrect.left = mrect.left - borderSize.x;
+            wrect.right = mrect.right + borderSize.x;
+        }
+        if (wrect.height() + maxIncrease > mrect.height())
+        {
+            wrect.top = mrect.top - borderSize.y;
+            wrect.bottom = mrect.bottom + borderSize.y;
+        }
+        Rect newRect = wrect;
+        if (corner & right)
+        {
+            newRect.right = mrect.right + borderSize.x - i * unitSize;
+            newRect.left = max(newRect.right - wrect.width(), mrect.left + dx);
+        }
+        else
+        {
+            newRect.left = mrect.left - borderSize.x + i * unitSize;
+            newRect.right = min(newRect.left + wrect.width(), mrect.right - dx);
+        }
+        if (corner & bottom)
+        {
+            newRect.bottom = mrect.bottom + borderSize.y - (int32_t(bucket.size()) - i - 1) * unitSize;
+            newRect.top = max(newRect.bottom - wrect.height(), mrect.top + dy);
+        }
+        else
+        {
+            newRect.top = mrect.top - borderSize.y + (int32_t(bucket.size()) - i - 1) * unitSize;
+            newRect.bottom = min(newRect.top + wrect.height(), mrect.bottom - dy);
+        }
+        wrect = newRect;
+        plan.push_back({ window.id, mon.id, corner, i, unitSize, dx, dy, wrect });
+
+        if (verticalScreen) i--;
+        else i++;
+    }
+}
+
+static void adjustWindowsInMonitorCorners(MovePlan& plan,
+                                          const pmr::vector<MonitorLayout>& layouts,
+                                          const pmr::vector<MonitorSlot>& monitors,
+                                          pmr::vector<WindowSlot>& windows,
+                                          const DesktopSnapshot& desktop,
+                                          const LayoutSettings& settings,
+                                          ThemeMetricsCache& themeMetrics)
+{
+    bool multiMonitor = monitors.size() > 1;
+    for (auto& layout : layouts)
+    {
+        auto const& mon = monitors[layout.monitor];
+        auto metrics = findMonitorMetrics(mon, desktop, settings, themeMetrics);
+        int unitSize = metrics.unitSize;
+        auto const& mrect = mon.rect;
+        const CornerEntry* only = nullptr;
+        for (auto& bucket : layout.corners)
+            if (bucket.size() == 1 && !only)
+                only = &bucket.front();
+            else if (bucket.size() > 0)
+            {
+                only = nullptr;
+                break;
+            }
+        bool verticalScreen = mrect.height() > mrect.width();
+        if (only)
+        {
+            auto const& hwndRect = windows[only->window].rect;
+            // check if window is not big enough to fill the screen
+            if ((verticalScreen && hwndRect.height() + settings.maxIncrease > mrect.height()) ||
+                (!verticalScreen && hwndRect.width() + settings.maxIncrease > mrect.width()))
+            {
+                only = nullptr;
+            }
+        }
+        if (only)
+        {
+            auto& window = windows[only->window];
+            auto& hwndRect = window.rect;
+            if (verticalScreen)
+            {
+                auto halfDelta = (mrect.height() - hwndRect.height()) / 2;
+                hwndRect = { mrect.left, mrect.top + halfDelta, mrect.left + hwndRect.width(), mrect.top + halfDelta + hwndRect.height() };
+            }
+            else
+            {
+                auto halfDelta = (mrect.width() - hwndRect.width()) / 2;
+                hwndRect = { mrect.left + halfDelta, mrect.top, mrect.left + halfDelta + hwndRect.width(), mrect.top + hwndRect.height() };
+            }
+            WindowMove move{ window.id, mon.id, Corner::topleft, 0, unitSize, 0, 0, hwndRect };
+            move.centered = true;
+            plan.push_back(move);
+        }
+        else
+        {
+            for (int i = 0; i < 4; i++)
+                adjustWindowsInCorner(plan, windows, mon, Corner(i), layout.corners,
+                                      { unitSize, { metrics.borderWidth, metrics.borderHeight }, multiMonitor }, settings.maxIncrease);
+        }
+    }
+}
+
+/// windows times monitors from which the batched main monitor search pays off, see bench --geometry
+constexpr size_t minBatchedGeometryWork = 8192;
+
+static pair<int, Corner> findMainMonitorAndCorner(Rect const &wrect, const pmr::vector<MonitorSlot>& monitors)
+{
+    size_t maxArea = 0;
+    int mon = -1;
+    Corner corner = Corner::topleft;
+    for (int m = 0; m < int(monitors.size()); m++)
+    {
+        Rect rect {};
+        Rect::intersect(rect, monitors[m].rect, wrect);
+        size_t area = rect.area();
+        if (area > maxArea)
+        {
+            mon = m;
+            maxArea = area;
+        }
+    }
+    if (mon >= 0)
+    {
+        Rect mrect = monitors[mon].rect;
+        auto minDist = mrect.diameter();
+        for(int i = 0; i < 4; i++)
+        {
+            auto c = Corner(i);
+            if (monitors[mon].avoidTopRight && c == Corner::topright) continue;
+            size_t dist = wrect.distanceFromCorner(mrect, c);
+            if(dist < minDist)
+            {
+                minDist = dist;
+                corner = c;
+            }
+        }
+    }
+    return { mon, corner };
+}
+
+static void distributeNewWindowsInCorners(MonitorLayout& layout, pmr::vector<WindowSlot>& windows, const MonitorSlot& mon,
+                                          const pmr::vector<Corner>& freeCorners, int maxIncrease)
+{
+    using enum Corner;
+    int i = 0;
+    size_t nextFree = 0;
+    array<Corner, 4> corners{ topright, bottomright, topleft, bottomleft };
+    bool smallWindowsEnded = false;
+    for (auto& [s, index] : layout.windowsBySize)
+    {
+        auto& window = windows[index];
+        if (!window.isNew || window.unmovable) continue;
+
+        if (!smallWindowsEnded && s >= mon.rect.height() - maxIncrease)
+        {
+            smallWindowsEnded = true;
+            i = 0;
+            corners = { bottomleft, bottomright, topleft, topright };
+        }
+        Corner c;
+        if (nextFree < freeCorners.size()) c = freeCorners[nextFree++];
+        else
+        {
+            c = corners[i % 4];
+            i++;
+            if (mon.avoidTopRight && c == topright)
+            {
+                c = corners[i % 4];
+                i++;
+            }
+        }
+        layout.corners[int(c)].push_back({ size_t(s), index });
+    }
+}
+
+/// <summary>
+/// Cost of placing a window at the top of the stack in a corner: the distance it travels plus the area it gains
+/// or loses, where a unit wide strip along an edge weighs as much as moving the window by the length of that edge.
+/// Windows already kept in the other corners clip it the same way as during adjustment.
+/// Big windows go to the bottom corners unless those are much more crowded.
+/// </summary>
+static int64_t cornerCost(const Rect& wrect, int32_t size, const Rect& mrect, Corner corner,
+                          const array<int32_t, 4>& keptInCorner, int unitSize, int maxIncrease)
+{
+    using enum Corner;
+    flags<Corner> c = corner;
+    int32_t width = wrect.width() + maxIncrease > mrect.width() ? mrect.width() : wrect.width();
+    int32_t height = wrect.height() + maxIncrease > mrect.height() ? mrect.height() : wrect.height();
+    int32_t x = c & right ? mrect.right - width : mrect.left;
+    int32_t y = c & bottom ? mrect.bottom - height : mrect.top;
+    int64_t cost = abs(int64_t(x) - wrect.left) + abs(int64_t(y) - wrect.top);
+
+    int32_t dx = max(keptInCorner[c ^ right], keptInCorner[c ^ bottomright]) * unitSize;
+    int32_t dy = keptInCorner[c ^ bottom] * unitSize;
+    int64_t area = int64_t(min(width, mrect.width() - dx)) * min(height, mrect.height() - dy);
+    cost += abs(int64_t(wrect.width()) * wrect.height() - area) / max(1, unitSize);
+
+    if (size >= mrect.height() - maxIncrease && !(c & bottom)) cost += mrect.width() + mrect.height();
+    return cost;
+}
+
+/// <summary>
+/// Give new windows the corners with the least total cost, see cornerCost. The n-th window in a stack
+/// is shifted by n unit sizes in both directions, so crowded corners get more expensive.
+/// Windows are added one at a time along the cheapest chain of moves between corners,
+/// which keeps the assignment optimal after every step.
+/// </summary>
+static void assignNewWindowsToCorners(MonitorLayout& layout, pmr::vector<WindowSlot>& windows, const MonitorSlot& mon,
+                                      int unitSize, int maxIncrease, pmr::memory_resource* arena)
+{
+    constexpr int64_t unreachable = numeric_limits<int64_t>::max() / 4;
+    struct Assignment
+    {
+        CornerEntry entry;
+        array<int64_t, 4> cost;
+        int corner;
+    };
+    array<int32_t, 4> kept{};
+    for (int c = 0; c < 4; c++) kept[c] = int32_t(layout.corners[c].size());
+    array<int32_t, 4> count = kept;
+    int64_t stackCost = 2 * int64_t(max(1, unitSize));
+    pmr::vector<Assignment> assigned(arena);
+    for (auto& [s, index] : layout.windowsBySize)
+    {
+        auto& window = windows[index];
+        if (!window.isNew || window.unmovable) continue;
+        Assignment added{ { size_t(s), index }, {}, -1 };
+        for (int c = 0; c < 4; c++)
+            added.cost[c] = mon.avoidTopRight && Corner(c) == Corner::topright
+                ? unreachable : cornerCost(window.rect, s, mon.rect, Corner(c), kept, unitSize, maxIncrease);
+
+        // cheapest move of an already assigned window from one corner to another
+        array<array<int64_t, 4>, 4> edge;
+        array<array<size_t, 4>, 4> edgeWindow{};
+        for (auto& row : edge) row.fill(unreachable);
+        for (size_t k = 0; k < assigned.size(); k++)
+        {
+            auto const& a = assigned[k];
+            for (int to = 0; to < 4; to++)
+                if (to != a.corner && a.cost[to] < unreachable && a.cost[to] - a.cost[a.corner] < edge[a.corner][to])
+                {
+                    edge[a.corner][to] = a.cost[to] - a.cost[a.corner];
+                    edgeWindow[a.corner][to] = k;
+                }
+        }
+        // shortest chains from the new window, moves may be cheaper than free but never form a negative cycle
+        array<int64_t, 4> distance = added.cost;
+        array<int, 4> previous{ -1, -1, -1, -1 };
+        for (int round = 0; round < 3; round++)
+            for (int from = 0; from < 4; from++)
+                for (int to = 0; to < 4; to++)
+                    if (distance[from] < unreachable && edge[from][to] < unreachable && distance[from] + edge[from][to] < distance[to])
+                    {
+                        distance[to] = distance[from] + edge[from][to];
+                        previous[to] = from;
+                    }
+        int last = 0;
+        for (int c = 1; c < 4; c++)
+            if (distance[c] + count[c] * stackCost < distance[last] + count[last] * stackCost) last = c;
+        count[last]++;
+        int c = last;
+        for (; previous[c] >= 0; c = previous[c]) assigned[edgeWindow[previous[c]][c]].corner = c;
+        added.corner = c;
+        assigned.push_back(added);
+    }
+    for (auto& a : assigned) layout.corners[a.corner].push_back(a.entry);
+}
+
+/// new windows of a monitor beyond which minDisplacement falls back to greedy assignment
+constexpr ptrdiff_t maxMinDisplacementWindows = 24;
+
+static void distributeWindowsInCorners(pmr::vector<MonitorLayout>& layouts,
+                                       pmr::vector<WindowSlot>& windows,
+                                       const pmr::vector<MonitorSlot>& monitors,
+                                       const pmr::vector<bool>& relayout,
+                                       const DesktopSnapshot& desktop,
+                                       const LayoutSettings& settings,
+                                       ThemeMetricsCache& themeMetrics,
+                                       pmr::memory_resource* arena)
+{
+    pmr::vector<int> layoutOfMonitor(monitors.size(), -1, arena);
+    for (uint32_t index = 0; index < windows.size(); index++)
+    {
+        auto& window = windows[index];
+        if (window.monitor < 0 || !relayout[window.monitor]) continue;
+        auto& layoutIndex = layoutOfMonitor[window.monitor];
+        if (layoutIndex < 0)
+        {
+            layoutIndex = int(layouts.size());
+            layouts.emplace_back(window.monitor, arena);
+        }
+        auto const& mrect = monitors[window.monitor].rect;
+        bool verticalScreen = mrect.height() > mrect.width();
+        layouts[layoutIndex].windowsBySize.push_back({ verticalScreen ? window.rect.width() : window.rect.height(), index });
+    }
+    // monitors are processed in id order
+    sort(layouts.begin(), layouts.end(), [](auto& a, auto& b) { return a.monitor < b.monitor; });
+
+    pmr::vector<Corner> freeCorners(arena);
+    for (auto& layout : layouts)
+    {
+        stable_sort(layout.windowsBySize.begin(), layout.windowsBySize.end(), [](auto& a, auto& b) { return a.first < b.first; });
+        auto& monitorCornerWindows = layout.corners;
+        for (auto& [s, index] : layout.windowsBySize)
+        {
+            auto& window = windows[index];
+            if (window.isNew || window.unmovable) continue;
+            monitorCornerWindows[int(window.corner)].push_back({ size_t(s), index });
+        }
+
+        auto const& mon = monitors[layout.monitor];
+        // with many new windows the stacks clip each other more than the chains of moves save, see bench --assignment
+        auto newWindows = count_if(layout.windowsBySize.begin(), layout.windowsBySize.end(),
+                                   [&](auto& entry) { return windows[entry.second].isNew && !windows[entry.second].unmovable; });
+        if (settings.cornerAssignment == CornerAssignment::minDisplacement && newWindows <= maxMinDisplacementWindows)
+        {
+            auto unitSize = findMonitorMetrics(mon, desktop, settings, themeMetrics).unitSize;
+            assignNewWindowsToCorners(layout, windows, mon, unitSize, settings.maxIncrease, arena);
+            for (auto& bucket : monitorCornerWindows) sortBucket(bucket);
+            continue;
+        }
+        auto const& mrect = mon.rect;
+        bool verticalScreen = mrect.height() > mrect.width();
+
+        freeCorners.clear();
+        size_t maxNumWindows = 0;
+        for (auto const& vw : monitorCornerWindows) maxNumWindows = max(maxNumWindows, vw.size());
+        using enum Corner;
+        for(auto corner: { topleft, bottomright, bottomleft, topright })
+        {
+            if (corner == topright && mon.avoidTopRight) continue;
+            auto const& vw = monitorCornerWindows[int(corner)];
+            auto const& vwToLookForBig = monitorCornerWindows[flags<Corner>(corner) ^ (verticalScreen ? Corner::right : Corner::bottom)];
+            auto freeSpace = int(maxNumWindows - vw.size());
+            for (auto& [s, _] : vwToLookForBig)
+                freeSpace -= int(int64_t(s) > (verticalScreen ? mrect.width() : mrect.height()) - settings.maxIncrease);
+            for (int i = 0; i < freeSpace; i++) freeCorners.push_back(corner);
+        }
+        distributeNewWindowsInCorners(layout, windows, mon, freeCorners, settings.maxIncrease);
+        for (auto& bucket : monitorCornerWindows) sortBucket(bucket);
+    }
+}
+
+/// <param name="relayout">set for the monitors of changed windows, both old and new ones</param>
+template<typename Placements> static bool hasChangedWindows(const Placements& oldWindowMonitor,
+                                                            pmr::vector<WindowSlot>& windows,
+                                                            const pmr::vector<MonitorSlot>& monitors,
+                                                            Point cursorPos,
+                                                            pmr::vector<bool>& relayout)
+{
+    auto leave = [&](MonitorId id)
+    {
+        auto m = lower_bound(monitors.begin(), monitors.end(), id, [](auto& slot, MonitorId id) { return slot.id < id; });
+        if (m != monitors.end() && m->id == id) relayout[m - monitors.begin()] = true;
+    };
+    bool changed = false;
+    // both lists are sorted by window, walk them together
+    auto old = oldWindowMonitor.begin();
+    for (auto& window : windows)
+    {
+        if (window.monitor < 0) continue;
+        for (; old != oldWindowMonitor.end() && old->window < window.id; ++old)
+        {
+            changed = true; // window disappeared
+            leave(old->monitor);
+        }
+        if (old == oldWindowMonitor.end() || old->window != window.id)
+        {
+            changed = true;
+            relayout[window.monitor] = true;
+            auto &mrect = monitors[window.monitor].rect;
+            if (!window.info->maximizable)
+            {
+                using enum Corner;
+                flags c = topleft;
+                if (abs(cursorPos.x - mrect.right) < abs(cursorPos.x - mrect.left)) c |= right;
+                if (abs(cursorPos.y - mrect.bottom) < abs(cursorPos.y - mrect.top)) c |= bottom;
+                window.corner = Corner(c);
+            }
+            else window.isNew = true;
+            continue;
+        }
+        if (old->monitor != monitors[window.monitor].id)
+        {
+            changed = true;
+            window.isNew = true;
+            relayout[window.monitor] = true;
+            leave(old->monitor);
+        }
+        else if (old->rect != window.rect)
+        {
+            changed = true;
+            relayout[window.monitor] = true;
+        }
+        ++old;
+    }
+    for (; old != oldWindowMonitor.end(); ++old)
+    {
+        changed = true;
+        leave(old->monitor);
+    }
+    return changed;
+}
+
+template<typename Placements> static void savePlacements(Placements& oldWindowMonitor, const pmr::vector<WindowSlot>& windows,
+                                                         const pmr::vector<MonitorSlot>& monitors)
+{
+    oldWindowMonitor.clear();
+    for (auto& window : windows)
+        if (window.monitor >= 0)
+            oldWindowMonitor.push_back({ window.id, monitors[window.monitor].id, window.corner, window.rect });
+}
+
+optional<MovePlan> LayoutEngine::arrange(const DesktopSnapshot& desktop, bool force)
+{
+    size_t estimate = 4096 + 512 * desktop.topology->monitors.size() + 256 * desktop.windows.size();
+    if (arenaBuffer.size() < estimate) arenaBuffer.resize(estimate);
+    OverflowCounter overflow;
+    optional<MovePlan> result;
+    {
+        pmr::monotonic_buffer_resource arena(arenaBuffer.data(), arenaBuffer.size(), &overflow);
+        result = arrange(desktop, force, &arena);
+    }
+    // grow the buffer for the next pass if this one did not fit
+    arenaOverflow = overflow.bytes;
+    if (overflow.bytes) arenaBuffer.resize(arenaBuffer.size() + overflow.bytes);
+    return result;
+}
+
+optional<MovePlan> LayoutEngine::arrange(const DesktopSnapshot& desktop, bool force, pmr::memory_resource* arena)
+{
+    using enum LayoutPhase;
+    timings = {};
+    scope = {};
+    pmr::vector<MonitorSlot> monitors(arena);
+    pmr::vector<WindowSlot> windows(arena);
+    {
+        PhaseTimer timer(timings, prepare);
+        auto const& displays = desktop.topology->monitors;
+        monitors.reserve(displays.size());
+        for (auto& m : displays) monitors.push_back({ m.id, m.workArea, &m, shouldAvoidTopRightCorner(settings, m) });
+        sortUnique(monitors);
+
+        windows.reserve(desktop.windows.size());
+        for (auto& w : desktop.windows) windows.push_back({ w.id, w.rect, &w });
+        sortUnique(windows);
+    }
+
+    // find main monitor for each window
+    {
+        PhaseTimer timer(timings, mainMonitor);
+        // building the columns costs more than the kernels save, unless AVX2 searches many windows on many monitors
+        pmr::vector<int> mainMonitors(arena);
+        pmr::vector<Corner> corners(arena);
+        if (bestGeometryKernel() == GeometryKernel::avx2 && windows.size() * monitors.size() >= minBatchedGeometryWork)
+        {
+            RectColumns windowRects(arena);
+            windowRects.reserve(windows.size());
+            for (auto& window : windows) windowRects.push_back(window.rect);
+            MonitorColumns monitorRects(arena);
+            monitorRects.reserve(monitors.size());
+            for (auto& mon : monitors) monitorRects.push_back(mon.rect, mon.avoidTopRight);
+            // far out coordinates are left to the per window search, whose results the kernels reproduce only within +-2^24
+            if (windowRects.vectorizable && monitorRects.vectorizable)
+            {
+                mainMonitors.resize(windows.size());
+                corners.resize(windows.size());
+                findMainMonitorsAndCorners(windowRects, monitorRects, mainMonitors, corners);
+            }
+        }
+
+        auto unmovable = unmovableWindows.begin();
+        for (size_t i = 0; i < windows.size(); i++)
+        {
+            auto& window = windows[i];
+            if (mainMonitors.empty()) tie(window.monitor, window.corner) = findMainMonitorAndCorner(window.rect, monitors);
+            else
+            {
+                window.monitor = mainMonitors[i];
+                window.corner = corners[i];
+            }
+            unmovable = lower_bound(unmovable, unmovableWindows.end(), window.id);
+            window.unmovable = unmovable != unmovableWindows.end() && *unmovable == window.id;
+        }
+    }
+
+    bool all = force || relayoutAll || desktop.topology != lastTopology || desktop.theme != lastTheme || settings != lastSettings;
+    pmr::vector<bool> relayout(monitors.size(), all, arena);
+    if (!force)
+    {
+        PhaseTimer timer(timings, changeDetection);
+        bool changed = hasChangedWindows(oldWindowMonitor, windows, monitors, desktop.cursor, relayout);
+        // a window raised above others may cover all their corners without any rect changing
+        if (settings.arrangeOnlyWhenOccluded)
+            changed |= !ranges::equal(desktop.windows, lastStacking, {}, &WindowInfo::id);
+        // forget unmovable windows which disappeared
+        erase_if(unmovableWindows, [&](WindowId w)
+        {
+            auto it = lower_bound(windows.begin(), windows.end(), w, [](auto& slot, WindowId id) { return slot.id < id; });
+            return it == windows.end() || it->id != w || it->monitor < 0;
+        });
+        // new monitors, DPI, work areas, theme or settings move windows whose rects did not change
+        if (!changed && !all) return nullopt;
+    }
+    if (settings.arrangeOnlyWhenOccluded)
+    {
+        lastStacking.clear();
+        for (auto const& w : desktop.windows) lastStacking.push_back(w.id);
+    }
+    if (!all && settings.arrangeOnlyWhenOccluded)
+    {
+        PhaseTimer timer(timings, occlusion);
+        auto const& coverage = analyzeCoverage(occlusionAnalyzer, desktop, settings, themeMetrics, arena);
+        // unmovable windows stay where they are, a pass would not give them a corner back;
+        // the monitors of the others are laid out, even when nothing changed on them
+        bool reachable = true;
+        for (size_t i = 0; i < coverage.windows.size(); i++)
+            if (auto const& c = coverage.windows[i]; c.onScreen && !c.reachable()
+                && !binary_search(unmovableWindows.begin(), unmovableWindows.end(), desktop.windows[i].id))
+            {
+                reachable = false;
+                auto it = lower_bound(windows.begin(), windows.end(), desktop.windows[i].id, [](auto& slot, WindowId id) { return slot.id < id; });
+                if (it != windows.end() && it->id == desktop.windows[i].id && it->monitor >= 0) relayout[it->monitor] = true;
+            }
+        if (reachable)
+        {
+            // the windows are accepted where they are, later passes compare with this placement
+            savePlacements(oldWindowMonitor, windows, monitors);
+            scope.allReachable = true;
+            return nullopt;
+        }
+    }
+    relayoutAll = false;
+    lastTopology = desktop.topology;
+    lastTheme = desktop.theme;
+    lastSettings = settings;
+
+    pmr::vector<MonitorLayout> layouts(arena);
+    {
+        PhaseTimer timer(timings, distribution);
+        distributeWindowsInCorners(layouts, windows, monitors, relayout, desktop, settings, themeMetrics, arena);
+    }
+
+    PhaseTimer timer(timings, adjustment);
+    MovePlan plan;
+    plan.reserve(windows.size());
+    adjustWindowsInMonitorCorners(plan, layouts, monitors, windows, desktop, settings, themeMetrics);
+    if (!force)
+    {
+        // windows already at their targets, mostly in the stacks which kept their offsets
+        erase_if(plan, [&](const WindowMove& move)
+        {
+            auto it = lower_bound(windows.begin(), windows.end(), move.window, [](auto& slot, WindowId id) { return slot.id < id; });
+            return it->info->rect == move.rect;
+        });
+    }
+    scope.monitors = layouts.size();
+    for (auto& layout : layouts) scope.windows += layout.windowsBySize.size();
+    scope.repositioned = plan.size();
+
+    // save window sizes after adjustment for size change detection to remain stable
+    savePlacements(oldWindowMonitor, windows, monitors);
+    return plan;
+}
+
+MovePlan LayoutEngine::resetPlan(const MovePlan& plan, const DesktopSnapshot& desktop)
+{
+    MovePlan result;
+    result.reserve(plan.size());
+    for (auto move : plan)
+    {
+        auto const& mrect = desktop.findMonitor(move.monitor)->workArea;
+        move.rect = { mrect.left, mrect.top, mrect.left + move.rect.width(), mrect.top + move.rect.height() };
+        result.push_back(move);
+    }
+    return result;
+}
+
+const DesktopCoverage& LayoutEngine::measureCoverage(const DesktopSnapshot& desktop)
+{
+    return analyzeCoverage(occlusionAnalyzer, desktop, settings, themeMetrics, pmr::get_default_resource());
+}
+
+void LayoutEngine::markUnmovable(WindowId w)
+{
+    if (auto it = lower_bound(unmovableWindows.begin(), unmovableWindows.end(), w); it == unmovableWindows.end() || *it != w)
+        unmovableWindows.insert(it, w);
+    erase_if(oldWindowMonitor, [w](auto& placement) { return placement.window == w; });
+}
+
+void LayoutEngine::releaseUnmovable(WindowId w)
+{
+    if (auto it = lower_bound(unmovableWindows.begin(), unmovableWindows.end(), w); it != unmovableWindows.end() && *it == w)
+        unmovableWindows.erase(it);
+    // seen as a new window by the next pass, which lays out only its monitor
+    erase_if(oldWindowMonitor, [w](auto& placement) { return placement.window == w; });
+}
+
+void LayoutEngine::updateWindowRect(WindowId w, const Rect& rect)
+{
+    auto it = lower_bound(oldWindowMonitor.begin(), oldWindowMonitor.end(), w, [](auto& p, WindowId id) { return p.window < id; });
+    if (it != oldWindowMonitor.end() && it->window == w) it->rect = rect;
+}
+
+vector<WindowId> LayoutEngine::knownWindows() const
+{
+    vector<WindowId> result;
+    result.reserve(oldWindowMonitor.size());
+    for (auto& placement : oldWindowMonitor) result.push_back(placement.window);
+    return result;
+}
+
+void LayoutEngine::clear()
+{
+    oldWindowMonitor.clear();
+    unmovableWindows.clear();
+    lastStacking.clear();
+    themeMetrics.clear();
+    relayoutAll = true;
+}
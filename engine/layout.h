@@ -0,0 +1,216 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+#include "geometry.h"
+#include "occlusion.h"
+#include "thememetrics.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// opaque platform handles (HWND/HMONITOR on Windows)
+using WindowId = std::uintptr_t;
+using MonitorId = std::uintptr_t;
+
+/// <summary>
+/// How windows which are new to a monitor are given corners
+/// </summary>
+enum class CornerAssignment : int
+{
+    greedy,          ///< fill up the emptier corners, then rotate over all of them
+    minDisplacement, ///< least total movement and resizing, see assignNewWindowsToCorners; greedy for many new windows
+};
+
+struct LayoutSettings
+{
+    int maxIncrease = 0;
+    bool avoidTopRightCorner = false;
+    bool increaseUnitSizeForTouch = true;
+    CornerAssignment cornerAssignment = CornerAssignment::greedy;
+    bool arrangeOnlyWhenOccluded = false; ///< leave changed windows alone while every window has a visible corner
+    bool animateMoves = false; ///< the windows glide to their targets, see MoveAnimator; does not change the plan
+
+    bool operator==(const LayoutSettings&) const = default;
+};
+
+struct MonitorInfo
+{
+    MonitorId id = 0;
+    Rect rect;     ///< whole monitor
+    Rect workArea; ///< without the taskbar and docked toolbars
+    std::string name;
+    unsigned dpi = 96;
+    bool touchCapable = false;
+
+    bool vertical() const { return workArea.height() > workArea.width(); }
+};
+
+/// <summary>
+/// Attached monitors. Immutable once built, shared by all passes until the display configuration changes.
+/// </summary>
+struct DisplayTopology
+{
+    std::vector<MonitorInfo> monitors;
+    MonitorId primary = 0;
+    unsigned primaryDpi = 96;
+    std::uint64_t generation = 0; ///< distinguishes rebuilt topologies
+
+    const MonitorInfo* findMonitor(MonitorId id) const;
+    /// shared topology without monitors
+    static const std::shared_ptr<const DisplayTopology>& empty();
+};
+
+struct WindowInfo
+{
+    WindowId id = 0;
+    Rect rect;
+    std::string processName;
+    std::string title;
+    bool maximizable = true;
+    bool perMonitorDpiAware = true;
+};
+
+/// <summary>
+/// Everything the layout needs to know about the desktop at the start of a pass
+/// </summary>
+struct DesktopSnapshot
+{
+    std::shared_ptr<const DisplayTopology> topology = DisplayTopology::empty(); ///< never null
+    std::vector<WindowInfo> windows; ///< eligible windows only, topmost first
+    Point cursor;
+    std::optional<ThemeSizes> theme;
+
+    const MonitorInfo* findMonitor(MonitorId id) const { return topology->findMonitor(id); }
+    const WindowInfo* findWindow(WindowId id) const;
+};
+
+struct WindowMove
+{
+    WindowId window = 0;
+    MonitorId monitor = 0;
+    flags<Corner> corner = Corner::topleft;
+    int index = 0;     ///< position in the corner stack
+    int unitSize = 0;
+    std::int32_t dx = 0;
+    std::int32_t dy = 0;
+    Rect rect;         ///< target window rect
+    bool centered = false; ///< the only window of a monitor, centered along the longer side
+};
+
+using MovePlan = std::vector<WindowMove>;
+
+enum class LayoutPhase : int
+{
+    prepare,         ///< copying and sorting the snapshot
+    mainMonitor,     ///< main monitor and nearest corner of every window
+    changeDetection, ///< comparison with the previous placement
+    occlusion,       ///< visible corners, with arrangeOnlyWhenOccluded
+    distribution,    ///< assignment of windows to corners
+    adjustment,      ///< target rects
+};
+constexpr int layoutPhaseCount = int(LayoutPhase::adjustment) + 1;
+const char* phaseName(LayoutPhase phase);
+
+/// <summary>
+/// Time spent in each phase of a pass, zero for phases the pass did not reach
+/// </summary>
+struct PassTimings
+{
+    std::array<std::chrono::nanoseconds, layoutPhaseCount> phases{};
+
+    std::chrono::nanoseconds& operator[](LayoutPhase phase) { return phases[int(phase)]; }
+    std::chrono::nanoseconds operator[](LayoutPhase phase) const { return phases[int(phase)]; }
+};
+
+/// <summary>
+/// How much of the desktop a pass laid out again
+/// </summary>
+struct PassScope
+{
+    size_t monitors = 0;     ///< monitors laid out again
+    size_t windows = 0;      ///< windows on those monitors
+    size_t repositioned = 0; ///< moves in the plan
+    bool allReachable = false; ///< windows changed, but the pass left them alone because every window had a visible corner
+};
+
+/// <summary>
+/// Platform independent window arrangement. Keeps the previous placement between passes
+/// in order to detect changes and to keep windows in their corners.
+/// </summary>
+class LayoutEngine
+{
+public:
+    LayoutSettings settings;
+
+    /// <summary>
+    /// Compute target rects for the windows of the snapshot. Without force, only monitors where a window appeared,
+    /// disappeared, or changed its rect are laid out again, and only windows which are not at their targets
+    /// are planned. Monitors, theme or settings which changed since the previous pass lay out everything.
+    /// With arrangeOnlyWhenOccluded, changed windows are only laid out when a window on screen lost all its visible corners,
+    /// which a change of the stacking order alone may cause; the monitors of such windows are laid out as well.
+    /// </summary>
+    /// <returns>nothing if the desktop did not change since the previous pass and force is not set</returns>
+    std::optional<MovePlan> arrange(const DesktopSnapshot& desktop, bool force = false);
+    /// <summary>
+    /// Moves of all planned windows to the top-left corners of their monitors
+    /// </summary>
+    static MovePlan resetPlan(const MovePlan& plan, const DesktopSnapshot& desktop);
+    /// <summary>
+    /// Visible corners and areas of the windows of the snapshot, with the smallest unit size of its monitors
+    /// </summary>
+    const DesktopCoverage& measureCoverage(const DesktopSnapshot& desktop);
+
+    /// the window refused to move, exclude it from layout until it disappears or is released
+    void markUnmovable(WindowId w);
+    /// take a window excluded by markUnmovable back into the layout of its monitor
+    void releaseUnmovable(WindowId w);
+    /// remember the actual rect of a window after it was moved
+    void updateWindowRect(WindowId w, const Rect& rect);
+    std::vector<WindowId> knownWindows() const;
+    /// the visual style changed, recompute unit and border sizes
+    void invalidateThemeMetrics()
+    {
+        themeMetrics.clear();
+        relayoutAll = true;
+    }
+    void clear();
+
+    /// <returns>bytes the last pass had to allocate beyond its arena buffer</returns>
+    size_t lastPassOverflow() const { return arenaOverflow; }
+    const PassTimings& lastPassTimings() const { return timings; }
+    const PassScope& lastPassScope() const { return scope; }
+    const ThemeMetricsCache::Stats& themeMetricsStats() const { return themeMetrics.stats(); }
+
+private:
+    std::optional<MovePlan> arrange(const DesktopSnapshot& desktop, bool force, std::pmr::memory_resource* arena);
+
+    struct Placement
+    {
+        WindowId window;
+        MonitorId monitor;
+        Corner corner;
+        Rect rect;
+    };
+
+    std::vector<Placement> oldWindowMonitor; ///< previous windows placement for tracking changes, sorted by window
+    std::vector<WindowId> unmovableWindows;  ///< sorted
+    std::vector<WindowId> lastStacking;      ///< windows of the previous pass topmost first, with arrangeOnlyWhenOccluded
+    std::vector<std::byte> arenaBuffer;      ///< backing store of the per-pass arena, grown to the largest pass
+    size_t arenaOverflow = 0;
+    PassTimings timings;
+    PassScope scope;
+    ThemeMetricsCache themeMetrics;
+    OcclusionAnalyzer occlusionAnalyzer;
+    // what the previous placement was computed for, a change lays out all monitors
+    std::shared_ptr<const DisplayTopology> lastTopology;
+    std::optional<ThemeSizes> lastTheme;
+    LayoutSettings lastSettings;
+    bool relayoutAll = true;
+};
+
+#endif // LAYOUT_H
@@ -0,0 +1,245 @@
+#include "logger.h"
+#include <bit>
+#include <cstring>
+#include <ctime>
+
+using namespace std;
+
+const char* levelName(LogLevel level)
+{
+    switch (level)
+    {
+        using enum LogLevel;
+    case trace: return "TRACE";
+    case debug: return "DEBUG";
+    case info: return "INFO";
+    case warning: return "WARN";
+    case error: return "ERROR";
+    case off: return "OFF";
+    }
+    return "?";
+}
+
+static FILE* openFile(const filesystem::path& path, const char* mode)
+{
+#ifdef _WIN32
+    FILE* file = nullptr;
+    wstring wideMode(mode, mode + strlen(mode));
+    _wfopen_s(&file, path.c_str(), wideMode.c_str());
+    return file;
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+void LogRecord::add(ArgType type, ArgValue value)
+{
+    if (argCount == maxArgs) return;
+    types[argCount] = type;
+    values[argCount] = value;
+    argCount++;
+}
+
+void LogRecord::add(string_view v)
+{
+    auto length = min(v.size(), textCapacity - textUsed);
+    v.copy(text.data() + textUsed, length);
+    ArgValue value;
+    value.text = { textUsed, uint16_t(length) };
+    add(ArgType::text, value);
+    textUsed = uint16_t(textUsed + length);
+}
+
+void LogRecord::formatTo(string& out) const
+{
+    char number[32];
+    size_t arg = 0;
+    for (const char* p = format; *p; p++)
+    {
+        if (p[0] != '{' || p[1] != '}' || arg == argCount)
+        {
+            out += *p;
+            continue;
+        }
+        p++;
+        auto v = values[arg];
+        switch (types[arg++])
+        {
+        case ArgType::signedInt: snprintf(number, sizeof(number), "%lld", (long long)v.i); break;
+        case ArgType::unsignedInt: snprintf(number, sizeof(number), "%llu", (unsigned long long)v.u); break;
+        case ArgType::hex: snprintf(number, sizeof(number), "0x%llx", (unsigned long long)v.u); break;
+        case ArgType::floating: snprintf(number, sizeof(number), "%g", v.d); break;
+        case ArgType::text:
+            out.append(text.data() + v.text.offset, v.text.length);
+            continue;
+        }
+        out += number;
+    }
+}
+
+Logger::Logger(size_t capacity) : mask(bit_ceil(max<size_t>(capacity, 2)) - 1)
+{
+    slots = make_unique<Slot[]>(mask + 1);
+    for (size_t i = 0; i <= mask; i++) slots[i].sequence.store(i, memory_order_relaxed);
+    worker = thread(&Logger::run, this);
+}
+
+Logger::~Logger()
+{
+    stopping = true;
+    idle = false;
+    idle.notify_one();
+    worker.join();
+    if (file) fclose(file);
+}
+
+bool Logger::setFile(const FileOptions& options)
+{
+    lock_guard lock(fileMutex);
+    if (file) fclose(file);
+    file = nullptr;
+    fileSize = 0;
+    fileOptions = options;
+    if (options.path.empty()) return true;
+    file = openFile(options.path, "ab");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    fileSize = uintmax_t(max(0L, ftell(file)));
+    return true;
+}
+
+void Logger::push(const LogRecord& record)
+{
+    // bounded multi-producer queue: a slot is free for position pos when its sequence equals pos
+    size_t pos = head.load(memory_order_relaxed);
+    Slot* slot;
+    for (;;)
+    {
+        slot = &slots[pos & mask];
+        auto diff = intptr_t(slot->sequence.load(memory_order_acquire)) - intptr_t(pos);
+        if (diff == 0)
+        {
+            if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        }
+        else if (diff < 0)
+        {
+            droppedRecords.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        else pos = head.load(memory_order_relaxed);
+    }
+    slot->record = record;
+    slot->sequence.store(pos + 1, memory_order_seq_cst);
+    // only the first producer after the consumer went to sleep pays for the wakeup
+    if (idle.load(memory_order_seq_cst) && idle.exchange(false)) idle.notify_one();
+}
+
+bool Logger::pending() const
+{
+    return slots[tail & mask].sequence.load(memory_order_seq_cst) == tail + 1;
+}
+
+bool Logger::pop(LogRecord& record)
+{
+    if (!pending()) return false;
+    auto& slot = slots[tail & mask];
+    record = slot.record;
+    slot.sequence.store(tail + mask + 1, memory_order_release);
+    tail++;
+    return true;
+}
+
+void Logger::flush()
+{
+    size_t target = head.load();
+    if (idle.exchange(false)) idle.notify_one();
+    for (size_t done = written.load(); done < target; done = written.load()) written.wait(done);
+}
+
+void Logger::run()
+{
+    LogRecord record;
+    string line;
+    for (;;)
+    {
+        size_t count = 0;
+        {
+            lock_guard lock(fileMutex);
+            for (; pop(record); count++) output(record, line);
+            if (count)
+            {
+                fflush(stdout);
+                if (file) fflush(file);
+            }
+        }
+        if (count)
+        {
+            written.fetch_add(count);
+            written.notify_all();
+            continue;
+        }
+        if (stopping) break;
+        idle.store(true, memory_order_seq_cst);
+        if (pending() || stopping)
+        {
+            idle = false;
+            continue;
+        }
+        idle.wait(true);
+    }
+}
+
+void Logger::output(const LogRecord& record, string& line)
+{
+    auto time = chrono::system_clock::to_time_t(record.time);
+    tm local;
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+    auto ms = chrono::duration_cast<chrono::milliseconds>(record.time.time_since_epoch()).count() % 1000;
+    char prefix[40];
+    snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d %-5s ", local.tm_hour, local.tm_min, local.tm_sec, int(ms),
+             levelName(record.level));
+    line = prefix;
+    record.formatTo(line);
+    line += '\n';
+
+    if (console.load(memory_order_relaxed)) fwrite(line.data(), 1, line.size(), stdout);
+    if (!file) return;
+    if (fileOptions.maxBytes && fileSize + line.size() > fileOptions.maxBytes && fileSize > 0) rotate();
+    if (!file) return;
+    fwrite(line.data(), 1, line.size(), file);
+    fileSize += line.size();
+}
+
+void Logger::rotate()
+{
+    fclose(file);
+    file = nullptr;
+    error_code ec;
+    auto const& path = fileOptions.path;
+    auto rotated = [&path](int i)
+    {
+        auto p = path;
+        p += '.';
+        p += to_string(i);
+        return p;
+    };
+    if (fileOptions.keep > 0)
+    {
+        filesystem::remove(rotated(fileOptions.keep), ec);
+        for (int i = fileOptions.keep - 1; i >= 1; i--) filesystem::rename(rotated(i), rotated(i + 1), ec);
+        filesystem::rename(path, rotated(1), ec);
+    }
+    else filesystem::remove(path, ec);
+    file = openFile(path, "wb");
+    fileSize = 0;
+}
+
+Logger& logger()
+{
+    static Logger instance;
+    return instance;
+}
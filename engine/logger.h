@@ -0,0 +1,159 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class LogLevel : std::uint8_t { trace, debug, info, warning, error, off };
+
+const char* levelName(LogLevel level);
+
+/// integer argument printed in hexadecimal
+struct LogHex
+{
+    std::uint64_t value;
+};
+
+/// <summary>
+/// A log message before formatting. The format string must outlive the logger (a literal),
+/// text arguments are copied into the record and truncated when they do not fit.
+/// </summary>
+struct LogRecord
+{
+    static constexpr size_t maxArgs = 12;
+    static constexpr size_t textCapacity = 192;
+    enum class ArgType : std::uint8_t { signedInt, unsignedInt, hex, floating, text };
+    union ArgValue
+    {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        struct { std::uint16_t offset; std::uint16_t length; } text;
+    };
+
+    std::chrono::system_clock::time_point time;
+    const char* format = "";
+    LogLevel level = LogLevel::info;
+    std::uint8_t argCount = 0;
+    std::uint16_t textUsed = 0;
+    std::array<ArgType, maxArgs> types;
+    std::array<ArgValue, maxArgs> values;
+    std::array<char, textCapacity> text;
+
+    void add(std::integral auto v)
+    {
+        if constexpr (std::is_signed_v<decltype(v)>) add(ArgType::signedInt, { .i = v });
+        else add(ArgType::unsignedInt, { .u = v });
+    }
+    void add(std::floating_point auto v) { add(ArgType::floating, { .d = v }); }
+    void add(LogHex v) { add(ArgType::hex, { .u = v.value }); }
+    template<typename T> void add(T* v) { add(LogHex{ std::uint64_t(reinterpret_cast<std::uintptr_t>(v)) }); }
+    void add(const char* v) { add(std::string_view(v)); }
+    void add(const std::string& v) { add(std::string_view(v)); }
+    void add(std::string_view v);
+    /// substitute the arguments for the {} placeholders of the format
+    void formatTo(std::string& out) const;
+
+private:
+    void add(ArgType type, ArgValue value);
+};
+
+/// <summary>
+/// Leveled logger. Messages are queued as fixed-size records in a lock-free ring buffer and formatted
+/// by a background thread, which writes them to the console and optionally to a rotated file.
+/// Any thread may log. A full ring drops messages instead of blocking the caller.
+/// </summary>
+class Logger
+{
+public:
+    struct FileOptions
+    {
+        std::filesystem::path path;
+        std::uintmax_t maxBytes = 1 << 20; ///< rotate when the file would grow beyond this size
+        int keep = 3;                      ///< rotated files kept as path.1 ... path.keep
+    };
+
+    /// <param name="capacity">records in the ring, rounded up to a power of two</param>
+    explicit Logger(size_t capacity = 1024);
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    void setLevel(LogLevel level) { threshold.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return threshold.load(std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= this->level(); }
+    void setConsole(bool enabled) { console.store(enabled, std::memory_order_relaxed); }
+    /// <returns>the file could be opened, empty path turns file output off</returns>
+    bool setFile(const FileOptions& options);
+
+    template<typename... Args> void write(LogLevel level, const char* format, const Args&... args)
+    {
+        static_assert(sizeof...(Args) <= LogRecord::maxArgs, "too many log arguments");
+        if (!enabled(level)) return;
+        LogRecord record;
+        record.time = std::chrono::system_clock::now();
+        record.format = format;
+        record.level = level;
+        (record.add(args), ...);
+        push(record);
+    }
+    template<typename... Args> void trace(const char* format, const Args&... args) { write(LogLevel::trace, format, args...); }
+    template<typename... Args> void debug(const char* format, const Args&... args) { write(LogLevel::debug, format, args...); }
+    template<typename... Args> void info(const char* format, const Args&... args) { write(LogLevel::info, format, args...); }
+    template<typename... Args> void warning(const char* format, const Args&... args) { write(LogLevel::warning, format, args...); }
+    template<typename... Args> void error(const char* format, const Args&... args) { write(LogLevel::error, format, args...); }
+
+    /// <summary>
+    /// Wait until every record queued so far is written
+    /// </summary>
+    void flush();
+    /// messages lost because the ring was full
+    size_t dropped() const { return droppedRecords.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    void push(const LogRecord& record);
+    bool pop(LogRecord& record);
+    bool pending() const;
+    void run();
+    void output(const LogRecord& record, std::string& line);
+    void rotate();
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    std::atomic<size_t> head = 0; ///< next slot to write, shared by producers
+    size_t tail = 0;              ///< next slot to read, consumer only
+    std::atomic<size_t> written = 0;
+    std::atomic<bool> idle = false;
+    std::atomic<bool> stopping = false;
+    std::atomic<size_t> droppedRecords = 0;
+    std::atomic<LogLevel> threshold = LogLevel::info;
+    std::atomic<bool> console = true;
+
+    std::mutex fileMutex;         ///< guards the file, taken by the consumer and setFile only
+    FileOptions fileOptions;
+    std::FILE* file = nullptr;
+    std::uintmax_t fileSize = 0;
+    std::thread worker;
+};
+
+/// <summary>
+/// The process-wide logger, started on first use
+/// </summary>
+Logger& logger();
+
+#endif // LOGGER_H
@@ -0,0 +1,187 @@
+#include "metrics.h"
+#include <bit>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+void Histogram::record(uint64_t value)
+{
+    buckets[bucketOf(value)]++;
+    total++;
+    sum += value;
+    minimum = (std::min)(minimum, value);
+    maximum = (std::max)(maximum, value);
+}
+
+uint64_t Histogram::percentile(double p) const
+{
+    if (!total) return 0;
+    auto rank = uint64_t(p / 100 * double(total) + 0.5);
+    rank = clamp<uint64_t>(rank, 1, total);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); b++)
+    {
+        seen += buckets[b];
+        if (seen >= rank) return (std::min)(upperBound(b), maximum);
+    }
+    return maximum;
+}
+
+size_t Histogram::bucketOf(uint64_t value)
+{
+    constexpr uint64_t exact = 1 << subBits;
+    if (value < exact) return size_t(value);
+    int width = bit_width(value);
+    int shift = width - 1 - subBits;
+    auto sub = size_t(value >> shift) & (exact - 1);
+    return (size_t(width - subBits) << subBits) + sub;
+}
+
+uint64_t Histogram::upperBound(size_t bucket)
+{
+    constexpr size_t exact = 1 << subBits;
+    if (bucket < exact) return bucket;
+    int width = int(bucket >> subBits) + subBits;
+    int shift = width - 1 - subBits;
+    uint64_t lower = uint64_t(exact + (bucket & (exact - 1))) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+const char* timerName(Timer timer)
+{
+    switch (timer)
+    {
+        using enum Timer;
+    case enumerate: return "enumerate";
+    case classify: return "classify";
+    case prepare: return "prepare";
+    case monitorAssignment: return "monitor_assignment";
+    case changeDetection: return "change_detection";
+    case occlusion: return "occlusion";
+    case distribution: return "distribution";
+    case adjustment: return "adjustment";
+    case move: return "move";
+    case pass: return "pass";
+    case requestToLastMove: return "request_to_last_move";
+    case toggleMinimize: return "toggle_minimize";
+    }
+    return "?";
+}
+
+const char* counterName(Counter counter)
+{
+    switch (counter)
+    {
+        using enum Counter;
+    case passes: return "passes";
+    case changedPasses: return "changed_passes";
+    case unchangedPasses: return "unchanged_passes";
+    case windowsEnumerated: return "windows_enumerated";
+    case windowsMoved: return "windows_moved";
+    case movesSkipped: return "moves_skipped";
+    case movesFailed: return "moves_failed";
+    case movesDeferred: return "moves_deferred";
+    case fingerprintChecks: return "fingerprint_checks";
+    case fingerprintHits: return "fingerprint_hits";
+    case monitorsRelaid: return "monitors_relaid";
+    case windowsRepositioned: return "windows_repositioned";
+    case windowsFiltered: return "windows_filtered";
+    case occlusionSkips: return "occlusion_skips";
+    case animationFrames: return "animation_frames";
+    case animationJumps: return "animation_jumps";
+    }
+    return "?";
+}
+
+void MetricsCollector::record(Timer timer, Duration duration)
+{
+    lock_guard lock(mutex);
+    timers[int(timer)].record(uint64_t((std::max)(chrono::nanoseconds(0), chrono::duration_cast<chrono::nanoseconds>(duration)).count()));
+}
+
+void MetricsCollector::add(Counter counter, uint64_t n)
+{
+    lock_guard lock(mutex);
+    counters[int(counter)] += n;
+}
+
+void MetricsCollector::recordPhases(const PassTimings& timings)
+{
+    using enum LayoutPhase;
+    static constexpr pair<LayoutPhase, Timer> phases[] = {
+        { prepare, Timer::prepare }, { mainMonitor, Timer::monitorAssignment }, { changeDetection, Timer::changeDetection },
+        { occlusion, Timer::occlusion }, { distribution, Timer::distribution }, { adjustment, Timer::adjustment },
+    };
+    for (auto [phase, timer] : phases)
+        if (timings[phase].count()) record(timer, timings[phase]);
+}
+
+Histogram MetricsCollector::histogram(Timer timer) const
+{
+    lock_guard lock(mutex);
+    return timers[int(timer)];
+}
+
+uint64_t MetricsCollector::value(Counter counter) const
+{
+    lock_guard lock(mutex);
+    return counters[int(counter)];
+}
+
+string MetricsCollector::toJson(TimePoint now) const
+{
+    lock_guard lock(mutex);
+    ostringstream out;
+    out << "{\"uptime_s\":" << chrono::duration<double>(now - start).count() << ",\"counters\":{";
+    for (int i = 0; i < counterCount; i++)
+        out << (i ? "," : "") << '"' << counterName(Counter(i)) << "\":" << counters[i];
+    out << "},\"timers_ns\":{";
+    bool first = true;
+    for (int i = 0; i < timerCount; i++)
+    {
+        auto const& h = timers[i];
+        if (!h.count()) continue;
+        out << (first ? "" : ",") << '"' << timerName(Timer(i)) << "\":{\"count\":" << h.count() << ",\"min\":" << h.minValue()
+            << ",\"mean\":" << uint64_t(h.mean()) << ",\"p50\":" << h.percentile(50) << ",\"p90\":" << h.percentile(90)
+            << ",\"p99\":" << h.percentile(99) << ",\"max\":" << h.maxValue() << '}';
+        first = false;
+    }
+    out << "}}";
+    return out.str();
+}
+
+void MetricsCollector::setFile(const filesystem::path& path, Duration interval)
+{
+    lock_guard lock(mutex);
+    file = path;
+    fileInterval = interval;
+    lastWrite.reset();
+}
+
+bool MetricsCollector::tick(TimePoint now)
+{
+    {
+        lock_guard lock(mutex);
+        if (file.empty() || (lastWrite && now - *lastWrite < fileInterval)) return false;
+    }
+    return writeFile(now);
+}
+
+bool MetricsCollector::writeFile(TimePoint now)
+{
+    auto json = toJson(now);
+    lock_guard lock(mutex);
+    if (file.empty()) return false;
+    lastWrite = now;
+    // readers never see a partially written file
+    auto temporary = file;
+    temporary += ".tmp";
+    {
+        ofstream out(temporary, ios::trunc);
+        if (!(out << json << '\n')) return false;
+    }
+    error_code ec;
+    filesystem::rename(temporary, file, ec);
+    return !ec;
+}
@@ -0,0 +1,119 @@
+#ifndef METRICS_H
+#define METRICS_H
+#include "eventcoalescer.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+
+/// <summary>
+/// Log-linear histogram of non-negative values, 16 buckets per power of two,
+/// so percentiles are exact below 16 and within 1/16 above
+/// </summary>
+class Histogram
+{
+public:
+    void record(std::uint64_t value);
+    std::uint64_t count() const { return total; }
+    std::uint64_t minValue() const { return total ? minimum : 0; }
+    std::uint64_t maxValue() const { return maximum; }
+    double mean() const { return total ? double(sum) / double(total) : 0; }
+    /// <param name="p">0 to 100</param>
+    /// <returns>upper bound of the bucket holding the percentile, 0 when empty</returns>
+    std::uint64_t percentile(double p) const;
+
+    static constexpr int subBits = 4;
+    static size_t bucketOf(std::uint64_t value);
+    /// <returns>largest value falling into the bucket</returns>
+    static std::uint64_t upperBound(size_t bucket);
+
+private:
+
+    std::array<std::uint64_t, (64 - subBits + 1) << subBits> buckets{};
+    std::uint64_t total = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t minimum = UINT64_MAX;
+    std::uint64_t maximum = 0;
+};
+
+enum class Timer
+{
+    enumerate,         ///< EnumWindows with the metadata of the windows
+    classify,          ///< classification of windows missing from the verdict cache
+    prepare,
+    monitorAssignment,
+    changeDetection,
+    occlusion,         ///< visible corners of the windows, with arrangeOnlyWhenOccluded
+    distribution,
+    adjustment,
+    move,              ///< committing the move plan
+    pass,              ///< whole pass from snapshot to last move
+    requestToLastMove, ///< first queued user request (tray click, settings change) to the last move
+    toggleMinimize,    ///< tray click to the last window minimized or restored
+};
+constexpr int timerCount = int(Timer::toggleMinimize) + 1;
+
+enum class Counter
+{
+    passes,
+    changedPasses,   ///< the desktop changed, a plan was computed
+    unchangedPasses,
+    windowsEnumerated,
+    windowsMoved,
+    movesSkipped,    ///< already in place
+    movesFailed,     ///< the window refused to move and is excluded from the layout
+    movesDeferred,   ///< the window is hung or slow and is retried after a backoff
+    fingerprintChecks,
+    fingerprintHits, ///< checks answered by the desktop fingerprint alone, without a full pass
+    monitorsRelaid,  ///< monitors laid out again by changed passes
+    windowsRepositioned, ///< planned moves, only windows of changed stacks unless the pass was forced
+    windowsFiltered, ///< excluded by the window rules
+    occlusionSkips,  ///< changed passes which left the windows alone, every window had a visible corner
+    animationFrames, ///< frames committed while animating moves
+    animationJumps,  ///< animated windows sent straight to their targets because frames took too long
+};
+constexpr int counterCount = int(Counter::animationJumps) + 1;
+
+const char* timerName(Timer timer);
+const char* counterName(Counter counter);
+
+/// <summary>
+/// Timers and counters of arrangement passes, exported as JSON on demand and to a metrics file
+/// rewritten at most once per interval. Safe to use from several threads.
+/// </summary>
+class MetricsCollector
+{
+public:
+    explicit MetricsCollector(TimePoint start = SteadyClock::now()) : start(start) {}
+
+    void record(Timer timer, Duration duration);
+    void add(Counter counter, std::uint64_t n = 1);
+    /// record the phases the pass reached
+    void recordPhases(const PassTimings& timings);
+
+    Histogram histogram(Timer timer) const;
+    std::uint64_t value(Counter counter) const;
+    std::string toJson(TimePoint now = SteadyClock::now()) const;
+
+    /// <summary>
+    /// Rewrite the file from tick at most once per interval, empty path turns the file off
+    /// </summary>
+    void setFile(const std::filesystem::path& path, Duration interval = std::chrono::seconds(10));
+    /// <returns>the file was rewritten</returns>
+    bool tick(TimePoint now = SteadyClock::now());
+    /// write the file now, replacing it atomically
+    bool writeFile(TimePoint now = SteadyClock::now());
+
+private:
+    mutable std::mutex mutex;
+    TimePoint start;
+    std::array<Histogram, timerCount> timers;
+    std::array<std::uint64_t, counterCount> counters{};
+    std::filesystem::path file;
+    Duration fileInterval{};
+    std::optional<TimePoint> lastWrite;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,334 @@
+#include "moveexecutor.h"
+
+using namespace std;
+
+static void countStatuses(MoveResult& result)
+{
+    for (auto s : result.status)
+        switch (s)
+        {
+        case MoveStatus::skipped: result.skipped++; break;
+        case MoveStatus::moved: result.committed++; break;
+        case MoveStatus::failed: result.failed++; break;
+        case MoveStatus::hung:
+        case MoveStatus::timedOut:
+        case MoveStatus::quarantined: result.deferred++; break;
+        }
+}
+
+MoveResult executeMovePlan(const MovePlan& plan, WindowMoveBackend& backend)
+{
+    MoveResult result;
+    result.status.resize(plan.size(), MoveStatus::skipped);
+    vector<WindowMove> pending;
+    vector<size_t> pendingIndex;
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        auto current = backend.currentRect(plan[i].window);
+        if (!current) result.status[i] = MoveStatus::failed;
+        else if (*current != plan[i].rect)
+        {
+            pending.push_back(plan[i]);
+            pendingIndex.push_back(i);
+        }
+    }
+
+    if (pending.size() > 1 && backend.moveBatch(pending))
+    {
+        result.batches++;
+        for (auto i : pendingIndex) result.status[i] = MoveStatus::moved;
+    }
+    else
+    {
+        if (pending.size() > 1) result.fallbacks++;
+        for (size_t j = 0; j < pending.size(); j++)
+        {
+            auto& move = pending[j];
+            auto current = backend.currentRect(move.window);
+            if (current && *current == move.rect) result.status[pendingIndex[j]] = MoveStatus::moved; // done by the failed transaction
+            else result.status[pendingIndex[j]] = current && backend.moveWindow(move) ? MoveStatus::moved : MoveStatus::failed;
+        }
+    }
+
+    countStatuses(result);
+    return result;
+}
+
+MoveResult MoveDispatcher::execute(const MovePlan& plan)
+{
+    MoveResult result;
+    result.status.resize(plan.size(), MoveStatus::skipped);
+    auto now = clock.now();
+    struct Outstanding
+    {
+        size_t index;
+        Rect before;
+    };
+    vector<Outstanding> outstanding;
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        auto const& move = plan[i];
+        auto current = backend.currentRect(move.window);
+        if (!current) result.status[i] = MoveStatus::failed;
+        else if (*current == move.rect) quarantine.erase(move.window); // a slow move took effect after all
+        else if (quarantined(move.window, now)) result.status[i] = MoveStatus::quarantined;
+        else if (backend.isHung(move.window))
+        {
+            result.status[i] = MoveStatus::hung;
+            penalize(move.window, now);
+        }
+        else outstanding.push_back({ i, *current });
+    }
+
+    auto postEach = [&]
+    {
+        erase_if(outstanding, [&](const Outstanding& o)
+        {
+            if (backend.postMove(plan[o.index])) return false;
+            result.status[o.index] = MoveStatus::failed;
+            return true;
+        });
+    };
+    // one transaction repaints the windows together
+    vector<WindowMove> batch;
+    for (auto const& o : outstanding) batch.push_back(plan[o.index]);
+    bool batched = batch.size() > 1 && backend.postBatch(batch);
+    if (batched) result.batches++;
+    else postEach();
+
+    // a move is done when the window changed at all, the application may have constrained its size
+    auto deadline = now + options.timeout;
+    auto batchDeadline = now + options.batchTimeout;
+    while (!outstanding.empty())
+    {
+        erase_if(outstanding, [&](const Outstanding& o)
+        {
+            auto const& move = plan[o.index];
+            auto current = backend.currentRect(move.window);
+            if (current && *current == o.before && *current != move.rect) return false;
+            result.status[o.index] = current ? MoveStatus::moved : MoveStatus::failed;
+            quarantine.erase(move.window);
+            return true;
+        });
+        now = clock.now();
+        if (outstanding.empty() || now >= deadline) break;
+        if (batched && now >= batchDeadline)
+        {
+            // a window which answered too late holds back the transaction, the others should not wait for it
+            batched = false;
+            result.fallbacks++;
+            postEach();
+            continue;
+        }
+        auto wake = (std::min)(deadline, now + options.pollInterval);
+        if (batched) wake = (std::min)(wake, batchDeadline);
+        clock.sleepUntil(wake);
+    }
+    for (auto const& o : outstanding)
+    {
+        result.status[o.index] = MoveStatus::timedOut;
+        penalize(plan[o.index].window, now);
+    }
+
+    countStatuses(result);
+    return result;
+}
+
+bool MoveDispatcher::quarantined(WindowId w, TimePoint now) const
+{
+    auto it = quarantine.find(w);
+    return it != quarantine.end() && now < it->second.retryAt;
+}
+
+vector<WindowId> MoveDispatcher::takeReleased(TimePoint now)
+{
+    vector<WindowId> result;
+    for (auto& [w, penalty] : quarantine)
+        if (!penalty.released && now >= penalty.retryAt)
+        {
+            penalty.released = true;
+            result.push_back(w);
+        }
+    return result;
+}
+
+bool MoveDispatcher::releaseDue(TimePoint now) const
+{
+    return any_of(quarantine.begin(), quarantine.end(), [now](auto& item) { return !item.second.released && now >= item.second.retryAt; });
+}
+
+void MoveDispatcher::prune(const DesktopSnapshot& desktop)
+{
+    erase_if(quarantine, [&](auto& item) { return !desktop.findWindow(item.first); });
+}
+
+void MoveDispatcher::penalize(WindowId w, TimePoint now)
+{
+    // the strikes are kept after the release, so a window which keeps hanging is retried less and less often
+    auto& penalty = quarantine[w];
+    auto delay = options.firstRetry;
+    for (int i = 0; i < penalty.strikes && delay < options.maxRetry; i++) delay *= 2;
+    penalty.strikes++;
+    penalty.retryAt = now + (std::min)(delay, options.maxRetry);
+    penalty.released = false;
+}
+
+optional<Rect> RecordingMoveBackend::currentRect(WindowId w)
+{
+    if (auto it = windows.find(w); it != windows.end()) return it->second;
+    return nullopt;
+}
+
+bool RecordingMoveBackend::moveBatch(const vector<WindowMove>& moves)
+{
+    if (failBatches) return false;
+    for (auto& move : moves)
+        if (unmovable.contains(move.window) || !windows.contains(move.window)) return false;
+    for (auto& move : moves) windows[move.window] = move.rect;
+    batches.push_back(moves);
+    return true;
+}
+
+bool RecordingMoveBackend::moveWindow(const WindowMove& move)
+{
+    if (unmovable.contains(move.window) || !windows.contains(move.window)) return false;
+    windows[move.window] = move.rect;
+    singleMoves.push_back(move);
+    return true;
+}
+
+size_t RecordingMoveBackend::committedMoves() const
+{
+    size_t result = singleMoves.size();
+    for (auto& batch : batches) result += batch.size();
+    return result;
+}
+
+Duration SimulatedMoveBackend::delay(WindowId w) const
+{
+    auto it = delays.find(w);
+    return it == delays.end() ? Duration() : it->second;
+}
+
+Duration SimulatedMoveBackend::repaintCost(WindowId w) const
+{
+    auto it = repaintTimes.find(w);
+    return it == repaintTimes.end() ? repaintTime : it->second;
+}
+
+optional<TimePoint> SimulatedMoveBackend::due(const Transaction& transaction) const
+{
+    // the windows answer one after the other and are repainted together
+    Duration answers{};
+    Duration repaints{};
+    for (auto const& move : transaction.moves)
+    {
+        if (!responsive(move.window)) return nullopt;
+        answers += delay(move.window);
+        repaints += repaintCost(move.window);
+    }
+    return transaction.started + answers + repaints;
+}
+
+void SimulatedMoveBackend::process()
+{
+    // every query of a frame would walk the queue again
+    auto now = clock.now();
+    if (processedAt == now) return;
+    processedAt = now;
+    // the next transaction starts when the one before it was committed
+    while (transaction)
+    {
+        auto done = due(*transaction);
+        if (!done || now < *done) break;
+        for (auto const& move : transaction->moves)
+            if (windows.contains(move.window)) windows[move.window] = move.rect;
+        batches.push_back(move(transaction->moves));
+        transaction.reset();
+        if (waiting)
+        {
+            transaction = Transaction{ move(*waiting), *done };
+            waiting.reset();
+        }
+    }
+
+    // posted moves take effect in order, a slow move holds back the later ones of its window
+    set<WindowId> blocked;
+    erase_if(queue, [&](const PostedMove& posted)
+    {
+        auto w = posted.move.window;
+        if (blocked.contains(w) || !responsive(w) || now < posted.posted + delay(w) + repaintCost(w) || !windows.contains(w))
+        {
+            blocked.insert(w);
+            return false;
+        }
+        windows[w] = posted.move.rect;
+        singleMoves.push_back(posted.move);
+        return true;
+    });
+}
+
+optional<Rect> SimulatedMoveBackend::currentRect(WindowId w)
+{
+    spend(1);
+    process();
+    return RecordingMoveBackend::currentRect(w);
+}
+
+bool SimulatedMoveBackend::postMove(const WindowMove& move)
+{
+    spend(1);
+    if (unmovable.contains(move.window) || !windows.contains(move.window)) return false;
+    posted++;
+    queue.push_back({ move, clock.now() });
+    processedAt.reset();
+    return true;
+}
+
+bool SimulatedMoveBackend::postBatch(const vector<WindowMove>& moves)
+{
+    spend(moves.size());
+    process();
+    for (auto const& move : moves)
+        if (unmovable.contains(move.window) || !windows.contains(move.window)) return false;
+    auto now = clock.now();
+    if (transaction && now - transaction->started >= stuckAfter) return false;
+    postedBatches++;
+    processedAt.reset();
+    vector<WindowMove> batch;
+    for (auto const& move : moves)
+        if (responsive(move.window) && delay(move.window) <= probeTimeout) batch.push_back(move);
+        else
+        {
+            posted++;
+            queue.push_back({ move, now });
+        }
+    if (batch.empty()) return true;
+    if (transaction) waiting = move(batch);
+    else transaction = Transaction{ move(batch), now };
+    return true;
+}
+
+void SimulatedMoveBackend::repaint(WindowId w)
+{
+    clock.sleepUntil(clock.now() + repaintCost(w));
+}
+
+void SimulatedMoveBackend::spend(size_t windows)
+{
+    if (callTime > Duration()) clock.sleepUntil(clock.now() + callTime * Duration::rep(windows));
+}
+
+bool SimulatedMoveBackend::moveBatch(const vector<WindowMove>& moves)
+{
+    if (!RecordingMoveBackend::moveBatch(moves)) return false;
+    for (auto const& move : moves) repaint(move.window);
+    return true;
+}
+
+bool SimulatedMoveBackend::moveWindow(const WindowMove& move)
+{
+    if (!RecordingMoveBackend::moveWindow(move)) return false;
+    repaint(move.window);
+    return true;
+}
@@ -0,0 +1,193 @@
+#ifndef MOVEEXECUTOR_H
+#define MOVEEXECUTOR_H
+#include "clock.h"
+#include "layout.h"
+#include <map>
+#include <set>
+
+/// <summary>
+/// Platform operations needed to apply a move plan
+/// </summary>
+class WindowMoveBackend
+{
+public:
+    virtual ~WindowMoveBackend() = default;
+    /// <returns>nothing if the window no longer exists</returns>
+    virtual std::optional<Rect> currentRect(WindowId w) = 0;
+    /// <summary>
+    /// Move all windows in a single transaction (DeferWindowPos on Windows)
+    /// </summary>
+    /// <returns>false if the transaction failed, some of the windows may have moved anyway</returns>
+    virtual bool moveBatch(const std::vector<WindowMove>& moves) = 0;
+    virtual bool moveWindow(const WindowMove& move) = 0;
+    /// the thread of the window stopped processing messages, a synchronous move would block
+    virtual bool isHung(WindowId w) { (void)w; return false; }
+    /// <summary>
+    /// Start moving the window without waiting for its thread (SWP_ASYNCWINDOWPOS on Windows)
+    /// </summary>
+    /// <returns>false if the move was refused</returns>
+    virtual bool postMove(const WindowMove& move) { return moveWindow(move); }
+    /// <summary>
+    /// Start moving the windows in a single transaction without waiting for it. Windows whose threads
+    /// do not answer at once are left out of the transaction and posted one by one.
+    /// </summary>
+    /// <returns>false if the backend cannot, the moves have to be posted one by one</returns>
+    virtual bool postBatch(const std::vector<WindowMove>& moves) { (void)moves; return false; }
+};
+
+enum class MoveStatus
+{
+    skipped,
+    moved,
+    failed,      ///< the window disappeared or refused the move
+    hung,        ///< not attempted, the window is hung
+    timedOut,    ///< the window did not process the move in time
+    quarantined, ///< not attempted, the window is waiting for its next retry
+};
+
+struct MoveResult
+{
+    std::vector<MoveStatus> status; ///< one per planned move
+    size_t skipped = 0;   ///< windows already at their target rect
+    size_t committed = 0; ///< windows actually moved
+    size_t failed = 0;
+    size_t deferred = 0;  ///< hung, timed out or quarantined windows, retried later
+    size_t batches = 0;   ///< committed transactions
+    size_t fallbacks = 0; ///< transactions replaced by moving one window at a time
+};
+
+/// <summary>
+/// Apply a move plan with as few moves as possible: moves to the current rect are dropped
+/// and the rest is committed in one transaction, falling back to moving windows one by one
+/// </summary>
+MoveResult executeMovePlan(const MovePlan& plan, WindowMoveBackend& backend);
+
+/// <summary>
+/// Applies move plans without ever blocking on a hung window. The moves are posted as one transaction,
+/// or to the window threads one by one when the backend cannot batch them or the transaction takes too long.
+/// The dispatcher waits a bounded time for them to take effect, and windows which are hung or too slow
+/// are quarantined, with the retry delay doubling at every further failure until a move succeeds.
+/// </summary>
+class MoveDispatcher
+{
+public:
+    struct Options
+    {
+        Duration timeout = std::chrono::milliseconds(500); ///< for all moves of a plan together
+        Duration batchTimeout = std::chrono::milliseconds(200); ///< before windows the transaction did not move are posted one by one
+        Duration pollInterval = std::chrono::milliseconds(10);
+        Duration firstRetry = std::chrono::seconds(5);
+        Duration maxRetry = std::chrono::minutes(10);
+    };
+
+    MoveDispatcher(WindowMoveBackend& backend, Clock& clock) : MoveDispatcher(backend, clock, Options()) {}
+    MoveDispatcher(WindowMoveBackend& backend, Clock& clock, Options options)
+        : backend(backend), clock(clock), options(options) {}
+
+    MoveResult execute(const MovePlan& plan);
+    bool quarantined(WindowId w, TimePoint now) const;
+    /// <returns>windows whose quarantine ended since the previous call, they may be laid out again</returns>
+    std::vector<WindowId> takeReleased(TimePoint now);
+    /// takeReleased would return some windows
+    bool releaseDue(TimePoint now) const;
+    /// forget quarantined windows which no longer exist
+    void prune(const DesktopSnapshot& desktop);
+    size_t quarantineSize() const { return quarantine.size(); }
+
+private:
+    struct Penalty
+    {
+        int strikes = 0;
+        TimePoint retryAt;
+        bool released = false;
+    };
+
+    void penalize(WindowId w, TimePoint now);
+
+    WindowMoveBackend& backend;
+    Clock& clock;
+    Options options;
+    std::map<WindowId, Penalty> quarantine;
+};
+
+/// <summary>
+/// In-memory backend which records committed moves
+/// </summary>
+class RecordingMoveBackend : public WindowMoveBackend
+{
+public:
+    std::map<WindowId, Rect> windows;
+    std::set<WindowId> unmovable;   ///< moves of these windows fail
+    bool failBatches = false;
+    std::vector<std::vector<WindowMove>> batches; ///< committed transactions
+    std::vector<WindowMove> singleMoves;          ///< committed one window moves
+
+    std::optional<Rect> currentRect(WindowId w) override;
+    bool moveBatch(const std::vector<WindowMove>& moves) override;
+    bool moveWindow(const WindowMove& move) override;
+    size_t committedMoves() const;
+};
+
+/// <summary>
+/// Recording backend whose windows take time to process posted moves, measured on a virtual clock.
+/// Hung windows are reported as such, stalled ones never process a move but are not reported; either
+/// processes its moves once it is neither. Moves take the repaint time of every window moved: synchronous
+/// ones pass it on the clock, posted ones take effect that much later. Posted transactions are committed
+/// one after the other, each once all its windows answered, and a newer batch replaces one still waiting.
+/// Changes to hung, stalled or the delays show once the clock moves on or something is posted.
+/// </summary>
+class SimulatedMoveBackend : public RecordingMoveBackend
+{
+public:
+    explicit SimulatedMoveBackend(Clock& clock) : clock(clock) {}
+
+    std::set<WindowId> hung;
+    std::set<WindowId> stalled;
+    std::map<WindowId, Duration> delays; ///< until a posted move takes effect, immediate if missing
+    std::map<WindowId, Duration> repaintTimes; ///< of a move, repaintTime if missing
+    Duration repaintTime{};
+    Duration callTime{}; ///< a query or a post of one window passes this on the clock, the CPU time of the call
+    Duration probeTimeout = std::chrono::milliseconds(50); ///< windows slower to answer are left out of transactions
+    Duration stuckAfter = std::chrono::seconds(1); ///< a transaction running longer makes postBatch refuse
+    size_t posted = 0;
+    size_t postedBatches = 0;
+
+    std::optional<Rect> currentRect(WindowId w) override;
+    bool moveBatch(const std::vector<WindowMove>& moves) override;
+    bool moveWindow(const WindowMove& move) override;
+    bool isHung(WindowId w) override { return hung.contains(w); }
+    bool postMove(const WindowMove& move) override;
+    bool postBatch(const std::vector<WindowMove>& moves) override;
+
+private:
+    struct PostedMove
+    {
+        WindowMove move;
+        TimePoint posted;
+    };
+
+    struct Transaction
+    {
+        std::vector<WindowMove> moves;
+        TimePoint started;
+    };
+
+    bool responsive(WindowId w) const { return !hung.contains(w) && !stalled.contains(w); }
+    Duration delay(WindowId w) const;
+    Duration repaintCost(WindowId w) const;
+    /// <returns>nothing while one of its windows does not answer</returns>
+    std::optional<TimePoint> due(const Transaction& transaction) const;
+    /// apply the transactions and posted moves which took effect by now
+    void process();
+    void repaint(WindowId w);
+    /// pass the time of calls for that many windows
+    void spend(size_t windows);
+
+    Clock& clock;
+    std::optional<TimePoint> processedAt; ///< nothing took effect since, until the clock moves on or something is posted
+    std::vector<PostedMove> queue;
+    std::optional<Transaction> transaction;          ///< being committed
+    std::optional<std::vector<WindowMove>> waiting;  ///< committed after it
+};
+
+#endif // MOVEEXECUTOR_H
@@ -0,0 +1,111 @@
+#include "occlusion.h"
+#include <bit>
+
+using namespace std;
+
+static int64_t floorDiv(int64_t a, int64_t b)
+{
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+static int64_t ceilDiv(int64_t a, int64_t b)
+{
+    return -floorDiv(-a, b);
+}
+
+/// bits first to last - 1 of a word, last at most 64
+static uint64_t bitRange(int64_t first, int64_t last)
+{
+    uint64_t upper = last >= 64 ? ~uint64_t(0) : (uint64_t(1) << last) - 1;
+    return upper & ~((uint64_t(1) << first) - 1);
+}
+
+OcclusionAnalyzer::Cells OcclusionAnalyzer::wholeCells(const Rect& r) const
+{
+    int64_t x = origin.x, y = origin.y;
+    return { clamp<int64_t>(ceilDiv(r.left - x, cellSize), 0, columns), clamp<int64_t>(ceilDiv(r.top - y, cellSize), 0, rows),
+             clamp<int64_t>(floorDiv(r.right - x, cellSize), 0, columns), clamp<int64_t>(floorDiv(r.bottom - y, cellSize), 0, rows) };
+}
+
+uint64_t OcclusionAnalyzer::countFree(const Cells& cells) const
+{
+    uint64_t free = 0;
+    for (int64_t y = cells.top; y < cells.bottom; y++)
+    {
+        auto row = bitmap.data() + size_t(y) * rowWords;
+        for (int64_t w = cells.left / 64; w * 64 < cells.right; w++)
+        {
+            auto mask = bitRange((std::max<int64_t>)(cells.left - w * 64, 0), cells.right - w * 64);
+            free += popcount(~row[w] & mask);
+        }
+    }
+    return free;
+}
+
+void OcclusionAnalyzer::setCovered(const Cells& cells, bool covered)
+{
+    for (int64_t y = cells.top; y < cells.bottom; y++)
+    {
+        auto row = bitmap.data() + size_t(y) * rowWords;
+        for (int64_t w = cells.left / 64; w * 64 < cells.right; w++)
+        {
+            auto mask = bitRange((std::max<int64_t>)(cells.left - w * 64, 0), cells.right - w * 64);
+            if (covered) row[w] |= mask;
+            else row[w] &= ~mask;
+        }
+    }
+}
+
+const DesktopCoverage& OcclusionAnalyzer::analyze(span<const Rect> workAreas, span<const Rect> windows, int unitSize)
+{
+    coverage.windows.clear();
+    coverage.onScreen = coverage.reachable = 0;
+    coverage.visibleArea = coverage.area = 0;
+
+    // the bitmap spans the work areas, the cells between them start covered
+    cellSize = (std::max)(1, unitSize / 2);
+    Rect bounds = workAreas.empty() ? Rect{} : workAreas.front();
+    for (auto const& a : workAreas)
+        bounds = { (std::min)(bounds.left, a.left), (std::min)(bounds.top, a.top),
+                   (std::max)(bounds.right, a.right), (std::max)(bounds.bottom, a.bottom) };
+    origin = { bounds.left, bounds.top };
+    columns = (std::max<int64_t>)(0, ceilDiv(bounds.width(), cellSize));
+    rows = (std::max<int64_t>)(0, ceilDiv(bounds.height(), cellSize));
+    rowWords = size_t(columns + 63) / 64;
+    bitmap.assign(rowWords * size_t(rows), ~uint64_t(0));
+    for (auto const& a : workAreas) setCovered(wholeCells(a), false);
+
+    coverage.windows.reserve(windows.size());
+    for (auto const& r : windows)
+    {
+        WindowCoverage window;
+        window.area = uint64_t((std::max)(0, r.width())) * uint64_t((std::max)(0, r.height()));
+        for (auto const& a : workAreas)
+            if (Rect visible; Rect::intersect(visible, r, a)) window.onScreen = true;
+
+        auto cells = wholeCells(r);
+        if (!cells.empty()) window.visibleArea = countFree(cells) * uint64_t(cellSize) * uint64_t(cellSize);
+        for (int i = 0; i < 4; i++)
+        {
+            flags<Corner> c = Corner(i);
+            Rect square = r;
+            if (c & Corner::right) square.left = (std::max)(r.left, r.right - unitSize);
+            else square.right = (std::min)(r.right, r.left + unitSize);
+            if (c & Corner::bottom) square.top = (std::max)(r.top, r.bottom - unitSize);
+            else square.bottom = (std::min)(r.bottom, r.top + unitSize);
+            if (auto corner = wholeCells(square); !corner.empty() && countFree(corner))
+                window.visibleCorners |= uint8_t(1 << i);
+        }
+        if (!cells.empty()) setCovered(cells, true);
+
+        if (window.onScreen)
+        {
+            coverage.onScreen++;
+            coverage.reachable += window.reachable();
+            coverage.visibleArea += window.visibleArea;
+            coverage.area += window.area;
+        }
+        coverage.windows.push_back(window);
+    }
+    return coverage;
+}
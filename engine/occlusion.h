@@ -0,0 +1,75 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+#include "geometry.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// <summary>
+/// What of a window can be seen and clicked
+/// </summary>
+struct WindowCoverage
+{
+    std::uint8_t visibleCorners = 0; ///< bit 1 << Corner for every corner whose unit square is not covered
+    bool onScreen = false;           ///< the window overlaps a work area
+    std::uint64_t visibleArea = 0;   ///< pixels in work areas and not covered by windows above, in whole cells
+    std::uint64_t area = 0;          ///< pixels of the window
+
+    bool reachable() const { return visibleCorners != 0; }
+};
+
+/// <summary>
+/// Coverage of all windows of a desktop, the measure of what the layout is for
+/// </summary>
+struct DesktopCoverage
+{
+    std::vector<WindowCoverage> windows; ///< in the order of the windows analyzed, topmost first
+    size_t onScreen = 0;
+    size_t reachable = 0;            ///< windows with a visible corner
+    std::uint64_t visibleArea = 0;
+    std::uint64_t area = 0;          ///< of the windows on screen
+
+    /// every window on screen can be brought forward by a click on one of its corners
+    bool allReachable() const { return reachable == onScreen; }
+    double reachableFraction() const { return onScreen ? double(reachable) / double(onScreen) : 1; }
+    double visibleFraction() const { return area ? double(visibleArea) / double(area) : 1; }
+};
+
+/// <summary>
+/// Rasterizes the windows front to back into a bitmap of the work areas with cells of half a unit,
+/// so the unit square at every corner holds at least one whole cell. A cell counts as covered when a single window
+/// above covers it whole, or when it is not wholly in a work area. A corner is visible when a cell of its unit square
+/// is not covered. Seams between windows above may thus read as visible, never the other way round.
+/// The bitmap is kept between calls, so a pass of the same desktop does not allocate.
+/// </summary>
+class OcclusionAnalyzer
+{
+public:
+    /// <param name="windows">window rects in z-order, topmost first</param>
+    /// <param name="unitSize">side of the corner squares in pixels</param>
+    const DesktopCoverage& analyze(std::span<const Rect> workAreas, std::span<const Rect> windows, int unitSize);
+    const DesktopCoverage& last() const { return coverage; }
+
+private:
+    struct Cells
+    {
+        std::int64_t left, top, right, bottom; ///< half-open cell ranges
+
+        bool empty() const { return left >= right || top >= bottom; }
+    };
+
+    Cells wholeCells(const Rect& r) const;
+    /// <returns>number of cells of the range which are not covered</returns>
+    std::uint64_t countFree(const Cells& cells) const;
+    void setCovered(const Cells& cells, bool covered);
+
+    std::vector<std::uint64_t> bitmap; ///< one bit per cell, set when covered; rows padded to whole words
+    size_t rowWords = 0;
+    std::int64_t columns = 0;
+    std::int64_t rows = 0;
+    Point origin;
+    std::int64_t cellSize = 1;
+    DesktopCoverage coverage;
+};
+
+#endif // OCCLUSION_H
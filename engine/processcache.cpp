@@ -0,0 +1,80 @@
+#include "processcache.h"
+#include "workerpool.h"
+#include <algorithm>
+
+using namespace std;
+
+ProcessCache::~ProcessCache()
+{
+    for (auto& [pid, entry] : entries) if (entry.handle) resolver.close(*entry.handle);
+}
+
+void ProcessCache::beginPass()
+{
+    pass++;
+    erase_if(entries, [this](auto& item)
+    {
+        auto& entry = item.second;
+        // processes which cannot be opened wait for their retry, unless nobody asked for them since it was due
+        if (!entry.handle) return pass > entry.retryPass + maxRetryPasses;
+        if (resolver.isRunning(*entry.handle, entry.startTime)) return false;
+        resolver.close(*entry.handle);
+        statistics.evictions++;
+        statistics.openHandles--;
+        return true;
+    });
+}
+
+bool ProcessCache::missing(ProcessId pid) const
+{
+    auto it = entries.find(pid);
+    return it == entries.end() || (!it->second.handle && pass >= it->second.retryPass);
+}
+
+ProcessCache::Entry ProcessCache::resolve(ProcessId pid)
+{
+    Entry entry;
+    entry.handle = resolver.open(pid);
+    if (!entry.handle) return entry;
+    entry.startTime = resolver.startTime(*entry.handle);
+    entry.info = resolver.query(*entry.handle);
+    return entry;
+}
+
+ProcessCache::Entry& ProcessCache::store(ProcessId pid, Entry resolved)
+{
+    statistics.misses++;
+    auto& entry = entries[pid];
+    if (resolved.handle) statistics.openHandles++;
+    else
+    {
+        resolved.failures = entry.failures + 1;
+        resolved.retryPass = pass + (std::min)(uint64_t(1) << (std::min)(resolved.failures, 6u), maxRetryPasses);
+    }
+    return entry = move(resolved);
+}
+
+const ProcessInfo* ProcessCache::find(ProcessId pid)
+{
+    if (!missing(pid))
+    {
+        statistics.hits++;
+        auto const& entry = entries.find(pid)->second;
+        return entry.info ? &*entry.info : nullptr;
+    }
+    auto& entry = store(pid, resolve(pid));
+    return entry.info ? &*entry.info : nullptr;
+}
+
+void ProcessCache::prefetch(const vector<ProcessId>& pids, WorkerPool& pool)
+{
+    vector<ProcessId> due;
+    for (auto pid : pids) if (missing(pid)) due.push_back(pid);
+    sort(due.begin(), due.end());
+    due.erase(unique(due.begin(), due.end()), due.end());
+
+    // the resolver blocks in system calls, the cache itself is only touched from this thread
+    vector<Entry> resolved(due.size());
+    pool.parallelFor(due.size(), [&](size_t i) { resolved[i] = resolve(due[i]); });
+    for (size_t i = 0; i < due.size(); i++) store(due[i], move(resolved[i]));
+}
@@ -0,0 +1,95 @@
+#ifndef PROCESSCACHE_H
+#define PROCESSCACHE_H
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+using ProcessId = std::uint32_t;
+using ProcessHandle = std::uintptr_t;
+
+struct ProcessInfo
+{
+    std::string name;      ///< executable file name, e.g. notepad.exe
+    std::string imagePath; ///< full path of the executable
+};
+
+/// <summary>
+/// Operating system access to process metadata, called from several threads at once by ProcessCache::prefetch
+/// </summary>
+class ProcessResolver
+{
+public:
+    virtual ~ProcessResolver() = default;
+    /// <returns>nothing if the process does not exist or access is denied</returns>
+    virtual std::optional<ProcessHandle> open(ProcessId pid) = 0;
+    virtual void close(ProcessHandle handle) = 0;
+    /// process creation time, together with the pid it identifies a process across pid reuse
+    virtual std::uint64_t startTime(ProcessHandle handle) = 0;
+    virtual bool isRunning(ProcessHandle handle, std::uint64_t startTime) = 0;
+    virtual std::optional<ProcessInfo> query(ProcessHandle handle) = 0;
+};
+
+/// <summary>
+/// Process metadata keyed by pid and start time, so every process is resolved once while it runs
+/// no matter how many windows it owns. Processes which cannot be opened are tried again after 2, 4, 8 and up to
+/// maxRetryPasses passes, not on every pass.
+/// </summary>
+class ProcessCache
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0; ///< processes which exited
+        size_t openHandles = 0;
+    };
+
+    static constexpr std::uint64_t maxRetryPasses = 64;
+
+    explicit ProcessCache(ProcessResolver& resolver) : resolver(resolver) {}
+    ~ProcessCache();
+    ProcessCache(const ProcessCache&) = delete;
+    ProcessCache& operator=(const ProcessCache&) = delete;
+
+    /// <summary>
+    /// Forget processes which exited, call once before every enumeration
+    /// </summary>
+    void beginPass();
+    /// <returns>nullptr if the process cannot be queried</returns>
+    const ProcessInfo* find(ProcessId pid);
+    /// <summary>
+    /// Resolve the processes missing from the cache on the pool, so the following finds are hits.
+    /// Every resolved process counts as a miss.
+    /// </summary>
+    void prefetch(const std::vector<ProcessId>& pids, WorkerPool& pool);
+    const Stats& stats() const { return statistics; }
+
+private:
+    struct Entry
+    {
+        std::optional<ProcessHandle> handle; ///< nothing for processes which cannot be opened
+        std::uint64_t startTime = 0;
+        std::optional<ProcessInfo> info;
+        unsigned failures = 0;        ///< opens which failed in a row
+        std::uint64_t retryPass = 0;  ///< when a process which cannot be opened is tried again
+    };
+
+    /// <returns>the process is not cached, or could not be opened and is due to be tried again</returns>
+    bool missing(ProcessId pid) const;
+    /// open and query the process, safe to call from several threads
+    Entry resolve(ProcessId pid);
+    /// cache the resolved process, a failed open counts against the failures before
+    Entry& store(ProcessId pid, Entry resolved);
+
+    ProcessResolver& resolver;
+    std::map<ProcessId, Entry> entries;
+    std::uint64_t pass = 0;
+    Stats statistics;
+};
+
+#endif // PROCESSCACHE_H
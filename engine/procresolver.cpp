@@ -0,0 +1,56 @@
+#include "procresolver.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+optional<uint64_t> ProcResolver::readStartTime(ProcessHandle handle) const
+{
+    ifstream stat(procRoot + '/' + to_string(handle) + "/stat");
+    string line;
+    if (!getline(stat, line)) return nullopt;
+    // the command name in parentheses may contain spaces, fields are counted after it
+    auto commEnd = line.rfind(')');
+    if (commEnd == string::npos) return nullopt;
+    istringstream fields(line.substr(commEnd + 1));
+    string field;
+    for (int i = 3; i < 22 && fields >> field; i++) {}
+    uint64_t result;
+    if (fields >> result) return result;
+    return nullopt;
+}
+
+optional<ProcessHandle> ProcResolver::open(ProcessId pid)
+{
+    if (!readStartTime(pid)) return nullopt;
+    opened++;
+    return pid;
+}
+
+void ProcResolver::close(ProcessHandle)
+{
+    closed++;
+}
+
+uint64_t ProcResolver::startTime(ProcessHandle handle)
+{
+    return readStartTime(handle).value_or(0);
+}
+
+bool ProcResolver::isRunning(ProcessHandle handle, uint64_t startTime)
+{
+    return readStartTime(handle) == startTime;
+}
+
+optional<ProcessInfo> ProcResolver::query(ProcessHandle handle)
+{
+    queries++;
+    error_code error;
+    auto path = filesystem::read_symlink(procRoot + '/' + to_string(handle) + "/exe", error);
+    if (!error) return ProcessInfo{ path.filename().string(), path.string() };
+    // kernel threads and processes of other users have no readable exe link
+    ifstream comm(procRoot + '/' + to_string(handle) + "/comm");
+    if (string name; getline(comm, name)) return ProcessInfo{ name, {} };
+    return nullopt;
+}
@@ -0,0 +1,28 @@
+#ifndef PROCRESOLVER_H
+#define PROCRESOLVER_H
+#include "processcache.h"
+#include <atomic>
+
+/// <summary>
+/// Linux process metadata from /proc; the handle is the pid itself
+/// </summary>
+class ProcResolver : public ProcessResolver
+{
+public:
+    explicit ProcResolver(std::string procRoot = "/proc") : procRoot(std::move(procRoot)) {}
+    std::optional<ProcessHandle> open(ProcessId pid) override;
+    void close(ProcessHandle handle) override;
+    std::uint64_t startTime(ProcessHandle handle) override;
+    bool isRunning(ProcessHandle handle, std::uint64_t startTime) override;
+    std::optional<ProcessInfo> query(ProcessHandle handle) override;
+
+    std::atomic<size_t> opened = 0;
+    std::atomic<size_t> closed = 0;
+    std::atomic<size_t> queries = 0;
+
+private:
+    std::optional<std::uint64_t> readStartTime(ProcessHandle handle) const;
+    std::string procRoot;
+};
+
+#endif // PROCRESOLVER_H
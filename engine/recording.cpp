@@ -0,0 +1,347 @@
+#include "recording.h"
+#include <cstring>
+#include <ostream>
+
+using namespace std;
+
+enum RecordType : uint8_t { topologyRecord = 1, passRecord = 2, feedbackRecord = 3 };
+
+// window fields present in a pass record
+enum WindowFields : uint8_t { rectField = 1, processField = 2, titleField = 4, maximizableFlag = 8, dpiAwareFlag = 16 };
+
+static void putVarint(vector<uint8_t>& out, uint64_t v)
+{
+    for (; v >= 0x80; v >>= 7) out.push_back(uint8_t(v | 0x80));
+    out.push_back(uint8_t(v));
+}
+
+static void putSigned(vector<uint8_t>& out, int64_t v)
+{
+    putVarint(out, (uint64_t(v) << 1) ^ uint64_t(v >> 63));
+}
+
+static void putString(vector<uint8_t>& out, const string& s)
+{
+    putVarint(out, s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+static void putRect(vector<uint8_t>& out, const Rect& r, const Rect& base)
+{
+    putSigned(out, int64_t(r.left) - base.left);
+    putSigned(out, int64_t(r.top) - base.top);
+    putSigned(out, int64_t(r.right) - base.right);
+    putSigned(out, int64_t(r.bottom) - base.bottom);
+}
+
+/// <summary>
+/// Bounds-checked decoding; after the first overrun every read returns zero and ok turns false
+/// </summary>
+struct Decoder
+{
+    span<const uint8_t> data;
+    size_t position = 0;
+    bool ok = true;
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64 && ok; shift += 7)
+        {
+            if (position == data.size()) break;
+            uint8_t b = data[position++];
+            v |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+    int64_t signedVarint()
+    {
+        auto v = varint();
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+    uint8_t byte()
+    {
+        if (position == data.size()) ok = false;
+        return ok ? data[position++] : 0;
+    }
+    string text()
+    {
+        auto length = varint();
+        if (!ok || length > data.size() - position)
+        {
+            ok = false;
+            return {};
+        }
+        string result(reinterpret_cast<const char*>(data.data() + position), size_t(length));
+        position += size_t(length);
+        return result;
+    }
+    Rect rect(const Rect& base)
+    {
+        Rect r;
+        r.left = int32_t(base.left + signedVarint());
+        r.top = int32_t(base.top + signedVarint());
+        r.right = int32_t(base.right + signedVarint());
+        r.bottom = int32_t(base.bottom + signedVarint());
+        return r;
+    }
+};
+
+SessionRecorder::SessionRecorder(ostream& out) : out(out)
+{
+    out.write(recording::magic, sizeof(recording::magic));
+    out.put(char(recording::version));
+    written = sizeof(recording::magic) + 1;
+}
+
+bool SessionRecorder::good() const
+{
+    return bool(out);
+}
+
+void SessionRecorder::writeRecord(uint8_t type)
+{
+    vector<uint8_t> header{ type };
+    putVarint(header, payload.size());
+    out.write(reinterpret_cast<const char*>(header.data()), streamsize(header.size()));
+    out.write(reinterpret_cast<const char*>(payload.data()), streamsize(payload.size()));
+    out.flush();
+    written += header.size() + payload.size();
+    payload.clear();
+}
+
+void SessionRecorder::recordPass(const DesktopSnapshot& desktop, const LayoutSettings& settings, bool force,
+                                 const optional<MovePlan>& plan, Duration arrangeTime, TimePoint now)
+{
+    if (desktop.topology != topology)
+    {
+        topology = desktop.topology;
+        putVarint(payload, topology->generation);
+        putVarint(payload, topology->primary);
+        putVarint(payload, topology->primaryDpi);
+        putVarint(payload, topology->monitors.size());
+        for (auto const& m : topology->monitors)
+        {
+            putVarint(payload, m.id);
+            putRect(payload, m.rect, {});
+            putRect(payload, m.workArea, m.rect);
+            putString(payload, m.name);
+            putVarint(payload, m.dpi);
+            payload.push_back(m.touchCapable);
+        }
+        writeRecord(topologyRecord);
+    }
+
+    if (!start) start = now;
+    putVarint(payload, uint64_t(chrono::duration_cast<chrono::microseconds>(now - *start).count()));
+    putVarint(payload, uint64_t(chrono::duration_cast<chrono::nanoseconds>(arrangeTime).count()));
+    putSigned(payload, settings.maxIncrease);
+    payload.push_back(uint8_t(settings.avoidTopRightCorner | settings.increaseUnitSizeForTouch << 1 | force << 2 |
+                              (settings.cornerAssignment == CornerAssignment::minDisplacement) << 3 |
+                              settings.arrangeOnlyWhenOccluded << 4 | settings.animateMoves << 5));
+    putSigned(payload, desktop.cursor.x);
+    putSigned(payload, desktop.cursor.y);
+    payload.push_back(desktop.theme.has_value());
+    if (desktop.theme)
+    {
+        putSigned(payload, desktop.theme->captionButtonHeight);
+        putSigned(payload, desktop.theme->paddedBorder);
+    }
+
+    // windows in z-order, ids as differences to the previous one
+    putVarint(payload, desktop.windows.size());
+    unordered_map<WindowId, WindowInfo> current;
+    current.reserve(desktop.windows.size());
+    WindowId previousId = 0;
+    for (auto const& w : desktop.windows)
+    {
+        auto old = windows.find(w.id);
+        bool known = old != windows.end();
+        uint8_t fields = (w.maximizable ? maximizableFlag : 0) | (w.perMonitorDpiAware ? dpiAwareFlag : 0);
+        if (!known || old->second.rect != w.rect) fields |= rectField;
+        if (known ? old->second.processName != w.processName : !w.processName.empty()) fields |= processField;
+        if (known ? old->second.title != w.title : !w.title.empty()) fields |= titleField;
+        putSigned(payload, int64_t(w.id - previousId));
+        payload.push_back(fields);
+        if (fields & rectField) putRect(payload, w.rect, known ? old->second.rect : Rect{});
+        if (fields & processField) putString(payload, w.processName);
+        if (fields & titleField) putString(payload, w.title);
+        previousId = w.id;
+        current.emplace(w.id, w);
+    }
+
+    payload.push_back(plan.has_value());
+    if (plan)
+    {
+        putVarint(payload, plan->size());
+        WindowId previousWindow = 0;
+        for (auto const& move : *plan)
+        {
+            auto window = current.find(move.window);
+            putSigned(payload, int64_t(move.window - previousWindow));
+            putVarint(payload, move.monitor);
+            payload.push_back(uint8_t(int(move.corner) | move.centered << 2));
+            putVarint(payload, uint64_t(move.index));
+            putSigned(payload, move.unitSize);
+            putSigned(payload, move.dx);
+            putSigned(payload, move.dy);
+            putRect(payload, move.rect, window != current.end() ? window->second.rect : Rect{});
+            previousWindow = move.window;
+        }
+    }
+    windows = move(current);
+    writeRecord(passRecord);
+}
+
+void SessionRecorder::recordFeedback(const RecordedFeedback& feedback)
+{
+    payload.push_back(uint8_t(feedback.kind));
+    putVarint(payload, feedback.window);
+    if (feedback.kind == RecordedFeedback::Kind::windowRect) putRect(payload, feedback.rect, {});
+    writeRecord(feedbackRecord);
+}
+
+RecordingReader::RecordingReader(span<const uint8_t> data) : data(data)
+{
+    if (data.size() < sizeof(recording::magic) + 1 || memcmp(data.data(), recording::magic, sizeof(recording::magic)) != 0)
+        fail("not a lazyclicker recording");
+    else if (data[sizeof(recording::magic)] != recording::version) fail("unsupported recording version");
+    else position = sizeof(recording::magic) + 1;
+}
+
+bool RecordingReader::fail(const char* message)
+{
+    problem = message;
+    position = data.size();
+    return false;
+}
+
+optional<RecordedEvent> RecordingReader::next()
+{
+    while (position < data.size())
+    {
+        Decoder header{ data, position };
+        uint8_t type = header.byte();
+        auto length = header.varint();
+        if (!header.ok || length > data.size() - header.position)
+        {
+            fail("truncated record");
+            return nullopt;
+        }
+        Decoder in{ data.subspan(header.position, size_t(length)) };
+        position = header.position + size_t(length);
+
+        if (type == topologyRecord)
+        {
+            auto rebuilt = make_shared<DisplayTopology>();
+            rebuilt->generation = in.varint();
+            rebuilt->primary = MonitorId(in.varint());
+            rebuilt->primaryDpi = unsigned(in.varint());
+            auto count = in.varint();
+            for (uint64_t i = 0; i < count && in.ok; i++)
+            {
+                MonitorInfo& m = rebuilt->monitors.emplace_back();
+                m.id = MonitorId(in.varint());
+                m.rect = in.rect({});
+                m.workArea = in.rect(m.rect);
+                m.name = in.text();
+                m.dpi = unsigned(in.varint());
+                m.touchCapable = in.byte();
+            }
+            if (!in.ok)
+            {
+                fail("corrupt monitor record");
+                return nullopt;
+            }
+            topology = move(rebuilt);
+        }
+        else if (type == passRecord)
+        {
+            RecordedPass pass;
+            pass.sinceStart = chrono::microseconds(in.varint());
+            pass.arrangeTime = chrono::nanoseconds(in.varint());
+            pass.settings.maxIncrease = int(in.signedVarint());
+            uint8_t flags = in.byte();
+            pass.settings.avoidTopRightCorner = flags & 1;
+            pass.settings.increaseUnitSizeForTouch = flags & 2;
+            pass.force = flags & 4;
+            if (flags & 8) pass.settings.cornerAssignment = CornerAssignment::minDisplacement;
+            pass.settings.arrangeOnlyWhenOccluded = flags & 16;
+            pass.settings.animateMoves = flags & 32;
+            auto& desktop = pass.desktop;
+            desktop.topology = topology;
+            desktop.cursor.x = int32_t(in.signedVarint());
+            desktop.cursor.y = int32_t(in.signedVarint());
+            if (in.byte())
+                desktop.theme = ThemeSizes{ int(in.signedVarint()), int(in.signedVarint()) };
+
+            auto count = in.varint();
+            unordered_map<WindowId, WindowInfo> current;
+            WindowId previousId = 0;
+            for (uint64_t i = 0; i < count && in.ok; i++)
+            {
+                WindowId id = previousId + WindowId(in.signedVarint());
+                uint8_t fields = in.byte();
+                auto old = windows.find(id);
+                WindowInfo w;
+                if (old != windows.end()) w = old->second;
+                else w.id = id;
+                if (fields & rectField) w.rect = in.rect(w.rect);
+                if (fields & processField) w.processName = in.text();
+                if (fields & titleField) w.title = in.text();
+                w.maximizable = fields & maximizableFlag;
+                w.perMonitorDpiAware = fields & dpiAwareFlag;
+                desktop.windows.push_back(w);
+                current.emplace(id, move(w));
+                previousId = id;
+            }
+
+            if (in.byte())
+            {
+                auto& plan = pass.plan.emplace();
+                auto moves = in.varint();
+                WindowId previousWindow = 0;
+                for (uint64_t i = 0; i < moves && in.ok; i++)
+                {
+                    WindowMove& move = plan.emplace_back();
+                    move.window = previousWindow + WindowId(in.signedVarint());
+                    move.monitor = MonitorId(in.varint());
+                    uint8_t corner = in.byte();
+                    move.corner = Corner(corner & 3);
+                    move.centered = corner & 4;
+                    move.index = int(in.varint());
+                    move.unitSize = int(in.signedVarint());
+                    move.dx = int32_t(in.signedVarint());
+                    move.dy = int32_t(in.signedVarint());
+                    auto window = current.find(move.window);
+                    move.rect = in.rect(window != current.end() ? window->second.rect : Rect{});
+                    previousWindow = move.window;
+                }
+            }
+            if (!in.ok)
+            {
+                fail("corrupt pass record");
+                return nullopt;
+            }
+            windows = move(current);
+            return pass;
+        }
+        else if (type == feedbackRecord)
+        {
+            RecordedFeedback feedback;
+            feedback.kind = RecordedFeedback::Kind(in.byte());
+            feedback.window = WindowId(in.varint());
+            if (feedback.kind == RecordedFeedback::Kind::windowRect) feedback.rect = in.rect({});
+            if (!in.ok || feedback.kind > RecordedFeedback::Kind::windowRect)
+            {
+                fail("corrupt feedback record");
+                return nullopt;
+            }
+            return feedback;
+        }
+        // records of unknown types are skipped, later versions may add some
+    }
+    return nullopt;
+}
@@ -0,0 +1,98 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+#include "eventcoalescer.h"
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <unordered_map>
+#include <variant>
+
+/// <summary>
+/// Session recordings: a header followed by records of a type byte, a varint payload length and the payload.
+/// Integers are LEB128 varints, signed ones zigzag encoded. Monitors are written when the topology changes,
+/// windows as differences to their state in the previous pass and move targets relative to the windows,
+/// so an idle desktop costs a few bytes per window and pass. Records are read in place,
+/// which allows memory-mapping the file.
+/// </summary>
+namespace recording
+{
+constexpr char magic[] = "LZREC";
+constexpr std::uint8_t version = 1;
+}
+
+/// <summary>
+/// One arrangement: the observed desktop, the settings and the plan the engine computed
+/// </summary>
+struct RecordedPass
+{
+    DesktopSnapshot desktop;
+    LayoutSettings settings;
+    bool force = false;
+    std::optional<MovePlan> plan; ///< nothing if the desktop did not change
+    Duration arrangeTime{};       ///< LayoutEngine::arrange alone
+    Duration sinceStart{};        ///< from the first recorded pass
+};
+
+/// <summary>
+/// Outcome of a move fed back into the engine, replayed to keep its state in step
+/// </summary>
+struct RecordedFeedback
+{
+    enum class Kind : std::uint8_t { unmovable, released, windowRect };
+    Kind kind = Kind::unmovable;
+    WindowId window = 0;
+    Rect rect; ///< windowRect only
+};
+
+using RecordedEvent = std::variant<RecordedPass, RecordedFeedback>;
+
+/// <summary>
+/// Streams passes and engine feedback into a recording, flushing after every record
+/// </summary>
+class SessionRecorder
+{
+public:
+    /// writes the header, the stream has to be binary
+    explicit SessionRecorder(std::ostream& out);
+
+    void recordPass(const DesktopSnapshot& desktop, const LayoutSettings& settings, bool force,
+                    const std::optional<MovePlan>& plan, Duration arrangeTime, TimePoint now = SteadyClock::now());
+    void recordFeedback(const RecordedFeedback& feedback);
+    std::uint64_t bytesWritten() const { return written; }
+    bool good() const;
+
+private:
+    void writeRecord(std::uint8_t type);
+
+    std::ostream& out;
+    std::vector<std::uint8_t> payload;
+    std::shared_ptr<const DisplayTopology> topology;
+    std::unordered_map<WindowId, WindowInfo> windows; ///< as of the previous pass
+    std::optional<TimePoint> start;
+    std::uint64_t written = 0;
+};
+
+/// <summary>
+/// Decodes a recording held in memory, e.g. a mapped file, which must outlive the reader
+/// </summary>
+class RecordingReader
+{
+public:
+    explicit RecordingReader(std::span<const std::uint8_t> data);
+    /// <returns>nothing at the end of the recording or on corrupt data, which sets error</returns>
+    std::optional<RecordedEvent> next();
+    /// empty unless the header or a record is corrupt
+    const std::string& error() const { return problem; }
+    size_t offset() const { return position; }
+
+private:
+    bool fail(const char* message);
+
+    std::span<const std::uint8_t> data;
+    size_t position = 0;
+    std::string problem;
+    std::shared_ptr<const DisplayTopology> topology = DisplayTopology::empty();
+    std::unordered_map<WindowId, WindowInfo> windows;
+};
+
+#endif // RECORDING_H
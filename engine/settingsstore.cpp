@@ -0,0 +1,326 @@
+#include "settingsstore.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+
+using namespace std;
+
+bool MemorySettingsBackend::save(const SettingsMap& all, const vector<string>& changed)
+{
+    for (auto const& name : changed)
+        if (auto it = all.find(name); it != all.end()) values.insert_or_assign(name, it->second);
+    saves++;
+    return true;
+}
+
+bool MemorySettingsBackend::clear()
+{
+    values.clear();
+    return true;
+}
+
+// INI FILE
+
+static string_view trim(string_view s)
+{
+    auto first = s.find_first_not_of(" \t\r");
+    if (first == string_view::npos) return {};
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+/// <returns>the section name if the line starts one</returns>
+static optional<string_view> sectionName(string_view line)
+{
+    line = trim(line);
+    if (line.size() < 2 || line.front() != '[' || line.back() != ']') return nullopt;
+    return trim(line.substr(1, line.size() - 2));
+}
+
+static optional<SettingValue> parseValue(string_view text)
+{
+    if (text == "true") return true;
+    if (text == "false") return false;
+    if (!text.empty() && text.front() == '"')
+    {
+        string value;
+        for (size_t i = 1; i < text.size(); i++)
+        {
+            char c = text[i];
+            if (c == '"') return value;
+            if (c == '\\' && i + 1 < text.size())
+            {
+                c = text[++i];
+                if (c == 'n') c = '\n';
+                else if (c == 't') c = '\t';
+            }
+            value += c;
+        }
+        return nullopt;
+    }
+    int number = 0;
+    auto [end, ec] = from_chars(text.data(), text.data() + text.size(), number);
+    if (ec == errc() && end == text.data() + text.size() && !text.empty()) return number;
+    // written by hand without quotes
+    return string(text);
+}
+
+static string formatValue(const SettingValue& value)
+{
+    if (auto b = get_if<bool>(&value)) return *b ? "true" : "false";
+    if (auto i = get_if<int>(&value)) return to_string(*i);
+    string text = "\"";
+    for (char c : get<string>(value))
+    {
+        if (c == '\\' || c == '"') text += '\\';
+        if (c == '\n') text += "\\n";
+        else if (c == '\t') text += "\\t";
+        else text += c;
+    }
+    return text + '"';
+}
+
+/// <summary>
+/// Replace the section of the file by the values, or remove it when there are none
+/// </summary>
+static bool rewriteSection(const filesystem::path& file, string_view section, const SettingsMap& values)
+{
+    vector<string> kept;
+    if (ifstream in(file); in)
+    {
+        bool inSection = false;
+        for (string line; getline(in, line);)
+        {
+            if (auto name = sectionName(line)) inSection = *name == section;
+            if (!inSection) kept.push_back(move(line));
+        }
+    }
+    while (!kept.empty() && trim(kept.back()).empty()) kept.pop_back();
+
+    error_code ec;
+    if (values.empty() && kept.empty())
+    {
+        filesystem::remove(file, ec);
+        return !ec;
+    }
+    if (file.has_parent_path()) filesystem::create_directories(file.parent_path(), ec);
+    auto temporary = file;
+    temporary += ".tmp";
+    {
+        ofstream out(temporary, ios::trunc);
+        for (auto const& line : kept) out << line << '\n';
+        if (!values.empty())
+        {
+            if (!kept.empty()) out << '\n';
+            out << '[' << section << "]\n";
+            for (auto const& [name, value] : values) out << name << '=' << formatValue(value) << '\n';
+        }
+        if (!out.flush()) return false;
+    }
+    filesystem::rename(temporary, file, ec);
+    return !ec;
+}
+
+IniSettingsBackend::IniSettingsBackend(filesystem::path file, string section) : file(move(file)), section(move(section)) {}
+
+optional<SettingsMap> IniSettingsBackend::load()
+{
+    SettingsMap values;
+    error_code ec;
+    if (!filesystem::exists(file, ec)) return values;
+    ifstream in(file);
+    if (!in) return nullopt;
+    bool inSection = false;
+    for (string line; getline(in, line);)
+    {
+        if (auto name = sectionName(line))
+        {
+            inSection = *name == section;
+            continue;
+        }
+        auto text = trim(line);
+        if (!inSection || text.empty() || text.front() == ';' || text.front() == '#') continue;
+        auto equals = text.find('=');
+        if (equals == string_view::npos) continue;
+        if (auto value = parseValue(trim(text.substr(equals + 1))))
+            values.insert_or_assign(string(trim(text.substr(0, equals))), move(*value));
+    }
+    return values;
+}
+
+bool IniSettingsBackend::save(const SettingsMap& all, const vector<string>&)
+{
+    return rewriteSection(file, section, all);
+}
+
+bool IniSettingsBackend::clear()
+{
+    return rewriteSection(file, section, {});
+}
+
+// STORE
+
+SettingsStore::SettingsStore(SettingsBackend& backend, Clock& clock, Duration flushDelay) :
+    backend(backend), clock(clock), flushDelay(flushDelay)
+{}
+
+bool SettingsStore::load()
+{
+    lock_guard flushLock(flushMutex);
+    auto loaded = backend.load();
+    if (!loaded) return false;
+    lock_guard lock(mutex);
+    values = move(*loaded);
+    dirty.clear();
+    return true;
+}
+
+optional<SettingValue> SettingsStore::find(string_view name) const
+{
+    lock_guard lock(mutex);
+    if (auto it = values.find(name); it != values.end()) return it->second;
+    return nullopt;
+}
+
+bool SettingsStore::assign(string_view name, SettingValue value)
+{
+    lock_guard lock(mutex);
+    auto it = values.find(name);
+    if (it != values.end() && it->second == value) return false;
+    if (it == values.end()) values.emplace(string(name), move(value));
+    else it->second = move(value);
+    auto now = clock.now();
+    if (dirty.empty()) firstChange = now;
+    lastChange = now;
+    if (ranges::find(dirty, name) == dirty.end()) dirty.emplace_back(name);
+    statistics.changes++;
+    return true;
+}
+
+optional<TimePoint> SettingsStore::flushDue() const
+{
+    lock_guard lock(mutex);
+    if (dirty.empty()) return nullopt;
+    return (std::min)(lastChange + flushDelay, firstChange + 4 * flushDelay);
+}
+
+bool SettingsStore::poll()
+{
+    auto due = flushDue();
+    if (!due || clock.now() < *due) return true;
+    return flush();
+}
+
+bool SettingsStore::flush()
+{
+    lock_guard flushLock(flushMutex);
+    SettingsMap all;
+    vector<string> batch;
+    {
+        lock_guard lock(mutex);
+        if (dirty.empty()) return true;
+        all = values;
+        batch.swap(dirty);
+    }
+    bool saved = backend.save(all, batch);
+    lock_guard lock(mutex);
+    if (saved)
+    {
+        statistics.flushes++;
+        statistics.written += batch.size();
+        return true;
+    }
+    // try again after another delay, together with whatever changes meanwhile
+    statistics.failures++;
+    if (dirty.empty()) firstChange = lastChange = clock.now();
+    for (auto& name : batch)
+        if (ranges::find(dirty, name) == dirty.end()) dirty.push_back(move(name));
+    return false;
+}
+
+bool SettingsStore::clear()
+{
+    lock_guard flushLock(flushMutex);
+    {
+        lock_guard lock(mutex);
+        values.clear();
+        dirty.clear();
+    }
+    return backend.clear();
+}
+
+SettingsStore::Stats SettingsStore::stats() const
+{
+    lock_guard lock(mutex);
+    return statistics;
+}
+
+bool SettingsStore::toBool(const SettingValue& value, bool fallback)
+{
+    if (auto b = get_if<bool>(&value)) return *b;
+    if (auto i = get_if<int>(&value)) return *i != 0;
+    // Qt stored booleans as text
+    auto& text = std::get<string>(value);
+    if (text == "true" || text == "1") return true;
+    if (text == "false" || text == "0") return false;
+    return fallback;
+}
+
+int SettingsStore::toInt(const SettingValue& value, int fallback)
+{
+    if (auto i = get_if<int>(&value)) return *i;
+    if (auto b = get_if<bool>(&value)) return *b;
+    auto& text = std::get<string>(value);
+    int number = 0;
+    auto [end, ec] = from_chars(text.data(), text.data() + text.size(), number);
+    return ec == errc() && end == text.data() + text.size() && !text.empty() ? number : fallback;
+}
+
+string SettingsStore::toString(const SettingValue& value)
+{
+    if (auto b = get_if<bool>(&value)) return *b ? "true" : "false";
+    if (auto i = get_if<int>(&value)) return to_string(*i);
+    return std::get<string>(value);
+}
+
+// LAYOUT SETTINGS
+
+LayoutSettings preferences::layoutSettings(const SettingsStore& store)
+{
+    LayoutSettings settings;
+    settings.maxIncrease = store.get(allowedIncrease);
+    settings.avoidTopRightCorner = store.get(avoidTopRightCorner);
+    settings.increaseUnitSizeForTouch = store.get(increaseUnitSizeForTouch);
+    settings.cornerAssignment = store.get(minimizeCornerDisplacement) ? CornerAssignment::minDisplacement : CornerAssignment::greedy;
+    settings.arrangeOnlyWhenOccluded = store.get(arrangeOnlyWhenOccluded);
+    settings.animateMoves = store.get(animateMoves);
+    return settings;
+}
+
+void preferences::setLayoutSettings(SettingsStore& store, const LayoutSettings& settings)
+{
+    store.set(allowedIncrease, settings.maxIncrease);
+    store.set(avoidTopRightCorner, settings.avoidTopRightCorner);
+    store.set(increaseUnitSizeForTouch, settings.increaseUnitSizeForTouch);
+    store.set(minimizeCornerDisplacement, settings.cornerAssignment == CornerAssignment::minDisplacement);
+    store.set(arrangeOnlyWhenOccluded, settings.arrangeOnlyWhenOccluded);
+    store.set(animateMoves, settings.animateMoves);
+}
+
+uint64_t AtomicLayoutSettings::pack(const LayoutSettings& settings)
+{
+    return uint64_t(uint32_t(settings.maxIncrease)) | uint64_t(settings.avoidTopRightCorner) << 32 |
+           uint64_t(settings.increaseUnitSizeForTouch) << 33 | uint64_t(settings.cornerAssignment) << 34 |
+           uint64_t(settings.arrangeOnlyWhenOccluded) << 36 | uint64_t(settings.animateMoves) << 37;
+}
+
+LayoutSettings AtomicLayoutSettings::unpack(uint64_t word)
+{
+    LayoutSettings settings;
+    settings.maxIncrease = int(uint32_t(word));
+    settings.avoidTopRightCorner = word >> 32 & 1;
+    settings.increaseUnitSizeForTouch = word >> 33 & 1;
+    settings.cornerAssignment = CornerAssignment(word >> 34 & 3);
+    settings.arrangeOnlyWhenOccluded = word >> 36 & 1;
+    settings.animateMoves = word >> 37 & 1;
+    return settings;
+}
@@ -0,0 +1,193 @@
+#ifndef SETTINGSSTORE_H
+#define SETTINGSSTORE_H
+#include "clock.h"
+#include "layout.h"
+#include "windowfilter.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+using SettingValue = std::variant<bool, int, std::string>;
+using SettingsMap = std::map<std::string, SettingValue, std::less<>>;
+
+/// <summary>
+/// Name and type of a setting, with the value it has until one is stored
+/// </summary>
+template<typename T> struct Setting
+{
+    const char* name;
+    T defaultValue;
+};
+
+/// <summary>
+/// Persistent storage of the settings. The store writes changes in batches, so a backend may open its storage once per batch.
+/// </summary>
+class SettingsBackend
+{
+public:
+    virtual ~SettingsBackend() = default;
+    /// <returns>the stored values, nothing if the storage exists but could not be read</returns>
+    virtual std::optional<SettingsMap> load() = 0;
+    /// <param name="all">every value of the store, for backends which rewrite the whole storage</param>
+    /// <param name="changed">names of the values changed since the last save</param>
+    virtual bool save(const SettingsMap& all, const std::vector<std::string>& changed) = 0;
+    /// <summary>
+    /// Remove the storage, when the application is uninstalled
+    /// </summary>
+    virtual bool clear() = 0;
+};
+
+/// <summary>
+/// Keeps the values in memory, for tools and simulations
+/// </summary>
+class MemorySettingsBackend : public SettingsBackend
+{
+public:
+    std::optional<SettingsMap> load() override { return values; }
+    bool save(const SettingsMap& all, const std::vector<std::string>& changed) override;
+    bool clear() override;
+
+    SettingsMap values;
+    int saves = 0; ///< batches written
+};
+
+/// <summary>
+/// One section of an INI file, rewritten as a whole through a temporary file so readers never see a partial one.
+/// Other sections and lines the store does not know are kept. Values are true/false, decimal integers
+/// or quoted strings with \\, \", \n and \t escaped.
+/// </summary>
+class IniSettingsBackend : public SettingsBackend
+{
+public:
+    explicit IniSettingsBackend(std::filesystem::path file, std::string section = "Preferences");
+    std::optional<SettingsMap> load() override;
+    bool save(const SettingsMap& all, const std::vector<std::string>& changed) override;
+    bool clear() override;
+
+private:
+    std::filesystem::path file;
+    std::string section;
+};
+
+/// <summary>
+/// Typed settings in memory, written behind to a backend. Changes are collected and written in one batch
+/// once no setting has changed for the flush delay, or at the latest after four delays of continuous changes,
+/// so dragging a slider costs one write. Safe to use from any thread.
+/// </summary>
+class SettingsStore
+{
+public:
+    struct Stats
+    {
+        std::uint64_t changes = 0; ///< calls of set which changed a value
+        std::uint64_t flushes = 0; ///< batches written
+        std::uint64_t written = 0; ///< values written in all batches
+        std::uint64_t failures = 0;
+    };
+
+    SettingsStore(SettingsBackend& backend, Clock& clock, Duration flushDelay = std::chrono::seconds(1));
+
+    /// <summary>
+    /// Replace the values by the stored ones, dropping unwritten changes
+    /// </summary>
+    bool load();
+    template<typename T> T get(const Setting<T>& setting) const;
+    /// <returns>the value changed and will be written</returns>
+    template<typename T> bool set(const Setting<T>& setting, const T& value);
+    /// <returns>when poll writes the pending changes, nothing when there are none</returns>
+    std::optional<TimePoint> flushDue() const;
+    /// <summary>
+    /// Write the pending changes if they are due
+    /// </summary>
+    /// <returns>nothing was left to write or the write succeeded</returns>
+    bool poll();
+    /// <summary>
+    /// Write the pending changes now, before the application exits
+    /// </summary>
+    bool flush();
+    /// <summary>
+    /// Forget all values and remove the storage
+    /// </summary>
+    bool clear();
+    Stats stats() const;
+
+private:
+    std::optional<SettingValue> find(std::string_view name) const;
+    bool assign(std::string_view name, SettingValue value);
+
+    static bool toBool(const SettingValue& value, bool fallback);
+    static int toInt(const SettingValue& value, int fallback);
+    static std::string toString(const SettingValue& value);
+
+    SettingsBackend& backend;
+    Clock& clock;
+    Duration flushDelay;
+    mutable std::mutex mutex;
+    std::mutex flushMutex; ///< keeps batches in order
+    SettingsMap values;
+    std::vector<std::string> dirty;
+    TimePoint firstChange;
+    TimePoint lastChange;
+    Stats statistics;
+};
+
+template<typename T> T SettingsStore::get(const Setting<T>& setting) const
+{
+    auto value = find(setting.name);
+    if (!value) return setting.defaultValue;
+    if constexpr (std::is_same_v<T, bool>) return toBool(*value, setting.defaultValue);
+    else if constexpr (std::is_same_v<T, int>) return toInt(*value, setting.defaultValue);
+    else return toString(*value);
+}
+
+template<typename T> bool SettingsStore::set(const Setting<T>& setting, const T& value)
+{
+    return assign(setting.name, SettingValue(value));
+}
+
+/// <summary>
+/// Settings of the application, under the names the Windows front-ends have always stored them
+/// </summary>
+namespace preferences
+{
+inline const Setting<int> allowedIncrease{ "allowedIncrease", 0 };
+inline const Setting<bool> avoidTopRightCorner{ "avoidTopRightCorner", false };
+inline const Setting<bool> increaseUnitSizeForTouch{ "increaseUnitSizeForTouch", false };
+inline const Setting<bool> minimizeCornerDisplacement{ "minimizeCornerDisplacement", false };
+inline const Setting<bool> arrangeOnlyWhenOccluded{ "arrangeOnlyWhenOccluded", false };
+inline const Setting<bool> animateMoves{ "animateMoves", false };
+inline const Setting<bool> autoArrange{ "actionAuto_arrange_windows", false };
+inline const Setting<std::string> windowRules{ "windowRules", WindowFilter::defaultRules };
+
+LayoutSettings layoutSettings(const SettingsStore& store);
+void setLayoutSettings(SettingsStore& store, const LayoutSettings& settings);
+}
+
+/// <summary>
+/// LayoutSettings packed in one word, so the thread which changes the settings publishes them
+/// and the threads which arrange read a consistent copy without locks
+/// </summary>
+class AtomicLayoutSettings
+{
+public:
+    explicit AtomicLayoutSettings(const LayoutSettings& settings = {}) : packed(pack(settings)) {}
+    LayoutSettings load() const { return unpack(packed.load(std::memory_order_acquire)); }
+    void store(const LayoutSettings& settings) { packed.store(pack(settings), std::memory_order_release); }
+
+private:
+    static std::uint64_t pack(const LayoutSettings& settings);
+    static LayoutSettings unpack(std::uint64_t word);
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+    std::atomic<std::uint64_t> packed;
+};
+
+#endif // SETTINGSSTORE_H
@@ -0,0 +1,117 @@
+#include "snapshotio.h"
+#include <array>
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+using namespace std;
+
+const char* cornerName(flags<Corner> corner)
+{
+    static constexpr array<const char*, 4> cornerNames{ "topleft", "topright", "bottomleft", "bottomright" };
+    return cornerNames[int(corner) & 3];
+}
+
+static bool readId(istream& in, uintptr_t& id)
+{
+    string token;
+    if (!(in >> token)) return false;
+    char* end = nullptr;
+    id = uintptr_t(strtoull(token.c_str(), &end, 0));
+    return end && !*end;
+}
+
+static bool readRect(istream& in, Rect& r)
+{
+    return bool(in >> r.left >> r.top >> r.right >> r.bottom);
+}
+
+static string restOfLine(istream& in)
+{
+    string rest;
+    getline(in >> ws, rest);
+    return rest;
+}
+
+optional<DesktopSnapshot> readSnapshot(istream& in, string* error)
+{
+    DesktopSnapshot desktop;
+    auto topology = make_shared<DisplayTopology>();
+    string line;
+    for (int lineNumber = 1; getline(in, line); lineNumber++)
+    {
+        istringstream ls(line);
+        string keyword;
+        if (!(ls >> keyword) || keyword[0] == '#') continue;
+
+        bool ok = false;
+        if (keyword == "primarydpi") ok = bool(ls >> topology->primaryDpi);
+        else if (keyword == "cursor") ok = bool(ls >> desktop.cursor.x >> desktop.cursor.y);
+        else if (keyword == "theme")
+        {
+            ThemeSizes theme;
+            ok = bool(ls >> theme.captionButtonHeight >> theme.paddedBorder);
+            desktop.theme = theme;
+        }
+        else if (keyword == "monitor")
+        {
+            MonitorInfo m;
+            int touch = 0;
+            ok = readId(ls, m.id) && readRect(ls, m.workArea) && (ls >> m.dpi >> touch);
+            m.rect = m.workArea;
+            m.touchCapable = touch;
+            m.name = restOfLine(ls);
+            if (topology->monitors.empty()) topology->primary = m.id;
+            topology->monitors.push_back(move(m));
+        }
+        else if (keyword == "window")
+        {
+            WindowInfo w;
+            int maximizable = 1;
+            int perMonitorDpiAware = 1;
+            ok = readId(ls, w.id) && readRect(ls, w.rect) && (ls >> maximizable >> perMonitorDpiAware >> w.processName);
+            w.maximizable = maximizable;
+            w.perMonitorDpiAware = perMonitorDpiAware;
+            w.title = restOfLine(ls);
+            desktop.windows.push_back(move(w));
+        }
+        if (!ok)
+        {
+            if (error) *error = "line " + to_string(lineNumber) + ": cannot parse '" + line + "'";
+            return nullopt;
+        }
+    }
+    desktop.topology = move(topology);
+    return desktop;
+}
+
+void writeSnapshot(ostream& out, const DesktopSnapshot& desktop)
+{
+    out << "primarydpi " << desktop.topology->primaryDpi << '\n';
+    if (desktop.theme) out << "theme " << desktop.theme->captionButtonHeight << ' ' << desktop.theme->paddedBorder << '\n';
+    out << "cursor " << desktop.cursor.x << ' ' << desktop.cursor.y << '\n';
+    for (auto& m : desktop.topology->monitors)
+    {
+        auto& r = m.workArea;
+        out << "monitor 0x" << hex << m.id << dec << ' ' << r.left << ' ' << r.top << ' ' << r.right << ' ' << r.bottom << ' '
+            << m.dpi << ' ' << int(m.touchCapable) << ' ' << m.name << '\n';
+    }
+    for (auto& w : desktop.windows)
+    {
+        auto& r = w.rect;
+        out << "window 0x" << hex << w.id << dec << ' ' << r.left << ' ' << r.top << ' ' << r.right << ' ' << r.bottom << ' '
+            << int(w.maximizable) << ' ' << int(w.perMonitorDpiAware) << ' '
+            << (w.processName.empty() ? "-" : w.processName) << ' ' << w.title << '\n';
+    }
+}
+
+void writePlan(ostream& out, const MovePlan& plan)
+{
+    for (auto& m : plan)
+    {
+        out << "0x" << hex << m.window << " 0x" << m.monitor << dec << ' ' << cornerName(m.corner) << ' ' << m.index << ' '
+            << m.rect.left << ' ' << m.rect.top << ' ' << m.rect.right << ' ' << m.rect.bottom;
+        if (m.centered) out << " centered";
+        out << '\n';
+    }
+}
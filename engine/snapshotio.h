@@ -0,0 +1,29 @@
+#ifndef SNAPSHOTIO_H
+#define SNAPSHOTIO_H
+#include "layout.h"
+#include <iosfwd>
+
+/// <summary>
+/// Read a desktop snapshot in the line based text format:
+/// <code>
+/// # comment
+/// primarydpi 96
+/// theme captionButtonHeight paddedBorder
+/// cursor x y
+/// monitor id left top right bottom dpi touch name
+/// window id left top right bottom maximizable perMonitorDpiAware process title
+/// </code>
+/// Ids accept any base understood by strtoull (0x prefix for hex), flags are 0 or 1.
+/// Monitor rects are work areas, the first monitor is the primary one.
+/// </summary>
+/// <returns>nothing on a syntax error, which is described in error</returns>
+std::optional<DesktopSnapshot> readSnapshot(std::istream& in, std::string* error = nullptr);
+void writeSnapshot(std::ostream& out, const DesktopSnapshot& desktop);
+/// <summary>
+/// One line per move: window monitor corner index left top right bottom [centered]
+/// </summary>
+void writePlan(std::ostream& out, const MovePlan& plan);
+
+const char* cornerName(flags<Corner> corner);
+
+#endif // SNAPSHOTIO_H
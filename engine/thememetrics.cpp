@@ -0,0 +1,40 @@
+#include "thememetrics.h"
+
+using namespace std;
+
+static MonitorMetrics computeMetrics(const ThemeSizes& theme, double sf0, double sf)
+{
+    MonitorMetrics result;
+    result.unitSize = int((theme.captionButtonHeight + theme.paddedBorder * 2) * sf / sf0);
+    result.borderWidth = int(theme.paddedBorder * sf / 100);
+    result.borderHeight = int(result.borderWidth * 100 / sf);
+    return result;
+}
+
+MonitorMetrics ThemeMetricsCache::find(const ThemeSizes& theme, unsigned dpi, bool touch, unsigned primary)
+{
+    if (primary != primaryDpi)
+    {
+        if (!entries.empty()) statistics.invalidations++;
+        entries.clear();
+        primaryDpi = primary;
+    }
+    for (auto& e : entries)
+        if (e.dpi == dpi && e.touch == touch && e.theme == theme)
+        {
+            statistics.hits++;
+            return e.metrics;
+        }
+    statistics.misses++;
+    double baseScaleFactor = 100 * primaryDpi / 96.0; // scaling factor of primary monitor for theme size correction
+    auto metrics = computeMetrics(theme, baseScaleFactor, 100 * dpi / 96.0);
+    if (touch) metrics.unitSize = metrics.unitSize * 3 / 2;
+    entries.push_back({ theme, dpi, touch, metrics });
+    return metrics;
+}
+
+void ThemeMetricsCache::clear()
+{
+    if (!entries.empty()) statistics.invalidations++;
+    entries.clear();
+}
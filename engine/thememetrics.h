@@ -0,0 +1,57 @@
+#ifndef THEMEMETRICS_H
+#define THEMEMETRICS_H
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// Raw theme sizes of the "WINDOW" class (SM_CYSIZE and SM_CXPADDEDBORDER)
+/// </summary>
+struct ThemeSizes
+{
+    int captionButtonHeight = 0;
+    int paddedBorder = 0;
+
+    bool operator==(const ThemeSizes&) const = default;
+};
+
+struct MonitorMetrics
+{
+    int unitSize = 16;
+    int borderWidth = 0;
+    int borderHeight = 0;
+};
+
+/// <summary>
+/// Unit and border sizes of monitors, computed once per theme, DPI and touch capability.
+/// Theme sizes are scaled relative to the primary monitor, so a change of its DPI drops all entries.
+/// </summary>
+class ThemeMetricsCache
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t invalidations = 0;
+    };
+
+    /// <param name="touch">the unit size is enlarged for touch input</param>
+    MonitorMetrics find(const ThemeSizes& theme, unsigned dpi, bool touch, unsigned primaryDpi);
+    void clear();
+    const Stats& stats() const { return statistics; }
+
+private:
+    struct Entry
+    {
+        ThemeSizes theme;
+        unsigned dpi;
+        bool touch;
+        MonitorMetrics metrics;
+    };
+
+    std::vector<Entry> entries; ///< a few monitor configurations at most
+    unsigned primaryDpi = 0;
+    Stats statistics;
+};
+
+#endif // THEMEMETRICS_H
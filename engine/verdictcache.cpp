@@ -0,0 +1,80 @@
+#include "verdictcache.h"
+
+using namespace std;
+
+void VerdictCache::beginPass()
+{
+    pass++;
+}
+
+void VerdictCache::endPass()
+{
+    statistics.evictions += erase_if(entries, [this](auto& item) { return item.second.lastSeenPass != pass; });
+}
+
+const WindowVerdict* VerdictCache::find(WindowId w, const WindowStyleKey& key)
+{
+    auto it = entries.find(w);
+    if (it == entries.end() || it->second.generation != currentGeneration || !(it->second.key == key))
+    {
+        statistics.misses++;
+        return nullptr;
+    }
+    statistics.hits++;
+    it->second.lastSeenPass = pass;
+    return &it->second.verdict;
+}
+
+const WindowVerdict& VerdictCache::store(WindowId w, const WindowStyleKey& key, WindowVerdict verdict)
+{
+    auto& entry = entries[w];
+    entry = { key, move(verdict), currentGeneration, pass };
+    return entry.verdict;
+}
+
+void VerdictCache::invalidate(WindowId w)
+{
+    // eligibility of an owner depends on the visibility of its popups, walk up a few levels
+    for (int depth = 0; w && depth < 8; depth++)
+    {
+        auto it = entries.find(w);
+        if (it == entries.end()) break;
+        if (it->second.generation == currentGeneration)
+        {
+            it->second.generation = 0;
+            statistics.invalidations++;
+        }
+        w = it->second.key.owner;
+    }
+}
+
+void VerdictCache::invalidateAll()
+{
+    currentGeneration++;
+}
+
+void VerdictCache::onEvent(const WindowEvent& event)
+{
+    using enum WindowEventKind;
+    switch (event.kind)
+    {
+    case destroyed:
+        if (auto it = entries.find(event.window); it != entries.end())
+        {
+            invalidate(it->second.key.owner);
+            entries.erase(it);
+        }
+        break;
+    case created:
+    case shown:
+    case hidden:
+    case nameChanged:
+    case ownerChanged:
+    case minimized:
+    case restored:
+        invalidate(event.window);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef VERDICTCACHE_H
+#define VERDICTCACHE_H
+#include "eventcoalescer.h"
+#include "processcache.h"
+#include <unordered_map>
+
+/// <summary>
+/// Cheaply readable window properties; a cached verdict is valid only while they stay the same
+/// </summary>
+struct WindowStyleKey
+{
+    std::uint32_t style = 0;
+    std::uint32_t exStyle = 0;
+    WindowId owner = 0;
+    friend bool operator==(const WindowStyleKey&, const WindowStyleKey&) = default;
+};
+
+/// <summary>
+/// Result of the expensive classification of a top-level window
+/// </summary>
+struct WindowVerdict
+{
+    bool eligible = false; ///< takes part in the layout
+    bool perMonitorDpiAware = true;
+    ProcessId pid = 0;
+    std::string processName;
+    std::string title;
+};
+
+/// <summary>
+/// Per-window classification verdicts which survive between passes. An entry is reused while
+/// the style key matches and no window event invalidated it or its owner chain.
+/// </summary>
+class VerdictCache
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t invalidations = 0;
+        size_t evictions = 0; ///< windows which disappeared
+    };
+
+    /// start an enumeration, windows not found until endPass are evicted
+    void beginPass();
+    void endPass();
+    /// <returns>nullptr if the verdict has to be computed again</returns>
+    const WindowVerdict* find(WindowId w, const WindowStyleKey& key);
+    const WindowVerdict& store(WindowId w, const WindowStyleKey& key, WindowVerdict verdict);
+    /// the window and the windows owning it have to be classified again
+    void invalidate(WindowId w);
+    /// start a new generation, making all verdicts stale
+    void invalidateAll();
+    void onEvent(const WindowEvent& event);
+    size_t size() const { return entries.size(); }
+    std::uint64_t generation() const { return currentGeneration; }
+    const Stats& stats() const { return statistics; }
+
+private:
+    struct Entry
+    {
+        WindowStyleKey key;
+        WindowVerdict verdict;
+        std::uint64_t generation = 0;
+        std::uint64_t lastSeenPass = 0;
+    };
+
+    std::unordered_map<WindowId, Entry> entries;
+    std::uint64_t currentGeneration = 1;
+    std::uint64_t pass = 0;
+    Stats statistics;
+};
+
+#endif // VERDICTCACHE_H
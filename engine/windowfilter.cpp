@@ -0,0 +1,238 @@
+#include "windowfilter.h"
+#include <charconv>
+
+using namespace std;
+
+const char* const WindowFilter::defaultRules =
+    "# hosts the frames of UWP apps, which are arranged through their own windows\n"
+    "exclude process=ApplicationFrameHost.exe\n";
+
+static char fold(char c)
+{
+    return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+}
+
+/// <param name="pattern">lower case</param>
+static bool globMatch(string_view pattern, string_view text)
+{
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = string_view::npos;
+    size_t resume = 0;
+    while (t < text.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == fold(text[t])))
+        {
+            p++;
+            t++;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            resume = t;
+        }
+        else if (star != string_view::npos)
+        {
+            // let the last star swallow one more character
+            p = star + 1;
+            t = ++resume;
+        }
+        else return false;
+    }
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+size_t WindowFilter::CaseInsensitiveHash::operator()(string_view s) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : s) hash = (hash ^ uint8_t(fold(c))) * 1099511628211ull;
+    return size_t(hash);
+}
+
+bool WindowFilter::CaseInsensitiveEqual::operator()(string_view a, string_view b) const
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (fold(a[i]) != fold(b[i])) return false;
+    return true;
+}
+
+uint64_t WindowFilter::TextMatcher::match(string_view value) const
+{
+    uint64_t matches = 0;
+    if (!exact.empty())
+        if (auto it = exact.find(value); it != exact.end()) matches = it->second;
+    for (auto const& [pattern, rules] : globs)
+        if ((rules & ~matches) && globMatch(pattern, value)) matches |= rules;
+    return matches;
+}
+
+/// <summary>
+/// Split a line into words, a quoted part may contain blanks and semicolons
+/// </summary>
+/// <returns>position after the rule, or nothing for an unterminated quote</returns>
+static optional<size_t> splitRule(string_view text, size_t pos, vector<string>& words)
+{
+    words.clear();
+    while (pos < text.size())
+    {
+        char c = text[pos];
+        if (c == '\n' || c == ';') return pos + 1;
+        if (c == ' ' || c == '\t' || c == '\r')
+        {
+            pos++;
+            continue;
+        }
+        if (c == '#')
+        {
+            while (pos < text.size() && text[pos] != '\n') pos++;
+            continue;
+        }
+        auto& word = words.emplace_back();
+        while (pos < text.size() && text[pos] != ' ' && text[pos] != '\t' && text[pos] != '\r' && text[pos] != '\n' && text[pos] != ';')
+        {
+            if (text[pos] == '"')
+            {
+                auto close = text.find_first_of("\"\n", pos + 1);
+                if (close == string_view::npos || text[close] != '"') return nullopt;
+                word.append(text.substr(pos + 1, close - pos - 1));
+                pos = close + 1;
+            }
+            else word += text[pos++];
+        }
+    }
+    return pos;
+}
+
+static optional<uint32_t> parseMask(string_view value)
+{
+    int base = 10;
+    if (value.starts_with("0x") || value.starts_with("0X"))
+    {
+        value.remove_prefix(2);
+        base = 16;
+    }
+    uint32_t mask = 0;
+    auto [end, ec] = from_chars(value.data(), value.data() + value.size(), mask, base);
+    if (ec != errc() || end != value.data() + value.size() || value.empty()) return nullopt;
+    return mask;
+}
+
+optional<WindowFilter> WindowFilter::parse(string_view text, string* error)
+{
+    WindowFilter filter;
+    size_t line = 1;
+    auto fail = [&](const string& message) -> optional<WindowFilter>
+    {
+        if (error) *error = "line " + to_string(line) + ": " + message;
+        return nullopt;
+    };
+
+    vector<string> words;
+    for (size_t pos = 0; pos < text.size();)
+    {
+        auto next = splitRule(text, pos, words);
+        if (!next) return fail("unterminated quote");
+        if (!words.empty())
+        {
+            bool include = words[0] == "include";
+            if (!include && words[0] != "exclude") return fail("expected include or exclude, found '" + words[0] + "'");
+            if (words.size() == 1) return fail("rule without conditions");
+            if (filter.ruleCount == maxRules) return fail("more than " + to_string(maxRules) + " rules");
+            uint64_t rule = uint64_t(1) << filter.ruleCount;
+            StyleCondition style{ rule, 0, 0 };
+            bool hasStyle = false;
+            bool hasExStyle = false;
+            for (size_t i = 1; i < words.size(); i++)
+            {
+                string_view condition = words[i];
+                auto equals = condition.find('=');
+                if (equals == string_view::npos || equals + 1 == condition.size())
+                    return fail("expected field=value, found '" + words[i] + "'");
+                auto key = condition.substr(0, equals);
+                auto value = condition.substr(equals + 1);
+                if (key == "style" || key == "exstyle")
+                {
+                    bool ex = key == "exstyle";
+                    auto mask = parseMask(value);
+                    if (!mask) return fail("invalid style mask '" + string(value) + "'");
+                    if (ex ? hasExStyle : hasStyle) return fail(string(key) + " given twice");
+                    (ex ? hasExStyle : hasStyle) = true;
+                    (ex ? style.exStyle : style.style) = *mask;
+                    filter.constrained[int(WindowField::style)] |= rule;
+                    continue;
+                }
+                WindowField field;
+                if (key == "process") field = WindowField::process;
+                else if (key == "class") field = WindowField::className;
+                else if (key == "title") field = WindowField::title;
+                else return fail("unknown field '" + string(key) + "'");
+                if (filter.constrained[int(field)] & rule) return fail(string(key) + " given twice");
+                filter.constrained[int(field)] |= rule;
+                auto& matcher = filter.text[int(field)];
+                if (value.find_first_of("*?") == string_view::npos)
+                {
+                    auto it = matcher.exact.find(value);
+                    if (it == matcher.exact.end()) it = matcher.exact.emplace(string(value), 0).first;
+                    it->second |= rule;
+                }
+                else
+                {
+                    string pattern(value);
+                    for (auto& c : pattern) c = fold(c);
+                    matcher.globs.emplace_back(move(pattern), rule);
+                }
+            }
+            if (hasStyle || hasExStyle) filter.styles.push_back(style);
+            if (include) filter.includeRules |= rule;
+            filter.allRules |= rule;
+            filter.ruleCount++;
+        }
+        if (text[*next - 1] == '\n') line++;
+        pos = *next;
+    }
+
+    for (unsigned known = 0; known < filter.complete.size(); known++)
+    {
+        auto rules = filter.allRules;
+        for (int f = 0; f < windowFieldCount; f++)
+            if (!(known & 1u << f)) rules &= ~filter.constrained[f];
+        filter.complete[known] = rules;
+    }
+    return filter;
+}
+
+bool WindowFilter::needs(const State& state, WindowField field) const
+{
+    return !(state.known & 1u << int(field)) && (state.alive & constrained[int(field)]) && decision(state) == Decision::undecided;
+}
+
+WindowFilter::Decision WindowFilter::testStyle(State& state, uint32_t style, uint32_t exStyle) const
+{
+    uint64_t matches = 0;
+    for (auto const& c : styles)
+        if ((style & c.style) == c.style && (exStyle & c.exStyle) == c.exStyle) matches |= c.rule;
+    return apply(state, WindowField::style, matches);
+}
+
+WindowFilter::Decision WindowFilter::test(State& state, WindowField field, string_view value) const
+{
+    uint64_t matches = state.alive & constrained[int(field)] ? text[int(field)].match(value) : 0;
+    return apply(state, field, matches);
+}
+
+WindowFilter::Decision WindowFilter::apply(State& state, WindowField field, uint64_t matches) const
+{
+    state.alive &= ~constrained[int(field)] | matches;
+    state.known |= 1u << int(field);
+    return decision(state);
+}
+
+WindowFilter::Decision WindowFilter::decision(const State& state) const
+{
+    if (!state.alive) return Decision::include;
+    auto first = state.alive & (~state.alive + 1);
+    if (!(first & complete[state.known])) return Decision::undecided;
+    return first & includeRules ? Decision::include : Decision::exclude;
+}
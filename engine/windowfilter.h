@@ -0,0 +1,112 @@
+#ifndef WINDOWFILTER_H
+#define WINDOWFILTER_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Window properties the rules test, in the order of the cost of reading them
+/// </summary>
+enum class WindowField : int
+{
+    style,     ///< style and extended style bits, read together with the window rect
+    className, ///< one call which does not send messages
+    title,     ///< the text of the window, read after the alt-tab heuristics
+    process,   ///< image name of the owning process, needs to open the process
+};
+constexpr int windowFieldCount = int(WindowField::process) + 1;
+
+/// <summary>
+/// User defined include and exclude rules, compiled once and shared by all threads.
+/// The first rule which matches a window decides, windows which match no rule are included. The fields are
+/// tested cheapest first, and a window is decided as soon as the first rule its fields did not contradict
+/// is matched, so exceptions go right before the rules they except. Each rule is a conjunction of conditions:
+///     exclude process=ApplicationFrameHost.exe
+///     exclude class=ConsoleWindowClass title="*Administrator*"
+///     include process=putty.exe
+///     exclude exstyle=0x80
+/// Names are case insensitive globs with * and ?, style values are masks whose bits must all be set.
+/// Rules end at new lines and semicolons, # starts a comment.
+/// </summary>
+class WindowFilter
+{
+public:
+    enum class Decision
+    {
+        undecided,
+        include,
+        exclude,
+    };
+
+    /// <summary>
+    /// Progress of one window through the rules
+    /// </summary>
+    struct State
+    {
+        std::uint64_t alive = 0; ///< rules which the tested fields did not contradict
+        unsigned known = 0;      ///< bits of the tested fields
+    };
+
+    static constexpr size_t maxRules = 64;
+    /// rules in effect until the settings provide others
+    static const char* const defaultRules;
+
+    /// <returns>nothing if the text has errors, described by error</returns>
+    static std::optional<WindowFilter> parse(std::string_view text, std::string* error = nullptr);
+
+    State begin() const { return { allRules, 0 }; }
+    /// <returns>testing the field may still change the decision</returns>
+    bool needs(const State& state, WindowField field) const;
+    Decision testStyle(State& state, std::uint32_t style, std::uint32_t exStyle) const;
+    /// <param name="field">any field but style</param>
+    Decision test(State& state, WindowField field, std::string_view value) const;
+    Decision decision(const State& state) const;
+    size_t size() const { return ruleCount; }
+
+private:
+    struct CaseInsensitiveHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const;
+    };
+    struct CaseInsensitiveEqual
+    {
+        using is_transparent = void;
+        bool operator()(std::string_view a, std::string_view b) const;
+    };
+
+    /// <summary>
+    /// Patterns of one text field of all rules; names without wildcards are looked up in one step
+    /// </summary>
+    struct TextMatcher
+    {
+        std::unordered_map<std::string, std::uint64_t, CaseInsensitiveHash, CaseInsensitiveEqual> exact;
+        std::vector<std::pair<std::string, std::uint64_t>> globs; ///< lower case patterns
+
+        std::uint64_t match(std::string_view value) const;
+    };
+
+    struct StyleCondition
+    {
+        std::uint64_t rule;
+        std::uint32_t style;
+        std::uint32_t exStyle;
+    };
+
+    size_t ruleCount = 0;
+    std::uint64_t allRules = 0;
+    std::uint64_t includeRules = 0;
+    std::array<std::uint64_t, windowFieldCount> constrained{}; ///< rules with a condition on the field
+    std::array<std::uint64_t, 1 << windowFieldCount> complete{}; ///< rules fully tested, by known fields
+    std::array<TextMatcher, windowFieldCount> text;             ///< style is unused
+    std::vector<StyleCondition> styles;
+
+    Decision apply(State& state, WindowField field, std::uint64_t matches) const;
+};
+
+#endif // WINDOWFILTER_H
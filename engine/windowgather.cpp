@@ -0,0 +1,155 @@
+#include "windowgather.h"
+#include <thread>
+
+using namespace std;
+
+GatherResult gatherWindows(const vector<WindowId>& handles, WindowQueryBackend& backend, const WindowFilter& filter,
+                           VerdictCache& verdicts, ProcessCache& processes, WorkerPool& pool)
+{
+    vector<optional<WindowProbe>> probes(handles.size());
+    pool.parallelFor(handles.size(), [&](size_t i) { probes[i] = backend.probe(handles[i]); });
+
+    vector<const WindowVerdict*> cached(handles.size());
+    vector<size_t> missing;
+    for (size_t i = 0; i < handles.size(); i++)
+        if (probes[i] && !(cached[i] = verdicts.find(handles[i], probes[i]->key))) missing.push_back(i);
+
+    GatherResult result;
+    result.classified = missing.size();
+    if (!missing.empty())
+    {
+        auto start = SteadyClock::now();
+        vector<WindowVerdict> fresh(missing.size());
+        vector<WindowFilter::State> states(missing.size(), filter.begin());
+        vector<optional<WindowField>> excludedBy(missing.size());
+        pool.parallelFor(missing.size(), [&](size_t m)
+        {
+            auto w = handles[missing[m]];
+            auto& state = states[m];
+            auto const& key = probes[missing[m]]->key;
+            // cheapest fields first, an excluded window is not queried any further
+            if (filter.testStyle(state, key.style, key.exStyle) == WindowFilter::Decision::exclude)
+            {
+                excludedBy[m] = WindowField::style;
+                return;
+            }
+            if (filter.needs(state, WindowField::className) &&
+                filter.test(state, WindowField::className, backend.className(w)) == WindowFilter::Decision::exclude)
+            {
+                excludedBy[m] = WindowField::className;
+                return;
+            }
+            auto& verdict = fresh[m] = backend.classify(w);
+            if (verdict.eligible && filter.needs(state, WindowField::title) &&
+                filter.test(state, WindowField::title, verdict.title) == WindowFilter::Decision::exclude)
+            {
+                verdict.eligible = false;
+                excludedBy[m] = WindowField::title;
+            }
+        });
+
+        vector<ProcessId> pids;
+        for (auto const& verdict : fresh) if (verdict.eligible) pids.push_back(verdict.pid);
+        processes.prefetch(pids, pool);
+        vector<size_t> accepted;
+        for (size_t m = 0; m < missing.size(); m++)
+        {
+            auto& verdict = fresh[m];
+            if (!verdict.eligible) continue;
+            if (auto info = processes.find(verdict.pid)) verdict.processName = info->name;
+            if (filter.needs(states[m], WindowField::process) &&
+                filter.test(states[m], WindowField::process, verdict.processName) == WindowFilter::Decision::exclude)
+            {
+                verdict.eligible = false;
+                excludedBy[m] = WindowField::process;
+            }
+            else accepted.push_back(m);
+        }
+        pool.parallelFor(accepted.size(), [&](size_t a)
+        {
+            auto m = accepted[a];
+            fresh[m].perMonitorDpiAware = backend.perMonitorDpiAware(handles[missing[m]]);
+        });
+
+        for (size_t m = 0; m < missing.size(); m++)
+        {
+            if (excludedBy[m]) result.filtered[int(*excludedBy[m])]++;
+            auto i = missing[m];
+            cached[i] = &verdicts.store(handles[i], probes[i]->key, move(fresh[m]));
+        }
+        result.classifyTime = SteadyClock::now() - start;
+    }
+
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        auto verdict = cached[i];
+        if (!verdict || !verdict->eligible) continue;
+        WindowInfo& info = result.windows.emplace_back();
+        info.id = handles[i];
+        info.rect = probes[i]->rect;
+        info.processName = verdict->processName;
+        info.title = verdict->title;
+        info.maximizable = probes[i]->maximizable;
+        info.perMonitorDpiAware = verdict->perMonitorDpiAware;
+    }
+    return result;
+}
+
+static void simulateLatency(Duration latency)
+{
+    if (latency.count() > 0) this_thread::sleep_for(latency);
+}
+
+optional<WindowProbe> SimulatedWindowBackend::probe(WindowId w)
+{
+    probes++;
+    simulateLatency(probeLatency);
+    auto it = windows.find(w);
+    return it == windows.end() ? nullopt : it->second.probe;
+}
+
+string SimulatedWindowBackend::className(WindowId w)
+{
+    classNameQueries++;
+    auto it = windows.find(w);
+    return it == windows.end() ? string() : it->second.className;
+}
+
+WindowVerdict SimulatedWindowBackend::classify(WindowId w)
+{
+    classifications++;
+    simulateLatency(classifyLatency);
+    auto it = windows.find(w);
+    if (it == windows.end()) return {};
+    auto verdict = it->second.verdict;
+    verdict.processName.clear();
+    verdict.perMonitorDpiAware = true; // answered by perMonitorDpiAware
+    return verdict;
+}
+
+bool SimulatedWindowBackend::perMonitorDpiAware(WindowId w)
+{
+    dpiQueries++;
+    auto it = windows.find(w);
+    return it == windows.end() || it->second.verdict.perMonitorDpiAware;
+}
+
+optional<ProcessHandle> SimulatedWindowBackend::open(ProcessId pid)
+{
+    if (!processes.contains(pid)) return nullopt;
+    return ProcessHandle(pid);
+}
+
+bool SimulatedWindowBackend::isRunning(ProcessHandle handle, uint64_t)
+{
+    return processes.contains(ProcessId(handle));
+}
+
+optional<ProcessInfo> SimulatedWindowBackend::query(ProcessHandle handle)
+{
+    processQueries++;
+    simulateLatency(processLatency);
+    auto it = processes.find(ProcessId(handle));
+    if (it == processes.end()) return nullopt;
+    return it->second;
+}
@@ -0,0 +1,94 @@
+#ifndef WINDOWGATHER_H
+#define WINDOWGATHER_H
+#include "layout.h"
+#include "verdictcache.h"
+#include "windowfilter.h"
+#include "workerpool.h"
+#include <array>
+#include <atomic>
+#include <unordered_map>
+
+/// <summary>
+/// Cheap per-window properties read for every enumerated window
+/// </summary>
+struct WindowProbe
+{
+    WindowStyleKey key;
+    Rect rect;
+    bool maximizable = true;
+};
+
+/// <summary>
+/// Per-window queries of the platform, called from several threads at once
+/// </summary>
+class WindowQueryBackend
+{
+public:
+    virtual ~WindowQueryBackend() = default;
+    /// <returns>nothing for windows which never take part in the layout, e.g. hidden or minimized ones</returns>
+    virtual std::optional<WindowProbe> probe(WindowId w) = 0;
+    /// read only when a rule tests it
+    virtual std::string className(WindowId w) { (void)w; return {}; }
+    /// <summary>
+    /// The expensive classification: heuristics, title and pid. The process name comes from the process cache,
+    /// the DPI awareness from perMonitorDpiAware once the window passed the rules.
+    /// </summary>
+    virtual WindowVerdict classify(WindowId w) = 0;
+    virtual bool perMonitorDpiAware(WindowId w) { (void)w; return true; }
+};
+
+struct GatherResult
+{
+    std::vector<WindowInfo> windows; ///< eligible windows in enumeration order
+    size_t classified = 0;           ///< windows missing from the verdict cache
+    Duration classifyTime{};         ///< classification and process resolution of those windows
+    std::array<size_t, windowFieldCount> filtered{}; ///< windows excluded by the rules, by the field which decided
+};
+
+/// <summary>
+/// Probe the enumerated windows and classify the ones missing from the verdict cache, fanning the queries
+/// out over the pool. The rules are tested as soon as the fields they need are read, so excluded windows
+/// skip the remaining queries. The caches are only touched from the calling thread and the result does not
+/// depend on the number of threads.
+/// </summary>
+GatherResult gatherWindows(const std::vector<WindowId>& handles, WindowQueryBackend& backend, const WindowFilter& filter,
+                           VerdictCache& verdicts, ProcessCache& processes, WorkerPool& pool);
+
+/// <summary>
+/// Windows and processes in memory, with a fixed latency per call standing in for the blocking
+/// system calls of a real desktop
+/// </summary>
+class SimulatedWindowBackend : public WindowQueryBackend, public ProcessResolver
+{
+public:
+    struct Window
+    {
+        std::optional<WindowProbe> probe;
+        std::string className;
+        WindowVerdict verdict; ///< the process name comes from processes
+    };
+
+    std::unordered_map<WindowId, Window> windows;
+    std::unordered_map<ProcessId, ProcessInfo> processes;
+    Duration probeLatency{};
+    Duration classifyLatency{};
+    Duration processLatency{}; ///< per process query
+    std::atomic<size_t> probes = 0;
+    std::atomic<size_t> classNameQueries = 0;
+    std::atomic<size_t> classifications = 0;
+    std::atomic<size_t> dpiQueries = 0;
+    std::atomic<size_t> processQueries = 0;
+
+    std::optional<WindowProbe> probe(WindowId w) override;
+    std::string className(WindowId w) override;
+    WindowVerdict classify(WindowId w) override;
+    bool perMonitorDpiAware(WindowId w) override;
+
+    std::optional<ProcessHandle> open(ProcessId pid) override;
+    void close(ProcessHandle) override {}
+    std::uint64_t startTime(ProcessHandle) override { return 1; }
+    bool isRunning(ProcessHandle handle, std::uint64_t) override;
+    std::optional<ProcessInfo> query(ProcessHandle handle) override;
+};
+
+#endif // WINDOWGATHER_H
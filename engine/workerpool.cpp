@@ -0,0 +1,67 @@
+#include "workerpool.h"
+
+using namespace std;
+
+WorkerPool::WorkerPool(unsigned workers)
+{
+    threads.reserve(workers);
+    for (unsigned i = 0; i < workers; i++) threads.emplace_back(&WorkerPool::work, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+void WorkerPool::parallelFor(size_t count, const function<void(size_t)>& body)
+{
+    if (count == 0) return;
+    if (threads.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; i++) body(i);
+        return;
+    }
+    {
+        lock_guard lock(mutex);
+        job = &body;
+        jobSize = count;
+        nextIteration = 0;
+        busy = unsigned(threads.size());
+        generation++;
+    }
+    wake.notify_all();
+    runIterations();
+    unique_lock lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+void WorkerPool::runIterations()
+{
+    for (size_t i = nextIteration++; i < jobSize; i = nextIteration++) (*job)(i);
+}
+
+void WorkerPool::work()
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        runIterations();
+        {
+            lock_guard lock(mutex);
+            busy--;
+        }
+        finished.notify_one();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed set of threads sharing the iterations of parallelFor. The calling thread takes part as well,
+/// so a pool without workers runs everything inline. Iterations are handed out one at a time,
+/// which keeps the threads busy when some iterations block much longer than others.
+/// </summary>
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned workers);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /// threads running parallelFor, including the caller
+    unsigned concurrency() const { return unsigned(threads.size()) + 1; }
+    /// <summary>
+    /// Run body(0) ... body(count - 1) and wait for all of them. The body must not throw.
+    /// Not reentrant, call from one thread at a time.
+    /// </summary>
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    void work();
+    void runIterations();
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobSize = 0;
+    std::atomic<size_t> nextIteration = 0;
+    std::uint64_t generation = 0;
+    unsigned busy = 0; ///< workers still running the current job
+    bool stopping = false;
+};
+
+#endif // WORKERPOOL_H
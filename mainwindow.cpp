@@ -22,8 +22,6 @@ MainWindow::MainWindow(QWidget *parent):
     trayIconMenu->addAction(ui->actionQuit_and_unregister);
     trayIcon->setContextMenu(trayIconMenu);
     registerForStartup();
-    timer.setInterval(1000);
-    connect(&timer, &QTimer::timeout, []{processAllWindows();});
 }
 
 MainWindow::~MainWindow()
@@ -34,13 +32,14 @@ MainWindow::~MainWindow()
 
 void MainWindow::on_actionAuto_arrange_windows_toggled(bool value)
 {
-    if(value) timer.start();
-    else timer.stop();
+    setAutoArrange(value);
 }
 
 void MainWindow::on_maxIncrease_valueChanged(int v)
 {
-    windowops_maxIncrease = v;
+    auto layout = layoutSettings();
+    layout.maxIncrease = v;
+    setLayoutSettings(layout, false);
 }
 
 void MainWindow::iconActivated(QSystemTrayIcon::ActivationReason reason)
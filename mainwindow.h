@@ -4,7 +4,6 @@
 #include "mainwindowwithsettings.h"
 #include <QSettings>
 #include <QSystemTrayIcon>
-#include <QTimer>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -28,6 +27,5 @@ private:
 
     Ui::MainWindow *ui;
     QSystemTrayIcon* trayIcon;
-    QTimer timer;
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,104 @@
+#include "registrysettings.h"
+#include <Windows.h>
+#include "engine/logger.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace std;
+
+static string narrow(wstring_view text)
+{
+    string result(size_t((std::max)(0, WideCharToMultiByte(CP_ACP, 0, text.data(), int(text.size()), nullptr, 0, nullptr, nullptr))), '\0');
+    WideCharToMultiByte(CP_ACP, 0, text.data(), int(text.size()), result.data(), int(result.size()), nullptr, nullptr);
+    return result;
+}
+
+static wstring widen(string_view text)
+{
+    wstring result(size_t((std::max)(0, MultiByteToWideChar(CP_ACP, 0, text.data(), int(text.size()), nullptr, 0))), L'\0');
+    MultiByteToWideChar(CP_ACP, 0, text.data(), int(text.size()), result.data(), int(result.size()));
+    return result;
+}
+
+optional<SettingsMap> RegistrySettingsBackend::load()
+{
+    SettingsMap values;
+    HKEY hKey;
+    auto status = RegOpenKeyEx(HKEY_CURRENT_USER, key.c_str(), 0, KEY_READ, &hKey);
+    if (status == ERROR_FILE_NOT_FOUND) return values;
+    if (status != ERROR_SUCCESS) return nullopt;
+    DWORD count = 0;
+    DWORD maxName = 0;
+    DWORD maxData = 0;
+    if (ERROR_SUCCESS == RegQueryInfoKey(hKey, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &count, &maxName, &maxData, nullptr, nullptr))
+    {
+        // one buffer for all values instead of an allocation per read
+        wstring name(maxName + 1, L'\0');
+        auto data = make_unique<BYTE[]>(maxData + sizeof(TCHAR));
+        for (DWORD i = 0; i < count; i++)
+        {
+            auto nameSize = DWORD(name.size());
+            auto dataSize = maxData;
+            DWORD type;
+            if (ERROR_SUCCESS != RegEnumValue(hKey, i, name.data(), &nameSize, nullptr, &type, data.get(), &dataSize)) continue;
+            auto valueName = narrow(wstring_view(name.data(), nameSize));
+            if (type == REG_DWORD && dataSize == sizeof(DWORD))
+            {
+                DWORD value;
+                memcpy(&value, data.get(), sizeof(value));
+                values.insert_or_assign(valueName, int(value));
+            }
+            else if (type == REG_SZ)
+            {
+                wstring_view text(bit_cast<const TCHAR*>(data.get()), dataSize / sizeof(TCHAR));
+                values.insert_or_assign(valueName, narrow(text.substr(0, text.find(L'\0'))));
+            }
+        }
+    }
+    RegCloseKey(hKey);
+    return values;
+}
+
+bool RegistrySettingsBackend::save(const SettingsMap& all, const vector<string>& changed)
+{
+    HKEY hKey;
+    if (ERROR_SUCCESS != RegCreateKeyEx(HKEY_CURRENT_USER, key.c_str(), 0, nullptr, REG_OPTION_NON_VOLATILE, KEY_WRITE, nullptr, &hKey, nullptr))
+    {
+        logger().error("Settings not saved, the registry key could not be opened");
+        return false;
+    }
+    bool result = true;
+    for (auto const& name : changed)
+    {
+        auto it = all.find(name);
+        if (it == all.end()) continue;
+        auto valueName = widen(name);
+        LSTATUS status;
+        if (auto text = get_if<string>(&it->second))
+        {
+            auto wide = widen(*text);
+            status = RegSetValueEx(hKey, valueName.c_str(), 0, REG_SZ, bit_cast<const BYTE*>(wide.c_str()), DWORD(sizeof(TCHAR) * (wide.size() + 1)));
+        }
+        else
+        {
+            DWORD value = holds_alternative<bool>(it->second) ? get<bool>(it->second) : DWORD(get<int>(it->second));
+            status = RegSetValueEx(hKey, valueName.c_str(), 0, REG_DWORD, bit_cast<const BYTE*>(&value), sizeof(value));
+        }
+        if (status != ERROR_SUCCESS)
+        {
+            logger().error("Setting {} not saved", name);
+            result = false;
+        }
+    }
+    RegCloseKey(hKey);
+    return result;
+}
+
+bool RegistrySettingsBackend::clear()
+{
+    // RegDeleteTree empties the key, RegDeleteKey removes it
+    auto status = RegDeleteTree(HKEY_CURRENT_USER, key.c_str());
+    if (status == ERROR_FILE_NOT_FOUND) return true;
+    return status == ERROR_SUCCESS && ERROR_SUCCESS == RegDeleteKey(HKEY_CURRENT_USER, key.c_str());
+}
@@ -0,0 +1,22 @@
+#ifndef REGISTRYSETTINGS_H
+#define REGISTRYSETTINGS_H
+#include "engine/settingsstore.h"
+
+/// <summary>
+/// Settings as the values of one key under HKEY_CURRENT_USER. Booleans and integers are DWORDs,
+/// text is REG_SZ converted from the ANSI code page, which the window rules are matched in.
+/// A batch opens the key once.
+/// </summary>
+class RegistrySettingsBackend : public SettingsBackend
+{
+public:
+    explicit RegistrySettingsBackend(std::wstring key) : key(std::move(key)) {}
+    std::optional<SettingsMap> load() override;
+    bool save(const SettingsMap& all, const std::vector<std::string>& changed) override;
+    bool clear() override;
+
+private:
+    std::wstring key;
+};
+
+#endif // REGISTRYSETTINGS_H
@@ -0,0 +1,205 @@
+#include "check.h"
+#include "engine/animator.h"
+#include <cmath>
+
+using namespace std;
+
+/// <summary>
+/// Windows of 400 x 300 at the top-left corner, animated on a virtual clock
+/// </summary>
+struct AnimatedDesktop
+{
+    ManualClock clock;
+    SimulatedMoveBackend backend{ clock };
+    MoveAnimator animator{ backend, clock };
+    TimePoint start = clock.now();
+
+    explicit AnimatedDesktop(WindowId count)
+    {
+        for (WindowId w = 1; w <= count; w++) backend.windows[w] = { 0, 0, 400, 300 };
+    }
+
+    /// <returns>moves of all windows to left</returns>
+    MovePlan to(int32_t left)
+    {
+        MovePlan plan;
+        for (auto const& [w, r] : backend.windows)
+        {
+            WindowMove move;
+            move.window = w;
+            move.rect = { left, r.top, left + r.width(), r.bottom };
+            plan.push_back(move);
+        }
+        return plan;
+    }
+
+    Rect at(WindowId w) { return backend.currentRect(w).value_or(Rect{}); }
+
+    /// <summary>
+    /// Wait for the next frame and post it
+    /// </summary>
+    /// <returns>a frame was due</returns>
+    bool step()
+    {
+        auto next = animator.nextFrame();
+        if (!next) return false;
+        clock.sleepUntil(*next);
+        animator.frame();
+        return true;
+    }
+
+    /// <returns>the left edge of a frame heading from from to to, at the time of the frame since the animation started</returns>
+    int32_t eased(int32_t from, int32_t to, Duration sinceStart) const
+    {
+        // a cubic ease out
+        double rest = 1 - chrono::duration<double>(sinceStart) / chrono::duration<double>(animator.currentOptions().duration);
+        return int32_t(from + llround((double(to) - from) * (1 - rest * rest * rest)));
+    }
+};
+
+TEST(animation, framesLandAtWholeIntervals)
+{
+    AnimatedDesktop d(3);
+    auto interval = d.animator.currentOptions().frameInterval;
+    d.animator.start(d.to(1000));
+    vector<Duration> times;
+    vector<int32_t> lefts;
+    while (d.step())
+    {
+        times.push_back(d.clock.now() - d.start);
+        lefts.push_back(d.at(1).left);
+    }
+    // 200 ms at 60 Hz
+    CHECK(times.size() == 12);
+    for (size_t i = 0; i < times.size(); i++) CHECK(times[i] == interval * long(i + 1));
+    for (size_t i = 1; i < lefts.size(); i++) CHECK(lefts[i] > lefts[i - 1]);
+    CHECK(lefts.front() == d.eased(0, 1000, interval));
+    CHECK(d.at(3) == (Rect{ 1000, 0, 1400, 300 }));
+    CHECK(d.backend.postedBatches == 12);
+    CHECK(d.animator.stats().frames == 12);
+    CHECK(d.animator.stats().droppedFrames == 0);
+    CHECK(d.animator.stats().slowFrames == 0);
+}
+
+TEST(animation, lateFrameSkipsThePeriodsItMissed)
+{
+    AnimatedDesktop d(1);
+    auto interval = d.animator.currentOptions().frameInterval;
+    d.animator.start(d.to(1000));
+    d.step();
+    // the frame due at two intervals comes at three and a half
+    d.clock.sleepUntil(d.start + interval * 7 / 2);
+    d.animator.frame();
+    CHECK(d.animator.nextFrame() == d.start + interval * 4);
+    CHECK(d.animator.stats().droppedFrames == 1);
+    CHECK(d.at(1).left == d.eased(0, 1000, interval * 7 / 2));
+}
+
+TEST(animation, retargetStartsFromTheLastPostedRect)
+{
+    AnimatedDesktop d(1);
+    auto interval = d.animator.currentOptions().frameInterval;
+    // the window takes the frames half an interval late
+    d.backend.delays[1] = interval * 3 / 2;
+    d.animator.start(d.to(1000));
+    d.step();
+    auto posted = d.eased(0, 1000, interval);
+    CHECK(d.at(1).left == 0);
+
+    // a new pass sends the window back while it is still at its start
+    d.clock.sleepUntil(d.start + interval * 6 / 5);
+    auto retargeted = d.clock.now();
+    auto result = d.animator.start(d.to(-1000));
+    CHECK(result.committed == 1);
+    CHECK(d.animator.stats().retargets == 1);
+    CHECK(d.animator.target(1) == (Rect{ -1000, 0, -600, 300 }));
+
+    // the frame at two intervals finds the window behind and skips, the one at three heads on from the posted rect
+    d.step();
+    CHECK(d.animator.stats().slowFrames == 1);
+    d.step();
+    CHECK(d.clock.now() == d.start + interval * 3);
+    d.clock.sleepUntil(d.clock.now() + interval * 3 / 2);
+    CHECK(d.at(1).left == d.eased(posted, -1000, d.start + interval * 3 - retargeted));
+
+    // and arrives the whole duration after the retarget
+    while (d.step()) {}
+    CHECK(d.clock.now() - retargeted >= d.animator.currentOptions().duration);
+    CHECK(d.clock.now() - retargeted < d.animator.currentOptions().duration + interval);
+    d.clock.sleepUntil(d.clock.now() + interval * 3 / 2);
+    CHECK(d.at(1).left == -1000);
+}
+
+TEST(animation, cancellationStopsThePosts)
+{
+    AnimatedDesktop d(4);
+    d.animator.start(d.to(1000));
+    d.step();
+    // the arranger cancels one window, the user drags another away and closes a third
+    d.animator.cancel(1);
+    auto cancelled = d.at(1);
+    auto& dragged = d.backend.windows[2];
+    dragged = { dragged.left + 50, dragged.top + 50, dragged.right + 50, dragged.bottom + 50 };
+    auto draggedTo = dragged;
+    d.backend.windows.erase(3);
+    auto batches = d.backend.batches.size();
+    while (d.step()) {}
+    for (size_t b = batches; b < d.backend.batches.size(); b++)
+        for (auto const& move : d.backend.batches[b]) CHECK(move.window == 4);
+    CHECK(d.at(1) == cancelled);
+    CHECK(d.at(2) == draggedTo);
+    CHECK(d.at(4) == (Rect{ 1000, 0, 1400, 300 }));
+    CHECK(d.animator.stats().cancellations == 2);
+    CHECK(!d.animator.target(1));
+    CHECK(!d.animator.active());
+}
+
+TEST(animation, twoFramesOverBudgetAfterPostingJump)
+{
+    // reading ten windows takes 3 ms of the 4 ms budget, posting them another 3 ms
+    AnimatedDesktop d(10);
+    d.backend.callTime = chrono::microseconds(300);
+    d.animator.start(d.to(1000));
+    d.step();
+    CHECK(d.animator.stats().frames == 1);
+    CHECK(d.animator.stats().slowFrames == 1);
+    CHECK(d.animator.active());
+    d.step();
+    CHECK(d.animator.stats().frames == 2);
+    CHECK(d.animator.stats().jumps == 10);
+    CHECK(!d.animator.active());
+    CHECK(d.backend.postedBatches == 3);
+    for (WindowId w = 1; w <= 10; w++) CHECK(d.at(w).left == 1000);
+}
+
+TEST(animation, framesOverBudgetBeforePostingAreNotPosted)
+{
+    // reading ten windows takes 5 ms of the 4 ms budget
+    AnimatedDesktop d(10);
+    d.backend.callTime = chrono::microseconds(500);
+    d.animator.start(d.to(1000));
+    d.step();
+    CHECK(d.animator.stats().frames == 0);
+    CHECK(d.animator.stats().slowFrames == 1);
+    CHECK(d.backend.postedBatches == 0);
+    CHECK(d.at(1).left == 0);
+    d.step();
+    CHECK(d.animator.stats().jumps == 10);
+    CHECK(d.backend.postedBatches == 1);
+    for (WindowId w = 1; w <= 10; w++) CHECK(d.at(w).left == 1000);
+}
+
+TEST(animation, frameOnTimeEndsTheSlowStreak)
+{
+    AnimatedDesktop d(10);
+    d.animator.start(d.to(1000));
+    d.backend.callTime = chrono::microseconds(500);
+    d.step();
+    d.backend.callTime = {};
+    d.step();
+    d.backend.callTime = chrono::microseconds(500);
+    d.step();
+    CHECK(d.animator.stats().slowFrames == 2);
+    CHECK(d.animator.stats().jumps == 0);
+    CHECK(d.animator.active());
+}
@@ -0,0 +1,129 @@
+#include "check.h"
+#include "engine/arrangequeue.h"
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using enum ArrangeCommand;
+
+TEST(queue, passesCollapseWithTheStrongestFlagsAndLatestSettings)
+{
+    LayoutSettings settings;
+    ArrangeQueue queue;
+    for (int i = 0; i < 5; i++) queue.post(arrange, settings);
+    CHECK(queue.size() == 1);
+    CHECK(!queue.tryTake()->force);
+    queue.post(arrange, settings);
+    queue.post(reset, settings);
+    settings.maxIncrease = 40;
+    auto ticket = queue.post(arrange, settings);
+    auto work = queue.tryTake();
+    CHECK(work && work->force && work->reset);
+    CHECK(work && work->commands == 3 && work->ticket == ticket);
+    CHECK(work && work->settings.maxIncrease == 40);
+    CHECK(!queue.tryTake());
+    CHECK(queue.stats().collapsed == 6);
+}
+
+TEST(queue, twoTogglesCancelOut)
+{
+    // into a pass which still completes their tickets, a third one toggles again
+    LayoutSettings settings;
+    ArrangeQueue queue;
+    queue.post(toggleMinimize, settings);
+    auto second = queue.post(toggleMinimize, settings);
+    CHECK(queue.size() == 1);
+    queue.post(toggleMinimize, settings);
+    auto work = queue.tryTake();
+    CHECK(work && !work->toggleMinimize && !work->force);
+    CHECK(work && work->ticket == second && work->commands == 2);
+    auto third = queue.tryTake();
+    CHECK(third && third->toggleMinimize);
+    CHECK(!queue.tryTake());
+}
+
+TEST(queue, passesDoNotMergeAcrossToggles)
+{
+    // a toggle has to see the desktop as the pass before it left it
+    LayoutSettings settings;
+    ArrangeQueue queue;
+    queue.post(arrange, settings);
+    queue.post(toggleMinimize, settings);
+    queue.post(force, settings);
+    CHECK(queue.size() == 3);
+    CHECK(!queue.tryTake()->toggleMinimize);
+    CHECK(queue.tryTake()->toggleMinimize);
+    CHECK(queue.tryTake()->force);
+}
+
+TEST(queue, onlyUserCommandsAreWaitedFor)
+{
+    // request-to-last-move latency starts at the first command a user posted, not at an earlier timer check
+    LayoutSettings settings;
+    ArrangeQueue queue;
+    queue.post(arrange, settings, false);
+    auto check = queue.tryTake();
+    CHECK(check && !check->userRequested);
+    queue.post(arrange, settings, false);
+    this_thread::sleep_for(chrono::milliseconds(1));
+    queue.post(arrange, settings);
+    queue.post(arrange, settings, false);
+    auto work = queue.tryTake();
+    CHECK(work && work->userRequested && *work->userRequested > work->requested);
+    queue.post(toggleMinimize, settings);
+    queue.post(toggleMinimize, settings, false);
+    auto cancelled = queue.tryTake();
+    CHECK(cancelled && cancelled->userRequested == cancelled->requested);
+}
+
+TEST(queue, eventsRideAlongAndOverflowMarksThemLost)
+{
+    LayoutSettings settings;
+    ArrangeQueue queue(4);
+    for (WindowId w = 1; w <= 3; w++) queue.postEvent({ WindowEventKind::locationChanged, w });
+    queue.post(arrange, settings);
+    auto first = queue.tryTake();
+    CHECK(first && first->events.size() == 3 && first->events[2].window == 3 && !first->eventsLost);
+    for (WindowId w = 1; w <= 6; w++) queue.postEvent({ WindowEventKind::created, w });
+    queue.post(arrange, settings);
+    auto second = queue.tryTake();
+    CHECK(second && second->events.size() == 4 && second->eventsLost);
+    queue.post(arrange, settings);
+    auto third = queue.tryTake();
+    CHECK(third && third->events.empty() && !third->eventsLost);
+}
+
+TEST(queue, busyWorkerGetsTheCommandsPostedMeanwhileAsOne)
+{
+    LayoutSettings settings;
+    ArrangeQueue queue;
+    mutex completed;
+    uint64_t lastTicket = 0;
+    uint64_t ticket = 0;
+    size_t executed = 0;
+    {
+        ArrangeWorker arranger(queue, [&](ArrangeWork&)
+        {
+            this_thread::sleep_for(chrono::milliseconds(2));
+            executed++;
+            return ArrangeCompletion();
+        }, [&](const ArrangeCompletion& completion)
+        {
+            lock_guard lock(completed);
+            lastTicket = completion.ticket;
+        });
+        for (int i = 0; i < 10000; i++) ticket = queue.post(i % 100 ? arrange : force, settings);
+        for (int i = 0; i < 1000; i++)
+        {
+            {
+                lock_guard lock(completed);
+                if (lastTicket == ticket) break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(5));
+        }
+    }
+    CHECK(lastTicket == ticket);
+    CHECK(executed < 100);
+    CHECK(queue.stats().posted == 10000);
+    CHECK(!queue.take());
+}
@@ -0,0 +1,90 @@
+#include "check.h"
+#include "engine/bulkminimize.h"
+#include <random>
+
+using namespace std;
+
+/// <summary>
+/// Windows which take up to 50 ms to respond, the last one hung, with the foreground below the topmost window
+/// </summary>
+struct SlowDesktop
+{
+    ManualClock clock;
+    SimulatedShowBackend backend{ clock };
+    BulkMinimizer minimizer{ backend, clock };
+    vector<WindowId> original;
+    WindowId foreground;
+
+    explicit SlowDesktop(int windows)
+    {
+        mt19937 random(1);
+        uniform_int_distribution<int> delayMs(0, 50);
+        for (WindowId w = 1; w <= WindowId(windows); w++)
+        {
+            backend.stackOrder.push_back(w);
+            backend.delays[w] = chrono::milliseconds(delayMs(random));
+        }
+        foreground = backend.foregroundWindow = backend.stackOrder[size_t(windows) / 2];
+        original = backend.stackOrder;
+    }
+
+    /// <returns>the stacking order without the hung windows</returns>
+    vector<WindowId> withoutHung(vector<WindowId> order) const
+    {
+        erase_if(order, [&](WindowId w) { return backend.hung.contains(w); });
+        return order;
+    }
+};
+
+TEST(minimize, togglesTakeAsLongAsTheSlowestWindow)
+{
+    SlowDesktop d(100);
+    auto minimized = d.minimizer.minimize(d.backend.zOrder());
+    CHECK(minimized.completed == 100);
+    CHECK(minimized.latency <= chrono::milliseconds(50));
+    for (auto w : d.original) CHECK(d.backend.minimized(w) == true);
+    auto restored = d.minimizer.restore();
+    CHECK(restored.completed == 100);
+    CHECK(restored.latency <= chrono::milliseconds(50));
+    CHECK(restored.zOrderRestored);
+}
+
+TEST(minimize, restoreKeepsStackingOrderAndForeground)
+{
+    SlowDesktop d(100);
+    d.backend.hung.insert(d.original.back());
+    auto minimized = d.minimizer.minimize(d.backend.zOrder());
+    CHECK(minimized.hung == 1);
+    CHECK(minimized.completed == 99);
+    d.minimizer.restore();
+    CHECK(d.withoutHung(d.backend.stackOrder) == d.withoutHung(d.original));
+    CHECK(d.backend.foregroundWindow == d.foreground);
+    CHECK(d.backend.stacked == 1);
+}
+
+TEST(minimize, topmostWindowGetsTheForegroundFromTheTaskbar)
+{
+    // a click on the tray icon gives the foreground to the taskbar
+    SlowDesktop d(10);
+    WindowId taskbar = 11;
+    d.backend.stackOrder.push_back(taskbar);
+    d.backend.foregroundWindow = taskbar;
+    d.minimizer.minimize(d.original);
+    d.minimizer.restore();
+    CHECK(d.backend.foregroundWindow == d.original.front());
+}
+
+TEST(minimize, windowHungWhileRestoringComesBackWithTheNextRestore)
+{
+    SlowDesktop d(10);
+    d.minimizer.minimize(d.original);
+    WindowId hanging = d.original[1];
+    d.backend.hung.insert(hanging);
+    auto skipped = d.minimizer.restore();
+    CHECK(skipped.hung == 1);
+    CHECK(d.backend.minimized(hanging) == true);
+    d.backend.hung.clear();
+    d.minimizer.minimize(d.original);
+    d.minimizer.restore();
+    CHECK(d.backend.minimized(hanging) == false);
+}
@@ -0,0 +1,23 @@
+#ifndef CHECK_H
+#define CHECK_H
+// A test is a function registered under a suite name; lazyclicker_tests runs the tests of the suite given on
+// the command line, or all of them, and exits with 1 if a check failed. Every suite is one CTest test.
+
+using TestFunction = void (*)();
+
+struct TestRegistration
+{
+    TestRegistration(const char* suite, const char* name, TestFunction function);
+};
+
+/// record a failed check, the test goes on
+void checkFailed(const char* expression, const char* file, int line);
+
+#define TEST(suite, name)                                                                  \
+    static void suite##_##name();                                                          \
+    static const TestRegistration suite##_##name##_registration(#suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define CHECK(expression) ((expression) ? void() : checkFailed(#expression, __FILE__, __LINE__))
+
+#endif // CHECK_H
@@ -0,0 +1,153 @@
+#include "check.h"
+#include "engine/displaytopology.h"
+#include "engine/layout.h"
+
+using namespace std;
+
+/// <summary>
+/// Twelve windows, six on a left monitor and six where a right one can be plugged in, arranged with the topology of a
+/// fake provider through its cache
+/// </summary>
+struct TopologyDesktop
+{
+    FakeTopologyProvider provider;
+    TopologyCache cache{ provider };
+    DesktopSnapshot desktop;
+    LayoutEngine engine;
+
+    TopologyDesktop()
+    {
+        provider.connect(monitor(1, { 0, 0, 1920, 1040 }));
+        desktop.theme = ThemeSizes{ 22, 4 };
+        desktop.cursor = { 960, 500 };
+        for (WindowId w = 1; w <= 12; w++)
+        {
+            WindowInfo window;
+            window.id = w;
+            int32_t x = (w > 6 ? 1920 : 0) + int32_t(w % 6) * 150 + 40;
+            window.rect = { x, int32_t(w % 3) * 120 + 30, x + 700, int32_t(w % 3) * 120 + 530 };
+            desktop.windows.push_back(window);
+        }
+        arrange();
+    }
+
+    static MonitorInfo monitor(MonitorId id, Rect workArea)
+    {
+        MonitorInfo m;
+        m.id = id;
+        m.workArea = workArea;
+        return m;
+    }
+
+    /// <summary>
+    /// Arrange with the cached topology and move the windows to their targets
+    /// </summary>
+    optional<MovePlan> arrange()
+    {
+        desktop.topology = cache.current();
+        auto plan = engine.arrange(desktop);
+        if (plan)
+            for (auto const& move : *plan)
+                for (auto& w : desktop.windows)
+                    if (w.id == move.window) w.rect = move.rect;
+        return plan;
+    }
+
+    void plugRight()
+    {
+        provider.connect(monitor(2, { 1920, 0, 3840, 1040 }));
+        cache.invalidate(DisplayChange::display);
+    }
+};
+
+static int32_t unitOn(const optional<MovePlan>& plan, MonitorId monitor)
+{
+    if (plan)
+        for (auto const& move : *plan)
+            if (move.monitor == monitor) return move.unitSize;
+    return 0;
+}
+
+TEST(topology, queriedOnceUntilNotified)
+{
+    TopologyDesktop d;
+    auto first = d.cache.current();
+    CHECK(d.cache.current() == first);
+    CHECK(d.provider.queries == 1);
+    CHECK(!d.arrange());
+
+    // a new monitor goes unnoticed until the notification
+    d.provider.connect(TopologyDesktop::monitor(2, { 1920, 0, 3840, 1040 }));
+    CHECK(d.cache.current() == first);
+    CHECK(d.provider.queries == 1);
+    d.cache.invalidate(DisplayChange::display);
+    CHECK(d.cache.current()->generation == first->generation + 1);
+    CHECK(d.cache.current()->monitors.size() == 2);
+    CHECK(d.provider.queries == 2);
+}
+
+TEST(topology, hotplugLaysOutTheNewMonitor)
+{
+    TopologyDesktop d;
+    d.plugRight();
+    CHECK(unitOn(d.arrange(), 2) > 0);
+}
+
+// Before the fix a pass whose window rects had not changed returned no plan, so a DPI or work area change was only
+// laid out once some window moved.
+TEST(topology, dpiChangeRelaysOutWindowsWhichDidNotMove)
+{
+    TopologyDesktop d;
+    d.plugRight();
+    auto unit96 = unitOn(d.arrange(), 2);
+    CHECK(!d.arrange());
+    d.provider.setDpi(2, 144);
+    d.cache.invalidate(DisplayChange::dpi);
+    auto plan = d.arrange();
+    CHECK(plan.has_value());
+    CHECK(unitOn(plan, 2) > unit96);
+}
+
+TEST(topology, workAreaChangeRelaysOutWindowsWhichDidNotMove)
+{
+    TopologyDesktop d;
+    CHECK(!d.arrange());
+    d.provider.setWorkArea(1, { 0, 0, 1920, 960 });
+    d.cache.invalidate(DisplayChange::settings);
+    auto plan = d.arrange();
+    CHECK(unitOn(plan, 1) > 0);
+    // a taller taskbar moves the bottom stacks up; the invisible resize border may hang over the edge
+    for (auto const& move : plan ? *plan : MovePlan()) CHECK(move.monitor != 1 || move.rect.bottom <= 960 + 16);
+}
+
+TEST(topology, unplugLeavesNoMoveForTheMonitorWhichIsGone)
+{
+    TopologyDesktop d;
+    d.plugRight();
+    d.arrange();
+    d.provider.disconnect(2);
+    d.cache.invalidate(DisplayChange::device);
+    auto plan = d.arrange();
+    CHECK(d.desktop.topology->monitors.size() == 1);
+    for (auto const& move : plan ? *plan : MovePlan()) CHECK(move.monitor != 2);
+}
+
+TEST(topology, queriesOnlyAfterNotifications)
+{
+    TopologyDesktop d;
+    d.plugRight();
+    d.arrange();
+    d.provider.setDpi(2, 144);
+    d.cache.invalidate(DisplayChange::dpi);
+    d.arrange();
+    d.provider.setWorkArea(1, { 0, 0, 1920, 960 });
+    d.cache.invalidate(DisplayChange::settings);
+    d.arrange();
+    d.provider.disconnect(2);
+    d.cache.invalidate(DisplayChange::device);
+    d.arrange();
+    d.arrange();
+    CHECK(d.provider.queries == 5);
+    CHECK(d.cache.stats().rebuilds == 5);
+    CHECK(d.cache.stats().invalidations == 4);
+}
@@ -0,0 +1,63 @@
+#include "check.h"
+#include "engine/eventcoalescer.h"
+
+using namespace std;
+using namespace chrono;
+using enum WindowEventKind;
+
+/// <returns>the times of the passes in milliseconds since the start of the script</returns>
+static vector<long long> passesOf(ScriptedEventSource& source, ArrangeCoalescer& coalescer)
+{
+    vector<long long> result;
+    for (auto t : runScript(source, coalescer)) result.push_back(duration_cast<milliseconds>(t.time_since_epoch()).count());
+    return result;
+}
+
+TEST(coalescer, burstIsArrangedOnceItWentQuiet)
+{
+    ScriptedEventSource burst;
+    for (int i = 0; i < 5; i++) burst.add(milliseconds(20 * i), { locationChanged, 1 });
+    ArrangeCoalescer coalescer(milliseconds(150), milliseconds(1000));
+    CHECK(passesOf(burst, coalescer) == vector<long long>{ 230 });
+}
+
+TEST(coalescer, streamIsArrangedEveryMaxDelay)
+{
+    ScriptedEventSource stream;
+    for (int i = 0; i <= 30; i++) stream.add(milliseconds(100 * i), { locationChanged, 1 });
+    ArrangeCoalescer coalescer(milliseconds(150), milliseconds(1000));
+    CHECK((passesOf(stream, coalescer) == vector<long long>{ 1000, 2100, 3150 }));
+    CHECK(coalescer.stats().maxLatency == milliseconds(1000));
+    CHECK(coalescer.stats().events == 31);
+}
+
+TEST(coalescer, dragIsArrangedAfterItsEnd)
+{
+    ScriptedEventSource drag;
+    drag.add(milliseconds(0), { moveSizeStart, 2 });
+    for (int i = 1; i <= 50; i++) drag.add(milliseconds(10 * i), { locationChanged, 2 });
+    drag.add(milliseconds(600), { moveSizeEnd, 2 });
+    ArrangeCoalescer coalescer(milliseconds(150), milliseconds(1000));
+    CHECK(passesOf(drag, coalescer) == vector<long long>{ 750 });
+    CHECK(coalescer.stats().eventsDuringDrag == 51);
+}
+
+TEST(coalescer, closedWindowEndsItsDrag)
+{
+    // a dragged window which closes never reports the end of its drag
+    ScriptedEventSource closed;
+    closed.add(milliseconds(0), { moveSizeStart, 3 });
+    closed.add(milliseconds(100), { locationChanged, 3 });
+    closed.add(milliseconds(200), { destroyed, 3 });
+    ArrangeCoalescer coalescer(milliseconds(150), milliseconds(1000));
+    CHECK(passesOf(closed, coalescer) == vector<long long>{ 350 });
+}
+
+TEST(coalescer, titlesAreIgnored)
+{
+    ScriptedEventSource titles;
+    for (int i = 0; i < 10; i++) titles.add(milliseconds(10 * i), { nameChanged, 4 });
+    ArrangeCoalescer coalescer(milliseconds(150), milliseconds(1000));
+    CHECK(passesOf(titles, coalescer).empty());
+    CHECK(coalescer.stats().events == 10);
+}
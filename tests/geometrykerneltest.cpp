@@ -0,0 +1,132 @@
+#include "check.h"
+#include "engine/geometrykernel.h"
+#include <random>
+
+using namespace std;
+
+/// <summary>
+/// The per window search of the layout engine, which the kernels reproduce
+/// </summary>
+static pair<int, Corner> perWindowSearch(const Rect& wrect, const vector<pair<Rect, bool>>& monitors)
+{
+    size_t maxArea = 0;
+    int mon = -1;
+    Corner corner = Corner::topleft;
+    for (int m = 0; m < int(monitors.size()); m++)
+    {
+        Rect rect{};
+        Rect::intersect(rect, monitors[m].first, wrect);
+        size_t area = rect.area();
+        if (area > maxArea)
+        {
+            mon = m;
+            maxArea = area;
+        }
+    }
+    if (mon >= 0)
+    {
+        Rect mrect = monitors[mon].first;
+        auto minDist = mrect.diameter();
+        for (int i = 0; i < 4; i++)
+        {
+            auto c = Corner(i);
+            if (monitors[mon].second && c == Corner::topright) continue;
+            size_t dist = wrect.distanceFromCorner(mrect, c);
+            if (dist < minDist)
+            {
+                minDist = dist;
+                corner = c;
+            }
+        }
+    }
+    return { mon, corner };
+}
+
+/// <returns>windows for which the kernel disagrees with the per window search</returns>
+static size_t mismatches(const vector<Rect>& windows, const vector<pair<Rect, bool>>& monitors, GeometryKernel kernel)
+{
+    RectColumns windowRects;
+    for (auto const& r : windows) windowRects.push_back(r);
+    MonitorColumns monitorRects;
+    for (auto const& [r, avoid] : monitors) monitorRects.push_back(r, avoid);
+    vector<int> monitor(windows.size());
+    vector<Corner> corner(windows.size());
+    findMainMonitorsAndCorners(windowRects, monitorRects, monitor, corner, kernel);
+    size_t result = 0;
+    for (size_t i = 0; i < windows.size(); i++) result += perWindowSearch(windows[i], monitors) != pair(monitor[i], corner[i]);
+    return result;
+}
+
+/// <returns>the kernels this processor runs</returns>
+static vector<GeometryKernel> supportedKernels()
+{
+    vector<GeometryKernel> result;
+    for (int k = 0; k < geometryKernelCount; k++)
+        if (geometryKernelSupported(GeometryKernel(k))) result.push_back(GeometryKernel(k));
+    return result;
+}
+
+TEST(geometry, kernelsAgreeWithThePerWindowSearch)
+{
+    // four monitors in a row, the second and the fourth avoiding their top right corner
+    vector<pair<Rect, bool>> monitors;
+    for (int32_t m = 0; m < 4; m++) monitors.push_back({ { m * 1920, 0, m * 1920 + 1920, 1040 }, m % 2 == 1 });
+    // more windows than a block, not a multiple of the lanes; some straddle monitors, some are off screen
+    mt19937 rng(1);
+    vector<Rect> windows;
+    for (int i = 0; i < 1003; i++)
+    {
+        int32_t left = int32_t(rng() % 8400) - 300;
+        int32_t top = int32_t(rng() % 1400) - 200;
+        windows.push_back({ left, top, left + int32_t(rng() % 1200) + 1, top + int32_t(rng() % 900) + 1 });
+    }
+    for (auto kernel : supportedKernels()) CHECK(mismatches(windows, monitors, kernel) == 0);
+}
+
+TEST(geometry, equalDistancesPickTheFirstCorner)
+{
+    vector<pair<Rect, bool>> monitors{ { { 0, 0, 1000, 1000 }, false }, { { 1000, 0, 2000, 1000 }, false } };
+    vector<Rect> windows(9, Rect{ 250, 250, 750, 750 }); // centered, all corners equally far
+    windows.push_back({ 500, 100, 1500, 600 }); // equal intersections, the first monitor wins
+    windows.push_back({ 3000, 0, 3100, 100 });  // off screen
+    for (auto kernel : supportedKernels()) CHECK(mismatches(windows, monitors, kernel) == 0);
+}
+
+TEST(geometry, kernelsAgreeUpToTheLimit)
+{
+    const int32_t limit = (1 << 24) - 1;
+    vector<pair<Rect, bool>> monitors{ { { -limit, -limit, 0, 0 }, false }, { { 0, 0, limit, limit }, true } };
+    mt19937 rng(2);
+    vector<Rect> windows;
+    for (int i = 0; i < 64; i++)
+    {
+        int32_t left = int32_t(rng() % uint32_t(2 * limit)) - limit;
+        int32_t top = int32_t(rng() % uint32_t(2 * limit)) - limit;
+        windows.push_back({ left, top, (std::min)(limit, left + int32_t(rng() % (1 << 23)) + 1), (std::min)(limit, top + int32_t(rng() % (1 << 23)) + 1) });
+    }
+    windows.push_back({ -limit, -limit, limit, limit });
+    RectColumns columns;
+    for (auto const& r : windows) columns.push_back(r);
+    CHECK(columns.vectorizable);
+    for (auto kernel : supportedKernels()) CHECK(mismatches(windows, monitors, kernel) == 0);
+}
+
+TEST(geometry, columnsBeyondTheLimitAreNotVectorizable)
+{
+    RectColumns columns;
+    columns.push_back({ 0, 0, 100, 100 });
+    CHECK(columns.vectorizable);
+    columns.push_back({ 0, 0, 1 << 24, 100 });
+    CHECK(!columns.vectorizable);
+
+    // they get the scalar kernel whichever was asked for
+    MonitorColumns monitors;
+    monitors.push_back({ 0, 0, 1 << 25, 1000 }, false);
+    vector<int> monitor(columns.size()), scalarMonitor(columns.size());
+    vector<Corner> corner(columns.size()), scalarCorner(columns.size());
+    findMainMonitorsAndCorners(columns, monitors, monitor, corner, bestGeometryKernel());
+    findMainMonitorsAndCorners(columns, monitors, scalarMonitor, scalarCorner, GeometryKernel::scalar);
+    CHECK(monitor == scalarMonitor);
+    CHECK(corner == scalarCorner);
+    CHECK((monitor == vector{ 0, 0 }));
+}
@@ -0,0 +1,105 @@
+#include "check.h"
+#include "engine/logger.h"
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/// <summary>
+/// A log file in a temporary directory, read back as the messages without their time and level
+/// </summary>
+struct LogDirectory
+{
+    filesystem::path root = filesystem::temp_directory_path() / ("lazyclicker-log-" + to_string(random_device()()));
+    filesystem::path file = root / "lazyclicker.log";
+
+    LogDirectory() { filesystem::create_directories(root); }
+    ~LogDirectory()
+    {
+        error_code ec;
+        filesystem::remove_all(root, ec);
+    }
+
+    vector<string> messages(const filesystem::path& path) const
+    {
+        // "hh:mm:ss.mmm LEVEL " comes first
+        constexpr size_t prefix = 19;
+        vector<string> result;
+        ifstream in(path);
+        for (string line; getline(in, line);) result.push_back(line.size() > prefix ? line.substr(prefix) : "");
+        return result;
+    }
+
+    filesystem::path rotated(int i) const
+    {
+        auto path = file;
+        path += '.';
+        path += to_string(i);
+        return path;
+    }
+};
+
+static vector<string> numbered(int first, int last)
+{
+    vector<string> result;
+    for (int i = first; i <= last; i++) result.push_back("line " + to_string(i));
+    return result;
+}
+
+TEST(logger, ringWrapsAroundWithoutLosingMessages)
+{
+    LogDirectory dir;
+    Logger log(4);
+    log.setConsole(false);
+    CHECK(log.setFile({ dir.file, 0 }));
+    // each batch fits the ring, which the consumer empties before the next
+    for (int batch = 0; batch < 50; batch++)
+    {
+        for (int i = 0; i < 3; i++) log.info("line {}", 100 + batch * 3 + i);
+        log.flush();
+    }
+    CHECK(log.dropped() == 0);
+    CHECK(dir.messages(dir.file) == numbered(100, 249));
+}
+
+TEST(logger, fullRingDropsMessagesInsteadOfBlocking)
+{
+    LogDirectory dir;
+    Logger log(4);
+    log.setConsole(false);
+    CHECK(log.setFile({ dir.file, 0 }));
+    for (int i = 1000; i < 2000; i++) log.info("line {}", i);
+    log.flush();
+    auto messages = dir.messages(dir.file);
+    CHECK(messages.size() + log.dropped() == 1000);
+    CHECK(!messages.empty() && messages.front() == "line 1000");
+    CHECK(is_sorted(messages.begin(), messages.end()));
+    log.setLevel(LogLevel::warning);
+    log.info("line {}", 3000);
+    log.flush();
+    CHECK(dir.messages(dir.file).size() == messages.size());
+}
+
+TEST(logger, filesRotateBeforeTheyGrowBeyondTheLimit)
+{
+    // a line is 28 bytes, three of them fit in 100
+    LogDirectory dir;
+    Logger log;
+    log.setConsole(false);
+    CHECK(log.setFile({ dir.file, 100, 2 }));
+    for (int i = 100; i < 110; i++) log.info("line {}", i);
+    log.flush();
+    CHECK(dir.messages(dir.file) == numbered(109, 109));
+    CHECK(dir.messages(dir.rotated(1)) == numbered(106, 108));
+    CHECK(dir.messages(dir.rotated(2)) == numbered(103, 105));
+    CHECK(!filesystem::exists(dir.rotated(3)));
+    CHECK(filesystem::file_size(dir.rotated(1)) == 84);
+    // without files to keep the log starts over
+    CHECK(log.setFile({ dir.file, 100, 0 }));
+    for (int i = 110; i < 114; i++) log.info("line {}", i);
+    log.flush();
+    CHECK(dir.messages(dir.file) == numbered(112, 113));
+    CHECK(dir.messages(dir.rotated(1)) == numbered(106, 108));
+}
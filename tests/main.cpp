@@ -0,0 +1,55 @@
+// Runs the engine tests: lazyclicker_tests [suite...], all suites without arguments.
+#include "check.h"
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+struct Test
+{
+    const char* suite;
+    const char* name;
+    TestFunction function;
+};
+
+/// registered by the static objects of the test files, whose order of construction is unspecified
+static vector<Test>& tests()
+{
+    static vector<Test> all;
+    return all;
+}
+
+static int failures = 0;
+
+TestRegistration::TestRegistration(const char* suite, const char* name, TestFunction function)
+{
+    tests().push_back({ suite, name, function });
+}
+
+void checkFailed(const char* expression, const char* file, int line)
+{
+    failures++;
+    cerr << file << ':' << line << ": check failed: " << expression << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    vector<string_view> suites(argv + 1, argv + argc);
+    size_t run = 0;
+    for (auto const& test : tests())
+    {
+        if (!suites.empty() && find(suites.begin(), suites.end(), test.suite) == suites.end()) continue;
+        int before = failures;
+        test.function();
+        run++;
+        cout << (failures == before ? "ok     " : "FAILED ") << test.suite << '.' << test.name << endl;
+    }
+    if (!run)
+    {
+        cerr << "no tests in the given suites" << endl;
+        return 2;
+    }
+    return failures ? 1 : 0;
+}
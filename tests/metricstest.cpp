@@ -0,0 +1,101 @@
+#include "check.h"
+#include "engine/metrics.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+using namespace std::chrono_literals;
+
+static string readFile(const filesystem::path& path)
+{
+    ifstream in(path);
+    stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+TEST(metrics, bucketsAreExactBelowSixteenAndWithinOneSixteenthAbove)
+{
+    for (uint64_t v = 0; v < 16; v++) CHECK(Histogram::bucketOf(v) == v && Histogram::upperBound(v) == v);
+    // every bucket starts right after the one before it ends
+    size_t last = Histogram::bucketOf(UINT64_MAX);
+    for (size_t b = 0; b < last; b++)
+    {
+        auto bound = Histogram::upperBound(b);
+        CHECK(Histogram::bucketOf(bound) == b);
+        CHECK(Histogram::bucketOf(bound + 1) == b + 1);
+    }
+    CHECK(Histogram::upperBound(last) == UINT64_MAX);
+    mt19937_64 random(7);
+    for (int i = 0; i < 10000; i++)
+    {
+        uint64_t v = random() >> (random() % 64);
+        auto bound = Histogram::upperBound(Histogram::bucketOf(v));
+        CHECK(bound >= v && bound - v <= v / 16);
+    }
+}
+
+TEST(metrics, percentilesReportTheBucketCappedAtTheMaximum)
+{
+    Histogram h;
+    CHECK(h.percentile(50) == 0 && h.minValue() == 0 && h.maxValue() == 0);
+    for (uint64_t v = 1; v <= 100; v++) h.record(v);
+    CHECK(h.count() == 100 && h.minValue() == 1 && h.maxValue() == 100 && h.mean() == 50.5);
+    CHECK(h.percentile(0) == 1);
+    CHECK(h.percentile(10) == 10);
+    // 50 shares its bucket with 51
+    CHECK(h.percentile(50) == 51);
+    CHECK(h.percentile(99) == 99);
+    CHECK(h.percentile(100) == 100);
+    h.record(1000000);
+    CHECK(h.percentile(100) == 1000000);
+}
+
+TEST(metrics, jsonHasEveryCounterAndOnlyRecordedTimers)
+{
+    TimePoint start;
+    MetricsCollector metrics(start);
+    metrics.add(Counter::passes, 3);
+    metrics.add(Counter::windowsMoved);
+    metrics.record(Timer::pass, 2000ns);
+    metrics.record(Timer::pass, 4000ns);
+    metrics.record(Timer::move, -1ns);
+    auto json = metrics.toJson(start + 1500ms);
+    CHECK(json.starts_with("{\"uptime_s\":1.5,\"counters\":{\"passes\":3,\"changed_passes\":0,"));
+    CHECK(json.find("\"windows_moved\":1,") != string::npos);
+    CHECK(json.find("\"animation_jumps\":0},") != string::npos);
+    CHECK(json.find("\"pass\":{\"count\":2,\"min\":2000,\"mean\":3000,\"p50\":2047,\"p90\":4000,\"p99\":4000,\"max\":4000}") != string::npos);
+    // durations below zero count as zero
+    CHECK(json.find("\"move\":{\"count\":1,\"min\":0,") != string::npos);
+    CHECK(json.find("\"enumerate\"") == string::npos);
+    CHECK(json.ends_with("}}"));
+}
+
+TEST(metrics, fileIsRewrittenAtMostOncePerInterval)
+{
+    auto dir = filesystem::temp_directory_path() / ("lazyclicker-metrics-" + to_string(random_device()()));
+    filesystem::create_directories(dir);
+    auto file = dir / "metrics.json";
+    TimePoint start;
+    MetricsCollector metrics(start);
+    CHECK(!metrics.tick(start));
+    metrics.setFile(file, 10s);
+    CHECK(metrics.tick(start));
+    CHECK(readFile(file) == metrics.toJson(start) + "\n");
+    metrics.add(Counter::passes);
+    CHECK(!metrics.tick(start + 9s));
+    CHECK(readFile(file).find("\"passes\":0") != string::npos);
+    CHECK(metrics.tick(start + 10s));
+    CHECK(readFile(file).find("\"passes\":1") != string::npos);
+    // an explicit write restarts the interval
+    CHECK(metrics.writeFile(start + 15s));
+    CHECK(!metrics.tick(start + 20s));
+    CHECK(metrics.tick(start + 25s));
+    CHECK(!filesystem::exists(dir / "metrics.json.tmp"));
+    metrics.setFile({});
+    CHECK(!metrics.tick(start + 60s) && !metrics.writeFile(start + 60s));
+    error_code ec;
+    filesystem::remove_all(dir, ec);
+}
@@ -0,0 +1,136 @@
+#include "check.h"
+#include "engine/moveexecutor.h"
+#include <algorithm>
+
+using namespace std;
+
+/// <returns>moves of the windows by d pixels down and right of where they are</returns>
+static MovePlan shiftedBy(SimulatedMoveBackend& backend, const vector<WindowId>& ids, int32_t d)
+{
+    MovePlan plan;
+    for (auto w : ids)
+    {
+        auto const& r = backend.windows[w];
+        WindowMove move;
+        move.window = w;
+        move.rect = { r.left + d, r.top + d, r.right + d, r.bottom + d };
+        plan.push_back(move);
+    }
+    return plan;
+}
+
+/// <returns>the ids of count windows which each take delay to process a move</returns>
+static vector<WindowId> addWindows(SimulatedMoveBackend& backend, WindowId count, Duration delay)
+{
+    vector<WindowId> ids;
+    for (WindowId w = 1; w <= count; w++)
+    {
+        backend.windows[w] = { 0, 0, 400, 300 };
+        backend.delays[w] = delay;
+        ids.push_back(w);
+    }
+    return ids;
+}
+
+TEST(dispatch, responsiveWindowsGoInOneTransaction)
+{
+    ManualClock clock;
+    SimulatedMoveBackend backend(clock);
+    auto ids = addWindows(backend, 20, chrono::milliseconds(1));
+    MoveDispatcher dispatcher(backend, clock);
+    auto result = dispatcher.execute(shiftedBy(backend, ids, 10));
+    CHECK(result.committed == ids.size());
+    CHECK(backend.batches.size() == 1);
+    CHECK(backend.singleMoves.empty());
+}
+
+TEST(dispatch, slowTransactionFallsBackAfterTheBatchTimeout)
+{
+    ManualClock clock;
+    SimulatedMoveBackend backend(clock);
+    auto ids = addWindows(backend, 10, chrono::milliseconds(30));
+    MoveDispatcher dispatcher(backend, clock);
+    auto start = clock.now();
+    auto result = dispatcher.execute(shiftedBy(backend, ids, 10));
+    CHECK(result.committed == ids.size());
+    CHECK(result.fallbacks == 1);
+    CHECK(clock.now() - start < MoveDispatcher::Options().timeout);
+}
+
+/// <summary>
+/// Quick, slow, hung, stalled and closed windows, moved once
+/// </summary>
+struct FaultyDesktop
+{
+    enum : WindowId { quick1 = 1, quick2, slow, hung, stalled, closed };
+    ManualClock clock;
+    SimulatedMoveBackend backend{ clock };
+    MoveDispatcher dispatcher{ backend, clock };
+    MoveResult first;
+    Duration firstElapsed{};
+
+    FaultyDesktop()
+    {
+        for (WindowId w = quick1; w <= stalled; w++) backend.windows[w] = { 0, 0, 400, 300 };
+        backend.delays[slow] = chrono::milliseconds(100);
+        backend.hung.insert(hung);
+        backend.stalled.insert(stalled);
+        MovePlan plan = shiftedBy(backend, { quick1, quick2, slow, hung, stalled }, 10);
+        WindowMove closedMove;
+        closedMove.window = closed;
+        plan.push_back(closedMove);
+        auto start = clock.now();
+        first = dispatcher.execute(plan);
+        firstElapsed = clock.now() - start;
+    }
+};
+
+TEST(dispatch, faultyWindowsDoNotBlockTheOthers)
+{
+    FaultyDesktop d;
+    vector<MoveStatus> expected{ MoveStatus::moved, MoveStatus::moved, MoveStatus::moved, MoveStatus::hung,
+                                 MoveStatus::timedOut, MoveStatus::failed };
+    CHECK(d.first.status == expected);
+    CHECK(d.firstElapsed <= MoveDispatcher::Options().timeout);
+    auto result = d.dispatcher.execute(shiftedBy(d.backend, { d.quick1, d.hung, d.stalled }, 20));
+    CHECK((result.status == vector{ MoveStatus::moved, MoveStatus::quarantined, MoveStatus::quarantined }));
+}
+
+TEST(dispatch, retryDelayDoublesUpToTheCap)
+{
+    FaultyDesktop d;
+    auto options = MoveDispatcher::Options();
+    auto failedAt = d.clock.now();
+    auto delay = options.firstRetry;
+    for (int i = 0; i < 9; i++)
+    {
+        auto retryAt = failedAt + delay;
+        CHECK(d.dispatcher.quarantined(d.stalled, retryAt - chrono::milliseconds(1)));
+        CHECK(!d.dispatcher.quarantined(d.stalled, retryAt));
+        d.clock.sleepUntil(retryAt);
+        CHECK(d.dispatcher.releaseDue(d.clock.now()));
+        auto ids = d.dispatcher.takeReleased(d.clock.now());
+        CHECK(ranges::find(ids, WindowId(d.stalled)) != ids.end());
+        // released once
+        CHECK(!d.dispatcher.releaseDue(d.clock.now()));
+        CHECK(d.dispatcher.takeReleased(d.clock.now()).empty());
+        // the stalled window keeps timing out
+        CHECK(d.dispatcher.execute(shiftedBy(d.backend, { d.stalled }, 30 + i)).status.front() == MoveStatus::timedOut);
+        failedAt = d.clock.now();
+        delay = (std::min)(delay * 2, options.maxRetry);
+    }
+    CHECK(delay == options.maxRetry);
+    CHECK(d.dispatcher.quarantined(d.stalled, failedAt + options.maxRetry - chrono::milliseconds(1)));
+}
+
+TEST(dispatch, answeringWindowsLeaveTheQuarantine)
+{
+    FaultyDesktop d;
+    d.backend.stalled.clear();
+    d.backend.hung.clear();
+    d.clock.sleepUntil(d.clock.now() + MoveDispatcher::Options().firstRetry);
+    d.dispatcher.takeReleased(d.clock.now());
+    auto result = d.dispatcher.execute(shiftedBy(d.backend, { d.hung, d.stalled }, 50));
+    CHECK(result.committed == 2);
+    CHECK(d.dispatcher.quarantineSize() == 0);
+}
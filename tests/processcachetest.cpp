@@ -0,0 +1,178 @@
+#include "check.h"
+#include "engine/procresolver.h"
+#include "engine/workerpool.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace std;
+
+/// <summary>
+/// A /proc tree in a temporary directory, with the files ProcResolver reads
+/// </summary>
+struct FakeProc
+{
+    filesystem::path root = filesystem::temp_directory_path() / ("lazyclicker-proc-" + to_string(random_device()()));
+
+    FakeProc() { filesystem::create_directories(root); }
+    ~FakeProc()
+    {
+        error_code ec;
+        filesystem::remove_all(root, ec);
+    }
+
+    void start(ProcessId pid, uint64_t startTime, const string& exe)
+    {
+        auto dir = root / to_string(pid);
+        exit(pid);
+        filesystem::create_directories(dir);
+        // the command name may contain blanks and parentheses, the start time is field 22
+        ofstream stat(dir / "stat");
+        stat << pid << " (my (app)) S";
+        for (int field = 4; field < 22; field++) stat << " 0";
+        stat << ' ' << startTime << " 0 0\n";
+        filesystem::create_symlink("/usr/bin/" + exe, dir / "exe");
+    }
+
+    void exit(ProcessId pid)
+    {
+        error_code ec;
+        filesystem::remove_all(root / to_string(pid), ec);
+    }
+};
+
+/// <summary>
+/// Counts the opens the cache attempts, failed ones included
+/// </summary>
+struct CountingResolver : ProcResolver
+{
+    using ProcResolver::ProcResolver;
+    size_t attempts = 0;
+
+    optional<ProcessHandle> open(ProcessId pid) override
+    {
+        attempts++;
+        return ProcResolver::open(pid);
+    }
+};
+
+TEST(processcache, processesAreResolvedOnceWhileTheyRun)
+{
+    FakeProc proc;
+    proc.start(100, 5000, "editor");
+    proc.start(200, 6000, "browser");
+    ProcResolver resolver(proc.root.string());
+    ProcessCache cache(resolver);
+    for (int pass = 0; pass < 3; pass++)
+    {
+        cache.beginPass();
+        // two windows of the editor, one of the browser
+        auto editor = cache.find(100);
+        CHECK(editor && editor->name == "editor" && editor->imagePath == "/usr/bin/editor");
+        CHECK(cache.find(100) == editor);
+        auto browser = cache.find(200);
+        CHECK(browser && browser->name == "browser");
+    }
+    CHECK(cache.stats().misses == 2);
+    CHECK(cache.stats().hits == 7);
+    CHECK(resolver.queries == 2);
+    CHECK(resolver.opened == 2);
+    CHECK(cache.stats().openHandles == 2);
+}
+
+TEST(processcache, reusedPidIsResolvedAgain)
+{
+    FakeProc proc;
+    proc.start(100, 5000, "editor");
+    ProcResolver resolver(proc.root.string());
+    ProcessCache cache(resolver);
+    cache.beginPass();
+    CHECK(cache.find(100)->name == "editor");
+    // the editor exits and a new process gets its pid
+    proc.start(100, 7000, "shell");
+    cache.beginPass();
+    CHECK(cache.stats().evictions == 1);
+    CHECK(resolver.closed == 1);
+    auto shell = cache.find(100);
+    CHECK(shell && shell->name == "shell");
+    CHECK(cache.stats().misses == 2);
+    CHECK(cache.stats().openHandles == 1);
+}
+
+TEST(processcache, openHandlesFollowTheRunningProcesses)
+{
+    FakeProc proc;
+    ProcResolver resolver(proc.root.string());
+    {
+        ProcessCache cache(resolver);
+        WorkerPool pool(2);
+        // every pass a process starts and the one started three passes before exits
+        for (ProcessId pid = 1000; pid < 1050; pid++)
+        {
+            proc.start(pid, pid * 10, "app" + to_string(pid));
+            if (pid >= 1003) proc.exit(pid - 3);
+            cache.beginPass();
+            vector<ProcessId> pids;
+            for (ProcessId p = pid >= 1002 ? pid - 2 : 1000; p <= pid; p++) pids.push_back(p);
+            cache.prefetch(pids, pool);
+            for (auto p : pids) CHECK(cache.find(p) != nullptr);
+            CHECK(cache.stats().openHandles <= 3);
+            CHECK(cache.stats().openHandles == resolver.opened - resolver.closed);
+        }
+        CHECK(cache.stats().misses == 50);
+        CHECK(cache.stats().evictions == 47);
+    }
+    CHECK(resolver.closed == resolver.opened);
+}
+
+TEST(processcache, failedOpensBackOff)
+{
+    FakeProc proc;
+    CountingResolver resolver(proc.root.string());
+    ProcessCache cache(resolver);
+    WorkerPool pool(0);
+    // asked for by a window every pass, tried on passes 1, 3, 7 and 15
+    for (int pass = 1; pass <= 20; pass++)
+    {
+        cache.beginPass();
+        cache.prefetch({ 300 }, pool);
+        CHECK(cache.find(300) == nullptr);
+    }
+    CHECK(resolver.attempts == 4);
+    CHECK(cache.stats().misses == 4);
+    CHECK(cache.stats().openHandles == 0);
+
+    // once it can be opened, the next retry finds it
+    proc.start(300, 9000, "service");
+    for (int pass = 21; pass <= 31; pass++)
+    {
+        cache.beginPass();
+        cache.find(300);
+    }
+    CHECK(resolver.attempts == 5);
+    auto service = cache.find(300);
+    CHECK(service && service->name == "service");
+    CHECK(cache.stats().openHandles == 1);
+}
+
+TEST(processcache, retriesAreCapped)
+{
+    FakeProc proc;
+    CountingResolver resolver(proc.root.string());
+    ProcessCache cache(resolver);
+    size_t before = 0;
+    int lastRetry = 0;
+    for (int pass = 1; pass <= 400; pass++)
+    {
+        cache.beginPass();
+        cache.find(300);
+        if (resolver.attempts > before)
+        {
+            CHECK(uint64_t(pass - lastRetry) <= ProcessCache::maxRetryPasses || !lastRetry);
+            lastRetry = pass;
+            before = resolver.attempts;
+        }
+    }
+    // 1, 3, 7, 15, 31, 63, 127, then every 64 passes
+    CHECK(resolver.attempts == 11);
+}
@@ -0,0 +1,99 @@
+#include "check.h"
+#include "engine/settingsstore.h"
+#include <fstream>
+#include <random>
+
+using namespace std;
+using namespace preferences;
+
+TEST(settings, dragIsWrittenBehindInFewBatches)
+{
+    // dragging a slider for ten seconds writes at most every four flush delays, and the last value at the end
+    ManualClock clock;
+    MemorySettingsBackend memory;
+    SettingsStore store(memory, clock, chrono::seconds(1));
+    for (int i = 1; i <= 100; i++)
+    {
+        clock.advance(chrono::milliseconds(100));
+        store.set(allowedIncrease, i);
+        store.poll();
+    }
+    CHECK(memory.saves == 2);
+    CHECK(!store.set(allowedIncrease, 100));
+    auto due = store.flushDue();
+    CHECK(due.has_value());
+    clock.sleepUntil(*due - chrono::milliseconds(1));
+    store.poll();
+    CHECK(memory.saves == 2);
+    clock.sleepUntil(*due);
+    store.poll();
+    CHECK(memory.saves == 3);
+    CHECK(!store.flushDue());
+    CHECK(get<int>(memory.values[allowedIncrease.name]) == 100);
+    CHECK(store.stats().changes == 100);
+    CHECK(store.stats().written == 3);
+}
+
+TEST(settings, layoutRoundTrip)
+{
+    // through the store and through the packed word
+    ManualClock clock;
+    MemorySettingsBackend memory;
+    SettingsStore store(memory, clock);
+    LayoutSettings layout;
+    layout.maxIncrease = 120;
+    layout.avoidTopRightCorner = true;
+    layout.increaseUnitSizeForTouch = false;
+    layout.cornerAssignment = CornerAssignment::minDisplacement;
+    layout.arrangeOnlyWhenOccluded = true;
+    layout.animateMoves = true;
+    setLayoutSettings(store, layout);
+    CHECK(store.flush());
+    SettingsStore reloaded(memory, clock);
+    CHECK(reloaded.load());
+    AtomicLayoutSettings packed;
+    packed.store(layoutSettings(reloaded));
+    CHECK(packed.load() == layout);
+}
+
+static string readFile(const filesystem::path& file)
+{
+    ifstream in(file);
+    return string(istreambuf_iterator<char>(in), {});
+}
+
+TEST(settings, iniFileKeepsOtherSections)
+{
+    auto file = filesystem::temp_directory_path() / ("lazyclicker-test-" + to_string(random_device()()) + ".ini");
+    {
+        ofstream out(file);
+        out << "[Window]\ngeometry=10 20 300 400\n\n[Preferences]\n; written by hand\nallowedIncrease = 7\nwindowRules=exclude title=x\n";
+    }
+    ManualClock clock;
+    IniSettingsBackend ini(file);
+    SettingsStore store(ini, clock);
+    CHECK(store.load());
+    CHECK(store.get(allowedIncrease) == 7);
+    CHECK(store.get(windowRules) == "exclude title=x");
+
+    // every value comes back, escapes included
+    const string rules = "# \"quoted\" and \\escaped\\\nexclude title=\"a\tb\"\n";
+    store.set(windowRules, rules);
+    store.set(avoidTopRightCorner, true);
+    store.set(allowedIncrease, -3);
+    CHECK(store.flush());
+    SettingsStore reloaded(ini, clock);
+    CHECK(reloaded.load());
+    CHECK(reloaded.get(windowRules) == rules);
+    CHECK(reloaded.get(avoidTopRightCorner));
+    CHECK(reloaded.get(allowedIncrease) == -3);
+    CHECK(readFile(file).starts_with("[Window]\ngeometry=10 20 300 400\n"));
+
+    // clearing removes only the section of the settings
+    CHECK(reloaded.clear());
+    CHECK(filesystem::exists(file));
+    CHECK(IniSettingsBackend(file).load()->empty());
+    CHECK(readFile(file) == "[Window]\ngeometry=10 20 300 400\n");
+    error_code ec;
+    filesystem::remove(file, ec);
+}
@@ -0,0 +1,46 @@
+#include "check.h"
+#include "engine/thememetrics.h"
+
+using namespace std;
+
+static bool sized(const MonitorMetrics& metrics, int unitSize, int borderWidth, int borderHeight)
+{
+    return metrics.unitSize == unitSize && metrics.borderWidth == borderWidth && metrics.borderHeight == borderHeight;
+}
+
+TEST(thememetrics, sizesScaleWithTheMonitorRelativeToThePrimary)
+{
+    ThemeMetricsCache cache;
+    ThemeSizes theme{ 22, 4 };
+    CHECK(sized(cache.find(theme, 96, false, 96), 30, 4, 4));
+    CHECK(sized(cache.find(theme, 144, false, 96), 45, 6, 4));
+    CHECK(sized(cache.find(theme, 144, true, 96), 67, 6, 4));
+    // the theme sizes are those of the primary monitor already
+    CHECK(cache.find(theme, 144, false, 144).unitSize == 30);
+}
+
+TEST(thememetrics, entriesAreReusedUntilTheThemeOrDpiChanges)
+{
+    ThemeMetricsCache cache;
+    ThemeSizes theme{ 22, 4 };
+    cache.find(theme, 96, false, 96);
+    cache.find(theme, 144, false, 96);
+    cache.find(theme, 96, false, 96);
+    cache.find(theme, 144, false, 96);
+    CHECK(cache.stats().hits == 2 && cache.stats().misses == 2);
+    // a new visual style misses without dropping the other entries
+    ThemeSizes large{ 30, 6 };
+    CHECK(cache.find(large, 96, false, 96).unitSize == 42);
+    cache.find(theme, 96, false, 96);
+    CHECK(cache.stats().misses == 3 && cache.stats().hits == 3 && cache.stats().invalidations == 0);
+    // a new primary DPI rescales every monitor
+    CHECK(cache.find(theme, 144, false, 120).unitSize == 36);
+    CHECK(cache.stats().invalidations == 1 && cache.stats().misses == 4);
+    cache.find(theme, 96, false, 120);
+    CHECK(cache.stats().misses == 5);
+    cache.clear();
+    cache.clear();
+    CHECK(cache.stats().invalidations == 2);
+    cache.find(theme, 144, false, 120);
+    CHECK(cache.stats().misses == 6);
+}
@@ -0,0 +1,82 @@
+#include "check.h"
+#include "engine/verdictcache.h"
+
+using namespace std;
+using enum WindowEventKind;
+
+static WindowVerdict eligible(const char* title)
+{
+    WindowVerdict verdict;
+    verdict.eligible = true;
+    verdict.title = title;
+    return verdict;
+}
+
+TEST(verdicts, verdictsLastWhileTheStyleKeyAndGenerationMatch)
+{
+    VerdictCache cache;
+    WindowStyleKey key{ 0x10cf0000, 0x100, 0 };
+    cache.beginPass();
+    CHECK(!cache.find(1, key));
+    cache.store(1, key, eligible("one"));
+    auto verdict = cache.find(1, key);
+    CHECK(verdict && verdict->eligible && verdict->title == "one");
+    // a style change may turn a tool window into an app window
+    auto restyled = key;
+    restyled.exStyle = 0x80;
+    CHECK(!cache.find(1, restyled));
+    CHECK(cache.find(1, key));
+    auto generation = cache.generation();
+    cache.invalidateAll();
+    CHECK(cache.generation() == generation + 1);
+    CHECK(!cache.find(1, key));
+    cache.store(1, key, eligible("one"));
+    CHECK(cache.find(1, key));
+    CHECK(cache.stats().hits == 3 && cache.stats().misses == 3 && cache.stats().invalidations == 0);
+}
+
+TEST(verdicts, invalidationWalksUpEightOwners)
+{
+    // window w is owned by w + 1, the walk stops before the ninth owner
+    VerdictCache cache;
+    cache.beginPass();
+    for (WindowId w = 1; w <= 10; w++) cache.store(w, { .owner = w < 10 ? w + 1 : 0 }, eligible("owned"));
+    cache.invalidate(1);
+    for (WindowId w = 1; w <= 10; w++) CHECK((cache.find(w, { .owner = w < 10 ? w + 1 : 0 }) == nullptr) == (w <= 8));
+    CHECK(cache.stats().invalidations == 8 && cache.stats().hits == 2 && cache.stats().misses == 8);
+    // entries already stale are not counted twice
+    cache.invalidate(1);
+    CHECK(cache.stats().invalidations == 8);
+}
+
+TEST(verdicts, eventsInvalidateTheWindowAndItsOwners)
+{
+    VerdictCache cache;
+    cache.beginPass();
+    cache.store(1, { .owner = 2 }, eligible("popup"));
+    cache.store(2, {}, eligible("owner"));
+    cache.store(3, {}, eligible("other"));
+    cache.onEvent({ locationChanged, 1 });
+    cache.onEvent({ raised, 3 });
+    CHECK(cache.find(1, { .owner = 2 }) && cache.find(2, {}) && cache.find(3, {}));
+    cache.onEvent({ nameChanged, 3 });
+    CHECK(!cache.find(3, {}));
+    cache.store(3, {}, eligible("renamed"));
+    // the owner may become eligible once its last popup is gone
+    cache.onEvent({ destroyed, 1 });
+    CHECK(cache.size() == 2 && !cache.find(2, {}) && cache.find(3, {}));
+    CHECK(cache.stats().invalidations == 2);
+}
+
+TEST(verdicts, windowsNotSeenInAPassAreEvicted)
+{
+    VerdictCache cache;
+    cache.beginPass();
+    cache.store(1, {}, eligible("one"));
+    cache.store(2, {}, eligible("two"));
+    cache.endPass();
+    cache.beginPass();
+    CHECK(cache.find(1, {}));
+    cache.endPass();
+    CHECK(cache.size() == 1 && cache.stats().evictions == 1);
+}
@@ -0,0 +1,118 @@
+#include "check.h"
+#include "engine/windowfilter.h"
+#include <string>
+
+using namespace std;
+using enum WindowFilter::Decision;
+
+/// <summary>
+/// Window fields a rule decides on
+/// </summary>
+struct RuleWindow
+{
+    uint32_t style = 0;
+    uint32_t exStyle = 0;
+    const char* className = "";
+    const char* title = "";
+    const char* process = "";
+};
+
+/// <summary>
+/// Decide like gatherWindows does, reading a field only while it may still change the decision
+/// </summary>
+static WindowFilter::Decision decide(const WindowFilter& filter, const RuleWindow& w)
+{
+    auto state = filter.begin();
+    auto decision = filter.needs(state, WindowField::style) ? filter.testStyle(state, w.style, w.exStyle) : filter.decision(state);
+    if (filter.needs(state, WindowField::className)) decision = filter.test(state, WindowField::className, w.className);
+    if (filter.needs(state, WindowField::title)) decision = filter.test(state, WindowField::title, w.title);
+    if (filter.needs(state, WindowField::process)) decision = filter.test(state, WindowField::process, w.process);
+    return decision;
+}
+
+static WindowFilter parse(const char* rules)
+{
+    string error;
+    auto filter = WindowFilter::parse(rules, &error);
+    CHECK(filter && error.empty());
+    return filter ? *filter : WindowFilter();
+}
+
+/// <returns>the error message of rules which do not parse</returns>
+static string parseError(const string& rules)
+{
+    string error;
+    CHECK(!WindowFilter::parse(rules, &error));
+    return error;
+}
+
+TEST(rules, firstMatchWins)
+{
+    auto filter = parse("exclude title=a*\ninclude title=ab\ninclude process=x.exe\nexclude process=x.exe");
+    CHECK(decide(filter, { .title = "ab" }) == exclude);
+    CHECK(decide(filter, { .title = "b", .process = "x.exe" }) == include);
+    CHECK(decide(filter, { .title = "b", .process = "y.exe" }) == include);
+}
+
+TEST(rules, exceptionsGoBeforeExcludes)
+{
+    auto filter = parse("include process=app12.exe\ninclude process=app15.exe title=\"window 1*\"\nexclude process=app1?.exe");
+    CHECK(decide(filter, { .title = "window 3", .process = "app12.exe" }) == include);
+    CHECK(decide(filter, { .title = "window 12", .process = "app15.exe" }) == include);
+    CHECK(decide(filter, { .title = "window 2", .process = "app15.exe" }) == exclude);
+    CHECK(decide(filter, { .title = "window 1", .process = "app13.exe" }) == exclude);
+    CHECK(decide(filter, { .title = "window 1", .process = "app3.exe" }) == include);
+    // below the rule it excepts an include never gets its turn
+    CHECK(decide(parse("exclude process=app1?.exe\ninclude process=app12.exe"), { .process = "app12.exe" }) == exclude);
+}
+
+TEST(rules, namesAreCaseInsensitive)
+{
+    auto filter = parse("exclude class=consolewindowclass\nexclude title=*SETUP*\nexclude process=Up?ater.EXE");
+    CHECK(decide(filter, { .className = "ConsoleWindowClass" }) == exclude);
+    CHECK(decide(filter, { .title = "My Setup wizard" }) == exclude);
+    CHECK(decide(filter, { .process = "updater.exe" }) == exclude);
+    CHECK(decide(filter, { .title = "Settings" }) == include);
+}
+
+TEST(rules, styleMasksNeedAllBits)
+{
+    auto filter = parse("exclude style=0x10000000 exstyle=0x80\nexclude exstyle=134217728");
+    CHECK(decide(filter, { .style = 0x10cf0000, .exStyle = 0x180 }) == exclude);
+    CHECK(decide(filter, { .style = 0x00cf0000, .exStyle = 0x80 }) == include);
+    CHECK(decide(filter, { .exStyle = 0x08000000 }) == exclude);
+    CHECK(decide(filter, { .exStyle = 0x00000008 }) == include);
+}
+
+TEST(rules, quotesKeepBlanksAndSemicolons)
+{
+    auto filter = parse("exclude title=\"a; b\" class=X # comment; not a rule\ninclude title=\"*  two blanks\"; exclude title=*blanks");
+    CHECK(filter.size() == 3);
+    CHECK(decide(filter, { .className = "x", .title = "a; b" }) == exclude);
+    CHECK(decide(filter, { .className = "x", .title = "a" }) == include);
+    CHECK(decide(filter, { .title = "with  two blanks" }) == include);
+    CHECK(decide(filter, { .title = "one blanks" }) == exclude);
+}
+
+TEST(rules, errorsNameTheLine)
+{
+    CHECK(parseError("exclude title=x\nexclude title=\"open") == "line 2: unterminated quote");
+    CHECK(parseError("drop title=x") == "line 1: expected include or exclude, found 'drop'");
+    CHECK(parseError("# rules\n\ninclude") == "line 3: rule without conditions");
+    CHECK(parseError("exclude title") == "line 1: expected field=value, found 'title'");
+    CHECK(parseError("exclude title=") == "line 1: expected field=value, found 'title='");
+    CHECK(parseError("exclude style=0xZZ") == "line 1: invalid style mask '0xZZ'");
+    CHECK(parseError("exclude exstyle=1 exstyle=2") == "line 1: exstyle given twice");
+    CHECK(parseError("exclude title=a title=b") == "line 1: title given twice");
+    CHECK(parseError("exclude name=a") == "line 1: unknown field 'name'");
+    string tooMany;
+    for (size_t i = 0; i <= WindowFilter::maxRules; i++) tooMany += "exclude title=t" + to_string(i) + "\n";
+    CHECK(parseError(tooMany) == "line 65: more than 64 rules");
+}
+
+TEST(rules, defaults)
+{
+    auto filter = parse(WindowFilter::defaultRules);
+    CHECK(decide(filter, { .process = "ApplicationFrameHost.exe" }) == exclude);
+    CHECK(decide(filter, { .process = "notepad.exe" }) == include);
+}
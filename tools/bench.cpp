@@ -0,0 +1,799 @@
+// Times the phases of the layout engine on synthetic desktops and prints one JSON object per scenario.
+// Every pass moves one window a few pixels and arranges the desktop again. The plan is not fed back,
+// because long corner stacks push most windows off screen, where they no longer take part in the layout.
+// With --settled the plan is fed back after all, so that a pass sees only the nudged window change, as on a real desktop.
+// With --gather it times the collection of window metadata instead, on a simulated backend with per-call latency.
+// With --filter it times the window rules and counts the queries they save in the same simulation.
+// With --assignment it compares the corner assignment modes on a first pass over one monitor, where every window is new.
+// With --geometry it times the main monitor and corner search per window against the batched kernels and checks they agree;
+// it exits with 1 if they do not.
+// With --occlusion it times the coverage analysis, scores the desktop before and after arranging, and counts the settled
+// passes which arrange with and without arrangeOnlyWhenOccluded.
+// With --animation it animates the first plan on a virtual clock, once with windows which repaint quickly and once
+// with slow ones, and once more retargeting the windows halfway and dragging one away; it prints the frame statistics.
+// With --minimize it minimizes and restores windows which take a random time to respond, one of them hung, on a virtual
+// clock, and compares the time of the toggles with that of showing the windows one by one.
+#include "engine/animator.h"
+#include "engine/bulkminimize.h"
+#include "engine/displaytopology.h"
+#include "engine/fingerprint.h"
+#include "engine/geometrykernel.h"
+#include "engine/layout.h"
+#include "engine/windowgather.h"
+#include <atomic>
+#include <functional>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string_view>
+#include <tuple>
+
+using namespace std;
+
+static atomic<size_t> allocations = 0;
+
+// Every allocation is counted; the replacements come as a complete set, so that memory is always released by the
+// function matching the one which allocated it.
+static void* allocate(size_t size, size_t alignment = 0)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (!size) size = 1;
+#ifdef _WIN32
+    void* p = alignment ? _aligned_malloc(size, alignment) : malloc(size);
+#else
+    void* p = alignment ? aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : malloc(size);
+#endif
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+static void release(void* p, bool aligned = false) noexcept
+{
+#ifdef _WIN32
+    if (aligned) return _aligned_free(p);
+#else
+    (void)aligned;
+#endif
+    free(p);
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, align_val_t alignment) { return allocate(size, size_t(alignment)); }
+void* operator new[](size_t size, align_val_t alignment) { return allocate(size, size_t(alignment)); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, align_val_t) noexcept { release(p, true); }
+void operator delete[](void* p, align_val_t) noexcept { release(p, true); }
+void operator delete(void* p, size_t, align_val_t) noexcept { release(p, true); }
+void operator delete[](void* p, size_t, align_val_t) noexcept { release(p, true); }
+
+struct Scenario
+{
+    int monitors;
+    int windows;
+};
+
+/// <summary>
+/// Monitors side by side with a mix of resolutions, scale factors and orientations
+/// </summary>
+static void addMonitors(DesktopSnapshot& desktop, int count, mt19937& rng)
+{
+    struct Model { int32_t width; int32_t height; unsigned dpi; };
+    static const Model models[] = {
+        { 1920, 1080, 96 }, { 1920, 1200, 96 }, { 2560, 1440, 120 }, { 2560, 1600, 144 },
+        { 3840, 2160, 144 }, { 3840, 2160, 192 }, { 1366, 768, 96 }, { 3440, 1440, 96 },
+    };
+    auto topology = make_shared<DisplayTopology>();
+    int32_t x = 0;
+    for (int i = 0; i < count; i++)
+    {
+        auto model = models[i == 0 ? 0 : rng() % size(models)];
+        int32_t width = model.width * 96 / model.dpi;
+        int32_t height = model.height * 96 / model.dpi;
+        if (i > 0 && rng() % 3 == 0) swap(width, height); // portrait
+        const int32_t taskbar = 40;
+        MonitorInfo monitor;
+        monitor.id = 0x100 + i;
+        monitor.rect = { x, 0, x + width, height };
+        monitor.workArea = { x, 0, x + width, height - taskbar };
+        monitor.name = "DISPLAY" + to_string(i + 1);
+        monitor.dpi = model.dpi;
+        monitor.touchCapable = rng() % 8 == 0;
+        topology->monitors.push_back(monitor);
+        x += width;
+    }
+    topology->primary = topology->monitors.front().id;
+    topology->primaryDpi = topology->monitors.front().dpi;
+    desktop.topology = move(topology);
+}
+
+/// <summary>
+/// Mostly dialogs and document windows, some nearly maximized ones and a few off screen
+/// </summary>
+static void addWindows(DesktopSnapshot& desktop, int count, mt19937& rng)
+{
+    uniform_real_distribution<double> unit(0, 1);
+    for (int i = 0; i < count; i++)
+    {
+        auto const& monitors = desktop.topology->monitors;
+        auto const& mrect = monitors[rng() % monitors.size()].workArea;
+        double kind = unit(rng);
+        // fractions of the work area: dialog, document, nearly maximized
+        auto [w0, dw, h0, dh] = kind < 0.35 ? tuple(0.15, 0.15, 0.15, 0.25)
+                              : kind < 0.85 ? tuple(0.4, 0.4, 0.45, 0.4)
+                              : tuple(0.9, 0.1, 0.9, 0.1);
+        double w = w0 + dw * unit(rng);
+        double h = h0 + dh * unit(rng);
+        int32_t width = max(120, int32_t(w * mrect.width()));
+        int32_t height = max(80, int32_t(h * mrect.height()));
+        int32_t left = mrect.left + int32_t(unit(rng) * max(1, mrect.width() - width));
+        int32_t top = mrect.top + int32_t(unit(rng) * max(1, mrect.height() - height));
+        if (unit(rng) < 0.02) top = -100000; // minimized to the parking position
+
+        WindowInfo window;
+        window.id = 0x10010 + 16 * WindowId(i);
+        window.rect = { left, top, left + width, top + height };
+        window.processName = "app" + to_string(i % 40) + ".exe";
+        window.title = "window " + to_string(i);
+        window.maximizable = unit(rng) < 0.9;
+        window.perMonitorDpiAware = unit(rng) < 0.8;
+        desktop.windows.push_back(window);
+    }
+    shuffle(desktop.windows.begin(), desktop.windows.end(), rng); // enumeration follows z-order, not ids
+}
+
+static DesktopSnapshot makeDesktop(Scenario scenario, unsigned seed)
+{
+    mt19937 rng(seed);
+    DesktopSnapshot desktop;
+    addMonitors(desktop, scenario.monitors, rng);
+    addWindows(desktop, scenario.windows, rng);
+    auto const& primary = desktop.topology->monitors.front().workArea;
+    desktop.cursor = { primary.width() / 2, primary.height() / 2 };
+    desktop.theme = ThemeSizes{ 22, 4 };
+    return desktop;
+}
+
+/// move the windows to their targets
+static void settle(DesktopSnapshot& desktop, const optional<MovePlan>& plan)
+{
+    if (!plan) return;
+    for (auto const& move : *plan)
+        for (auto& w : desktop.windows)
+            if (w.id == move.window) w.rect = move.rect;
+}
+
+static void run(Scenario scenario, int passes, unsigned seed, bool settled)
+{
+    auto desktop = makeDesktop(scenario, seed);
+    LayoutEngine engine;
+    auto first = engine.arrange(desktop); // the first pass places every window and sizes the arena
+    if (settled) settle(desktop, first);
+
+    mt19937 rng(seed);
+    PassTimings total;
+    chrono::nanoseconds wall{};
+    size_t passAllocations = 0;
+    size_t overflow = 0;
+    int planned = 0;
+    PassScope scope;
+    for (int pass = 0; pass < passes; pass++)
+    {
+        auto& nudged = desktop.windows[rng() % desktop.windows.size()].rect;
+        int32_t delta = pass % 2 ? -8 : 8;
+        nudged.left += delta;
+        nudged.right += delta;
+
+        size_t before = allocations.load(memory_order_relaxed);
+        auto start = chrono::steady_clock::now();
+        auto plan = engine.arrange(desktop);
+        wall += chrono::steady_clock::now() - start;
+        if (settled) settle(desktop, plan);
+        passAllocations += allocations.load(memory_order_relaxed) - before;
+        overflow += engine.lastPassOverflow();
+        for (int i = 0; i < layoutPhaseCount; i++) total.phases[i] += engine.lastPassTimings().phases[i];
+        planned += plan.has_value();
+        scope.monitors += engine.lastPassScope().monitors;
+        scope.windows += engine.lastPassScope().windows;
+        scope.repositioned += engine.lastPassScope().repositioned;
+    }
+
+    // the pre-check which answers most ticks of an idle desktop
+    vector<WindowState> states;
+    for (auto const& w : desktop.windows) states.push_back({ w.id, w.rect, 1 });
+    uint64_t fingerprint = desktopFingerprint(states);
+    int noticed = 0; // every pass changes a window, so every fingerprint must differ from the one before
+    auto fingerprintStart = chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        states[size_t(pass) % states.size()].visibility ^= 2;
+        auto next = desktopFingerprint(states);
+        noticed += next != fingerprint;
+        fingerprint = next;
+    }
+    chrono::nanoseconds fingerprintTime = chrono::steady_clock::now() - fingerprintStart;
+
+    double perWindow = double(passes) * max(1, scenario.windows);
+    cout << "{\"monitors\":" << scenario.monitors << ",\"windows\":" << scenario.windows << ",\"settled\":" << (settled ? "true" : "false")
+         << ",\"passes\":" << passes << ",\"planned\":" << planned << ",\"seed\":" << seed << ",\"ns_per_window\":{";
+    for (int i = 0; i < layoutPhaseCount; i++)
+        cout << '"' << phaseName(LayoutPhase(i)) << "\":" << total.phases[i].count() / perWindow << ',';
+    cout << "\"total\":" << wall.count() / perWindow << "},\"fingerprint_ns_per_window\":" << fingerprintTime.count() / perWindow
+         << ",\"fingerprint_changes_noticed\":" << double(noticed) / passes << ",\"relaid_per_pass\":{\"monitors\":" << double(scope.monitors) / passes << ",\"windows\":" << double(scope.windows) / passes
+         << ",\"repositioned\":" << double(scope.repositioned) / passes << '}'
+         << ",\"allocations_per_pass\":" << double(passAllocations) / passes
+         << ",\"arena_overflow_bytes_per_pass\":" << double(overflow) / passes << '}' << endl;
+}
+
+/// <summary>
+/// The windows of the desktop plus as many hidden ones, owned by 40 processes
+/// </summary>
+static void simulate(const DesktopSnapshot& desktop, SimulatedWindowBackend& backend, vector<WindowId>& handles)
+{
+    for (auto const& window : desktop.windows)
+    {
+        auto& simulated = backend.windows[window.id];
+        simulated.probe = WindowProbe{ { 0x10000000, 0, 0 }, window.rect, window.maximizable };
+        simulated.verdict.eligible = true;
+        simulated.verdict.pid = 1000 + ProcessId(window.id % 40);
+        simulated.verdict.title = window.title;
+        simulated.verdict.perMonitorDpiAware = window.perMonitorDpiAware;
+        backend.processes[simulated.verdict.pid] = { window.processName, "C:\\Program Files\\" + window.processName };
+        handles.push_back(window.id);
+        handles.push_back(window.id + 8); // hidden, rejected by the probe
+    }
+    backend.probeLatency = chrono::microseconds(5);
+    backend.classifyLatency = chrono::microseconds(100);
+    backend.processLatency = chrono::microseconds(300);
+}
+
+static void runGather(int windows, unsigned seed)
+{
+    auto desktop = makeDesktop({ 1, windows }, seed);
+    SimulatedWindowBackend backend;
+    vector<WindowId> handles;
+    simulate(desktop, backend, handles);
+
+    double baseline[2] = {};
+    vector<WindowId> reference;
+    for (unsigned threads : { 1, 2, 4, 8 })
+    {
+        WorkerPool pool(threads - 1);
+        WindowFilter filter; // no rules
+        VerdictCache verdicts;
+        ProcessCache processes(backend);
+        double ms[2];
+        GatherResult result;
+        for (int pass = 0; pass < 2; pass++) // cold caches, then warm ones
+        {
+            verdicts.beginPass();
+            processes.beginPass();
+            auto start = chrono::steady_clock::now();
+            result = gatherWindows(handles, backend, filter, verdicts, processes, pool);
+            ms[pass] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            verdicts.endPass();
+            if (threads == 1) baseline[pass] = ms[pass];
+        }
+        vector<WindowId> ids;
+        for (auto const& window : result.windows) ids.push_back(window.id);
+        if (threads == 1) reference = ids;
+        cout << "{\"gather\":{\"windows\":" << windows << ",\"handles\":" << handles.size() << ",\"threads\":" << threads
+             << ",\"cold_ms\":" << ms[0] << ",\"cold_speedup\":" << baseline[0] / ms[0] << ",\"warm_ms\":" << ms[1]
+             << ",\"warm_speedup\":" << baseline[1] / ms[1] << ",\"identical\":" << (ids == reference ? "true" : "false") << "}}" << endl;
+    }
+}
+
+static void runAssignment(int windows, int passes, unsigned seed)
+{
+    for (auto mode : { CornerAssignment::greedy, CornerAssignment::minDisplacement })
+    {
+        chrono::nanoseconds distribution{};
+        chrono::nanoseconds wall{};
+        double displacement = 0;
+        double resized = 0;
+        double cost = 0;
+        for (int pass = 0; pass < passes; pass++)
+        {
+            auto desktop = makeDesktop({ 1, windows }, seed + unsigned(pass));
+            LayoutEngine engine;
+            engine.settings.cornerAssignment = mode;
+            auto start = chrono::steady_clock::now();
+            auto plan = engine.arrange(desktop);
+            wall += chrono::steady_clock::now() - start;
+            distribution += engine.lastPassTimings()[LayoutPhase::distribution];
+            for (auto const& move : *plan)
+            {
+                auto const& before = desktop.findWindow(move.window)->rect;
+                displacement += double(abs(move.rect.left - before.left) + abs(move.rect.top - before.top));
+                auto area = [](const Rect& r) { return double(max(0, r.width())) * double(max(0, r.height())); };
+                resized += abs(area(move.rect) - area(before));
+                // what cornerCost weighs: a unit wide strip as much as moving by its length
+                cost += double(abs(move.rect.left - before.left) + abs(move.rect.top - before.top))
+                        + abs(area(move.rect) - area(before)) / max(1, move.unitSize);
+            }
+        }
+        cout << "{\"assignment\":{\"mode\":\"" << (mode == CornerAssignment::greedy ? "greedy" : "min_displacement")
+             << "\",\"windows\":" << windows << ",\"passes\":" << passes
+             << ",\"distribution_us\":" << chrono::duration<double, micro>(distribution).count() / passes
+             << ",\"pass_us\":" << chrono::duration<double, micro>(wall).count() / passes
+             << ",\"displacement_px\":" << displacement / passes << ",\"resized_px2\":" << resized / passes
+             << ",\"cost\":" << cost / passes << "}}" << endl;
+    }
+}
+
+/// <summary>
+/// Rules of a user who excludes consoles, setup programs and a family of processes, with a few exceptions
+/// </summary>
+static const char* const benchRules = R"(
+exclude exstyle=0x80
+exclude class=ConsoleWindowClass
+exclude class=CASCADIA_HOSTING_WINDOW_CLASS
+exclude class=#32770 title="* Properties"
+exclude class=Chrome_WidgetWin_1 title="Picture-in-picture"
+exclude title="*Setup*"
+exclude title="Installing *"
+exclude process=ApplicationFrameHost.exe
+include process=app12.exe
+include process=app15.exe title="window 1*"
+exclude process=app1?.exe
+exclude process=app3.exe title="*7"
+exclude process=updater*.exe
+exclude style=0x00000000 exstyle=0x08000000
+)";
+
+static void runFilter(int windows, unsigned seed)
+{
+    static const char* const classes[] = { "Chrome_WidgetWin_1", "Notepad", "ConsoleWindowClass", "CabinetWClass",
+                                           "#32770", "ApplicationFrameWindow", "MozillaWindowClass", "XLMAIN" };
+    auto desktop = makeDesktop({ 1, windows }, seed);
+    SimulatedWindowBackend backend;
+    vector<WindowId> handles;
+    simulate(desktop, backend, handles);
+    mt19937 rng(seed);
+    for (auto& [id, window] : backend.windows)
+    {
+        window.className = classes[rng() % size(classes)];
+        if (window.probe && rng() % 10 == 0) window.probe->key.exStyle |= 0x80; // tool window
+        if (rng() % 20 == 0) window.verdict.title = "Setup - " + window.verdict.title;
+    }
+    auto filter = WindowFilter::parse(benchRules);
+
+    // all fields of every window, as if each was classified from scratch
+    const int rounds = max(1, 1000000 / windows);
+    size_t excluded = 0;
+    auto start = chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+        for (auto w : handles)
+        {
+            auto const& window = backend.windows[w];
+            if (!window.probe) continue;
+            auto state = filter->begin();
+            auto decision = filter->testStyle(state, window.probe->key.style, window.probe->key.exStyle);
+            if (filter->needs(state, WindowField::className)) decision = filter->test(state, WindowField::className, window.className);
+            if (filter->needs(state, WindowField::title)) decision = filter->test(state, WindowField::title, window.verdict.title);
+            if (filter->needs(state, WindowField::process))
+                decision = filter->test(state, WindowField::process, backend.processes[window.verdict.pid].name);
+            excluded += decision == WindowFilter::Decision::exclude;
+        }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (double(rounds) * windows);
+
+    backend.probeLatency = backend.classifyLatency = backend.processLatency = {};
+    for (bool rules : { false, true })
+    {
+        backend.classNameQueries = backend.classifications = backend.dpiQueries = backend.processQueries = 0;
+        WorkerPool pool(0);
+        VerdictCache verdicts;
+        ProcessCache processes(backend);
+        verdicts.beginPass();
+        processes.beginPass();
+        auto result = gatherWindows(handles, backend, rules ? *filter : WindowFilter(), verdicts, processes, pool);
+        verdicts.endPass();
+        cout << "{\"filter\":{\"windows\":" << windows << ",\"rules\":" << (rules ? filter->size() : 0)
+             << ",\"ns_per_window\":" << (rules ? ns : 0) << ",\"excluded_per_round\":" << (rules ? excluded / rounds : 0)
+             << ",\"eligible\":" << result.windows.size()
+             << ",\"class_queries\":" << backend.classNameQueries << ",\"classifications\":" << backend.classifications
+             << ",\"process_queries\":" << backend.processQueries << ",\"dpi_queries\":" << backend.dpiQueries << ",\"filtered\":{";
+        for (int f = 0; f < windowFieldCount; f++)
+        {
+            static const char* const names[] = { "style", "class", "title", "process" };
+            cout << (f ? "," : "") << '"' << names[f] << "\":" << result.filtered[f];
+        }
+        cout << "}}}" << endl;
+    }
+}
+
+/// <summary>
+/// The per window search the layout engine did before the batched kernels, kept as the reference
+/// </summary>
+static pair<int, Corner> referenceMainMonitorAndCorner(const Rect& wrect, const vector<pair<Rect, bool>>& monitors)
+{
+    size_t maxArea = 0;
+    int mon = -1;
+    Corner corner = Corner::topleft;
+    for (int m = 0; m < int(monitors.size()); m++)
+    {
+        Rect rect{};
+        Rect::intersect(rect, monitors[m].first, wrect);
+        size_t area = rect.area();
+        if (area > maxArea)
+        {
+            mon = m;
+            maxArea = area;
+        }
+    }
+    if (mon >= 0)
+    {
+        Rect mrect = monitors[mon].first;
+        auto minDist = mrect.diameter();
+        for (int i = 0; i < 4; i++)
+        {
+            auto c = Corner(i);
+            if (monitors[mon].second && c == Corner::topright) continue;
+            size_t dist = wrect.distanceFromCorner(mrect, c);
+            if (dist < minDist)
+            {
+                minDist = dist;
+                corner = c;
+            }
+        }
+    }
+    return { mon, corner };
+}
+
+/// <returns>windows for which a kernel disagreed with the reference</returns>
+static size_t runGeometry(Scenario scenario, int passes, unsigned seed)
+{
+    auto desktop = makeDesktop(scenario, seed);
+    mt19937 rng(seed);
+    // a third of the windows straddle monitors, where the intersections decide
+    vector<Rect> rects;
+    for (auto const& w : desktop.windows)
+    {
+        auto r = w.rect;
+        if (rng() % 3 == 0)
+        {
+            int32_t shift = int32_t(rng() % uint32_t(2 * r.width() + 1)) - r.width();
+            r.left += shift;
+            r.right += shift;
+        }
+        rects.push_back(r);
+    }
+    vector<pair<Rect, bool>> monitors;
+    for (auto const& m : desktop.topology->monitors) monitors.push_back({ m.workArea, monitors.size() % 2 == 1 });
+
+    vector<pair<int, Corner>> expected(rects.size());
+    chrono::nanoseconds reference{};
+    for (int pass = 0; pass < passes; pass++)
+    {
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < rects.size(); i++) expected[i] = referenceMainMonitorAndCorner(rects[i], monitors);
+        reference += chrono::steady_clock::now() - start;
+    }
+    cout << "{\"geometry\":{\"monitors\":" << scenario.monitors << ",\"windows\":" << scenario.windows << ",\"passes\":" << passes
+         << ",\"reference_ns_per_window\":" << chrono::duration<double, nano>(reference).count() / passes / double(rects.size());
+    size_t total = 0;
+    for (int k = 0; k < geometryKernelCount; k++)
+    {
+        auto kernel = GeometryKernel(k);
+        if (!geometryKernelSupported(kernel)) continue;
+        vector<int> monitor(rects.size());
+        vector<Corner> corner(rects.size());
+        chrono::nanoseconds wall{};
+        for (int pass = 0; pass < passes; pass++)
+        {
+            // the layout engine builds the columns every pass, so they are timed too
+            auto start = chrono::steady_clock::now();
+            RectColumns windowRects;
+            windowRects.reserve(rects.size());
+            for (auto const& r : rects) windowRects.push_back(r);
+            MonitorColumns monitorRects;
+            for (auto const& [r, avoid] : monitors) monitorRects.push_back(r, avoid);
+            findMainMonitorsAndCorners(windowRects, monitorRects, monitor, corner, kernel);
+            wall += chrono::steady_clock::now() - start;
+        }
+        size_t mismatches = 0;
+        for (size_t i = 0; i < rects.size(); i++) mismatches += expected[i] != pair(monitor[i], corner[i]);
+        total += mismatches;
+        cout << ",\"" << geometryKernelName(kernel) << "_ns_per_window\":" << chrono::duration<double, nano>(wall).count() / passes / double(rects.size())
+             << ",\"" << geometryKernelName(kernel) << "_mismatches\":" << mismatches;
+    }
+    cout << "}}" << endl;
+    return total;
+}
+
+static void writeCoverage(const char* label, const DesktopCoverage& coverage)
+{
+    cout << ",\"" << label << "\":{\"reachable\":" << coverage.reachableFraction() << ",\"visible\":" << coverage.visibleFraction() << '}';
+}
+
+static void runOcclusion(Scenario scenario, int passes, unsigned seed)
+{
+    auto desktop = makeDesktop(scenario, seed);
+    LayoutEngine engine;
+    auto before = engine.measureCoverage(desktop);
+    auto start = chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) engine.measureCoverage(desktop);
+    chrono::nanoseconds analysis = chrono::steady_clock::now() - start;
+    settle(desktop, engine.arrange(desktop));
+    auto after = engine.measureCoverage(desktop);
+
+    cout << "{\"occlusion\":{\"monitors\":" << scenario.monitors << ",\"windows\":" << scenario.windows << ",\"passes\":" << passes
+         << ",\"ns_per_window\":" << double(analysis.count()) / passes / double(scenario.windows);
+    writeCoverage("before", before);
+    writeCoverage("after", after);
+    // the same nudges of the arranged desktop, arranging always and only when a window lost its corners
+    for (bool onlyWhenOccluded : { false, true })
+    {
+        auto nudged = desktop;
+        LayoutEngine settledEngine;
+        settledEngine.settings.arrangeOnlyWhenOccluded = onlyWhenOccluded;
+        settle(nudged, settledEngine.arrange(nudged));
+        mt19937 rng(seed);
+        int planned = 0;
+        for (int pass = 0; pass < passes; pass++)
+        {
+            auto& rect = nudged.windows[rng() % nudged.windows.size()].rect;
+            int32_t delta = pass % 2 ? -8 : 8;
+            rect.left += delta;
+            rect.right += delta;
+            auto plan = settledEngine.arrange(nudged);
+            planned += plan.has_value();
+            settle(nudged, plan);
+        }
+        cout << ",\"" << (onlyWhenOccluded ? "planned_only_when_occluded" : "planned_always") << "\":" << planned;
+        if (!onlyWhenOccluded) continue;
+        writeCoverage("nudged", settledEngine.measureCoverage(nudged));
+        // raising the bottom window changes no rect, only which corners stay visible
+        int raisedPlanned = 0;
+        int occludedAfter = 0;
+        for (int pass = 0; pass < passes; pass++)
+        {
+            rotate(nudged.windows.begin(), nudged.windows.end() - 1, nudged.windows.end());
+            auto plan = settledEngine.arrange(nudged);
+            raisedPlanned += plan.has_value();
+            settle(nudged, plan);
+            occludedAfter += !settledEngine.measureCoverage(nudged).allReachable();
+        }
+        cout << ",\"raised_planned\":" << raisedPlanned << ",\"raised_occluded_after\":" << occludedAfter;
+    }
+    cout << "}}" << endl;
+}
+
+/// <summary>
+/// Processor time of an animation, which the virtual clock does not see
+/// </summary>
+struct AnimationCpu
+{
+    chrono::nanoseconds start{};
+    chrono::nanoseconds frames{};
+    chrono::nanoseconds maxFrame{};
+};
+
+static void startAnimation(MoveAnimator& animator, const MovePlan& plan, AnimationCpu& cpu)
+{
+    auto start = chrono::steady_clock::now();
+    animator.start(plan);
+    cpu.start += chrono::steady_clock::now() - start;
+}
+
+/// <summary>
+/// Post frames like MoveAnimator::run, timing each on the steady clock
+/// </summary>
+static void runFrames(MoveAnimator& animator, Clock& clock, AnimationCpu& cpu, const function<bool()>& interrupt = {})
+{
+    while (auto next = animator.nextFrame())
+    {
+        if (interrupt && interrupt()) return;
+        clock.sleepUntil(*next);
+        auto start = chrono::steady_clock::now();
+        animator.frame();
+        chrono::nanoseconds elapsed = chrono::steady_clock::now() - start;
+        cpu.frames += elapsed;
+        cpu.maxFrame = max(cpu.maxFrame, elapsed);
+    }
+}
+
+static void writeAnimation(const char* label, const MoveAnimator& animator, Duration elapsed, const AnimationCpu& cpu)
+{
+    auto const& stats = animator.stats();
+    auto ms = [](auto d) { return chrono::duration<double, milli>(d).count(); };
+    cout << ",\"" << label << "\":{\"frames\":" << stats.frames << ",\"dropped\":" << stats.droppedFrames
+         << ",\"slow\":" << stats.slowFrames << ",\"jumps\":" << stats.jumps << ",\"retargets\":" << stats.retargets
+         << ",\"cancellations\":" << stats.cancellations << ",\"ms\":" << ms(elapsed) << ",\"cpu_start_ms\":" << ms(cpu.start)
+         << ",\"cpu_ns_per_frame\":" << (stats.frames ? double(cpu.frames.count()) / double(stats.frames) : 0.0)
+         << ",\"max_frame_cpu_ms\":" << ms(cpu.maxFrame) << '}';
+}
+
+static void runAnimation(Scenario scenario, unsigned seed)
+{
+    auto desktop = makeDesktop(scenario, seed);
+    LayoutEngine engine;
+    auto plan = engine.arrange(desktop);
+    if (!plan) return;
+
+    // ms is virtual time, the cpu fields are measured on the steady clock
+    cout << "{\"animation\":{\"monitors\":" << scenario.monitors << ",\"windows\":" << scenario.windows << ",\"moves\":" << plan->size();
+    // repaint times per window: a light application, and one which takes longer than the frame budget for a dozen windows
+    for (auto [label, repaint] : { pair("fast", chrono::microseconds(20)), pair("slow", chrono::microseconds(400)) })
+    {
+        ManualClock clock;
+        SimulatedMoveBackend backend(clock);
+        backend.repaintTime = repaint;
+        for (auto const& w : desktop.windows) backend.windows[w.id] = w.rect;
+        MoveAnimator animator(backend, clock);
+        auto start = clock.now();
+        AnimationCpu cpu;
+        startAnimation(animator, *plan, cpu);
+        runFrames(animator, clock, cpu);
+        writeAnimation(label, animator, clock.now() - start, cpu);
+    }
+    // halfway, a new pass sends every window back to the top-left corner, and the user drags one of them away
+    {
+        ManualClock clock;
+        SimulatedMoveBackend backend(clock);
+        backend.repaintTime = chrono::microseconds(20);
+        for (auto const& w : desktop.windows) backend.windows[w.id] = w.rect;
+        MoveAnimator animator(backend, clock);
+        auto start = clock.now();
+        AnimationCpu cpu;
+        startAnimation(animator, *plan, cpu);
+        runFrames(animator, clock, cpu, [&] { return clock.now() - start >= animator.currentOptions().duration / 2; });
+        startAnimation(animator, LayoutEngine::resetPlan(*plan, desktop), cpu);
+        // the user grabs the window once it took the frame posted last
+        clock.sleepUntil(clock.now() + animator.currentOptions().frameInterval / 2);
+        backend.currentRect(plan->front().window);
+        auto& dragged = backend.windows[plan->front().window];
+        dragged = { dragged.left + 50, dragged.top + 50, dragged.right + 50, dragged.bottom + 50 };
+        runFrames(animator, clock, cpu);
+        writeAnimation("retarget", animator, clock.now() - start, cpu);
+    }
+    cout << "}}" << endl;
+}
+
+static void writeToggle(const char* label, const BulkMinimizer::Result& result)
+{
+    cout << ",\"" << label << "\":{\"requested\":" << result.requested << ",\"completed\":" << result.completed
+         << ",\"hung\":" << result.hung << ",\"timed_out\":" << result.timedOut << ",\"failed\":" << result.failed
+         << ",\"ms\":" << chrono::duration<double, milli>(result.latency).count() << '}';
+}
+
+static void runMinimize(int windows, unsigned seed)
+{
+    mt19937 random(seed);
+    uniform_int_distribution<int> delayMs(0, 50);
+    ManualClock clock;
+    SimulatedShowBackend backend(clock);
+    Duration serial{};
+    for (int i = 0; i < windows; i++)
+    {
+        WindowId w = WindowId(i + 1);
+        backend.stackOrder.push_back(w);
+        backend.delays[w] = chrono::milliseconds(delayMs(random));
+        serial += backend.delays[w];
+    }
+    // the foreground window is not always the topmost one, e.g. below a topmost tool window
+    backend.foregroundWindow = backend.stackOrder[size_t(windows) / 2];
+    WindowId hung = backend.stackOrder.back();
+    if (windows > 1) backend.hung.insert(hung);
+
+    // ShowWindow waits for every window in turn, on the way down and up again, and forever for the hung one
+    cout << "{\"minimize\":{\"windows\":" << windows
+         << ",\"serial_ms\":" << 2 * chrono::duration<double, milli>(serial).count();
+    BulkMinimizer minimizer(backend, clock);
+    auto minimized = minimizer.minimize(backend.zOrder());
+    writeToggle("minimized", minimized);
+    auto restored = minimizer.restore();
+    writeToggle("restored", restored);
+    cout << ",\"stack_transactions\":" << backend.stacked << "}}" << endl;
+}
+
+static vector<int> parseList(string_view list)
+{
+    vector<int> result;
+    while (!list.empty())
+    {
+        auto comma = list.find(',');
+        result.push_back(atoi(string(list.substr(0, comma)).c_str()));
+        list = comma == string_view::npos ? string_view() : list.substr(comma + 1);
+    }
+    return result;
+}
+
+static int usage()
+{
+    cerr << "usage: lazyclicker_bench [--gather | --filter | --assignment | --settled | --geometry | --occlusion | --animation | --minimize] [--monitors 1,2,4,8] [--windows 10,100,1000,5000] [--passes N] [--seed N]\n"
+            "prints one JSON object per scenario; --passes defaults to enough passes for 200000 windows\n"
+            "--gather times window metadata collection with 1, 2, 4 and 8 threads instead of the layout\n"
+            "--filter times the window rules and counts the queries they save\n"
+            "--assignment compares greedy and minimum displacement corner assignment of new windows on one monitor\n"
+            "--settled moves the windows to their targets after every pass, so only the stacks of the nudged window change\n"
+            "--geometry compares the per window main monitor and corner search with the batched kernels\n"
+            "--occlusion times the visible corner analysis and counts the passes arrangeOnlyWhenOccluded saves\n"
+            "--animation animates the first plan on a virtual clock and counts frames, dropped frames, jumps and retargets\n"
+            "--minimize minimizes and restores windows on a virtual clock and compares the time with a serial toggle\n";
+    return 2;
+}
+
+int main(int argc, char* argv[])
+{
+    vector<int> monitorCounts{ 1, 2, 4, 8 };
+    vector<int> windowCounts{ 10, 100, 1000, 5000 };
+    int passes = 0;
+    unsigned seed = 1;
+    bool gather = false;
+    bool filter = false;
+    bool assignment = false;
+    bool settled = false;
+    bool geometry = false;
+    bool occlusion = false;
+    bool animation = false;
+    bool minimize = false;
+    for (int i = 1; i < argc; i++)
+    {
+        string_view arg = argv[i];
+        if (arg == "--gather") gather = true;
+        else if (arg == "--filter") filter = true;
+        else if (arg == "--assignment") assignment = true;
+        else if (arg == "--settled") settled = true;
+        else if (arg == "--geometry") geometry = true;
+        else if (arg == "--occlusion") occlusion = true;
+        else if (arg == "--animation") animation = true;
+        else if (arg == "--minimize") minimize = true;
+        else if (arg == "--monitors" && i + 1 < argc) monitorCounts = parseList(argv[++i]);
+        else if (arg == "--windows" && i + 1 < argc) windowCounts = parseList(argv[++i]);
+        else if (arg == "--passes" && i + 1 < argc) passes = atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = unsigned(atoi(argv[++i]));
+        else return usage();
+    }
+    if (filter)
+    {
+        for (int windows : windowCounts)
+        {
+            if (windows < 1) return usage();
+            runFilter(windows, seed);
+        }
+        return 0;
+    }
+    if (gather)
+    {
+        for (int windows : windowCounts)
+        {
+            if (windows < 1) return usage();
+            runGather(windows, seed);
+        }
+        return 0;
+    }
+    if (minimize)
+    {
+        for (int windows : windowCounts)
+        {
+            if (windows < 1) return usage();
+            runMinimize(windows, seed);
+        }
+        return 0;
+    }
+    if (assignment)
+    {
+        for (int windows : windowCounts)
+        {
+            if (windows < 1) return usage();
+            runAssignment(windows, passes > 0 ? passes : 100, seed);
+        }
+        return 0;
+    }
+    size_t mismatches = 0;
+    for (int monitors : monitorCounts)
+        for (int windows : windowCounts)
+        {
+            if (monitors < 1 || windows < 1) return usage();
+            if (animation) runAnimation({ monitors, windows }, seed);
+            else if (occlusion) runOcclusion({ monitors, windows }, passes > 0 ? passes : max(20, 200000 / windows), seed);
+            else if (geometry) mismatches += runGeometry({ monitors, windows }, passes > 0 ? passes : max(20, 200000 / windows), seed);
+            else run({ monitors, windows }, passes > 0 ? passes : max(20, 200000 / windows), seed, settled);
+        }
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// Reads desktop snapshots and prints the move plan the layout engine computes for them.
+// Several snapshots are processed as consecutive passes of one engine.
+#include "engine/moveexecutor.h"
+#include "engine/recording.h"
+#include "engine/snapshotio.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+using namespace std;
+
+/// <summary>
+/// One comment line with the windows which keep a visible corner and the share of window area in view
+/// </summary>
+static void writeCoverage(ostream& out, const char* label, const DesktopCoverage& coverage)
+{
+    out << "# coverage " << label << " reachable " << coverage.reachable << '/' << coverage.onScreen
+        << " visible " << int(coverage.visibleFraction() * 1000 + 0.5) / 10.0 << "%\n";
+}
+
+static int usage()
+{
+    cerr << "usage: lazyclicker_plan [--force] [--reset] [--max-increase N] [--avoid-top-right] [--no-touch-unit] [--min-displacement]\n"
+            "                        [--only-occluded] [--coverage] [--repeat N] [--record FILE] snapshot... (- for stdin)\n"
+            "--only-occluded arranges changed windows only when a window has no visible corner\n"
+            "--coverage prints the visible corners and area before and after every plan\n"
+            "--repeat N runs every pass N times on a fresh engine and reports the mean time on stderr\n"
+            "--record FILE writes the passes to a session recording for lazyclicker_replay\n";
+    return 2;
+}
+
+int main(int argc, char* argv[])
+{
+    LayoutEngine engine;
+    bool force = false;
+    bool reset = false;
+    bool coverage = false;
+    int repeat = 0;
+    const char* recordPath = nullptr;
+    vector<string_view> files;
+    for (int i = 1; i < argc; i++)
+    {
+        string_view arg = argv[i];
+        if (arg == "--force") force = true;
+        else if (arg == "--reset") reset = true;
+        else if (arg == "--avoid-top-right") engine.settings.avoidTopRightCorner = true;
+        else if (arg == "--no-touch-unit") engine.settings.increaseUnitSizeForTouch = false;
+        else if (arg == "--max-increase" && i + 1 < argc) engine.settings.maxIncrease = atoi(argv[++i]);
+        else if (arg == "--min-displacement") engine.settings.cornerAssignment = CornerAssignment::minDisplacement;
+        else if (arg == "--only-occluded") engine.settings.arrangeOnlyWhenOccluded = true;
+        else if (arg == "--coverage") coverage = true;
+        else if (arg == "--repeat" && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+        else if (arg.starts_with("--")) return usage();
+        else files.push_back(arg);
+    }
+    if (files.empty()) return usage();
+    ofstream recordFile;
+    optional<SessionRecorder> recorder;
+    if (recordPath)
+    {
+        recordFile.open(recordPath, ios::binary | ios::trunc);
+        if (!recordFile)
+        {
+            cerr << recordPath << ": cannot create" << endl;
+            return 1;
+        }
+        recorder.emplace(recordFile);
+    }
+
+    for (size_t pass = 0; pass < files.size(); pass++)
+    {
+        ifstream file;
+        if (files[pass] != "-") file.open(string(files[pass]));
+        istream& in = files[pass] == "-" ? cin : file;
+        if (!in)
+        {
+            cerr << files[pass] << ": cannot open" << endl;
+            return 1;
+        }
+        string error;
+        auto desktop = readSnapshot(in, &error);
+        if (!desktop)
+        {
+            cerr << files[pass] << ": " << error << endl;
+            return 1;
+        }
+
+        if (repeat > 0)
+        {
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < repeat; i++)
+            {
+                LayoutEngine fresh;
+                fresh.settings = engine.settings;
+                fresh.arrange(*desktop, force);
+            }
+            chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+            cerr << files[pass] << ": " << desktop->windows.size() << " windows, "
+                 << elapsed.count() / repeat << " us/pass" << endl;
+        }
+
+        cout << "# pass " << pass + 1 << ' ' << files[pass] << '\n';
+        auto arrangeStart = chrono::steady_clock::now();
+        auto plan = engine.arrange(*desktop, force);
+        if (recorder) recorder->recordPass(*desktop, engine.settings, force, plan, chrono::steady_clock::now() - arrangeStart);
+        if (coverage) writeCoverage(cout, "before", engine.measureCoverage(*desktop));
+        if (!plan)
+        {
+            cout << (engine.lastPassScope().allReachable ? "# all reachable\n" : "# unchanged\n");
+            continue;
+        }
+        writePlan(cout, *plan);
+        if (coverage)
+        {
+            auto arranged = *desktop;
+            for (auto& move : *plan)
+                for (auto& w : arranged.windows)
+                    if (w.id == move.window) w.rect = move.rect;
+            writeCoverage(cout, "after", engine.measureCoverage(arranged));
+        }
+        RecordingMoveBackend backend;
+        for (auto& w : desktop->windows) backend.windows[w.id] = w.rect;
+        auto result = executeMovePlan(*plan, backend);
+        cout << "# committed " << result.committed << " skipped " << result.skipped << " batches " << result.batches << '\n';
+        if (reset)
+        {
+            cout << "# reset\n";
+            writePlan(cout, LayoutEngine::resetPlan(*plan, *desktop));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+// Replays a session recording through the layout engine, compares every plan with the recorded one
+// and reports the time of every step. The recording is memory-mapped where the platform allows it.
+#include "engine/metrics.h"
+#include "engine/recording.h"
+#include "engine/snapshotio.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/// <summary>
+/// Contents of a file, mapped read-only or read into memory
+/// </summary>
+class FileView
+{
+public:
+    explicit FileView(const char* path)
+    {
+#ifndef _WIN32
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                mapped = p;
+                bytes = { static_cast<const uint8_t*>(p), size_t(st.st_size) };
+            }
+        }
+        close(fd);
+        if (mapped) return;
+#endif
+        ifstream in(path, ios::binary);
+        if (!in) return;
+        buffer.assign(istreambuf_iterator<char>(in), {});
+        bytes = { reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size() };
+        opened = true;
+    }
+    ~FileView()
+    {
+#ifndef _WIN32
+        if (mapped) munmap(mapped, bytes.size());
+#endif
+    }
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    bool good() const { return mapped || opened; }
+    span<const uint8_t> data() const { return bytes; }
+
+private:
+    void* mapped = nullptr;
+    bool opened = false;
+    string buffer;
+    span<const uint8_t> bytes;
+};
+
+static bool sameMove(const WindowMove& a, const WindowMove& b)
+{
+    return a.window == b.window && a.monitor == b.monitor && int(a.corner) == int(b.corner) && a.index == b.index
+        && a.rect == b.rect && a.centered == b.centered;
+}
+
+/// <returns>moves which differ, including moves missing from either plan</returns>
+static size_t comparePlans(const optional<MovePlan>& recorded, const optional<MovePlan>& replayed, ostream& details)
+{
+    if (!recorded || !replayed)
+    {
+        if (recorded.has_value() != replayed.has_value())
+            details << "#   " << (recorded ? "recorded a plan, replay found the desktop unchanged" : "replay planned an unchanged desktop") << '\n';
+        return recorded.has_value() != replayed.has_value() ? (recorded ? recorded : replayed)->size() + 1 : 0;
+    }
+    size_t differing = 0;
+    size_t common = min(recorded->size(), replayed->size());
+    for (size_t i = 0; i < common; i++)
+        if (!sameMove((*recorded)[i], (*replayed)[i]))
+        {
+            differing++;
+            details << "#   recorded ";
+            writePlan(details, { (*recorded)[i] });
+            details << "#   replayed ";
+            writePlan(details, { (*replayed)[i] });
+        }
+    differing += max(recorded->size(), replayed->size()) - common;
+    if (recorded->size() != replayed->size())
+        details << "#   recorded " << recorded->size() << " moves, replayed " << replayed->size() << '\n';
+    return differing;
+}
+
+static void applyFeedback(LayoutEngine& engine, const RecordedFeedback& feedback)
+{
+    switch (feedback.kind)
+    {
+        using enum RecordedFeedback::Kind;
+    case unmovable: engine.markUnmovable(feedback.window); break;
+    case released: engine.releaseUnmovable(feedback.window); break;
+    case windowRect: engine.updateWindowRect(feedback.window, feedback.rect); break;
+    }
+}
+
+static int usage()
+{
+    cerr << "usage: lazyclicker_replay [--verbose] [--snapshot N] recording\n"
+            "prints one line per recorded pass (moves recorded/replayed, - when the desktop was unchanged)\n"
+            "and a summary; exits with 1 if a replayed plan differs\n"
+            "--verbose prints the differing moves\n"
+            "--snapshot N prints the desktop of pass N in the lazyclicker_plan format instead\n";
+    return 2;
+}
+
+int main(int argc, char* argv[])
+{
+    bool verbose = false;
+    int snapshot = 0;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        string_view arg = argv[i];
+        if (arg == "--verbose") verbose = true;
+        else if (arg == "--snapshot" && i + 1 < argc) snapshot = atoi(argv[++i]);
+        else if (arg.starts_with("--") || path) return usage();
+        else path = argv[i];
+    }
+    if (!path) return usage();
+
+    FileView file(path);
+    if (!file.good())
+    {
+        cerr << path << ": cannot open" << endl;
+        return 3;
+    }
+    RecordingReader reader(file.data());
+    LayoutEngine engine;
+    Histogram replayed, recorded;
+    int passes = 0;
+    int differingPasses = 0;
+    while (auto event = reader.next())
+    {
+        if (auto feedback = get_if<RecordedFeedback>(&*event))
+        {
+            applyFeedback(engine, *feedback);
+            continue;
+        }
+        auto& pass = get<RecordedPass>(*event);
+        passes++;
+        if (snapshot)
+        {
+            if (passes < snapshot) continue;
+            writeSnapshot(cout, pass.desktop);
+            return 0;
+        }
+
+        engine.settings = pass.settings;
+        auto start = chrono::steady_clock::now();
+        auto plan = engine.arrange(pass.desktop, pass.force);
+        chrono::nanoseconds elapsed = chrono::steady_clock::now() - start;
+        replayed.record(uint64_t(elapsed.count()));
+        recorded.record(uint64_t(chrono::duration_cast<chrono::nanoseconds>(pass.arrangeTime).count()));
+
+        ostringstream details;
+        auto differing = comparePlans(pass.plan, plan, details);
+        differingPasses += differing > 0;
+        cout << "pass " << passes << " +" << chrono::duration<double>(pass.sinceStart).count() << "s windows "
+             << pass.desktop.windows.size() << " monitors " << pass.desktop.topology->monitors.size() << (pass.force ? " forced" : "")
+             << " moves " << (pass.plan ? to_string(pass.plan->size()) : "-") << '/' << (plan ? to_string(plan->size()) : "-")
+             << " differing " << differing << " arrange_us " << elapsed.count() / 1000.0 << " recorded_us "
+             << chrono::duration<double, micro>(pass.arrangeTime).count() << '\n';
+        if (verbose) cout << details.str();
+    }
+    if (!reader.error().empty())
+    {
+        cerr << path << ": " << reader.error() << " at byte " << reader.offset() << endl;
+        return 3;
+    }
+    if (snapshot)
+    {
+        cerr << path << ": " << passes << " passes only" << endl;
+        return 1;
+    }
+    cout << "# " << passes << " passes, " << differingPasses << " differ; arrange us p50 " << replayed.percentile(50) / 1000.0
+         << " p99 " << replayed.percentile(99) / 1000.0 << " max " << replayed.maxValue() / 1000.0 << "; recorded us p50 "
+         << recorded.percentile(50) / 1000.0 << " p99 " << recorded.percentile(99) / 1000.0 << " max " << recorded.maxValue() / 1000.0
+         << endl;
+    return differingPasses ? 1 : 0;
+}
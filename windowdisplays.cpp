@@ -0,0 +1,99 @@
+#include "windowdisplays.h"
+#include <ShellScalingApi.h>
+#include <memory>
+
+using namespace std;
+
+static Rect toRect(const RECT& r) { return { r.left, r.top, r.right, r.bottom }; }
+
+static BOOL CALLBACK enumMonitorsProc(HMONITOR monitor, HDC__ const */*dc*/, RECT const */*pRect*/, vector<MonitorInfo>* monitors)
+{
+    monitors->emplace_back().id = bit_cast<MonitorId>(monitor);
+    return TRUE;
+}
+
+static vector<HMONITOR> touchMonitors()
+{
+    vector<HMONITOR> result;
+    UINT32 deviceCount = 0;
+    GetPointerDevices(&deviceCount, nullptr);
+    if (!deviceCount) return result;
+    auto pointerDevices = make_unique<POINTER_DEVICE_INFO[]>(deviceCount);
+    if (!GetPointerDevices(&deviceCount, pointerDevices.get())) return result;
+    for (auto i = 0U; i < deviceCount; i++) result.push_back(pointerDevices[i].monitor);
+    return result;
+}
+
+DisplayTopology Win32TopologyProvider::query()
+{
+    DisplayTopology topology;
+    EnumDisplayMonitors(nullptr, nullptr, MONITORENUMPROC(enumMonitorsProc), bit_cast<LPARAM>(&topology.monitors));
+    auto touch = touchMonitors();
+    for (auto& m : topology.monitors)
+    {
+        auto mon = bit_cast<HMONITOR>(m.id);
+        MONITORINFOEXA info {sizeof(MONITORINFOEXA)};
+        GetMonitorInfoA(mon, &info);
+        m.rect = toRect(info.rcMonitor);
+        m.workArea = toRect(info.rcWork);
+        m.name = info.szDevice;
+        UINT dpiX;
+        UINT dpiY;
+        if (SUCCEEDED(GetDpiForMonitor(mon, MDT_EFFECTIVE_DPI, &dpiX, &dpiY))) m.dpi = dpiY;
+        m.touchCapable = ranges::find(touch, mon) != touch.end();
+        if (info.dwFlags & MONITORINFOF_PRIMARY)
+        {
+            topology.primary = m.id;
+            topology.primaryDpi = m.dpi;
+        }
+    }
+    return topology;
+}
+
+bool Win32DisplayWatcher::start(Sink s)
+{
+    if (window) return true;
+    constexpr auto className = L"lazyclicker display watcher";
+    WNDCLASSEXW windowClass{ sizeof(WNDCLASSEXW) };
+    windowClass.lpfnWndProc = windowProc;
+    windowClass.hInstance = GetModuleHandleW(nullptr);
+    windowClass.lpszClassName = className;
+    if (!RegisterClassExW(&windowClass) && GetLastError() != ERROR_CLASS_ALREADY_EXISTS) return false;
+    // broadcasts do not reach message-only windows, so this one is top-level but never shown
+    window = CreateWindowExW(WS_EX_TOOLWINDOW, className, L"", WS_POPUP, 0, 0, 0, 0, nullptr, nullptr, windowClass.hInstance, this);
+    if (!window) return false;
+    RegisterPointerDeviceNotifications(window, FALSE);
+    sink = move(s);
+    return true;
+}
+
+void Win32DisplayWatcher::stop()
+{
+    if (window)
+    {
+        DestroyWindow(window);
+        window = nullptr;
+    }
+    sink = nullptr;
+}
+
+LRESULT CALLBACK Win32DisplayWatcher::windowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == WM_NCCREATE)
+        SetWindowLongPtrW(hwnd, GWLP_USERDATA, bit_cast<LONG_PTR>(bit_cast<CREATESTRUCTW*>(lParam)->lpCreateParams));
+    auto watcher = bit_cast<Win32DisplayWatcher*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    if (watcher && watcher->sink)
+    {
+        using enum DisplayChange;
+        switch (message)
+        {
+        case WM_DISPLAYCHANGE: watcher->sink(display); break;
+        case WM_DPICHANGED: watcher->sink(dpi); break;
+        case WM_SETTINGCHANGE: watcher->sink(settings); break; // work area, taskbar position
+        case WM_DEVICECHANGE:
+        case WM_POINTERDEVICECHANGE: watcher->sink(device); break;
+        case WM_THEMECHANGED: watcher->sink(theme); break;
+        }
+    }
+    return DefWindowProcW(hwnd, message, wParam, lParam);
+}
@@ -0,0 +1,37 @@
+#ifndef WINDOWDISPLAYS_H
+#define WINDOWDISPLAYS_H
+#include "engine/displaytopology.h"
+#include <Windows.h>
+#include <functional>
+
+/// <summary>
+/// Monitors through EnumDisplayMonitors, GetMonitorInfo and GetDpiForMonitor.
+/// Pointer devices are listed once per query, not once per monitor.
+/// </summary>
+class Win32TopologyProvider : public DisplayTopologyProvider
+{
+public:
+    DisplayTopology query() override;
+};
+
+/// <summary>
+/// Hidden top-level window receiving the broadcasts which change the display topology:
+/// WM_DISPLAYCHANGE, WM_DPICHANGED, WM_SETTINGCHANGE, WM_DEVICECHANGE and WM_POINTERDEVICECHANGE,
+/// and of WM_THEMECHANGED, which changes the theme sizes.
+/// Notifications are delivered on the thread that called start, which must run a message loop.
+/// </summary>
+class Win32DisplayWatcher
+{
+public:
+    using Sink = std::function<void(DisplayChange)>;
+    ~Win32DisplayWatcher() { stop(); }
+    bool start(Sink sink);
+    void stop();
+
+private:
+    static LRESULT CALLBACK windowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
+    HWND window = nullptr;
+    Sink sink;
+};
+
+#endif // WINDOWDISPLAYS_H
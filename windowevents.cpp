@@ -0,0 +1,64 @@
+#include "windowevents.h"
+
+using namespace std;
+
+Win32EventSource* Win32EventSource::instance = nullptr;
+
+bool Win32EventSource::start(Sink s)
+{
+    if (instance) return false; // win event callbacks carry no context, allow a single subscriber
+    sink = move(s);
+    instance = this;
+    constexpr DWORD flags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+    hooks[0] = SetWinEventHook(EVENT_SYSTEM_MOVESIZESTART, EVENT_SYSTEM_MINIMIZEEND, nullptr, winEventProc, 0, 0, flags);
+    hooks[1] = SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_HIDE, nullptr, winEventProc, 0, 0, flags);
+    hooks[2] = SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_PARENTCHANGE, nullptr, winEventProc, 0, 0, flags);
+    hooks[3] = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, winEventProc, 0, 0, flags);
+    for (auto hook : hooks)
+        if (!hook)
+        {
+            stop();
+            return false;
+        }
+    return true;
+}
+
+void Win32EventSource::stop()
+{
+    for (auto& hook : hooks)
+        if (hook)
+        {
+            UnhookWinEvent(hook);
+            hook = nullptr;
+        }
+    if (instance == this) instance = nullptr;
+    sink = nullptr;
+}
+
+void CALLBACK Win32EventSource::winEventProc(HWINEVENTHOOK /*hook*/, DWORD event, HWND hwnd, LONG idObject, LONG idChild,
+                                             DWORD /*idEventThread*/, DWORD /*dwmsEventTime*/)
+{
+    // only whole top-level windows, not carets, scrollbars or child controls
+    if (!instance || !instance->sink || !hwnd || idObject != OBJID_WINDOW || idChild != CHILDID_SELF) return;
+    if (event != EVENT_OBJECT_DESTROY && GetAncestor(hwnd, GA_ROOT) != hwnd) return;
+
+    using enum WindowEventKind;
+    WindowEventKind kind;
+    switch (event)
+    {
+    case EVENT_OBJECT_CREATE: kind = created; break;
+    case EVENT_OBJECT_DESTROY: kind = destroyed; break;
+    case EVENT_OBJECT_SHOW: kind = shown; break;
+    case EVENT_OBJECT_HIDE: kind = hidden; break;
+    case EVENT_OBJECT_LOCATIONCHANGE: kind = locationChanged; break;
+    case EVENT_SYSTEM_MOVESIZESTART: kind = moveSizeStart; break;
+    case EVENT_SYSTEM_MOVESIZEEND: kind = moveSizeEnd; break;
+    case EVENT_SYSTEM_MINIMIZESTART: kind = minimized; break;
+    case EVENT_SYSTEM_MINIMIZEEND: kind = restored; break;
+    case EVENT_OBJECT_NAMECHANGE: kind = nameChanged; break;
+    case EVENT_OBJECT_PARENTCHANGE: kind = ownerChanged; break;
+    case EVENT_SYSTEM_FOREGROUND: kind = raised; break;
+    default: return;
+    }
+    instance->sink({ kind, bit_cast<WindowId>(hwnd) }, SteadyClock::now());
+}
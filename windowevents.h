@@ -0,0 +1,26 @@
+#ifndef WINDOWEVENTS_H
+#define WINDOWEVENTS_H
+#include "engine/eventcoalescer.h"
+#include <Windows.h>
+#include <array>
+
+/// <summary>
+/// Window notifications from SetWinEventHook, delivered on the thread that called start,
+/// which must run a message loop
+/// </summary>
+class Win32EventSource : public WindowEventSource
+{
+public:
+    ~Win32EventSource() override { stop(); }
+    bool start(Sink sink) override;
+    void stop() override;
+
+private:
+    static void CALLBACK winEventProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd, LONG idObject, LONG idChild,
+                                      DWORD idEventThread, DWORD dwmsEventTime);
+    static Win32EventSource* instance;
+    std::array<HWINEVENTHOOK, 4> hooks{};
+    Sink sink;
+};
+
+#endif // WINDOWEVENTS_H
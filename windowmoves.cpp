@@ -0,0 +1,214 @@
+#include "windowmoves.h"
+#include <Windows.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+static HWND toHWND(WindowId w) { return bit_cast<HWND>(w); }
+
+/// <summary>
+/// Batch waiting for the transaction thread, a newer batch replaces it
+/// </summary>
+struct Win32MoveBackend::Transactions
+{
+    mutex lock;
+    condition_variable wake;
+    optional<vector<WindowMove>> waiting;
+    optional<SteadyClock::time_point> committingSince;
+    bool started = false;
+};
+
+Win32MoveBackend::Win32MoveBackend() : transactions(make_shared<Transactions>()) {}
+
+/// <summary>
+/// Tells which windows belong to threads that answer at once. A transaction waits for every window in it,
+/// so windows of slow threads are left out of it.
+/// </summary>
+class ThreadProbe
+{
+public:
+    bool answers(HWND w)
+    {
+        auto [it, first] = answered.try_emplace(GetWindowThreadProcessId(w, nullptr), false);
+        // threads not probed by the deadline count as slow
+        if (first && SteadyClock::now() - start < deadline)
+            it->second = SendMessageTimeoutW(w, WM_NULL, 0, 0, SMTO_ABORTIFHUNG | SMTO_ERRORONEXIT, timeout, nullptr) != 0;
+        return it->second;
+    }
+
+private:
+    static constexpr UINT timeout = 50; // ms per thread
+    static constexpr auto deadline = chrono::milliseconds(200); // for all threads
+    SteadyClock::time_point start = SteadyClock::now();
+    unordered_map<DWORD, bool> answered;
+};
+
+optional<Rect> Win32MoveBackend::currentRect(WindowId w)
+{
+    if (RECT r; GetWindowRect(toHWND(w), &r)) return Rect{ r.left, r.top, r.right, r.bottom };
+    return nullopt;
+}
+
+static bool commitBatch(const vector<WindowMove>& moves)
+{
+    HDWP hdwp = BeginDeferWindowPos(int(moves.size()));
+    for (auto const& move : moves)
+    {
+        if (!hdwp) return false;
+        auto const& r = move.rect;
+        hdwp = DeferWindowPos(hdwp, toHWND(move.window), nullptr, r.left, r.top, r.width(), r.height(),
+                              SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE);
+    }
+    return hdwp && EndDeferWindowPos(hdwp);
+}
+
+bool Win32MoveBackend::moveBatch(const vector<WindowMove>& moves)
+{
+    return commitBatch(moves);
+}
+
+bool Win32MoveBackend::moveWindow(const WindowMove& move)
+{
+    auto const& r = move.rect;
+    return MoveWindow(toHWND(move.window), r.left, r.top, r.width(), r.height(), TRUE);
+}
+
+bool Win32MoveBackend::isHung(WindowId w)
+{
+    return IsHungAppWindow(toHWND(w));
+}
+
+static bool postWindowPos(const WindowMove& move)
+{
+    // windows of other threads receive the request in their queue instead of a blocking message
+    auto const& r = move.rect;
+    return SetWindowPos(toHWND(move.window), nullptr, r.left, r.top, r.width(), r.height(),
+                        SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE | SWP_ASYNCWINDOWPOS);
+}
+
+bool Win32MoveBackend::postMove(const WindowMove& move)
+{
+    return postWindowPos(move);
+}
+
+/// <summary>
+/// Commit the windows whose threads answer at once in one transaction and post the others one by one,
+/// so a slow application holds up neither the transaction nor the windows of other applications
+/// </summary>
+static void commitPosted(const vector<WindowMove>& moves)
+{
+    ThreadProbe probe;
+    vector<WindowMove> batch;
+    for (auto const& move : moves)
+        if (probe.answers(toHWND(move.window))) batch.push_back(move);
+        else postWindowPos(move);
+    if (batch.size() < 2 || !commitBatch(batch))
+        for (auto const& move : batch) postWindowPos(move);
+}
+
+bool Win32MoveBackend::postBatch(const vector<WindowMove>& moves)
+{
+    // a thread which answered the probe and stopped right after holds up the transaction; until it is
+    // back, the moves are posted one by one
+    constexpr auto stuckAfter = chrono::seconds(1);
+    auto t = transactions;
+    {
+        lock_guard guard(t->lock);
+        if (t->committingSince && SteadyClock::now() - *t->committingSince >= stuckAfter) return false;
+        t->waiting = moves;
+        if (!t->started)
+        {
+            t->started = true;
+            // detached, a transaction stuck on a window must not hold up the exit
+            thread([t]
+            {
+                unique_lock guard(t->lock);
+                while (true)
+                {
+                    t->wake.wait(guard, [&] { return t->waiting.has_value(); });
+                    auto batch = move(*t->waiting);
+                    t->waiting.reset();
+                    t->committingSince = SteadyClock::now();
+                    guard.unlock();
+                    commitPosted(batch);
+                    guard.lock();
+                    t->committingSince.reset();
+                }
+            }).detach();
+        }
+    }
+    t->wake.notify_one();
+    return true;
+}
+
+vector<WindowId> Win32ShowBackend::zOrder()
+{
+    // EnumWindows walks the top-level windows from the top of the stack down
+    vector<WindowId> windows;
+    EnumWindows([](HWND w, LPARAM p) -> BOOL
+    {
+        reinterpret_cast<vector<WindowId>*>(p)->push_back(bit_cast<WindowId>(w));
+        return TRUE;
+    }, reinterpret_cast<LPARAM>(&windows));
+    return windows;
+}
+
+WindowId Win32ShowBackend::foreground()
+{
+    return bit_cast<WindowId>(GetForegroundWindow());
+}
+
+optional<bool> Win32ShowBackend::minimized(WindowId w)
+{
+    if (!IsWindow(toHWND(w))) return nullopt;
+    return bool(IsIconic(toHWND(w)));
+}
+
+bool Win32ShowBackend::isHung(WindowId w)
+{
+    return IsHungAppWindow(toHWND(w));
+}
+
+bool Win32ShowBackend::postShow(WindowId w, bool minimize)
+{
+    // neither variant activates the window, so the foreground does not wander while the windows come and go
+    return ShowWindowAsync(toHWND(w), minimize ? SW_SHOWMINNOACTIVE : SW_SHOWNOACTIVATE);
+}
+
+bool Win32ShowBackend::stack(const vector<WindowId>& windows)
+{
+    // the transaction waits for the windows in it, so it runs on a thread of its own
+    thread([windows]
+    {
+        constexpr UINT flags = SWP_NOMOVE | SWP_NOSIZE | SWP_NOOWNERZORDER | SWP_NOACTIVATE;
+        ThreadProbe probe;
+        vector<bool> answers;
+        for (auto w : windows) answers.push_back(probe.answers(toHWND(w)));
+        HDWP hdwp = BeginDeferWindowPos(int(windows.size()));
+        HWND after = HWND_TOP;
+        for (size_t i = 0; i < windows.size() && hdwp; i++)
+            if (answers[i])
+            {
+                hdwp = DeferWindowPos(hdwp, toHWND(windows[i]), after, 0, 0, 0, 0, flags);
+                after = toHWND(windows[i]);
+            }
+        bool committed = hdwp && EndDeferWindowPos(hdwp);
+        // the other windows take their places below their predecessors whenever their threads get to it
+        after = HWND_TOP;
+        for (size_t i = 0; i < windows.size(); i++)
+        {
+            if (!answers[i] || !committed) SetWindowPos(toHWND(windows[i]), after, 0, 0, 0, 0, flags | SWP_ASYNCWINDOWPOS);
+            after = toHWND(windows[i]);
+        }
+    }).detach();
+    return true;
+}
+
+bool Win32ShowBackend::activate(WindowId w)
+{
+    // allowed because the toggle follows a click on the tray icon, which gives the foreground to this process
+    return SetForegroundWindow(toHWND(w));
+}
@@ -0,0 +1,45 @@
+#ifndef WINDOWMOVES_H
+#define WINDOWMOVES_H
+#include "engine/bulkminimize.h"
+#include "engine/moveexecutor.h"
+#include <memory>
+
+/// <summary>
+/// Moves top-level windows with DeferWindowPos transactions, MoveWindow one by one,
+/// or asynchronously with SetWindowPos. Posted transactions are committed on a thread of their own.
+/// </summary>
+class Win32MoveBackend : public WindowMoveBackend
+{
+public:
+    Win32MoveBackend();
+
+    std::optional<Rect> currentRect(WindowId w) override;
+    bool moveBatch(const std::vector<WindowMove>& moves) override;
+    bool moveWindow(const WindowMove& move) override;
+    bool isHung(WindowId w) override;
+    bool postMove(const WindowMove& move) override;
+    bool postBatch(const std::vector<WindowMove>& moves) override;
+
+private:
+    struct Transactions;
+    /// shared with the transaction thread, which outlives the backend when a window holds it up at exit
+    std::shared_ptr<Transactions> transactions;
+};
+
+/// <summary>
+/// Minimizes and restores top-level windows with ShowWindowAsync, which only queues the request for the thread
+/// of the window, and stacks them with one DeferWindowPos transaction on a thread of its own
+/// </summary>
+class Win32ShowBackend : public WindowShowBackend
+{
+public:
+    std::vector<WindowId> zOrder() override;
+    WindowId foreground() override;
+    std::optional<bool> minimized(WindowId w) override;
+    bool isHung(WindowId w) override;
+    bool postShow(WindowId w, bool minimize) override;
+    bool stack(const std::vector<WindowId>& windows) override;
+    bool activate(WindowId w) override;
+};
+
+#endif // WINDOWMOVES_H
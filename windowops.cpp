@@ -1,643 +1,638 @@
 #include "windowops.h"
-#include <map>
+#include "engine/animator.h"
+#include "engine/arrangequeue.h"
+#include "engine/fingerprint.h"
+#include "engine/layout.h"
+#include "engine/logger.h"
+#include "engine/metrics.h"
+#include "engine/recording.h"
+#include "engine/settingsstore.h"
+#include "engine/snapshotio.h"
+#include "engine/verdictcache.h"
+#include "engine/windowfilter.h"
+#include "windowdisplays.h"
+#include "windowevents.h"
+#include "windowmoves.h"
+#include "windowprocesses.h"
+#include "windowqueries.h"
 #include <vector>
-#include <set>
-#include <Psapi.h>
 #include <Uxtheme.h>
 #include <ShellScalingApi.h>
+#include <algorithm>
 #include <array>
-#include <list>
-#include <queue>
-#include <cassert>
+#include <fstream>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 
-int windowops_maxIncrease = 0;
-bool avoidTopRightCorner = false;
-bool increaseUnitSizeForTouch = true;
+static LayoutEngine layoutEngine;
+static AtomicLayoutSettings currentSettings;
+static Win32EventSource eventSource;
+static Win32MoveBackend moveBackend;
+static SystemClock systemClock;
+static MoveDispatcher moveDispatcher(moveBackend, systemClock);
+static MoveAnimator moveAnimator(moveBackend, systemClock);
+static Win32ShowBackend showBackend;
+static BulkMinimizer bulkMinimizer(showBackend, systemClock);
+static Win32TopologyProvider topologyProvider;
+static TopologyCache topologyCache(topologyProvider);
+static Win32DisplayWatcher displayWatcher;
+static Win32ProcessResolver processResolver;
+static ProcessCache processCache(processResolver);
+static VerdictCache verdictCache;
+static shared_ptr<const WindowFilter> passFilter; ///< rules the cached verdicts were made with
+static Win32WindowQueries windowQueries;
+// a few threads suffice, the queries mostly wait for other processes
+static WorkerPool gatherPool((std::min)(3u, (std::max)(1u, thread::hardware_concurrency()) - 1));
+static ArrangeCoalescer coalescer;
+static MetricsCollector metrics;
+static UINT_PTR coalescerTimer = 0;
+static UINT_PTR checkTimer = 0;
+static AdaptiveInterval checkInterval;
+static atomic<Duration::rep> checkPeriod = checkInterval.current().count(); ///< published for the check timer
+static optional<uint64_t> lastFingerprint; ///< of the desktop after the last full pass
+static atomic<bool> eventSourceRunning = false;
+static atomic<bool> displayWatcherRunning = false;
+static optional<ThemeSizes> themeSizes;
+static bool themeSizesStale = true;
+static bool autoArrange = false;
+// everything above except the watchers, the coalescer and the queue belongs to the arranger thread
+static ArrangeQueue arrangeQueue;
+static atomic<HWND> notifyWindow = nullptr;
+static atomic<UINT> notifyMessage = 0;
+static mutex windowFilterMutex;
+static shared_ptr<const WindowFilter> windowFilter = make_shared<const WindowFilter>(*WindowFilter::parse(WindowFilter::defaultRules));
+static ofstream recordingFile;
+static optional<SessionRecorder> recorder;
+static unique_ptr<ArrangeWorker> arranger; ///< last, so it stops before the state it uses goes away
+
+static WindowId toId(HWND w) { return bit_cast<WindowId>(w); }
+static HWND toHWND(WindowId w) { return bit_cast<HWND>(w); }
+
+// VISITOR PROCEDURES AND OTHER PROGRAM LOGIC
+
+static BOOL CALLBACK enumWindowsProc(HWND hWnd, vector<WindowId>* pHandles)
+{
+    // only collect the handles, the queries run in parallel afterwards
+    pHandles->push_back(toId(hWnd));
+    return TRUE;
+}
+
+static BOOL CALLBACK fingerprintWindowsProc(HWND hWnd, vector<WindowState>* pStates)
+{
+    auto visibility = uint32_t(GetWindowLong(hWnd, GWL_STYLE)) & (WS_VISIBLE | WS_MINIMIZE);
+    RECT r{};
+    if (visibility == WS_VISIBLE) GetWindowRect(hWnd, &r);
+    pStates->push_back({ toId(hWnd), { r.left, r.top, r.right, r.bottom }, visibility });
+    return TRUE;
+}
 
 /// <summary>
-/// enum class wrapper
+/// Hash of the handle, rect and visibility of every top-level window, a fraction of the cost of a snapshot.
+/// With arrangeOnlyWhenOccluded the stacking order counts as well, since raising a window may hide another.
 /// </summary>
-/// <typeparam name="E">enum class</typeparam>
-/// <typeparam name="I">underlying int</typeparam>
-template<typename Enum>struct flags {
-    using Int = typename std::underlying_type_t<Enum>;
-    Int value;
-    flags() = default;
-    explicit(false) flags(Enum x) : value(Int(x)) {}
-    auto operator=(Enum x) { value = Int(x); return *this; }
-    auto operator=(Int x) { value = x; return *this; }
-    explicit(false) operator Int() const { return value; }
-    explicit operator Enum() const { return Enum(value); }
-    friend Int operator&(flags f, Enum x) { return f.value & Int(x); }
-    friend Int operator^(flags f, Enum x) { return f.value ^ Int(x); }
-    friend bool operator==(flags f, Enum x) { return f.value == Int(x); }
-    flags& operator|=(Enum x) { value |= Int(x); return *this; }
-};
-
-enum class Corner : int { top = 0, left = 0, topleft = top | left, right = 1, topright = top | right,
-                          bottom = 2, bottomleft = bottom | left, bottomright = bottom | right };
-
-struct Rect : public RECT
-{
-    constexpr long width() const { return right - left; }
-    constexpr long height() const { return bottom - top; }
-    constexpr size_t area() const { return (bottom - top) * (right - left); }
-
-    size_t diameter() const
-    {
-        auto width = right - left;
-        auto height = bottom - top;
-        return size_t(sqrt(width * width + height * height));
-    }
+static uint64_t takeFingerprint()
+{
+    static vector<WindowState> states;
+    states.clear();
+    EnumWindows(WNDENUMPROC(fingerprintWindowsProc), bit_cast<LPARAM>(&states));
+    auto fingerprint = desktopFingerprint(states);
+    if (layoutEngine.settings.arrangeOnlyWhenOccluded) fingerprint ^= stackingFingerprint(states);
+    return fingerprint;
+}
 
-    constexpr bool isDifferentSize(const RECT& r2) const
+static optional<ThemeSizes> loadThemeData(HWND w)
+{
+    if (HTHEME theme = OpenThemeData(w, L"WINDOW"))
     {
-        auto w1 = right - left;
-        auto w2 = r2.right - r2.left;
-        auto h1 = bottom - top;
-        auto h2 = r2.bottom - r2.top;
-        bool result = (w1 != w2) || (h1 != h2);
+        ThemeSizes result{ GetThemeSysSize(theme, SM_CYSIZE), GetThemeSysSize(theme, SM_CXPADDEDBORDER) };
+        CloseThemeData(theme);
         return result;
     }
+    return nullopt;
+}
 
-    void moveInside(const Rect& monRect)
-    {
-        int maxw = monRect.right - monRect.left;
-        int maxh = monRect.bottom - monRect.top;
-        right -= max(0L, right - left - maxw);
-        bottom -= max(0L, bottom - top - maxh);
-        left -= max(0L, right - monRect.right);
-        top -= max(0L, bottom - monRect.bottom);
-    }
+static void displayMovedWindowDetails(const WindowMove& move, const DesktopSnapshot& desktop)
+{
+    if (!logger().enabled(LogLevel::debug)) return;
+    auto const& wrect = move.rect;
+    auto const& monitor = *desktop.findMonitor(move.monitor);
+    auto const& mrect = monitor.workArea;
+    logger().debug("Moved window {} [{}] ({}@{}:{}); dx={}, dy={}; relative: {}:{}:{}:{}",
+                   toHWND(move.window), desktop.findWindow(move.window)->processName, monitor.name, cornerName(move.corner),
+                   move.index, move.dx / move.unitSize, move.dy / move.unitSize,
+                   wrect.left - mrect.left, wrect.top - mrect.top, wrect.right - mrect.right, wrect.bottom - mrect.bottom);
+}
 
-    int distanceFromCorner(const Rect &mrect, flags<Corner> c) const
+static void displayMonitorsAndWindows(const DesktopSnapshot& desktop)
+{
+    // the window details cost extra system calls, skip them unless they are logged
+    if (!logger().enabled(LogLevel::debug)) return;
+    logger().debug("Monitors:");
+    for (auto const& m : desktop.topology->monitors)
     {
-        POINT mcorner = {};
-        POINT wcorner = {};
-        bool isRight = c & Corner::right;
-        mcorner.x = isRight ? mrect.right : mrect.left;
-        wcorner.x = isRight ? right : left;
-        bool isBottom = c & Corner::bottom;
-        mcorner.y = isBottom ? mrect.bottom : mrect.top;
-        wcorner.y = isBottom ? bottom : top;
-        int distX = wcorner.x - mcorner.x;
-        int distY = wcorner.y - mcorner.y;
-        return int(sqrt(distX * distX + distY * distY));
+        auto const& rect = m.workArea;
+        logger().debug("{}: {}:{}:{}:{}({}x{})", m.name, rect.left, rect.top, rect.right, rect.bottom, rect.width(), rect.height());
     }
 
-    friend bool operator!=(const RECT& self, const RECT& other)
+    logger().debug("Windows:");
+    for (auto const& w : desktop.windows)
     {
-        return self.left != other.left || self.right != other.right || self.top != other.top || self.bottom != other.bottom;
+        auto const& rect = w.rect;
+        HWND hwnd = toHWND(w.id);
+        logger().debug("{}: {}({}):{}:{}:{}:{} dpiAwareness={}, style={}", hwnd, w.title, w.processName,
+                       rect.left, rect.top, rect.right, rect.bottom,
+                       int(GetAwarenessFromDpiAwarenessContext(GetWindowDpiAwarenessContext(hwnd))),
+                       LogHex{ uint32_t(GetWindowLong(hwnd, GWL_EXSTYLE)) });
     }
+}
 
-    constexpr explicit(false) Rect(const RECT& other) : RECT(other) {}
-    Rect() = default;
-};
-
-map<HMONITOR, string> monitorNames;
-map<HWND, pair<string, string>> windowTitles;
-map<HWND, tuple<HMONITOR, Corner, Rect>> oldWindowMonitor; /// previous windows placement for tracking changes
-set<HWND> unmovableWindows;
+static void scheduleCoalescerTimer();
 
-// WINDOWS UTILITY FUNCTIONS
+static void onWindowEvent(const WindowEvent& event, TimePoint now)
+{
+    arrangeQueue.postEvent(event);
+    if (!autoArrange) return;
+    coalescer.onEvent(event, now);
+    scheduleCoalescerTimer();
+}
 
-static string GetProcessNameFromHWND(HWND hwnd)
+static bool startEventSource()
 {
-    DWORD processId;
-    GetWindowThreadProcessId(hwnd, &processId);
+    if (!eventSourceRunning) eventSourceRunning = eventSource.start(onWindowEvent);
+    return eventSourceRunning;
+}
 
-    if (HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId); hProcess)
-    {
-        if (array<char, MAX_PATH> processName{ "<unknown>" }; GetModuleBaseNameA(hProcess, nullptr, processName.data(), sizeof(processName)))
-            return processName.data();
+static void onDisplayChange(DisplayChange reason)
+{
+    if (reason != DisplayChange::theme) topologyCache.invalidate(reason);
+    // the arranger drops its theme metrics when it takes the event
+    arrangeQueue.postEvent({ WindowEventKind::displayChanged });
+    if (!autoArrange) return;
+    coalescer.onEvent({ WindowEventKind::displayChanged }, SteadyClock::now());
+    scheduleCoalescerTimer();
+}
 
-        CloseHandle(hProcess);
-    }
-    return "";
+static bool startDisplayWatcher()
+{
+    if (!displayWatcherRunning) displayWatcherRunning = displayWatcher.start(onDisplayChange);
+    return displayWatcherRunning;
 }
 
-// https://stackoverflow.com/questions/7277366/why-does-enumwindows-return-more-windows-than-i-expected
-static BOOL IsAltTabWindow(HWND hwnd)
+static DesktopSnapshot takeDesktopSnapshot()
 {
-    if (!hwnd) return FALSE;
-    if(!IsWindowVisible(hwnd)) return FALSE;
+    DesktopSnapshot desktop;
+    // without display notifications nothing tells when the topology becomes stale
+    if (!displayWatcherRunning) topologyCache.invalidate(DisplayChange::display);
+    desktop.topology = topologyCache.current();
 
-    HWND hwndWalk = nullptr;
-    HWND hwndTry = GetAncestor(hwnd, GA_ROOTOWNER);
-    while(hwndTry != hwndWalk)
+    processCache.beginPass();
+    shared_ptr<const WindowFilter> filter;
     {
-        hwndWalk = hwndTry;
-        hwndTry = GetLastActivePopup(hwndWalk);
-        if(IsWindowVisible(hwndTry)) break;
+        lock_guard lock(windowFilterMutex);
+        filter = windowFilter;
     }
-    if(hwndWalk != hwnd) return FALSE;
-
-    // the following removes some task tray programs and "Program Manager"
-    TITLEBARINFO ti {sizeof(TITLEBARINFO)};
-    GetTitleBarInfo(hwnd, &ti);
-    if(ti.rgstate[0] & STATE_SYSTEM_INVISIBLE) return FALSE;
-
-    // Tool windows should not be displayed either, these do not appear in the
-    // task bar.
-    if(GetWindowLong(hwnd, GWL_EXSTYLE) & WS_EX_TOOLWINDOW) return FALSE;
-
-    return TRUE;
+    if (filter != passFilter) verdictCache.invalidateAll();
+    passFilter = filter;
+    // without window events nothing tells when a verdict becomes stale
+    if (!eventSourceRunning) verdictCache.invalidateAll();
+    verdictCache.beginPass();
+    auto start = SteadyClock::now();
+    vector<WindowId> handles;
+    EnumWindows(WNDENUMPROC(enumWindowsProc), bit_cast<LPARAM>(&handles));
+    auto gathered = gatherWindows(handles, windowQueries, *filter, verdictCache, processCache, gatherPool);
+    desktop.windows = move(gathered.windows);
+    // windows still gliding count as arrived, so the layout does not take them for moved by the user
+    if (moveAnimator.active())
+        for (auto& w : desktop.windows)
+            if (auto target = moveAnimator.target(w.id)) w.rect = *target;
+    metrics.record(Timer::enumerate, SteadyClock::now() - start);
+    if (gathered.classified) metrics.record(Timer::classify, gathered.classifyTime);
+    metrics.add(Counter::windowsEnumerated, desktop.windows.size());
+    for (auto n : gathered.filtered) metrics.add(Counter::windowsFiltered, n);
+    verdictCache.endPass();
+    if (themeSizesStale && desktop.windows.size())
+    {
+        themeSizes = loadThemeData(toHWND(desktop.windows.front().id));
+        themeSizesStale = !themeSizes || !displayWatcherRunning;
+    }
+    desktop.theme = themeSizes;
+    POINT cursorPos;
+    GetCursorPos(&cursorPos);
+    desktop.cursor = { cursorPos.x, cursorPos.y };
+    return desktop;
 }
 
-// VISITOR PROCEDURES AND OTHER PROGRAM LOGIC
-
-static BOOL CALLBACK enumWindowsProc(HWND hWnd, map<HWND, Rect>* pWindows)
+/// <summary>
+/// Outcomes of moves reach the engine through here, so a recording can replay them
+/// </summary>
+static void feedBack(const RecordedFeedback& feedback)
 {
-    auto &windows = *pWindows;
-    if(!IsAltTabWindow(hWnd)) return TRUE;
-
-    int length = GetWindowTextLength(hWnd);
-    if(!length) return TRUE;
-    auto buffer = make_unique<char[]>(length + 1);
-    GetWindowTextA(hWnd, buffer.get(), length + 1);
-
-    Rect &rect = windows[hWnd];
-    GetWindowRect(hWnd, &rect);
-    if (string processName = GetProcessNameFromHWND(hWnd); processName == "ApplicationFrameHost.exe" || IsIconic(hWnd))
+    switch (feedback.kind)
     {
-        windows.erase(hWnd);
-        windowTitles.erase(hWnd);
+    case RecordedFeedback::Kind::unmovable: layoutEngine.markUnmovable(feedback.window); break;
+    case RecordedFeedback::Kind::released: layoutEngine.releaseUnmovable(feedback.window); break;
+    case RecordedFeedback::Kind::windowRect: layoutEngine.updateWindowRect(feedback.window, feedback.rect); break;
     }
-    else windowTitles[hWnd] = {processName, buffer.get()};
-
-    return TRUE;
+    if (recorder) recorder->recordFeedback(feedback);
 }
 
-static BOOL CALLBACK enumMonitorsProc(HMONITOR monitor, HDC__ const */*dc*/, RECT const *pRect, map<HMONITOR, RECT>* monitorRects)
+/// refresh period of the primary display, which paces the animation frames
+static Duration refreshInterval()
 {
-    (*monitorRects)[monitor] = *pRect;
-    return TRUE;
+    DEVMODEW mode{};
+    mode.dmSize = sizeof(mode);
+    if (EnumDisplaySettingsW(nullptr, ENUM_CURRENT_SETTINGS, &mode) && mode.dmDisplayFrequency > 1)
+        return chrono::duration_cast<Duration>(chrono::duration<double>(1.0 / mode.dmDisplayFrequency));
+    return MoveAnimator::Options().frameInterval;
 }
 
-static void resetAllWindowPositions(
-    const map<HMONITOR, map<flags<Corner>, multimap<size_t, HWND>>>& windowsOrderInCorners,
-    const map<HMONITOR, Rect> &monitorRects,
-    map<HWND, Rect> &windowRects)
+/// <summary>
+/// Let the windows glide to their targets until they arrive or new work is queued, which retargets them.
+/// Hung and quarantined windows go to the dispatcher, which does not wait for them.
+/// </summary>
+static MoveResult animateMovePlan(const MovePlan& plan)
 {
-    for(auto &[mon, mcvw]: windowsOrderInCorners)
+    MovePlan animated;
+    MovePlan dispatched;
+    vector<size_t> animatedIndex;
+    vector<size_t> dispatchedIndex;
+    auto now = SteadyClock::now();
+    for (size_t i = 0; i < plan.size(); i++)
     {
-        auto &mrect = monitorRects.at(mon);
-        for(auto &[corner, windows]: mcvw)
-            for(auto& [s, w] : windows)
-            {
-                auto const &wrect = windowRects.at(w);
-                MoveWindow(w, mrect.left, mrect.top, wrect.right - wrect.left, wrect.bottom - wrect.top, TRUE);
-            }
+        bool slow = moveDispatcher.quarantined(plan[i].window, now) || moveBackend.isHung(plan[i].window);
+        (slow ? dispatched : animated).push_back(plan[i]);
+        (slow ? dispatchedIndex : animatedIndex).push_back(i);
     }
-}
-
-static bool loadThemeData(HWND w, double sf0, double sf, int& unitSize, int& borderWidth, int& borderHeight)
-{
-    if (HTHEME theme = OpenThemeData(w, L"WINDOW"))
+    if (!moveAnimator.active())
     {
-        unitSize = int((GetThemeSysSize(theme, SM_CYSIZE) + GetThemeSysSize(theme, SM_CXPADDEDBORDER) * 2) * sf / sf0);
-        borderWidth = int(GetThemeSysSize(theme, SM_CXPADDEDBORDER) * sf / 100);
-        borderHeight = int(borderWidth * 100 / sf);
-        CloseThemeData(theme);
-        return true;
+        auto options = moveAnimator.currentOptions();
+        options.frameInterval = refreshInterval();
+        moveAnimator.setOptions(options);
     }
-    return false;
-}
 
-static void displayMovedWindowDetails(HWND w, HMONITOR mon, flags<Corner> corner, 
-                                      tuple<int, int, long, long> params, const pair<Rect, Rect>& rects)
-{
-    auto& [wrect, mrect] = rects;
-    auto const &[i, unitSize, dx1, dy] = params;
-    array<const char*, 4> cornerNames{ "topleft", "topright", "bottomleft", "bottomright" };
-    cout << "Moved window " << w << " [" << windowTitles[w].first << "] " << '(' << monitorNames[mon] << '@';
-    cout << cornerNames[int(corner)] << ':' << i << ')';
-    cout << "; dx=" << dx1 / unitSize << ", dy=" << dy / unitSize;
-    cout << "; relative: " << wrect.left - mrect.left << ':';
-    cout << wrect.top - mrect.top << ':' << wrect.right - mrect.right << ':' << wrect.bottom - mrect.bottom << endl;
+    MoveResult result;
+    result.status.resize(plan.size(), MoveStatus::skipped);
+    auto merge = [&](const MoveResult& part, const vector<size_t>& index)
+    {
+        for (size_t j = 0; j < index.size(); j++) result.status[index[j]] = part.status[j];
+        result.skipped += part.skipped;
+        result.committed += part.committed;
+        result.failed += part.failed;
+        result.deferred += part.deferred;
+        result.batches += part.batches;
+        result.fallbacks += part.fallbacks;
+    };
+    if (!dispatched.empty()) merge(moveDispatcher.execute(dispatched), dispatchedIndex);
+    merge(moveAnimator.start(animated), animatedIndex);
+    return result;
 }
 
-static bool isMonitorTouchCapable(HMONITOR__ const* mon)
+/// <summary>
+/// Commit animation frames until the windows arrived or new work is queued
+/// </summary>
+static void runAnimation()
 {
-    UINT32 deviceCount = 0;
-    GetPointerDevices(&deviceCount, nullptr);
-    if (!deviceCount) return false;
-    auto pointerDevices = make_unique<POINTER_DEVICE_INFO[]>(deviceCount);
-    if (!GetPointerDevices(&deviceCount, pointerDevices.get())) return false;
-    for (auto i = 0U; i < deviceCount; i++) if (pointerDevices[i].monitor == mon) return true;
-    return false;
+    auto before = moveAnimator.stats();
+    moveAnimator.run([] { return arrangeQueue.size() > 0; });
+    metrics.add(Counter::animationFrames, moveAnimator.stats().frames - before.frames);
+    metrics.add(Counter::animationJumps, moveAnimator.stats().jumps - before.jumps);
 }
 
-static void adjustWindowsInCorner(std::map<HWND, Rect>& windowRects,
-                                  HMONITOR mon,
-                                  const Rect& mrect,
-                                  flags<Corner> corner,
-                                  const std::map<flags<Corner>, std::multimap<size_t, HWND>>& mcvw, 
-                                  tuple<int /*unitSize*/, SIZE /*borderSize*/, bool /*multiMonitor*/> settings)
+/// <returns>number of moved windows</returns>
+static size_t arrangePass(bool force, bool reset)
 {
-    auto [unitSize, borderSize, multiMonitor] = settings;
-    const auto& windows = mcvw.at(corner);
-    bool verticalScreen = mrect.height() > mrect.width();
-    int i = verticalScreen ? int(windows.size() - 1) : 0;
-    for (auto& [s, w] : windows)
-    {
-        if (auto dpiAwareness = GetAwarenessFromDpiAwarenessContext(GetWindowDpiAwarenessContext(w));
-            multiMonitor && dpiAwareness != DPI_AWARENESS_PER_MONITOR_AWARE)
-            borderSize = { 0, 0 }; // prevent dpi unaware windows from being resized in context of a different screen
-
-        using enum Corner;
-        flags<Corner> otherCorner;
-        // 1°
-        otherCorner = corner ^ bottom;
-        long dy = max(0, long(mcvw.at(otherCorner).size()) - i) * unitSize - borderSize.cy;
-        // 2°
-        otherCorner = corner ^ right;
-        long dx = long(mcvw.at(otherCorner).size()) * unitSize;
-        otherCorner = corner ^ bottomright;
-        dx = max(dx, long(mcvw.at(otherCorner).size()) * unitSize) - borderSize.cx;
-        auto& wrect = windowRects.at(w);
-        if (wrect.width() + windowops_maxIncrease > mrect.width())
-        {
-            wrect.left = mrect.left - borderSize.cx;
-            wrect.right = mrect.right + borderSize.cx;
-        }
-        if (wrect.height() + windowops_maxIncrease > mrect.height())
-        {
-            wrect.top = mrect.top - borderSize.cy;
-            wrect.bottom = mrect.bottom + borderSize.cy;
-        }
-        RECT newRect = wrect;
-        if (corner & right)
-        {
-            newRect.right = mrect.right + borderSize.cx - i * unitSize;
-            newRect.left = max(newRect.right - wrect.width(), mrect.left + dx);
-        }
-        else
-        {
-            newRect.left = mrect.left - borderSize.cx + i * unitSize;
-            newRect.right = min(newRect.left + wrect.width(), mrect.right - dx);
-        }
-        if (corner & bottom)
+    auto passStart = SteadyClock::now();
+    SetProcessDpiAwareness(PROCESS_PER_MONITOR_DPI_AWARE);
+    DesktopSnapshot desktop = takeDesktopSnapshot();
+    moveDispatcher.prune(desktop);
+    // windows whose quarantine ended take part in the layout again, as new windows of their monitors
+    auto released = moveDispatcher.takeReleased(SteadyClock::now());
+    for (auto w : released) feedBack({ RecordedFeedback::Kind::released, w });
+
+    // unmaximize windows to get rid of related issues, without waiting for their threads
+    for (auto const& w : desktop.windows)
+        if (auto const& r = w.rect; IsZoomed(toHWND(w.id)) && !moveDispatcher.quarantined(w.id, passStart) && !moveBackend.isHung(w.id))
         {
-            newRect.bottom = mrect.bottom + borderSize.cy - (long(windows.size()) - i - 1) * unitSize;
-            newRect.top = max(newRect.bottom - wrect.height(), mrect.top + dy);
+            ShowWindowAsync(toHWND(w.id), SW_RESTORE);
+            SetWindowPos(toHWND(w.id), nullptr, r.left, r.top, int(r.width()), int(r.height()),
+                         SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE | SWP_ASYNCWINDOWPOS);
         }
-        else
+
+    auto arrangeStart = SteadyClock::now();
+    auto plan = layoutEngine.arrange(desktop, force);
+    if (recorder) recorder->recordPass(desktop, layoutEngine.settings, force, plan, SteadyClock::now() - arrangeStart);
+    metrics.add(Counter::passes);
+    metrics.recordPhases(layoutEngine.lastPassTimings());
+    if (!plan)
+    {
+        metrics.add(Counter::unchangedPasses);
+        if (layoutEngine.lastPassScope().allReachable) metrics.add(Counter::occlusionSkips);
+        metrics.record(Timer::pass, SteadyClock::now() - passStart);
+        metrics.tick();
+        return 0;
+    }
+    metrics.add(Counter::changedPasses);
+    metrics.add(Counter::monitorsRelaid, layoutEngine.lastPassScope().monitors);
+    metrics.add(Counter::windowsRepositioned, plan->size());
+
+    displayMonitorsAndWindows(desktop);
+    auto moveStart = SteadyClock::now();
+    bool animate = layoutEngine.settings.animateMoves;
+    auto result = animate ? animateMovePlan(*plan) : moveDispatcher.execute(*plan);
+    if (animate) runAnimation();
+    metrics.record(Timer::move, SteadyClock::now() - moveStart);
+    metrics.add(Counter::windowsMoved, result.committed);
+    metrics.add(Counter::movesSkipped, result.skipped);
+    metrics.add(Counter::movesFailed, result.failed);
+    metrics.add(Counter::movesDeferred, result.deferred);
+    for (size_t i = 0; i < plan->size(); i++)
+    {
+        auto const& move = (*plan)[i];
+        if (move.centered && !moveAnimator.target(move.window))
         {
-            newRect.top = mrect.top - borderSize.cy + (long(windows.size()) - i - 1) * unitSize;
-            newRect.bottom = min(newRect.top + wrect.height(), mrect.bottom - dy);
+            // save the actual window size for size change detection to remain stable
+            if (auto actual = moveBackend.currentRect(move.window)) feedBack({ RecordedFeedback::Kind::windowRect, move.window, *actual });
         }
-        wrect = newRect;
-        if (MoveWindow(w, wrect.left, wrect.top, wrect.width(), wrect.height(), TRUE))
-            displayMovedWindowDetails(w, mon, corner, { i, unitSize, dx, dy }, { wrect, mrect });
-        else
+        else if (result.status[i] == MoveStatus::moved)
+            displayMovedWindowDetails(move, desktop);
+        else if (result.status[i] == MoveStatus::failed)
+            feedBack({ RecordedFeedback::Kind::unmovable, move.window });
+        else if (result.status[i] != MoveStatus::skipped)
         {
-            unmovableWindows.insert(w);
-            oldWindowMonitor.erase(w);
+            // hung or slow, laid out again when the dispatcher releases it
+            feedBack({ RecordedFeedback::Kind::unmovable, move.window });
+            logger().warning("Window {} is not responding, move {}", LogHex{ move.window },
+                             result.status[i] == MoveStatus::timedOut ? "timed out" : "deferred");
         }
+    }
+    logger().info("Moved {} windows, skipped {}, failed {}, deferred {}", result.committed, result.skipped, result.failed,
+                  result.deferred);
+    auto const& verdicts = verdictCache.stats();
+    logger().info("Window verdicts: {} hits, {} misses, {} invalidations", verdicts.hits, verdicts.misses, verdicts.invalidations);
 
-        if (verticalScreen) i--;
-        else i++;
+    if (reset && animate)
+    {
+        moveAnimator.start(LayoutEngine::resetPlan(*plan, desktop));
+        runAnimation();
     }
+    else if(reset)
+        moveDispatcher.execute(LayoutEngine::resetPlan(*plan, desktop));
+    metrics.record(Timer::pass, SteadyClock::now() - passStart);
+    metrics.tick();
+    return result.committed;
 }
 
-static void adjustWindowsInMonitorCorners(const map<HMONITOR, map<flags<Corner>, multimap<size_t, HWND>>>& windowsOrderInCorners, const map<HMONITOR, Rect>& monitorRects, map<HWND, Rect>& windowRects)
+/// <returns>windows are minimized</returns>
+static bool toggleMinimized()
 {
-    UINT dpiX;
-    UINT dpiY;
-    static double baseScaleFactor = 0;
-    if (baseScaleFactor == 0)
-    {
-        HMONITOR primaryMonitor = MonitorFromWindow(GetDesktopWindow(), MONITOR_DEFAULTTOPRIMARY);
-        GetDpiForMonitor(primaryMonitor, MDT_EFFECTIVE_DPI, &dpiX, &dpiY);
-        baseScaleFactor = 100 * dpiY / 96.0; // scaling factor of primary monitor for theme size correction
-        cerr << "sf0=" << baseScaleFactor << '%' << endl;
-    }
-    for(auto &[mon, windowsInCorners]: windowsOrderInCorners)
-    {
-        GetDpiForMonitor(mon, MDT_EFFECTIVE_DPI, &dpiX, &dpiY);
-        double sf = 100 * dpiY / 96.0;
-        int unitSize = 16;
-        int borderWidth = 0;
-        int borderHeight = 0;
-        auto &mrect = monitorRects.at(mon);
-        for (auto &[_, windows] : windowsInCorners)
-            if(windows.size() && loadThemeData(get<HWND>(*windows.begin()), baseScaleFactor, sf, unitSize, borderWidth, borderHeight))
-                break;
-        bool multiMonitor = monitorRects.size() > 1;
-        if (increaseUnitSizeForTouch && isMonitorTouchCapable(mon)) unitSize = unitSize * 3 / 2;
-        HWND onlyHWND = {};
-		for (auto& [_, windows] : windowsInCorners)
-            if(windows.size() == 1 && !onlyHWND) 
-                onlyHWND = windows.begin()->second;
-			else if (windows.size() > 0)
-            { 
-                onlyHWND = {}; 
-                break; 
-            }
-        bool verticalScreen = mrect.height() > mrect.width();
-        Rect* hwndRect = nullptr;
-        if (onlyHWND)
-        {
-            hwndRect = &windowRects.at(onlyHWND);
-			// check if window is not big enough to fill the screen
-            if (verticalScreen && hwndRect->height() + windowops_maxIncrease > mrect.height() ||
-                !verticalScreen && hwndRect->width() + windowops_maxIncrease > mrect.width())
-            {
-                onlyHWND = {};
-            }
-        }
-        if (onlyHWND)
-        {
-            if (verticalScreen)
-            {
-                auto screenHeight = mrect.height();
-                auto windowHeight = hwndRect->height();
-                auto halfDelta = (screenHeight - windowHeight) / 2;
-                MoveWindow(onlyHWND, mrect.left, mrect.top + halfDelta, hwndRect->width(), windowHeight, TRUE);
-            }
-            else
-            {
-                auto screenWidth = mrect.width();
-                auto windowWidth = hwndRect->width();
-                auto halfDelta = (screenWidth - windowWidth) / 2;
-                MoveWindow(onlyHWND, mrect.left + halfDelta, mrect.top, windowWidth, hwndRect->height(), TRUE);
-            }
-            GetWindowRect(onlyHWND, hwndRect);
-        }
+    bool minimize = !bulkMinimizer.holding();
+    auto result = minimize ? bulkMinimizer.minimize(layoutEngine.knownWindows()) : bulkMinimizer.restore();
+    const char* done = minimize ? "minimized" : "restored";
+    if (result.hung || result.timedOut || result.failed)
+        logger().warning("{} of {} windows {}, {} hung, {} timed out, {} failed", result.completed, result.requested, done,
+                         result.hung, result.timedOut, result.failed);
+    if (!minimize && result.requested && !result.zOrderRestored) logger().debug("the stacking order of the restored windows was not restored");
+    return minimize;
+}
+
+// ARRANGER THREAD
+
+/// <returns>the events changed something the desktop fingerprint does not cover</returns>
+static bool applyEvents(const ArrangeWork& work)
+{
+    bool displayChanged = work.eventsLost;
+    bool unseen = work.eventsLost;
+    if (work.eventsLost) verdictCache.invalidateAll();
+    for (auto const& event : work.events)
+        if (event.kind == WindowEventKind::displayChanged) displayChanged = true;
         else
         {
-            for (int i = 0; i < 4; i++)
-                adjustWindowsInCorner(windowRects, mon, mrect, Corner(i), windowsInCorners, { unitSize, { borderWidth, borderHeight }, multiMonitor });
+            // titles and owners decide whether a window takes part in the layout
+            unseen |= event.kind == WindowEventKind::nameChanged || event.kind == WindowEventKind::ownerChanged;
+            verdictCache.onEvent(event);
         }
+    if (displayChanged)
+    {
+        // caption sizes follow the DPI and the non-client metrics as well as the visual style
+        themeSizesStale = true;
+        layoutEngine.invalidateThemeMetrics();
     }
+    return unseen || displayChanged;
 }
 
-static bool shouldAvoidTopRightCorner(HMONITOR__ const* mon)
+/// <returns>the desktop is as the last full pass left it, which makes another pass pointless</returns>
+static bool unchangedSinceLastPass(const ArrangeWork& work, bool eventsNeedPass)
 {
-    if (avoidTopRightCorner) return true;
-    if(increaseUnitSizeForTouch && isMonitorTouchCapable(mon)) return true;
-    return false;
+    metrics.add(Counter::fingerprintChecks);
+    bool unchanged = takeFingerprint() == lastFingerprint && !eventsNeedPass && !moveDispatcher.releaseDue(SteadyClock::now());
+    if (unchanged) metrics.add(Counter::fingerprintHits);
+    if (unchanged && work.events.empty()) checkInterval.idle();
+    else checkInterval.activity();
+    checkPeriod = checkInterval.current().count();
+    return unchanged;
 }
 
-static pair<HMONITOR, Corner> findMainMonitorAndCorner(Rect const &wrect, const map<HMONITOR, Rect> &monitorRects)
+static ArrangeCompletion executeWork(ArrangeWork& work)
 {
-    size_t maxArea = 0;
-    HMONITOR mon = nullptr;
-    Corner corner = Corner::topleft;
-    for(auto &[m, r]: monitorRects)
+    bool eventsNeedPass = applyEvents(work);
+    layoutEngine.settings = work.settings;
+    if (!work.settings.animateMoves) moveAnimator.finish();
+    ArrangeCompletion completion;
+    if (!work.toggleMinimize && !work.force && unchangedSinceLastPass(work, eventsNeedPass))
     {
-        Rect rect {};
-        IntersectRect(&rect, &r, &wrect);
-        size_t area = rect.area();
-        if (area > maxArea)
-        {
-            mon = m;
-            maxArea = area;
-        }
+        // the work which interrupted the animation changed nothing, the windows glide on
+        if (moveAnimator.active()) runAnimation();
+        return completion;
     }
-    if(mon)
+    if (work.toggleMinimize)
     {
-        Rect mrect = monitorRects.at(mon);
-        auto minDist = mrect.diameter();
-        for(int i = 0; i < 4; i++)
-        {
-            auto c = Corner(i);
-            if (shouldAvoidTopRightCorner(mon) && c == Corner::topright) continue;
-            int dist = wrect.distanceFromCorner(mrect, c);
-            if(dist < minDist)
-            {
-                minDist = dist;
-                corner = c;
-            }
-        }
+        moveAnimator.finish();
+        completion.minimized = toggleMinimized();
+        completion.latency = SteadyClock::now() - work.requested;
+        metrics.record(Timer::toggleMinimize, completion.latency);
+        // restored windows are arranged right away
+        if (!completion.minimized) completion.moved = arrangePass(true, false);
     }
-    return { mon, corner };
+    else completion.moved = arrangePass(work.force, work.reset);
+    // a pass which found nothing to do lets the windows of an interrupted animation glide on
+    if (moveAnimator.active()) runAnimation();
+    lastFingerprint = takeFingerprint();
+    // passes started by timers and window events are not waited for by anyone
+    if (completion.moved && work.userRequested) metrics.record(Timer::requestToLastMove, SteadyClock::now() - *work.userRequested);
+    if (work.commands > 1) logger().debug("{} requests served by one pass", work.commands);
+    return completion;
 }
 
-// API FUNCTIONS
+static void notifyCompletion(const ArrangeCompletion& completion)
+{
+    auto latency = chrono::duration_cast<chrono::milliseconds>(completion.latency).count();
+    // the milliseconds saturate instead of spilling into the sign bit of a 32-bit lParam
+    auto latencyBits = LPARAM((std::min)(latency, decltype(latency)(LONG_MAX >> arrangeLatencyShift))) << arrangeLatencyShift;
+    if (HWND window = notifyWindow)
+        PostMessage(window, notifyMessage, WPARAM(completion.moved),
+                    LPARAM((completion.toggleMinimize ? arrangeToggledMinimize : 0) | (completion.minimized ? arrangeMinimized : 0)) | latencyBits);
+}
 
-static void distributeNewWindowsInCorners(std::multimap<long, std::pair<HWND, Corner>>& mwc, const std::set<HWND>& newWindows, HMONITOR__ const *mon, const Rect& mrect, std::queue<Corner>& freeCorners, std::map<flags<Corner>, std::multimap<size_t, HWND>>& order)
+/// <summary>
+/// Queue a command for the arranger thread, starting the thread and the watchers on first use.
+/// The watchers deliver their notifications to the calling thread, which runs the message loop.
+/// </summary>
+static void postCommand(ArrangeCommand command, bool byUser = true)
 {
-    using enum Corner;
-    int i = 0;
-    array<Corner, 4> corners{ topright, bottomright, topleft, bottomleft };
-    bool smallWindowsEnded = false;
-    for (auto& [s, wc] : mwc)
-    {
-        auto& [w, c] = wc;
-        if (!newWindows.contains(w) || unmovableWindows.contains(w)) continue;
+    startEventSource();
+    startDisplayWatcher();
+    if (!arranger) arranger = make_unique<ArrangeWorker>(arrangeQueue, executeWork, notifyCompletion);
+    arrangeQueue.post(command, currentSettings.load(), byUser);
+}
 
-        if (!smallWindowsEnded && s >= mrect.height() - windowops_maxIncrease)
-        {
-            smallWindowsEnded = true;
-            i = 0;
-            corners = { bottomleft, bottomright, topleft, topright };
-        }
-        if (freeCorners.size())
-        {
-            c = freeCorners.front();
-            freeCorners.pop();
-        }
-        else
-        {
-            c = corners[i % 4];
-            i++;
-            if (shouldAvoidTopRightCorner(mon) && c == topright)
-            {
-                c = corners[i % 4];
-                i++;
-            }
-        }
-        order[c].insert({ s, w });
-    }
+// API FUNCTIONS
+
+void arrangeAllWindows(bool force, bool reset)
+{
+    postCommand(reset ? ArrangeCommand::reset : force ? ArrangeCommand::force : ArrangeCommand::arrange);
 }
 
-static auto distributeWindowsInCorners(const map<HWND, tuple<HMONITOR, Corner, Rect>>& windowMonitor,
-                                       const set<HWND>& newWindows,
-                                       const map<HMONITOR, Rect>& monitorRects)
+bool setWindowRules(wstring_view rules)
 {
-    map<HMONITOR, map<flags<Corner>, multimap<size_t, HWND>>> windowsOrderInCorners;
-    map<HMONITOR, multimap<long, pair<HWND, Corner>>> windowsOnMonitor;
-    for (auto& [w, mc] : windowMonitor) {
-        auto m = get<HMONITOR>(mc);
-        auto const& mrect = monitorRects.at(m);
-        bool verticalScreen = mrect.height() > mrect.width();
-        auto r = get<Rect>(mc);
-        windowsOnMonitor[m].insert({ verticalScreen ? r.width() : r.height(), {w, get<Corner>(mc)} });
-    }
+    string text(size_t((std::max)(0, WideCharToMultiByte(CP_ACP, 0, rules.data(), int(rules.size()), nullptr, 0, nullptr, nullptr))), '\0');
+    WideCharToMultiByte(CP_ACP, 0, rules.data(), int(rules.size()), text.data(), int(text.size()), nullptr, nullptr);
+    return setWindowRules(string_view(text));
+}
 
-    for (auto& [mon, mwc] : windowsOnMonitor)
+bool setWindowRules(string_view rules)
+{
+    string error;
+    auto filter = WindowFilter::parse(rules, &error);
+    if (!filter)
     {
-        auto& monitorCornerWindows = windowsOrderInCorners[mon];
-        for (int i = 0; i < 4; i++) monitorCornerWindows[Corner(i)]; // ensure all window sets exist
-        for (auto& [s, wc] : mwc)
-        {
-            auto& [w, c] = wc;
-            if (newWindows.contains(w) || unmovableWindows.contains(w)) continue;
-            monitorCornerWindows[c].insert({ s, w });
-        }
+        logger().error("Window rules not applied, {}", error);
+        return false;
+    }
+    logger().info("{} window rules", filter->size());
+    lock_guard lock(windowFilterMutex);
+    windowFilter = make_shared<const WindowFilter>(move(*filter));
+    return true;
+}
 
-        auto const& mrect = monitorRects.at(mon);
-        bool verticalScreen = mrect.height() > mrect.width();
+LayoutSettings layoutSettings()
+{
+    return currentSettings.load();
+}
 
-        queue<Corner> freeCorners; 
-        size_t maxNumWindows = 0;
-        for (auto const& [c, vw] : monitorCornerWindows) maxNumWindows = max(maxNumWindows, vw.size());
-        using enum Corner;
-        for(auto corner: { topleft, bottomright, bottomleft, topright })
-        {
-            if (corner == topright && shouldAvoidTopRightCorner(mon)) continue;
-            auto const& vw = monitorCornerWindows[corner];
-            auto const& vwToLookForBig = monitorCornerWindows[Corner(flags<Corner>(corner) ^ (verticalScreen ? Corner::right : Corner::bottom))];
-            auto freeSpace = int(maxNumWindows - vw.size());
-            for (auto& [s, _] : vwToLookForBig)
-                freeSpace -= int(s > (verticalScreen ? mrect.width() : mrect.height()) - windowops_maxIncrease);
-            for (int i = 0; i < freeSpace; i++) freeCorners.push(corner);
-        }
-        distributeNewWindowsInCorners(mwc, newWindows, mon, monitorRects.at(mon), freeCorners, monitorCornerWindows);
-    }
+void setLayoutSettings(const LayoutSettings& settings, bool rearrange)
+{
+    currentSettings.store(settings);
+    if (rearrange) postCommand(ArrangeCommand::settingsChanged);
+}
 
-    return windowsOrderInCorners;
+void toggleMinimizeAllWindows()
+{
+    postCommand(ArrangeCommand::toggleMinimize);
 }
 
-static void displayMonitorsAndWindows(std::map<HMONITOR, Rect>& monitorRects, std::map<HWND, Rect>& windowRects)
+void setArrangeNotification(HWND window, UINT message)
 {
-    cout << "Monitors:\n";
-    for (auto const& [m, s] : monitorNames)
-    {
-        auto const& rect = monitorRects[m];
-        cout << monitorNames[m] << ": " << rect.left << ':' << rect.top << ':' << rect.right << ':' << rect.bottom;
-        cout << '(' << rect.right - rect.left << 'x' << rect.bottom - rect.top << ')' << endl;
-    }
+    notifyMessage = message;
+    notifyWindow = window;
+}
 
-    cout << "Windows:\n";
-    for (auto const& [w, ss] : windowTitles)
-    {
-        auto const& rect = windowRects[w];
-        cout << w << ": " << ss.second << '(' << ss.first << ')' << ':' << rect.left << ':' << rect.top << ':'
-             << rect.right << ':' << rect.bottom << "dpiAwareness=" 
-             << GetAwarenessFromDpiAwarenessContext(GetWindowDpiAwarenessContext(w)) << ", style=" 
-             << hex << GetWindowLong(w, GWL_EXSTYLE) << dec << endl;
-    }
+void stopArranger()
+{
+    notifyWindow = nullptr;
+    if (arranger) arranger->stop();
 }
 
-static bool hasChangedWindows(std::map<HWND, std::tuple<HMONITOR, Corner, Rect>>& windowMonitor, 
-                                 std::set<HWND>& newWindows, 
-                                 const std::map<HMONITOR, Rect>& monitorRects)
+static void CALLBACK onCheckTimer(HWND, UINT, UINT_PTR, DWORD);
+
+/// <summary>
+/// Restart the check timer with the period the arranger published last
+/// </summary>
+static void scheduleCheckTimer()
 {
-    bool changed = false;
-    for (auto& [w, r] : oldWindowMonitor)
-        if (!windowMonitor.contains(w))
-            changed = true;
-        else if (get<HMONITOR>(windowMonitor.at(w)) != get<HMONITOR>(r))
-        {
-            changed = true;
-            newWindows.insert(w);
-        }
+    if (checkTimer) KillTimer(nullptr, checkTimer);
+    auto period = chrono::ceil<chrono::milliseconds>(Duration(checkPeriod.load())).count();
+    checkTimer = SetTimer(nullptr, 0, UINT(period), onCheckTimer);
+}
 
-    set<HWND> deletedUnmovableWindows;
-    for (auto& w : unmovableWindows) if (!windowMonitor.contains(w)) deletedUnmovableWindows.insert(w);
-    for (auto& w : deletedUnmovableWindows) unmovableWindows.erase(w);
-    deletedUnmovableWindows.clear();
+static void CALLBACK onCheckTimer(HWND, UINT, UINT_PTR, DWORD)
+{
+    // events may be missed, a check answered by the fingerprint costs little
+    postCommand(ArrangeCommand::arrange, false);
+    scheduleCheckTimer();
+}
 
-    for (auto& [w, r] : windowMonitor)
-    {
-        if (!oldWindowMonitor.contains(w))
-        {
-            changed = true;
-            auto &mrect = monitorRects.at(get<HMONITOR>(r));
-            if ((GetWindowLong(w, GWL_STYLE) & WS_MAXIMIZEBOX) == 0)
-            {
-                using enum Corner;
-                POINT cursorPos;
-                GetCursorPos(&cursorPos);
-                flags c = topleft;
-                if (abs(cursorPos.x - mrect.right) < abs(cursorPos.x - mrect.left)) c |= right;
-                if (abs(cursorPos.y - mrect.bottom) < abs(cursorPos.y - mrect.top)) c |= bottom;
-                get<Corner>(r) = Corner(c);
-            }
-            else newWindows.insert(w);
-        }
-        else if (get<Rect>(oldWindowMonitor[w]) != get<Rect>(windowMonitor[w]))
-            changed = true;
-    }
-    return changed;
+static void CALLBACK onCoalescerTimer(HWND, UINT, UINT_PTR, DWORD)
+{
+    KillTimer(nullptr, coalescerTimer);
+    coalescerTimer = 0;
+    if (coalescer.poll(SteadyClock::now())) postCommand(ArrangeCommand::arrange, false);
+    scheduleCoalescerTimer();
 }
 
-void arrangeAllWindows(bool force, bool reset)
+static void scheduleCoalescerTimer()
 {
-    SetProcessDpiAwareness(PROCESS_PER_MONITOR_DPI_AWARE);
-    map<HMONITOR, Rect> monitorRects;
-    EnumDisplayMonitors(nullptr, nullptr, MONITORENUMPROC(enumMonitorsProc), bit_cast<LPARAM>(&monitorRects));
-    for(auto &[m, r]: monitorRects)
+    if (coalescerTimer) return; // the timer checks the deadline again when it fires
+    if (auto due = coalescer.deadline())
     {
-        MONITORINFOEXA info {sizeof(MONITORINFOEXA)};
-        GetMonitorInfoA(m, &info);
-        r = info.rcWork;
-        monitorNames[m] = info.szDevice;
+        auto delay = chrono::ceil<chrono::milliseconds>(*due - SteadyClock::now()).count();
+        coalescerTimer = SetTimer(nullptr, 0, delay > 0 ? UINT(delay) : 1, onCoalescerTimer);
     }
+}
 
-    map<HWND, Rect> windowRects;
-    EnumWindows(WNDENUMPROC(enumWindowsProc), bit_cast<LPARAM>(&windowRects));
-
-    // unmaximize windows to get rid of related issues
-    for (auto const& [w, r] : windowRects)
-        if (IsZoomed(w))
-        {
-            ShowWindow(w, SW_RESTORE);
-            MoveWindow(w, r.left, r.top, int(r.width()), int(r.height()), true);
-        }
-
-    // find main monitor for each window
-    map<HWND, tuple<HMONITOR, Corner, Rect>> windowLocations;
-    for (auto &[w, r] : windowRects)
+bool setAutoArrange(bool enabled)
+{
+    autoArrange = enabled && startEventSource();
+    if (!autoArrange)
     {
-        auto [m, c] = findMainMonitorAndCorner(r, monitorRects);
-        // if(!monitor) monitor = monitorRects.rbegin()->first; // TODO that would steal space for invisible windows, consider filtering them better because some fall into this category incorrectly
-        if(m) windowLocations[w] = {m, c, r};
-        // else
-        //     cout << "No monitor for window " << w << endl;
+        if (coalescerTimer) KillTimer(nullptr, coalescerTimer);
+        coalescerTimer = 0;
+        if (checkTimer) KillTimer(nullptr, checkTimer);
+        checkTimer = 0;
+        coalescer = ArrangeCoalescer();
+        return !enabled;
     }
+    postCommand(ArrangeCommand::arrange);
+    if (!checkTimer) scheduleCheckTimer();
+    return true;
+}
 
-    set<HWND> newWindows;
-    if(!force && !hasChangedWindows(windowLocations, newWindows, monitorRects)) return;
-
-    displayMonitorsAndWindows(monitorRects, windowRects);
-    auto windowsOrderInCorners = distributeWindowsInCorners(windowLocations, newWindows, monitorRects);
-
-    oldWindowMonitor = windowLocations;
-    adjustWindowsInMonitorCorners(windowsOrderInCorners, monitorRects, windowRects);
-    // save window sizes after adjustment for size change detection to remain stable
-    for (auto& [w, mcr] : oldWindowMonitor) if (windowRects.contains(w)) get<Rect>(mcr) = windowRects[w];
+string metricsJson()
+{
+    return metrics.toJson();
+}
 
-    if(reset)
-		resetAllWindowPositions(windowsOrderInCorners, monitorRects, windowRects);
+bool setRecordingFile(const filesystem::path& path)
+{
+    recorder.reset();
+    recordingFile.close();
+    if (path.empty()) return true;
+    recordingFile.open(path, ios::binary | ios::trunc);
+    if (!recordingFile) return false;
+    recorder.emplace(recordingFile);
+    logger().info("Recording the session to {}", path.string());
+    return true;
 }
 
-bool toggleMinimizeAllWindows()
+void setMetricsFile(const filesystem::path& path)
 {
-    static vector<HWND> bulkMinimizedWindows;
+    metrics.setFile(path);
+    metrics.writeFile();
+}
 
-    if (bulkMinimizedWindows.size())
-    {
-        for (auto& w : bulkMinimizedWindows)
-            ShowWindow(w, SW_RESTORE);
-        bulkMinimizedWindows.clear();
-        return false;
-    }
-    else
-    {
-        for (auto const& [w, mcr] : oldWindowMonitor)
-            if (!IsIconic(w))
-            {
-                ShowWindow(w, SW_MINIMIZE);
-                bulkMinimizedWindows.push_back(w);
-            }
-        return true;
-    }
+void dumpMetrics()
+{
+    for (int i = 0; i < counterCount; i++) logger().info("{}: {}", counterName(Counter(i)), metrics.value(Counter(i)));
+    if (auto checks = metrics.value(Counter::fingerprintChecks))
+        logger().info("fingerprint answered {}% of checks", 100.0 * double(metrics.value(Counter::fingerprintHits)) / double(checks));
+    if (auto changed = metrics.value(Counter::changedPasses))
+        logger().info("{} windows repositioned per changed pass", double(metrics.value(Counter::windowsRepositioned)) / double(changed));
+    for (int i = 0; i < timerCount; i++)
+        if (auto h = metrics.histogram(Timer(i)); h.count())
+            logger().info("{}: {} samples, p50 {} us, p90 {} us, p99 {} us, max {} us", timerName(Timer(i)), h.count(),
+                          h.percentile(50) / 1000, h.percentile(90) / 1000, h.percentile(99) / 1000, h.maxValue() / 1000);
+    metrics.writeFile();
 }
 
 // REGISTRY FUNCTIONS
@@ -686,7 +681,9 @@ bool CreateConsole()
         freopen_s(&fp, "CONOUT$", "w", stderr);
         freopen_s(&fp, "CONIN$", "r", stdin);
 
-        cout << "Console created successfully." << endl;
+        // the console is for watching the details, which are formatted in the background
+        logger().setLevel(LogLevel::debug);
+        logger().info("Console created successfully.");
     }
     return result;
 }
@@ -4,16 +4,74 @@
 #include <optional>
 #include <iostream>
 #include <bit>
+#include <filesystem>
+#include <string>
+#include "engine/layout.h"
 
-extern int windowops_maxIncrease;
-extern bool avoidTopRightCorner;
-extern bool increaseUnitSizeForTouch;
-
+/// <summary>
+/// The functions below queue work for the arranger thread and return at once; redundant queued requests
+/// are served by a single pass. They must be called from the thread running the message loop,
+/// which receives the window and display notifications.
+/// </summary>
 void arrangeAllWindows(bool force = false, bool reset = false);
 /// <summary>
+/// Arrange windows in response to window events instead of polling.
+/// </summary>
+/// <returns>event subscription succeeded</returns>
+bool setAutoArrange(bool enabled);
+/// <summary>
+/// Minimize all arranged windows, or restore and arrange the ones minimized before
+/// </summary>
+void toggleMinimizeAllWindows();
+/// <summary>
+/// Settings of the queued and future passes
+/// </summary>
+LayoutSettings layoutSettings();
+/// <summary>
+/// Use the settings from the next queued pass on. They are published as one atomic word,
+/// so posting a pass reads them without locks.
+/// </summary>
+/// <param name="rearrange">arrange with the new settings now, even if no window changed</param>
+void setLayoutSettings(const LayoutSettings& settings, bool rearrange = true);
+
+/// flags in the lParam of the completion message; after a toggle, the bits from arrangeLatencyShift up
+/// hold the milliseconds from the tray click to the last window minimized or restored
+enum ArrangeNotification { arrangeToggledMinimize = 1, arrangeMinimized = 2, arrangeLatencyShift = 8 };
+/// <summary>
+/// Post the message to the window whenever the arranger finishes some work,
+/// with the number of moved windows in wParam and ArrangeNotification flags in lParam
+/// </summary>
+void setArrangeNotification(HWND window, UINT message);
+/// <summary>
+/// Wait for the current pass and stop the arranger thread, call before the message loop ends
+/// </summary>
+void stopArranger();
+/// <summary>
+/// Phase timers, percentiles and counters of the passes so far
+/// </summary>
+std::string metricsJson();
+/// <summary>
+/// Rewrite the metrics file at most every 10 seconds after passes, empty path turns it off
+/// </summary>
+void setMetricsFile(const std::filesystem::path& path);
+/// <summary>
+/// Record every pass and its plan for lazyclicker_replay, empty path stops recording.
+/// Call before the first arrangement.
+/// </summary>
+/// <returns>the file could be created</returns>
+bool setRecordingFile(const std::filesystem::path& path);
+/// <summary>
+/// Replace the window rules, see WindowFilter, from the next pass on. Windows text is converted to the ANSI code page,
+/// which the window titles and process names are read in.
+/// </summary>
+/// <returns>the rules were valid, otherwise the previous ones stay and the error is logged</returns>
+bool setWindowRules(std::wstring_view rules);
+/// <param name="rules">text in the ANSI code page</param>
+bool setWindowRules(std::string_view rules);
+/// <summary>
+/// Log a summary of the metrics and rewrite the metrics file now
 /// </summary>
-/// <returns>windows were minimized</returns>
-bool toggleMinimizeAllWindows();
+void dumpMetrics();
 
 template<typename T, int RegType> inline std::optional<T> 
 readRegistryValue(std::basic_string_view<TCHAR> key, std::basic_string_view<TCHAR> name)
@@ -0,0 +1,40 @@
+#include "windowprocesses.h"
+#include <Windows.h>
+#include <array>
+
+using namespace std;
+
+optional<ProcessHandle> Win32ProcessResolver::open(ProcessId pid)
+{
+    if (HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid))
+        return bit_cast<ProcessHandle>(hProcess);
+    return nullopt;
+}
+
+void Win32ProcessResolver::close(ProcessHandle handle)
+{
+    CloseHandle(bit_cast<HANDLE>(handle));
+}
+
+uint64_t Win32ProcessResolver::startTime(ProcessHandle handle)
+{
+    FILETIME creation{}, exit, kernel, user;
+    GetProcessTimes(bit_cast<HANDLE>(handle), &creation, &exit, &kernel, &user);
+    return (uint64_t(creation.dwHighDateTime) << 32) | creation.dwLowDateTime;
+}
+
+bool Win32ProcessResolver::isRunning(ProcessHandle handle, uint64_t)
+{
+    // the open handle pins the process object, so the pid cannot be reused while it is cached
+    return WaitForSingleObject(bit_cast<HANDLE>(handle), 0) == WAIT_TIMEOUT;
+}
+
+optional<ProcessInfo> Win32ProcessResolver::query(ProcessHandle handle)
+{
+    array<char, MAX_PATH> path{};
+    DWORD size = DWORD(path.size());
+    if (!QueryFullProcessImageNameA(bit_cast<HANDLE>(handle), 0, path.data(), &size)) return nullopt;
+    string imagePath(path.data(), size);
+    auto separator = imagePath.find_last_of("\\/");
+    return ProcessInfo{ separator == string::npos ? imagePath : imagePath.substr(separator + 1), imagePath };
+}
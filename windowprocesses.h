@@ -0,0 +1,19 @@
+#ifndef WINDOWPROCESSES_H
+#define WINDOWPROCESSES_H
+#include "engine/processcache.h"
+
+/// <summary>
+/// Process metadata through limited-information process handles, which are kept open
+/// while the process is cached so its exit can be detected without reopening it
+/// </summary>
+class Win32ProcessResolver : public ProcessResolver
+{
+public:
+    std::optional<ProcessHandle> open(ProcessId pid) override;
+    void close(ProcessHandle handle) override;
+    std::uint64_t startTime(ProcessHandle handle) override;
+    bool isRunning(ProcessHandle handle, std::uint64_t startTime) override;
+    std::optional<ProcessInfo> query(ProcessHandle handle) override;
+};
+
+#endif // WINDOWPROCESSES_H
@@ -0,0 +1,81 @@
+#include "windowqueries.h"
+#include <Windows.h>
+#include <algorithm>
+#include <array>
+#include <memory>
+
+using namespace std;
+
+static WindowId toId(HWND w) { return bit_cast<WindowId>(w); }
+static HWND toHWND(WindowId w) { return bit_cast<HWND>(w); }
+
+// https://stackoverflow.com/questions/7277366/why-does-enumwindows-return-more-windows-than-i-expected
+static BOOL IsAltTabWindow(HWND hwnd)
+{
+    if (!hwnd) return FALSE;
+    if(!IsWindowVisible(hwnd)) return FALSE;
+
+    HWND hwndWalk = nullptr;
+    HWND hwndTry = GetAncestor(hwnd, GA_ROOTOWNER);
+    while(hwndTry != hwndWalk)
+    {
+        hwndWalk = hwndTry;
+        hwndTry = GetLastActivePopup(hwndWalk);
+        if(IsWindowVisible(hwndTry)) break;
+    }
+    if(hwndWalk != hwnd) return FALSE;
+
+    // the following removes some task tray programs and "Program Manager"
+    TITLEBARINFO ti {sizeof(TITLEBARINFO)};
+    GetTitleBarInfo(hwnd, &ti);
+    if(ti.rgstate[0] & STATE_SYSTEM_INVISIBLE) return FALSE;
+
+    // Tool windows should not be displayed either, these do not appear in the
+    // task bar.
+    if(GetWindowLong(hwnd, GWL_EXSTYLE) & WS_EX_TOOLWINDOW) return FALSE;
+
+    return TRUE;
+}
+
+optional<WindowProbe> Win32WindowQueries::probe(WindowId w)
+{
+    HWND hWnd = toHWND(w);
+    // visibility and minimization are style bits, most windows are rejected without further queries
+    WindowStyleKey key{ uint32_t(GetWindowLong(hWnd, GWL_STYLE)), uint32_t(GetWindowLong(hWnd, GWL_EXSTYLE)), toId(GetWindow(hWnd, GW_OWNER)) };
+    if (!(key.style & WS_VISIBLE) || (key.style & WS_MINIMIZE)) return nullopt;
+
+    RECT rect;
+    if (!GetWindowRect(hWnd, &rect)) return nullopt;
+    return WindowProbe{ key, { rect.left, rect.top, rect.right, rect.bottom }, bool(key.style & WS_MAXIMIZEBOX) };
+}
+
+string Win32WindowQueries::className(WindowId w)
+{
+    array<char, 257> name{}; // class names are at most 256 characters long
+    int length = GetClassNameA(toHWND(w), name.data(), int(name.size()));
+    return string(name.data(), size_t((std::max)(0, length)));
+}
+
+WindowVerdict Win32WindowQueries::classify(WindowId w)
+{
+    HWND hWnd = toHWND(w);
+    WindowVerdict verdict;
+    if(!IsAltTabWindow(hWnd)) return verdict;
+
+    int length = GetWindowTextLength(hWnd);
+    if(!length) return verdict;
+    auto buffer = make_unique<char[]>(length + 1);
+    GetWindowTextA(hWnd, buffer.get(), length + 1);
+
+    DWORD processId;
+    GetWindowThreadProcessId(hWnd, &processId);
+    verdict.pid = processId;
+    verdict.title = buffer.get();
+    verdict.eligible = true;
+    return verdict;
+}
+
+bool Win32WindowQueries::perMonitorDpiAware(WindowId w)
+{
+    return GetAwarenessFromDpiAwarenessContext(GetWindowDpiAwarenessContext(toHWND(w))) == DPI_AWARENESS_PER_MONITOR_AWARE;
+}
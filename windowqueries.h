@@ -0,0 +1,18 @@
+#ifndef WINDOWQUERIES_H
+#define WINDOWQUERIES_H
+#include "engine/windowgather.h"
+
+/// <summary>
+/// Window properties through user32; the queries read window state without sending messages,
+/// so they may run on any thread
+/// </summary>
+class Win32WindowQueries : public WindowQueryBackend
+{
+public:
+    std::optional<WindowProbe> probe(WindowId w) override;
+    std::string className(WindowId w) override;
+    WindowVerdict classify(WindowId w) override;
+    bool perMonitorDpiAware(WindowId w) override;
+};
+
+#endif // WINDOWQUERIES_H
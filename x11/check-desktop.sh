@@ -0,0 +1,105 @@
+#!/bin/sh
+# Arranges a few windows on a virtual X server split into two RandR monitors, managed by openbox, and checks where
+# they end up: the rects read back after lazyclicker_x11 --once must be the targets lazyclicker_plan computes for
+# the same desktop, and another pass must find nothing to move.
+# Needs cmake, pkg-config, the xcb and xcb-randr development files, Xvfb, openbox, xrandr, xprop and xlogo.
+# usage: x11/check-desktop.sh [build directory]
+# DISPLAY_NAME picks the virtual display (:97), TOLERANCE the pixels a rect may be off by (0).
+set -eu
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+build=${1:-$root/build-x11-check}
+display=${DISPLAY_NAME:-:97}
+tolerance=${TOLERANCE:-0}
+
+fail()
+{
+    echo "check-desktop: $*" >&2
+    exit 1
+}
+
+# runs the command until it succeeds, for at most ten seconds
+wait_for()
+{
+    tries=0
+    until "$@" >/dev/null 2>&1; do
+        tries=$((tries + 1))
+        [ $tries -lt 100 ] || fail "timed out waiting for: $*"
+        sleep 0.1
+    done
+}
+
+for tool in cmake pkg-config Xvfb openbox xrandr xprop xlogo; do
+    command -v $tool >/dev/null || fail "$tool not found"
+done
+pkg-config --exists xcb-randr || fail "the xcb-randr development files are not installed"
+
+cmake -S "$root" -B "$build" >/dev/null
+# without RandR the screen would be a single monitor and the check would prove less than it claims
+grep -q '^XCB_RANDR_FOUND:INTERNAL=1' "$build/CMakeCache.txt" || fail "lazyclicker_x11 was configured without xcb-randr"
+cmake --build "$build" --target lazyclicker_x11 lazyclicker_plan -j"$(nproc)" >/dev/null
+x11=$build/x11/lazyclicker_x11
+plan=$build/lazyclicker_plan
+
+tmp=$(mktemp -d)
+pids=
+cleanup()
+{
+    for pid in $pids; do kill $pid 2>/dev/null || true; done
+    rm -rf "$tmp"
+}
+trap cleanup EXIT
+
+Xvfb $display -screen 0 2560x1080x24 -nolisten tcp >"$tmp/xvfb.log" 2>&1 &
+pids=$!
+export DISPLAY=$display
+wait_for xprop -root
+# the output becomes the left monitor, the right one has no output of its own
+xrandr --setmonitor left 1280/338x1080/285+0+0 screen
+xrandr --setmonitor right 1280/338x1080/285+1280+0 none
+[ "$(xrandr --listmonitors | head -n 1)" = "Monitors: 2" ] || fail "the virtual screen was not split into two monitors"
+
+openbox >"$tmp/openbox.log" 2>&1 &
+pids="$pids $!"
+wait_for sh -c 'xprop -root _NET_SUPPORTING_WM_CHECK | grep -q "window id"'
+
+# xlogo accepts any size, so the window manager has no reason to round the targets
+count=0
+for geometry in 400x300+50+60 700x500+300+200 500x400+900+100 600x300+1500+500 300x200+2000+700 800x600+1200+300; do
+    xlogo -geometry $geometry &
+    pids="$pids $!"
+    count=$((count + 1))
+done
+wait_for sh -c "[ \$(xprop -root _NET_CLIENT_LIST | tr -cd , | wc -c) -ge $((count - 1)) ]"
+# the frames are put around the windows after they are listed
+sleep 1
+
+"$x11" --once --snapshot >"$tmp/before.txt"
+[ "$(grep -c '^monitor' "$tmp/before.txt")" -eq 2 ] || fail "lazyclicker_x11 did not see both monitors"
+[ "$(grep -c '^window' "$tmp/before.txt")" -eq $count ] || fail "lazyclicker_x11 did not see all $count windows"
+"$plan" "$tmp/before.txt" >"$tmp/plan.txt"
+# the window manager applies the moves after the client has gone
+sleep 1
+"$x11" --once --snapshot >"$tmp/after.txt"
+
+# plan lines: window monitor corner index left top right bottom; snapshot lines: window id left top right bottom ...
+awk -v tolerance="$tolerance" '
+    FNR == NR { if ($1 !~ /^#/) { target[$1] = $5 " " $6 " " $7 " " $8; planned++ } next }
+    $1 == "window" && ($2 in target) {
+        checked++
+        split(target[$2], t, " ")
+        for (i = 1; i <= 4; i++)
+            if ((d = t[i] - $(i + 2)) > tolerance || -d > tolerance) {
+                print "check-desktop: window " $2 " is at " $3 " " $4 " " $5 " " $6 ", planned " target[$2] > "/dev/stderr"
+                wrong++
+                break
+            }
+    }
+    END {
+        if (!planned) { print "check-desktop: nothing was planned" > "/dev/stderr"; exit 1 }
+        if (checked < planned) { print "check-desktop: " planned - checked " planned windows are gone" > "/dev/stderr"; exit 1 }
+        exit wrong > 0
+    }' "$tmp/plan.txt" "$tmp/after.txt" || fail "the windows are not where they were planned"
+
+"$plan" "$tmp/after.txt" | grep -q '^# committed 0 ' || fail "another pass would move windows again"
+echo "check-desktop: $(grep -vc '^#' "$tmp/plan.txt") windows arranged on 2 monitors as planned"
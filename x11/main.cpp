@@ -0,0 +1,219 @@
+// Arranges the windows of an X11 desktop managed by an EWMH window manager, the X11 counterpart of windowops.cpp.
+// Runs until interrupted, arranging after every burst of window events, or a single pass with --once.
+#include "engine/logger.h"
+#include "engine/procresolver.h"
+#include "engine/snapshotio.h"
+#include "x11displays.h"
+#include "x11events.h"
+#include "x11moves.h"
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <string_view>
+
+using namespace std;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static int usage()
+{
+    cerr << "usage: lazyclicker_x11 [--display NAME] [--once] [--force] [--snapshot] [--rules FILE] [--debug]\n"
+            "                       [--max-increase N] [--avoid-top-right] [--no-touch-unit] [--min-displacement] [--only-occluded]\n"
+            "--once arranges once and exits, --snapshot prints the desktop of every pass in the format of lazyclicker_plan\n"
+            "--rules FILE reads window rules, the style and exstyle bits are the _NET_WM_STATE and _NET_WM_WINDOW_TYPE\n"
+            "atoms in the order of x11queries.h\n";
+    return 2;
+}
+
+/// <summary>
+/// Everything a pass needs, living as long as the connection
+/// </summary>
+struct X11Desktop
+{
+    explicit X11Desktop(XcbConnection& connection)
+        : connection(connection), queries(connection), moves(connection, queries), displays(connection),
+          topologyCache(displays), events(connection), processCache(processResolver), pool(0) {}
+
+    XcbConnection& connection;
+    X11WindowQueries queries;
+    X11MoveBackend moves;
+    X11TopologyProvider displays;
+    TopologyCache topologyCache;
+    X11EventSource events;
+    ProcResolver processResolver;
+    ProcessCache processCache;
+    VerdictCache verdictCache;
+    WindowFilter filter;
+    WorkerPool pool; ///< the queries are answered from memory, threads would only add overhead
+    LayoutEngine layoutEngine;
+    vector<WindowId> centered; ///< windows centered by the previous pass, whose size the application may have constrained
+    bool eventsRunning = false;
+    bool printSnapshots = false;
+};
+
+static DesktopSnapshot takeDesktopSnapshot(X11Desktop& x)
+{
+    DesktopSnapshot desktop;
+    if (!x.eventsRunning) x.topologyCache.invalidate(DisplayChange::display);
+    desktop.topology = x.topologyCache.current();
+
+    x.processCache.beginPass();
+    if (!x.eventsRunning) x.verdictCache.invalidateAll();
+    x.verdictCache.beginPass();
+    auto handles = x.queries.clientList();
+    x.queries.prefetch(handles);
+    x.events.watch(handles);
+    auto gathered = gatherWindows(handles, x.queries, x.filter, x.verdictCache, x.processCache, x.pool);
+    desktop.windows = move(gathered.windows);
+    x.verdictCache.endPass();
+
+    // the title bar stands in for the caption buttons, which the window manager draws in it
+    ThemeSizes theme;
+    for (auto const& w : desktop.windows)
+        if (auto window = x.queries.find(w.id)) theme.captionButtonHeight = (std::max)(theme.captionButtonHeight, int(window->frame.top));
+    if (theme.captionButtonHeight) desktop.theme = theme;
+
+    auto c = x.connection.get();
+    if (XcbReply<xcb_query_pointer_reply_t> pointer{ xcb_query_pointer_reply(c, xcb_query_pointer(c, x.connection.root()), nullptr) })
+        desktop.cursor = { pointer->root_x, pointer->root_y };
+    x.connection.roundTrip();
+    return desktop;
+}
+
+/// <returns>number of moved windows</returns>
+static size_t arrangePass(X11Desktop& x, bool force)
+{
+    auto passStart = SteadyClock::now();
+    auto tripsBefore = x.connection.roundTrips();
+    DesktopSnapshot desktop = takeDesktopSnapshot(x);
+    if (x.printSnapshots) writeSnapshot(cout, desktop);
+
+    // the rects the window manager settled on for the windows centered last time
+    for (auto w : x.centered)
+        if (auto window = desktop.findWindow(w)) x.layoutEngine.updateWindowRect(w, window->rect);
+    x.centered.clear();
+
+    // maximized windows refuse to move, the window manager takes the state back first
+    for (auto const& w : desktop.windows)
+        if (auto window = x.queries.find(w.id); window && window->maximized()) x.moves.unmaximize(w.id);
+
+    auto plan = x.layoutEngine.arrange(desktop, force);
+    if (!plan)
+    {
+        x.connection.flush();
+        logger().debug("Nothing to arrange, {} windows, {} round trips", desktop.windows.size(), x.connection.roundTrips() - tripsBefore);
+        return 0;
+    }
+
+    auto result = executeMovePlan(*plan, x.moves);
+    for (size_t i = 0; i < plan->size(); i++)
+    {
+        auto const& move = (*plan)[i];
+        if (result.status[i] == MoveStatus::failed) x.layoutEngine.markUnmovable(move.window);
+        else if (move.centered) x.centered.push_back(move.window);
+    }
+    chrono::duration<double, milli> elapsed = SteadyClock::now() - passStart;
+    logger().info("Moved {} windows, skipped {}, failed {} in {} ms, {} round trips", result.committed, result.skipped, result.failed,
+                  elapsed.count(), x.connection.roundTrips() - tripsBefore);
+    return result.committed;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* display = nullptr;
+    const char* rulesPath = nullptr;
+    bool once = false;
+    bool force = false;
+    bool printSnapshots = false;
+    LayoutSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        string_view arg = argv[i];
+        if (arg == "--display" && i + 1 < argc) display = argv[++i];
+        else if (arg == "--once") once = true;
+        else if (arg == "--force") force = true;
+        else if (arg == "--snapshot") printSnapshots = true;
+        else if (arg == "--rules" && i + 1 < argc) rulesPath = argv[++i];
+        else if (arg == "--debug") logger().setLevel(LogLevel::debug);
+        else if (arg == "--avoid-top-right") settings.avoidTopRightCorner = true;
+        else if (arg == "--no-touch-unit") settings.increaseUnitSizeForTouch = false;
+        else if (arg == "--max-increase" && i + 1 < argc) settings.maxIncrease = atoi(argv[++i]);
+        else if (arg == "--min-displacement") settings.cornerAssignment = CornerAssignment::minDisplacement;
+        else if (arg == "--only-occluded") settings.arrangeOnlyWhenOccluded = true;
+        else return usage();
+    }
+
+    string error;
+    auto connection = XcbConnection::connect(display, &error);
+    if (!connection)
+    {
+        cerr << error << endl;
+        return 1;
+    }
+    if (!connection->supports(Atom::netClientListStacking))
+    {
+        cerr << "the window manager does not support _NET_CLIENT_LIST_STACKING" << endl;
+        return 1;
+    }
+    X11Desktop x(*connection);
+    x.layoutEngine.settings = settings;
+    x.printSnapshots = printSnapshots;
+    if (rulesPath)
+    {
+        ifstream file(rulesPath);
+        stringstream text;
+        text << file.rdbuf();
+        auto filter = file ? WindowFilter::parse(text.str(), &error) : nullopt;
+        if (!filter)
+        {
+            cerr << rulesPath << ": " << (file ? error : "cannot open") << endl;
+            return 1;
+        }
+        x.filter = move(*filter);
+    }
+    if (!connection->supports(Atom::netMoveresizeWindow))
+        logger().warning("The window manager does not support _NET_MOVERESIZE_WINDOW, windows are configured directly");
+
+    if (once)
+    {
+        arrangePass(x, force);
+        logger().flush();
+        return 0;
+    }
+
+    ArrangeCoalescer coalescer;
+    x.eventsRunning = x.events.start([&](const WindowEvent& event, TimePoint now)
+    {
+        x.verdictCache.onEvent(event);
+        if (event.kind == WindowEventKind::displayChanged) x.topologyCache.invalidate(DisplayChange::display);
+        coalescer.onEvent(event, now);
+    });
+    signal(SIGINT, [](int) { interrupted = 1; });
+    signal(SIGTERM, [](int) { interrupted = 1; });
+
+    arrangePass(x, force);
+    while (!interrupted)
+    {
+        // replies awaited by the pass may have brought events along, which poll would not report
+        if (!x.events.dispatch())
+        {
+            logger().error("Connection to the X server lost");
+            break;
+        }
+        if (coalescer.poll(SteadyClock::now()))
+        {
+            arrangePass(x, false);
+            continue;
+        }
+        int timeout = -1;
+        if (auto deadline = coalescer.deadline())
+            timeout = int(chrono::ceil<chrono::milliseconds>((std::max)(*deadline - SteadyClock::now(), Duration::zero())).count());
+        pollfd fd{ x.connection.fd(), POLLIN, 0 };
+        poll(&fd, 1, timeout);
+    }
+    x.events.stop();
+    logger().flush();
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "x11displays.h"
+#ifdef LAZYCLICKER_RANDR
+#include <xcb/randr.h>
+#endif
+
+using namespace std;
+
+DisplayTopology X11TopologyProvider::query()
+{
+    auto c = connection.get();
+    auto workareaCookie = connection.requestProperty(connection.root(), connection.atom(Atom::netWorkarea), 4 * 64);
+    auto desktopCookie = connection.requestProperty(connection.root(), connection.atom(Atom::netCurrentDesktop), 1);
+    DisplayTopology topology;
+#ifdef LAZYCLICKER_RANDR
+    if (connection.hasMonitors())
+    {
+        XcbReply<xcb_randr_get_monitors_reply_t> reply{ xcb_randr_get_monitors_reply(c, xcb_randr_get_monitors(c, connection.root(), 1), nullptr) };
+        vector<xcb_get_atom_name_cookie_t> names;
+        for (auto it = reply ? xcb_randr_get_monitors_monitors_iterator(reply.get()) : xcb_randr_monitor_info_iterator_t{}; it.rem;
+             xcb_randr_monitor_info_next(&it))
+        {
+            MonitorInfo m;
+            m.id = it.data->name; // the atom naming the monitor, stable while it stays connected
+            m.rect = { it.data->x, it.data->y, it.data->x + it.data->width, it.data->y + it.data->height };
+            if (it.data->primary) topology.primary = m.id;
+            topology.monitors.push_back(m);
+            names.push_back(xcb_get_atom_name(c, it.data->name));
+        }
+        for (size_t i = 0; i < names.size(); i++)
+            if (XcbReply<xcb_get_atom_name_reply_t> name{ xcb_get_atom_name_reply(c, names[i], nullptr) })
+                topology.monitors[i].name.assign(xcb_get_atom_name_name(name.get()), size_t(xcb_get_atom_name_name_length(name.get())));
+        connection.roundTrip();
+    }
+#else
+    (void)c;
+#endif
+    if (topology.monitors.empty())
+    {
+        auto& screen = connection.defaultScreen();
+        MonitorInfo m;
+        m.id = screen.root;
+        m.rect = { 0, 0, screen.width_in_pixels, screen.height_in_pixels };
+        m.name = "screen";
+        topology.monitors.push_back(m);
+    }
+
+    auto workareas = connection.property(workareaCookie);
+    auto desktop = connection.property(desktopCookie);
+    connection.roundTrip();
+    size_t current = desktop.values.empty() ? 0 : desktop.values.front();
+    optional<Rect> workarea;
+    if (workareas.values.size() >= 4 * (current + 1))
+    {
+        auto v = workareas.values.data() + 4 * current;
+        workarea = Rect{ int32_t(v[0]), int32_t(v[1]), int32_t(v[0] + v[2]), int32_t(v[1] + v[3]) };
+    }
+    for (auto& m : topology.monitors)
+        if (!workarea || !Rect::intersect(m.workArea, m.rect, *workarea)) m.workArea = m.rect;
+
+    // the first monitor is the primary one when RandR names none
+    if (!topology.findMonitor(topology.primary)) topology.primary = topology.monitors.front().id;
+    return topology;
+}
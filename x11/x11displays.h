@@ -0,0 +1,21 @@
+#ifndef X11DISPLAYS_H
+#define X11DISPLAYS_H
+#include "engine/displaytopology.h"
+#include "xcbconnection.h"
+
+/// <summary>
+/// Monitors through RandR 1.5 GetMonitors, or the whole screen as one monitor without it. The work area of a monitor
+/// is its intersection with _NET_WORKAREA of the current desktop, which EWMH defines for all monitors together.
+/// X11 scales applications with one global DPI, so every monitor reports 96 and the unit sizes stay unscaled.
+/// </summary>
+class X11TopologyProvider : public DisplayTopologyProvider
+{
+public:
+    explicit X11TopologyProvider(XcbConnection& connection) : connection(connection) {}
+    DisplayTopology query() override;
+
+private:
+    XcbConnection& connection;
+};
+
+#endif // X11DISPLAYS_H
@@ -0,0 +1,119 @@
+#include "x11events.h"
+#ifdef LAZYCLICKER_RANDR
+#include <xcb/randr.h>
+#endif
+
+using namespace std;
+
+constexpr uint32_t clientEvents = XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
+
+bool X11EventSource::start(Sink s)
+{
+    if (!connection.ok()) return false;
+    sink = move(s);
+    const uint32_t rootEvents[] = { XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE };
+    xcb_change_window_attributes(connection.get(), connection.root(), XCB_CW_EVENT_MASK, rootEvents);
+#ifdef LAZYCLICKER_RANDR
+    if (connection.hasMonitors())
+    {
+        randrEvent = xcb_get_extension_data(connection.get(), &xcb_randr_id)->first_event;
+        xcb_randr_select_input(connection.get(), connection.root(), XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE);
+    }
+#endif
+    connection.flush();
+    return true;
+}
+
+void X11EventSource::stop()
+{
+    if (!sink) return;
+    // other clients may still be selecting events of their own on these windows, only ours are removed
+    const uint32_t none[] = { XCB_EVENT_MASK_NO_EVENT };
+    xcb_change_window_attributes(connection.get(), connection.root(), XCB_CW_EVENT_MASK, none);
+    for (auto w : watched) xcb_change_window_attributes(connection.get(), xcb_window_t(w), XCB_CW_EVENT_MASK, none);
+    connection.flush();
+    watched.clear();
+    sink = nullptr;
+}
+
+void X11EventSource::watch(const vector<WindowId>& clients)
+{
+    if (!sink) return;
+    set<WindowId> current(clients.begin(), clients.end());
+    for (auto w : current)
+        if (!watched.contains(w))
+            xcb_change_window_attributes(connection.get(), xcb_window_t(w), XCB_CW_EVENT_MASK, &clientEvents);
+    // closed windows are gone with their selections, the others stopped being managed
+    const uint32_t none[] = { XCB_EVENT_MASK_NO_EVENT };
+    for (auto w : watched)
+        if (!current.contains(w)) xcb_change_window_attributes(connection.get(), xcb_window_t(w), XCB_CW_EVENT_MASK, none);
+    watched = move(current);
+    connection.flush();
+}
+
+bool X11EventSource::dispatch()
+{
+    while (XcbReply<xcb_generic_event_t> event{ xcb_poll_for_event(connection.get()) }) handle(*event);
+    return connection.ok();
+}
+
+void X11EventSource::deliver(WindowEventKind kind, WindowId w)
+{
+    if (sink) sink({ kind, w }, SteadyClock::now());
+}
+
+void X11EventSource::handle(const xcb_generic_event_t& event)
+{
+    using enum WindowEventKind;
+    auto root = connection.root();
+    auto type = event.response_type & 0x7f; // the high bit marks events sent by other clients
+#ifdef LAZYCLICKER_RANDR
+    if (randrEvent && type == randrEvent + XCB_RANDR_SCREEN_CHANGE_NOTIFY)
+    {
+        deliver(displayChanged, 0);
+        return;
+    }
+#endif
+    switch (type)
+    {
+    case XCB_PROPERTY_NOTIFY:
+    {
+        auto& e = reinterpret_cast<const xcb_property_notify_event_t&>(event);
+        if (e.window == root)
+        {
+            // new and closed windows show in the client list first, their own events follow once watched
+            if (e.atom == connection.atom(Atom::netClientListStacking)) deliver(created, 0);
+            else if (e.atom == connection.atom(Atom::netWorkarea) || e.atom == connection.atom(Atom::netCurrentDesktop))
+                deliver(displayChanged, 0);
+        }
+        else if (e.atom == XCB_ATOM_WM_NAME || e.atom == connection.atom(Atom::netWmName)) deliver(nameChanged, e.window);
+        else if (e.atom == XCB_ATOM_WM_TRANSIENT_FOR) deliver(ownerChanged, e.window);
+        else if (e.atom == connection.atom(Atom::netWmState) || e.atom == connection.atom(Atom::netWmWindowType))
+            deliver(restored, e.window); // style bits changed, the verdict is taken again
+        else if (e.atom == connection.atom(Atom::netFrameExtents)) deliver(locationChanged, e.window);
+        break;
+    }
+    case XCB_CONFIGURE_NOTIFY:
+    {
+        auto& e = reinterpret_cast<const xcb_configure_notify_event_t&>(event);
+        deliver(e.window == root ? displayChanged : locationChanged, e.window == root ? 0 : e.window);
+        break;
+    }
+    case XCB_MAP_NOTIFY:
+        deliver(shown, reinterpret_cast<const xcb_map_notify_event_t&>(event).window);
+        break;
+    case XCB_UNMAP_NOTIFY:
+        deliver(hidden, reinterpret_cast<const xcb_unmap_notify_event_t&>(event).window);
+        break;
+    case XCB_DESTROY_NOTIFY:
+    {
+        auto w = reinterpret_cast<const xcb_destroy_notify_event_t&>(event).window;
+        watched.erase(w);
+        deliver(destroyed, w);
+        break;
+    }
+    default:
+        // errors of requests whose replies nobody awaits, e.g. moves of windows closed meanwhile
+        break;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef X11EVENTS_H
+#define X11EVENTS_H
+#include "engine/eventcoalescer.h"
+#include "xcbconnection.h"
+#include <set>
+
+/// <summary>
+/// Window notifications from the X server. The root window reports new and closed windows through
+/// _NET_CLIENT_LIST_STACKING and display changes through RandR, _NET_WORKAREA and its own geometry; client windows
+/// are watched once watch lists them. Events are read on the connection, so the owner of the connection calls
+/// dispatch whenever its descriptor is readable and after every batch of replies, which may have queued events.
+/// </summary>
+class X11EventSource : public WindowEventSource
+{
+public:
+    explicit X11EventSource(XcbConnection& connection) : connection(connection) {}
+    ~X11EventSource() override { stop(); }
+    bool start(Sink sink) override;
+    void stop() override;
+    /// <summary>
+    /// Select the events of the client windows not watched yet and forget the ones no longer listed
+    /// </summary>
+    void watch(const std::vector<WindowId>& clients);
+    /// <summary>
+    /// Deliver the events received so far without blocking
+    /// </summary>
+    /// <returns>the connection is still usable</returns>
+    bool dispatch();
+
+private:
+    void deliver(WindowEventKind kind, WindowId w);
+    void handle(const xcb_generic_event_t& event);
+
+    XcbConnection& connection;
+    std::set<WindowId> watched;
+    std::uint8_t randrEvent = 0; ///< first event of the extension, 0 without RandR
+    Sink sink;
+};
+
+#endif // X11EVENTS_H
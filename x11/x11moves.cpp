@@ -0,0 +1,67 @@
+#include "x11moves.h"
+
+using namespace std;
+
+// _NET_MOVERESIZE_WINDOW: gravity in bits 0-7, x, y, width and height present in bits 8-11,
+// the source in bits 12-15, 2 for pagers and other tools acting for the user
+constexpr uint32_t staticGravity = XCB_GRAVITY_STATIC;
+constexpr uint32_t moveResizeAll = 0xF00;
+constexpr uint32_t sourceTool = 2 << 12;
+
+// _NET_WM_STATE actions
+constexpr uint32_t stateRemove = 0;
+
+optional<Rect> X11MoveBackend::currentRect(WindowId w)
+{
+    auto window = queries.find(w);
+    if (!window) return nullopt;
+    return window->rect();
+}
+
+bool X11MoveBackend::send(const WindowMove& move)
+{
+    auto window = queries.find(move.window);
+    if (!window) return false;
+    // the target is the frame, the window manager wants the client rect
+    auto const& f = window->frame;
+    int32_t x = move.rect.left + f.left;
+    int32_t y = move.rect.top + f.top;
+    auto width = uint32_t((std::max)(1, move.rect.width() - f.left - f.right));
+    auto height = uint32_t((std::max)(1, move.rect.height() - f.top - f.bottom));
+    if (connection.supports(Atom::netMoveresizeWindow))
+    {
+        // static gravity places the client itself at x, y no matter how the frame is decorated
+        connection.sendRootMessage(xcb_window_t(move.window), Atom::netMoveresizeWindow,
+                                   { staticGravity | moveResizeAll | sourceTool, uint32_t(x), uint32_t(y), width, height });
+    }
+    else
+    {
+        // ICCCM: with the default north-west gravity a configure request positions the frame
+        const uint32_t values[] = { uint32_t(move.rect.left), uint32_t(move.rect.top), width, height };
+        xcb_configure_window(connection.get(), xcb_window_t(move.window),
+                             XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, values);
+    }
+    return true;
+}
+
+bool X11MoveBackend::moveBatch(const vector<WindowMove>& moves)
+{
+    // the window manager applies the requests in order, unknown windows are the only failure noticed here
+    bool all = true;
+    for (auto const& move : moves) all = send(move) && all;
+    connection.flush();
+    return all;
+}
+
+bool X11MoveBackend::moveWindow(const WindowMove& move)
+{
+    bool sent = send(move);
+    connection.flush();
+    return sent;
+}
+
+void X11MoveBackend::unmaximize(WindowId w)
+{
+    connection.sendRootMessage(xcb_window_t(w), Atom::netWmState,
+                               { stateRemove, connection.atom(Atom::netWmStateMaximizedVert), connection.atom(Atom::netWmStateMaximizedHorz), sourceTool >> 12, 0 });
+}
@@ -0,0 +1,33 @@
+#ifndef X11MOVES_H
+#define X11MOVES_H
+#include "engine/moveexecutor.h"
+#include "x11queries.h"
+
+/// <summary>
+/// Moves windows by asking the window manager with _NET_MOVERESIZE_WINDOW, or by configuring the client window
+/// when the window manager does not support it. Requests are only flushed, never awaited: a batch of moves costs
+/// no round trip and a window whose client hangs cannot block it. The current rects are the ones the queries
+/// read at the start of the pass.
+/// </summary>
+class X11MoveBackend : public WindowMoveBackend
+{
+public:
+    X11MoveBackend(XcbConnection& connection, X11WindowQueries& queries) : connection(connection), queries(queries) {}
+
+    std::optional<Rect> currentRect(WindowId w) override;
+    bool moveBatch(const std::vector<WindowMove>& moves) override;
+    bool moveWindow(const WindowMove& move) override;
+    /// <summary>
+    /// Ask the window manager to take back the maximization, the window keeps its rect until it is moved
+    /// </summary>
+    void unmaximize(WindowId w);
+
+private:
+    /// <returns>the window is known</returns>
+    bool send(const WindowMove& move);
+
+    XcbConnection& connection;
+    X11WindowQueries& queries;
+};
+
+#endif // X11MOVES_H
@@ -0,0 +1,165 @@
+#include "x11queries.h"
+#include <algorithm>
+
+using namespace std;
+
+static uint32_t atomBits(const XcbConnection& connection, const vector<uint32_t>& atoms, const pair<Atom, uint32_t>* table, size_t count)
+{
+    uint32_t bits = 0;
+    for (auto a : atoms)
+        for (size_t i = 0; i < count; i++)
+            if (a == connection.atom(table[i].first)) bits |= table[i].second;
+    return bits;
+}
+
+static constexpr pair<Atom, uint32_t> stateBits[] = {
+    { Atom::netWmStateHidden, wmStateHidden },
+    { Atom::netWmStateMaximizedVert, wmStateMaximizedVert },
+    { Atom::netWmStateMaximizedHorz, wmStateMaximizedHorz },
+    { Atom::netWmStateFullscreen, wmStateFullscreen },
+    { Atom::netWmStateSkipTaskbar, wmStateSkipTaskbar },
+    { Atom::netWmStateShaded, wmStateShaded },
+    { Atom::netWmStateModal, wmStateModal },
+    { Atom::netWmStateAbove, wmStateAbove },
+    { Atom::netWmStateSticky, wmStateSticky },
+};
+
+static constexpr pair<Atom, uint32_t> typeBits[] = {
+    { Atom::netWmWindowTypeNormal, wmTypeNormal },
+    { Atom::netWmWindowTypeDialog, wmTypeDialog },
+    { Atom::netWmWindowTypeUtility, wmTypeUtility },
+    { Atom::netWmWindowTypeToolbar, wmTypeToolbar },
+    { Atom::netWmWindowTypeMenu, wmTypeMenu },
+    { Atom::netWmWindowTypeSplash, wmTypeSplash },
+    { Atom::netWmWindowTypeDock, wmTypeDock },
+    { Atom::netWmWindowTypeDesktop, wmTypeDesktop },
+    { Atom::netWmWindowTypeNotification, wmTypeNotification },
+};
+
+vector<WindowId> X11WindowQueries::clientList()
+{
+    auto list = connection.property(connection.requestProperty(connection.root(), connection.atom(Atom::netClientListStacking), 65536));
+    connection.roundTrip();
+    // the stacking order is bottom to top
+    return vector<WindowId>(list.values.rbegin(), list.values.rend());
+}
+
+X11WindowQueries::Geometry X11WindowQueries::requestGeometry(xcb_window_t w)
+{
+    auto c = connection.get();
+    return { xcb_get_geometry(c, w), xcb_translate_coordinates(c, w, connection.root(), 0, 0),
+             connection.requestProperty(w, connection.atom(Atom::netFrameExtents), 4) };
+}
+
+bool X11WindowQueries::readGeometry(const Geometry& cookies, X11Window& window)
+{
+    auto c = connection.get();
+    XcbReply<xcb_get_geometry_reply_t> geometry{ xcb_get_geometry_reply(c, cookies.geometry, nullptr) };
+    XcbReply<xcb_translate_coordinates_reply_t> origin{ xcb_translate_coordinates_reply(c, cookies.origin, nullptr) };
+    auto extents = connection.property(cookies.extents);
+    if (!geometry || !origin) return false;
+    window.client = { origin->dst_x, origin->dst_y, origin->dst_x + geometry->width, origin->dst_y + geometry->height };
+    if (extents.values.size() == 4)
+        window.frame = { int32_t(extents.values[0]), int32_t(extents.values[1]), int32_t(extents.values[2]), int32_t(extents.values[3]) };
+    else window.frame = {};
+    return true;
+}
+
+void X11WindowQueries::prefetch(const vector<WindowId>& handles)
+{
+    struct Cookies
+    {
+        Geometry geometry;
+        xcb_get_window_attributes_cookie_t attributes;
+        xcb_get_property_cookie_t state, type, name, legacyName, pid, wmClass, transientFor, actions;
+    };
+
+    // every request goes out before the first reply is awaited
+    auto c = connection.get();
+    vector<Cookies> cookies;
+    cookies.reserve(handles.size());
+    for (auto handle : handles)
+    {
+        auto w = xcb_window_t(handle);
+        cookies.push_back({ requestGeometry(w),
+                            xcb_get_window_attributes(c, w),
+                            connection.requestProperty(w, connection.atom(Atom::netWmState), 32),
+                            connection.requestProperty(w, connection.atom(Atom::netWmWindowType), 32),
+                            connection.requestProperty(w, connection.atom(Atom::netWmName), 256),
+                            connection.requestProperty(w, XCB_ATOM_WM_NAME, 256),
+                            connection.requestProperty(w, connection.atom(Atom::netWmPid), 1),
+                            connection.requestProperty(w, XCB_ATOM_WM_CLASS, 128),
+                            connection.requestProperty(w, XCB_ATOM_WM_TRANSIENT_FOR, 1),
+                            connection.requestProperty(w, connection.atom(Atom::netWmAllowedActions), 64) });
+    }
+
+    windows.clear();
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        auto& r = cookies[i];
+        X11Window window;
+        XcbReply<xcb_get_window_attributes_reply_t> attributes{ xcb_get_window_attributes_reply(c, r.attributes, nullptr) };
+        auto state = connection.property(r.state);
+        auto type = connection.property(r.type);
+        auto name = connection.property(r.name);
+        auto legacyName = connection.property(r.legacyName);
+        auto pid = connection.property(r.pid);
+        auto wmClass = connection.property(r.wmClass);
+        auto transientFor = connection.property(r.transientFor);
+        auto actions = connection.property(r.actions);
+        if (!readGeometry(r.geometry, window) || !attributes) continue; // destroyed since it was listed
+
+        window.viewable = attributes->map_state == XCB_MAP_STATE_VIEWABLE;
+        window.state = atomBits(connection, state.values, stateBits, size(stateBits));
+        window.type = atomBits(connection, type.values, typeBits, size(typeBits));
+        // ICCCM: a window without a type is normal, or a dialog when it is transient
+        if (type.values.empty()) window.type = transientFor.values.empty() ? wmTypeNormal : wmTypeDialog;
+        window.title = !name.text.empty() ? move(name.text) : move(legacyName.text);
+        if (!pid.values.empty()) window.pid = pid.values.front();
+        // WM_CLASS holds the instance and the class, each terminated by nul
+        if (auto instanceEnd = wmClass.text.find('\0'); instanceEnd != string::npos)
+            window.className = wmClass.text.substr(instanceEnd + 1, wmClass.text.find('\0', instanceEnd + 1) - instanceEnd - 1);
+        if (!transientFor.values.empty()) window.transientFor = transientFor.values.front();
+        if (actions.type != XCB_ATOM_NONE)
+        {
+            auto allowed = [&](Atom a) { return std::find(actions.values.begin(), actions.values.end(), connection.atom(a)) != actions.values.end(); };
+            window.maximizable = allowed(Atom::netWmActionMaximizeHorz) && allowed(Atom::netWmActionMaximizeVert);
+        }
+        windows.emplace(handles[i], move(window));
+    }
+    connection.roundTrip();
+}
+
+const X11Window* X11WindowQueries::find(WindowId w) const
+{
+    auto it = windows.find(w);
+    return it == windows.end() ? nullptr : &it->second;
+}
+
+optional<WindowProbe> X11WindowQueries::probe(WindowId w)
+{
+    // iconified windows are unmapped or hidden, shaded ones show nothing but their title bar
+    auto window = find(w);
+    if (!window || !window->viewable || (window->state & (wmStateHidden | wmStateShaded))) return nullopt;
+    return WindowProbe{ { window->state, window->type, window->transientFor }, window->rect(), window->maximizable };
+}
+
+string X11WindowQueries::className(WindowId w)
+{
+    auto window = find(w);
+    return window ? window->className : string();
+}
+
+WindowVerdict X11WindowQueries::classify(WindowId w)
+{
+    // the windows a taskbar would show: normal windows and dialogs which are neither fullscreen nor skipped
+    WindowVerdict verdict;
+    auto window = find(w);
+    if (!window || !(window->type & (wmTypeNormal | wmTypeDialog))) return verdict;
+    if (window->state & (wmStateFullscreen | wmStateSkipTaskbar)) return verdict;
+    if (window->title.empty()) return verdict;
+    verdict.pid = window->pid;
+    verdict.title = window->title;
+    verdict.eligible = true;
+    return verdict;
+}
@@ -0,0 +1,103 @@
+#ifndef X11QUERIES_H
+#define X11QUERIES_H
+#include "engine/windowgather.h"
+#include "xcbconnection.h"
+#include <unordered_map>
+
+/// _NET_WM_STATE atoms as bits, the style of a window on X11; window rules test them with style=
+enum WmStateBit : std::uint32_t
+{
+    wmStateHidden = 0x1,
+    wmStateMaximizedVert = 0x2,
+    wmStateMaximizedHorz = 0x4,
+    wmStateFullscreen = 0x8,
+    wmStateSkipTaskbar = 0x10,
+    wmStateShaded = 0x20,
+    wmStateModal = 0x40,
+    wmStateAbove = 0x80,
+    wmStateSticky = 0x100,
+};
+
+/// _NET_WM_WINDOW_TYPE atoms as bits, the extended style of a window on X11; window rules test them with exstyle=
+enum WmTypeBit : std::uint32_t
+{
+    wmTypeNormal = 0x1,
+    wmTypeDialog = 0x2,
+    wmTypeUtility = 0x4,
+    wmTypeToolbar = 0x8,
+    wmTypeMenu = 0x10,
+    wmTypeSplash = 0x20,
+    wmTypeDock = 0x40,
+    wmTypeDesktop = 0x80,
+    wmTypeNotification = 0x100,
+};
+
+/// <summary>
+/// Decoration the window manager adds around a client window (_NET_FRAME_EXTENTS)
+/// </summary>
+struct FrameExtents
+{
+    std::int32_t left = 0, right = 0, top = 0, bottom = 0;
+};
+
+/// <summary>
+/// What one batch of requests tells about a client window
+/// </summary>
+struct X11Window
+{
+    Rect client;         ///< root coordinates
+    FrameExtents frame;
+    std::uint32_t state = 0; ///< WmStateBit
+    std::uint32_t type = 0;  ///< WmTypeBit
+    WindowId transientFor = 0;
+    ProcessId pid = 0;
+    std::string title;
+    std::string className; ///< the class part of WM_CLASS
+    bool viewable = false;
+    bool maximizable = true;
+
+    /// the window with its decoration, the rect the layout works with
+    Rect rect() const { return { client.left - frame.left, client.top - frame.top, client.right + frame.right, client.bottom + frame.bottom }; }
+    bool maximized() const { return state & (wmStateMaximizedVert | wmStateMaximizedHorz); }
+};
+
+/// <summary>
+/// Client windows of an EWMH window manager. The properties of all windows are requested in one pipelined batch
+/// by prefetch and answered from memory afterwards, so the queries may run on the threads of gatherWindows
+/// while the connection is used by nobody else.
+/// </summary>
+class X11WindowQueries : public WindowQueryBackend
+{
+public:
+    explicit X11WindowQueries(XcbConnection& connection) : connection(connection) {}
+
+    /// <returns>managed windows from _NET_CLIENT_LIST_STACKING, topmost first</returns>
+    std::vector<WindowId> clientList();
+    /// <summary>
+    /// Read the properties, geometry and attributes of the windows in a single round trip, forgetting all other windows
+    /// </summary>
+    void prefetch(const std::vector<WindowId>& handles);
+    /// <returns>nullptr for windows not prefetched or gone</returns>
+    const X11Window* find(WindowId w) const;
+
+    std::optional<WindowProbe> probe(WindowId w) override;
+    std::string className(WindowId w) override;
+    WindowVerdict classify(WindowId w) override;
+
+private:
+    struct Geometry
+    {
+        xcb_get_geometry_cookie_t geometry;
+        xcb_translate_coordinates_cookie_t origin;
+        xcb_get_property_cookie_t extents;
+    };
+
+    Geometry requestGeometry(xcb_window_t w);
+    /// <returns>the window is gone</returns>
+    bool readGeometry(const Geometry& cookies, X11Window& window);
+
+    XcbConnection& connection;
+    std::unordered_map<WindowId, X11Window> windows;
+};
+
+#endif // X11QUERIES_H
@@ -0,0 +1,138 @@
+#include "xcbconnection.h"
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#ifdef LAZYCLICKER_RANDR
+#include <xcb/randr.h>
+#endif
+
+using namespace std;
+
+static constexpr const char* atomNames[atomCount] = {
+    "UTF8_STRING",
+    "_NET_SUPPORTED",
+    "_NET_CLIENT_LIST_STACKING",
+    "_NET_WORKAREA",
+    "_NET_CURRENT_DESKTOP",
+    "_NET_ACTIVE_WINDOW",
+    "_NET_WM_NAME",
+    "_NET_WM_PID",
+    "_NET_WM_STATE",
+    "_NET_WM_STATE_HIDDEN",
+    "_NET_WM_STATE_MAXIMIZED_VERT",
+    "_NET_WM_STATE_MAXIMIZED_HORZ",
+    "_NET_WM_STATE_FULLSCREEN",
+    "_NET_WM_STATE_SKIP_TASKBAR",
+    "_NET_WM_STATE_SHADED",
+    "_NET_WM_STATE_MODAL",
+    "_NET_WM_STATE_ABOVE",
+    "_NET_WM_STATE_STICKY",
+    "_NET_WM_WINDOW_TYPE",
+    "_NET_WM_WINDOW_TYPE_NORMAL",
+    "_NET_WM_WINDOW_TYPE_DIALOG",
+    "_NET_WM_WINDOW_TYPE_UTILITY",
+    "_NET_WM_WINDOW_TYPE_TOOLBAR",
+    "_NET_WM_WINDOW_TYPE_MENU",
+    "_NET_WM_WINDOW_TYPE_SPLASH",
+    "_NET_WM_WINDOW_TYPE_DOCK",
+    "_NET_WM_WINDOW_TYPE_DESKTOP",
+    "_NET_WM_WINDOW_TYPE_NOTIFICATION",
+    "_NET_WM_ALLOWED_ACTIONS",
+    "_NET_WM_ACTION_MAXIMIZE_HORZ",
+    "_NET_WM_ACTION_MAXIMIZE_VERT",
+    "_NET_FRAME_EXTENTS",
+    "_NET_MOVERESIZE_WINDOW",
+};
+
+unique_ptr<XcbConnection> XcbConnection::connect(const char* display, string* error)
+{
+    int screenNumber = 0;
+    auto c = xcb_connect(display, &screenNumber);
+    if (xcb_connection_has_error(c))
+    {
+        xcb_disconnect(c);
+        if (!display) display = getenv("DISPLAY");
+        if (error) *error = string("cannot open display ") + (display ? display : "(DISPLAY not set)");
+        return {};
+    }
+    auto screens = xcb_setup_roots_iterator(xcb_get_setup(c));
+    for (int i = 0; i < screenNumber && screens.rem; i++) xcb_screen_next(&screens);
+    if (!screens.rem)
+    {
+        xcb_disconnect(c);
+        if (error) *error = "no screen " + to_string(screenNumber);
+        return {};
+    }
+    unique_ptr<XcbConnection> connection(new XcbConnection(c, screens.data));
+
+    // all atoms and the extension in one round trip
+    array<xcb_intern_atom_cookie_t, atomCount> cookies;
+    for (int i = 0; i < atomCount; i++) cookies[i] = xcb_intern_atom(c, 0, uint16_t(strlen(atomNames[i])), atomNames[i]);
+#ifdef LAZYCLICKER_RANDR
+    auto randr = xcb_get_extension_data(c, &xcb_randr_id);
+    auto versionCookie = randr && randr->present ? optional(xcb_randr_query_version(c, 1, 5)) : nullopt;
+#endif
+    for (int i = 0; i < atomCount; i++)
+        if (XcbReply<xcb_intern_atom_reply_t> reply{ xcb_intern_atom_reply(c, cookies[i], nullptr) })
+            connection->atoms[i] = reply->atom;
+#ifdef LAZYCLICKER_RANDR
+    if (versionCookie)
+        if (XcbReply<xcb_randr_query_version_reply_t> version{ xcb_randr_query_version_reply(c, *versionCookie, nullptr) })
+            connection->monitors = version->major_version > 1 || (version->major_version == 1 && version->minor_version >= 5);
+#endif
+    connection->roundTrip();
+
+    auto supported = connection->property(connection->requestProperty(connection->root(), connection->atom(Atom::netSupported), 4096));
+    connection->supported = move(supported.values);
+    sort(connection->supported.begin(), connection->supported.end());
+    connection->roundTrip();
+    return connection;
+}
+
+XcbConnection::~XcbConnection()
+{
+    xcb_disconnect(connection);
+}
+
+bool XcbConnection::supports(Atom a) const
+{
+    return binary_search(supported.begin(), supported.end(), atom(a));
+}
+
+xcb_get_property_cookie_t XcbConnection::requestProperty(xcb_window_t w, xcb_atom_t property, uint32_t maxWords)
+{
+    return xcb_get_property(connection, 0, w, property, XCB_GET_PROPERTY_TYPE_ANY, 0, maxWords);
+}
+
+XcbProperty XcbConnection::property(xcb_get_property_cookie_t cookie)
+{
+    XcbProperty result;
+    XcbReply<xcb_get_property_reply_t> reply{ xcb_get_property_reply(connection, cookie, nullptr) };
+    if (!reply || reply->type == XCB_ATOM_NONE) return result;
+    result.type = reply->type;
+    auto data = xcb_get_property_value(reply.get());
+    auto length = xcb_get_property_value_length(reply.get());
+    if (reply->format == 32)
+    {
+        auto words = static_cast<const uint32_t*>(data);
+        result.values.assign(words, words + length / 4);
+    }
+    else if (reply->format == 8)
+    {
+        // lists of strings such as WM_CLASS are separated by nul characters, kept as they are
+        result.text.assign(static_cast<const char*>(data), size_t(length));
+    }
+    return result;
+}
+
+void XcbConnection::sendRootMessage(xcb_window_t w, Atom type, const array<uint32_t, 5>& data)
+{
+    xcb_client_message_event_t event{};
+    event.response_type = XCB_CLIENT_MESSAGE;
+    event.format = 32;
+    event.window = w;
+    event.type = atom(type);
+    copy(data.begin(), data.end(), event.data.data32);
+    xcb_send_event(connection, 0, root(), XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY,
+                   reinterpret_cast<const char*>(&event));
+}
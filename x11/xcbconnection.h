@@ -0,0 +1,122 @@
+#ifndef XCBCONNECTION_H
+#define XCBCONNECTION_H
+#include <xcb/xcb.h>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// EWMH atoms, interned together when connecting. Atoms of the core protocol (WM_NAME, WM_CLASS, ...) are predefined.
+/// </summary>
+enum class Atom : int
+{
+    utf8String,
+    netSupported,
+    netClientListStacking,
+    netWorkarea,
+    netCurrentDesktop,
+    netActiveWindow,
+    netWmName,
+    netWmPid,
+    netWmState,
+    netWmStateHidden,
+    netWmStateMaximizedVert,
+    netWmStateMaximizedHorz,
+    netWmStateFullscreen,
+    netWmStateSkipTaskbar,
+    netWmStateShaded,
+    netWmStateModal,
+    netWmStateAbove,
+    netWmStateSticky,
+    netWmWindowType,
+    netWmWindowTypeNormal,
+    netWmWindowTypeDialog,
+    netWmWindowTypeUtility,
+    netWmWindowTypeToolbar,
+    netWmWindowTypeMenu,
+    netWmWindowTypeSplash,
+    netWmWindowTypeDock,
+    netWmWindowTypeDesktop,
+    netWmWindowTypeNotification,
+    netWmAllowedActions,
+    netWmActionMaximizeHorz,
+    netWmActionMaximizeVert,
+    netFrameExtents,
+    netMoveresizeWindow,
+};
+constexpr int atomCount = int(Atom::netMoveresizeWindow) + 1;
+
+/// frees the replies of xcb, which are allocated with malloc
+struct XcbFree
+{
+    void operator()(void* p) const { std::free(p); }
+};
+template<typename T> using XcbReply = std::unique_ptr<T, XcbFree>;
+
+/// <summary>
+/// Value of a window property, 32 bit formats as numbers and 8 bit formats as text
+/// </summary>
+struct XcbProperty
+{
+    xcb_atom_t type = XCB_ATOM_NONE;
+    std::vector<std::uint32_t> values;
+    std::string text;
+};
+
+/// <summary>
+/// Connection to the X server with the root window of the default screen and the interned atoms.
+/// Requests return cookies at once; callers send every request of a batch before waiting for the first reply,
+/// so a batch costs a single round trip. xcb is thread-safe, but the window manager sees the requests in order
+/// only when one thread sends them.
+/// </summary>
+class XcbConnection
+{
+public:
+    /// <param name="display">nullptr for $DISPLAY</param>
+    /// <returns>nothing if the server cannot be reached, which is described in error</returns>
+    static std::unique_ptr<XcbConnection> connect(const char* display = nullptr, std::string* error = nullptr);
+    ~XcbConnection();
+    XcbConnection(const XcbConnection&) = delete;
+    XcbConnection& operator=(const XcbConnection&) = delete;
+
+    xcb_connection_t* get() const { return connection; }
+    xcb_window_t root() const { return screen->root; }
+    const xcb_screen_t& defaultScreen() const { return *screen; }
+    xcb_atom_t atom(Atom a) const { return atoms[int(a)]; }
+    /// the window manager lists the atom in _NET_SUPPORTED
+    bool supports(Atom a) const;
+    /// RandR 1.5 monitors are available
+    bool hasMonitors() const { return monitors; }
+    int fd() const { return xcb_get_file_descriptor(connection); }
+    bool ok() const { return !xcb_connection_has_error(connection); }
+    void flush() { xcb_flush(connection); }
+
+    xcb_get_property_cookie_t requestProperty(xcb_window_t w, xcb_atom_t property, std::uint32_t maxWords = 1024);
+    /// <returns>an empty property if it is missing or the window is gone</returns>
+    XcbProperty property(xcb_get_property_cookie_t cookie);
+    /// <summary>
+    /// Send a client message to the root window, as EWMH wants it for requests to the window manager
+    /// </summary>
+    void sendRootMessage(xcb_window_t w, Atom type, const std::array<std::uint32_t, 5>& data);
+
+    /// <summary>
+    /// Count a batch whose replies are awaited, so a pass can report its round trips
+    /// </summary>
+    void roundTrip() { trips++; }
+    std::size_t roundTrips() const { return trips; }
+
+private:
+    XcbConnection(xcb_connection_t* connection, xcb_screen_t* screen) : connection(connection), screen(screen) {}
+
+    xcb_connection_t* connection;
+    xcb_screen_t* screen;
+    std::array<xcb_atom_t, atomCount> atoms{};
+    std::vector<xcb_atom_t> supported; ///< sorted
+    bool monitors = false;
+    std::size_t trips = 0;
+};
+
+#endif // XCBCONNECTION_H